@@ -2,27 +2,124 @@
 
 #include "ast.h"
 #include "lib/mem.h"
+#include "lib/matrix.h"
+#include "lib/sort.h"
+#include "lib/vmath.h"
+#include "lib/bitset.h"
+#include "lib/binio.h"
+#include "lib/input.h"
+#include "lib/csv.h"
+#include "lib/pool.h"
+#include "lib/chan.h"
+#include "lib/simd.h"
 #include <stdbool.h>
 #include <math.h>
 #include <limits.h>
 #include <float.h>
 #include <stdint.h>
 #include <stdio.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <stdatomic.h>
 
-JumpBuffer *jump_buffer = {0};
+_Thread_local JumpBuffer *jump_buffer = {0};
 
-Function *function_table = NULL;
-ReturnValue current_return_value;
-Arena arena;
+_Thread_local Interpreter *current_interpreter;
+_Thread_local ReturnValue current_return_value;
 
-TypeModifiers current_modifiers = {false, false, false, false, false};
 extern VarType current_var_type;
 
-Scope *current_scope;
+_Thread_local Scope *current_scope;
+_Thread_local FILE *yap_stream;
+
+// Where interpreter_exit unwinds to on this thread: the top of a run, a
+// parse, or the squad slice or spawned call being run
+static _Thread_local jmp_buf *exit_point;
+
+// bison and flex keep their state in globals, so one program parses at a time
+static pthread_mutex_t parse_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/*
+ * spawn runs a user function as a pool task. Its arguments are evaluated
+ * at once in the spawning frame, and the result is stored into the target
+ * when the frame syncs: at sync, when the function returns, or when the
+ * scope holding the target closes. A task starts from an empty scope chain
+ * on whichever thread runs it, the same as any call starts from a fresh
+ * function scope.
+ */
+typedef struct SpawnTask
+{
+    Interpreter *interpreter;
+    Function *func;
+    Value *values;           // evaluated arguments
+    Variable **arrays;       // array arguments, pointing into array_storage
+    Variable *array_storage; // copies of the caller's array views
+    int count;
+    FILE *stream;            // the spawner's yap_stream
+    ReturnValue result;
+    Scope *scope;            // scope holding the target, NULL if there is none
+    const char *name;        // scalar target
+    void *element;           // array element target...
+    VarType element_type;    // ...and its type
+    struct SpawnTask *next;
+} SpawnTask;
+
+// Calls spawned by one function call, in spawn order
+typedef struct
+{
+    PoolGroup group;
+    SpawnTask *first;
+    SpawnTask *last;
+    Scope **pinned; // scopes whose variables pending calls use
+    size_t num_pinned;
+    size_t pinned_capacity;
+    Variable **pinned_arrays; // arrays pending calls use or store into
+    size_t num_pinned_arrays;
+    size_t pinned_arrays_capacity;
+} SpawnFrame;
+
+static _Thread_local SpawnFrame *spawn_frame;
+
+/*
+ * Runs fn(ctx, index) so that an error or ragequit inside it stops here
+ * rather than at the top of the program, and returns false if one did.
+ * Scopes the failed code left open are not freed, since calls it spawned
+ * may still be using them.
+ */
+static bool run_guarded(void (*fn)(void *ctx, size_t index), void *ctx, size_t index)
+{
+    jmp_buf *saved_exit = exit_point;
+    JumpBuffer *saved_jump = jump_buffer;
+    SpawnFrame *saved_frame = spawn_frame;
+    jmp_buf here;
+
+    exit_point = &here;
+    if (setjmp(here) != 0)
+    {
+        while (jump_buffer != saved_jump)
+            POP_JUMP_BUFFER();
+        spawn_frame = saved_frame;
+        exit_point = saved_exit;
+        return false;
+    }
+    fn(ctx, index);
+    exit_point = saved_exit;
+    return true;
+}
+
+// Makes interpreter the one this thread runs, along with its input, and
+// returns the one it ran before
+static Interpreter *bind_interpreter(Interpreter *interpreter)
+{
+    Interpreter *previous = current_interpreter;
+    current_interpreter = interpreter;
+    input_use(interpreter ? interpreter->input : NULL);
+    return previous;
+}
 
 /* Include the symbol table functions */
 extern void yyerror(const char *s);
-extern void cleanup(void);
 extern void ragequit(int exit_code);
 extern void chill(unsigned int seconds);
 extern void yapping(const char *format, ...);
@@ -36,6 +133,9 @@ extern float slorp_float(float var);
 extern double slorp_double(double var);
 extern TypeModifiers get_variable_modifiers(const char *name);
 extern int yylineno;
+extern FILE *yyin;
+extern int yyparse(void);
+extern int yylex_destroy(void);
 
 // Symbol table functions
 bool set_variable(const char *name, void *value, VarType type, TypeModifiers mods)
@@ -74,6 +174,27 @@ bool set_variable(const char *name, void *value, VarType type, TypeModifiers mod
     return false; // Symbol table is full
 }
 
+size_t get_element_size(VarType type)
+{
+    switch (type)
+    {
+    case VAR_INT:
+        return sizeof(int);
+    case VAR_SHORT:
+        return sizeof(short);
+    case VAR_FLOAT:
+        return sizeof(float);
+    case VAR_DOUBLE:
+        return sizeof(double);
+    case VAR_BOOL:
+        return sizeof(bool);
+    case VAR_CHAR:
+        return sizeof(char);
+    default:
+        return sizeof(int);
+    }
+}
+
 bool set_multi_array_variable(const char *name, int dimensions[], int num_dimensions, TypeModifiers mods, VarType type)
 {
     Variable *var = get_variable(name);
@@ -97,2969 +218,7286 @@ bool set_multi_array_variable(const char *name, int dimensions[], int num_dimens
     var->array_dimensions.total_size = total;
     var->array_length = total;
 
-    size_t element_size;
-    switch (type)
+    // cap arrays are bit-packed, 64 flags per word
+    size_t count = total;
+    size_t element_size = get_element_size(type);
+    if (type == VAR_BOOL)
     {
-    case VAR_INT:
-        element_size = sizeof(int);
-        break;
-    case VAR_SHORT:
-        element_size = sizeof(short);
-        break;
-    case VAR_FLOAT:
-        element_size = sizeof(float);
-        break;
-    case VAR_DOUBLE:
-        element_size = sizeof(double);
-        break;
-    case VAR_BOOL:
-        element_size = sizeof(bool);
-        break;
-    case VAR_CHAR:
-        element_size = sizeof(char);
-        break;
-    default:
-        element_size = sizeof(int);
-        break;
+        count = bitset_words(total);
+        element_size = sizeof(bitset_word);
     }
 
-    var->value.array_data = safe_malloc_array(total, element_size);
+    // safe_malloc hands back zeroed memory (large arrays come straight from
+    // mmap), so there is no need to clear it again here.
+    var->value.array_data = safe_malloc_array(count, element_size);
     if (var->value.array_data == NULL)
     {
         return false;
     }
 
-    memset(var->value.array_data, 0, total * element_size);
     return true;
 }
 
-ASTNode *create_multi_array_declaration_node(char *name, int dimensions[], int num_dimensions, VarType type) {
+/*
+ * Array declarations keep their dimension expressions and initializers in
+ * the AST; the array itself is allocated in the current scope each time
+ * the declaration runs (see declare_array).
+ */
+ASTNode *create_multi_array_declaration_node(char *name, ASTNode *dimensions[], int num_dimensions, VarType type, ExpressionList *init) {
     ASTNode *node = ARENA_ALLOC(ASTNode);
     if (!node) {
         yyerror("Memory allocation failed");
-        exit(EXIT_FAILURE);
+        interpreter_exit(EXIT_FAILURE);
     }
-    
-    node->type = NODE_ARRAY_ACCESS;
+
+    node->type = NODE_ARRAY_DECLARATION;
     node->var_type = type;
+    node->modifiers = get_current_modifiers();
     node->is_array = true;
-    
-    // Store dimensions in node
-    for (int i = 0; i < num_dimensions; i++) {
-        node->array_dimensions.dimensions[i] = dimensions[i];
-    }
-    node->array_dimensions.num_dimensions = num_dimensions;
-    
-    // Calculate total size
-    size_t total = 1;
+    node->data.array_decl.name = ARENA_STRDUP(name);
+    node->data.array_decl.num_dimensions = num_dimensions;
     for (int i = 0; i < num_dimensions; i++) {
-        total *= dimensions[i];
+        node->data.array_decl.dimensions[i] = dimensions[i];
+    }
+
+    // The parser frees its (circular) initializer list, so keep an arena copy
+    ExpressionList *head = NULL;
+    if (init) {
+        ExpressionList *curr = init;
+        do {
+            ExpressionList *copy = ARENA_ALLOC(ExpressionList);
+            copy->expr = curr->expr;
+            if (head) {
+                copy->next = head;
+                copy->prev = head->prev;
+                head->prev->next = copy;
+                head->prev = copy;
+            } else {
+                copy->next = copy;
+                copy->prev = copy;
+                head = copy;
+            }
+            curr = curr->next;
+        } while (curr != init);
     }
-    node->array_dimensions.total_size = total;
-    node->array_length = total; // For backward compatibility
-    
-    // Set the variable name
-    node->data.name = ARENA_STRDUP(name);
-    
-    return node;
-}
+    node->data.array_decl.init = head;
 
-ASTNode *create_multi_array_access_node(char *name, ASTNode *indices[], int num_indices) {
-    ASTNode *node = ARENA_ALLOC(ASTNode);
-    if (!node) {
-        yyerror("Memory allocation failed");
-        exit(EXIT_FAILURE);
-    }
-    
-    node->type = NODE_ARRAY_ACCESS;
-    
-    // Store the array name
-    node->data.array.name = ARENA_STRDUP(name);
-    
-    // Store indices
-    node->data.array.num_dimensions = num_indices;
-    for (int i = 0; i < num_indices; i++) {
-        node->data.array.indices[i] = indices[i];
-    }
-    
     return node;
-} 
-
-// Function to rename the old create_array_access_node to maintain compatibility
-ASTNode *create_array_access_node_single(char *name, ASTNode *index) {
-    // Create a wrapper that calls the multi-dimensional version with a single index
-    ASTNode *indices[1] = {index};
-    return create_multi_array_access_node(name, indices, 1);
 }
 
-// Calculate the memory offset for multi-dimensional array access
-size_t calculate_array_offset(Variable *var, int indices[], int num_indices) {
-    // Validate that the number of indices matches the number of dimensions
-    if (num_indices != var->array_dimensions.num_dimensions) {
-        char error_msg[100];
-        sprintf(error_msg, "Array '%s' has %d dimensions but accessed with %d indices", 
-                var->name, var->array_dimensions.num_dimensions, num_indices);
-        yyerror(error_msg);
-        exit(EXIT_FAILURE);
-    }
-    
-    // Calculate the offset using row-major order
-    size_t offset = 0;
-    size_t multiplier = 1;
-    
-    // Start from the rightmost dimension
-    for (int i = num_indices - 1; i >= 0; i--) {
-        // Check if the index is within bounds
-        if (indices[i] < 0 || indices[i] >= var->array_dimensions.dimensions[i]) {
+static void declare_array(ASTNode *node) {
+    const char *name = node->data.array_decl.name;
+    int num_dimensions = node->data.array_decl.num_dimensions;
+    int dimensions[MAX_DIMENSIONS];
+
+    for (int i = 0; i < num_dimensions; i++) {
+        dimensions[i] = evaluate_expression_int(node->data.array_decl.dimensions[i]);
+        if (dimensions[i] <= 0) {
             char error_msg[100];
-            sprintf(error_msg, "Array index out of bounds: dimension %d", i + 1);
+            snprintf(error_msg, sizeof(error_msg), "Array '%s' dimension %d must be positive, got %d",
+                     name, i + 1, dimensions[i]);
             yyerror(error_msg);
-            exit(EXIT_FAILURE);
-        }
-        
-        offset += indices[i] * multiplier;
-        
-        // Update multiplier for the next dimension
-        if (i > 0) {
-            multiplier *= var->array_dimensions.dimensions[i];
+            interpreter_exit(EXIT_FAILURE);
         }
     }
-    
-    return offset;
-}
 
-// Evaluate a multi-dimensional array access node
-void *evaluate_multi_array_access(ASTNode *node) {
-    // Get the variable
-    Variable *var = get_variable(node->data.array.name);
-    if (var == NULL || !var->is_array) {
-        char error_msg[100];
-        sprintf(error_msg, "Variable '%s' is not an array", node->data.array.name);
-        yyerror(error_msg);
-        exit(EXIT_FAILURE);
+    Variable *var = variable_new((char *)name);
+    add_variable_to_scope(name, var);
+    SAFE_FREE(var);
+
+    if (!set_multi_array_variable(name, dimensions, num_dimensions, node->modifiers, node->var_type)) {
+        yyerror("Failed to create array");
+        interpreter_exit(EXIT_FAILURE);
     }
-    
-    // Extract the indices
-    int num_indices = node->data.array.num_dimensions;
-    int indices[MAX_DIMENSIONS];
-    
-    for (int i = 0; i < num_indices; i++) {
-        indices[i] = evaluate_expression_int(node->data.array.indices[i]);
+    if (node->data.array_decl.init) {
+        populate_multi_array_variable((char *)name, node->data.array_decl.init, dimensions, num_dimensions);
     }
-    
-    // Calculate the offset
-    size_t offset = calculate_array_offset(var, indices, num_indices);
-    
-    // Return a pointer to the element
-    switch (var->var_type) {
-        case VAR_INT:
-            return (int*)var->value.array_data + offset;
-        case VAR_SHORT:
-            return (short*)var->value.array_data + offset;
-        case VAR_FLOAT:
-            return (float*)var->value.array_data + offset;
-        case VAR_DOUBLE:
-            return (double*)var->value.array_data + offset;
-        case VAR_BOOL:
-            return (bool*)var->value.array_data + offset;
-        case VAR_CHAR:
-            return (char*)var->value.array_data + offset;
-        default:
-            yyerror("Unknown variable type");
-            exit(EXIT_FAILURE);
+}
+
+ASTNode *create_map_declaration_node(char *name, VarType key_type, VarType value_type)
+{
+    if (key_type != VAR_INT && key_type != VAR_CHAR)
+    {
+        yyerror("lore keys must be rizz or yap");
+        interpreter_exit(EXIT_FAILURE);
     }
+
+    ASTNode *node = ARENA_ALLOC(ASTNode);
+    node->type = NODE_MAP_DECLARATION;
+    node->var_type = value_type;
+    node->modifiers = get_current_modifiers();
+    node->data.map_decl.name = ARENA_STRDUP(name);
+    node->data.map_decl.key_type = key_type;
+    return node;
 }
 
-bool set_int_variable(const char *name, int value, TypeModifiers mods)
+// Maps, like arrays, are made in the current scope each time the
+// declaration runs and freed with their block
+static void declare_map(ASTNode *node)
 {
-    return set_variable(name, &value, VAR_INT, mods);
+    const char *name = node->data.map_decl.name;
+    Variable *var = variable_new((char *)name);
+    var->is_map = true;
+    var->modifiers = node->modifiers;
+    var->var_type = node->var_type;
+    var->key_type = node->data.map_decl.key_type;
+    var->value.map_data = hm_new();
+    add_variable_to_scope(name, var);
+    SAFE_FREE(var);
 }
 
-bool set_char_variable(const char *name, int value, TypeModifiers mods)
+ASTNode *create_channel_declaration_node(char *name, VarType type, ASTNode *capacity, bool single)
 {
-    return set_variable(name, &value, VAR_CHAR, mods);
+    ASTNode *node = ARENA_ALLOC(ASTNode);
+    node->type = NODE_CHANNEL_DECLARATION;
+    node->var_type = type;
+    node->modifiers = get_current_modifiers();
+    node->data.channel_decl.name = ARENA_STRDUP(name);
+    node->data.channel_decl.capacity = capacity;
+    node->data.channel_decl.single = single;
+    return node;
 }
 
-bool set_array_variable(char *name, int length, TypeModifiers mods, VarType type)
+// Channels are made when the declaration runs and freed with their block
+static void declare_channel(ASTNode *node)
 {
-    // search for an existing variable
-    Variable *var = get_variable(name);
-    if (var != NULL)
+    const char *name = node->data.channel_decl.name;
+    int capacity = evaluate_expression_int(node->data.channel_decl.capacity);
+    if (capacity <= 0)
     {
-        if (var->is_array)
-        {
-            // free the old array
-            SAFE_FREE(var->value.array_data);
-        }
-        var->var_type = type;
-        var->is_array = true;
-        var->array_length = length;
-        var->modifiers = mods;
-        switch (type)
-        {
-        case VAR_INT:
-            var->value.array_data = SAFE_MALLOC_ARRAY(int, length);
-            if (length)
-                memset(var->value.array_data, 0, length * sizeof(int));
-            break;
-        case VAR_SHORT:
-            var->value.array_data = SAFE_MALLOC_ARRAY(short, length);
-            if (length)
-                memset(var->value.array_data, 0, length * sizeof(short));
-            break;
-        case VAR_FLOAT:
-            var->value.array_data = SAFE_MALLOC_ARRAY(float, length);
-            if (length)
-                memset(var->value.array_data, 0, length * sizeof(float));
-            break;
-        case VAR_DOUBLE:
-            var->value.array_data = SAFE_MALLOC_ARRAY(double, length);
-            if (length)
-                memset(var->value.array_data, 0, length * sizeof(double));
-            break;
-        case VAR_BOOL:
-            var->value.array_data = SAFE_MALLOC_ARRAY(bool, length);
-            if (length)
-                memset(var->value.array_data, 0, length * sizeof(bool));
-            break;
-        case VAR_CHAR:
-            var->value.array_data = SAFE_MALLOC_ARRAY(char, length);
-            if (length)
-                memset(var->value.array_data, 0, length * sizeof(char));
-            break;
-        default:
-            break;
-        }
-        return true;
-    }
-
-    return false; // no space
+        char error_msg[100];
+        snprintf(error_msg, sizeof(error_msg), "Channel '%s' capacity must be positive, got %d", name, capacity);
+        yyerror(error_msg);
+        interpreter_exit(EXIT_FAILURE);
+    }
+
+    Variable *var = variable_new((char *)name);
+    var->is_channel = true;
+    var->var_type = node->var_type;
+    var->modifiers = node->modifiers;
+    // A failing program cancels the channel, so nothing waits on it forever
+    var->value.channel_data = chan_new((size_t)capacity, sizeof(Value), node->data.channel_decl.single,
+                                       &current_interpreter->failed);
+    add_variable_to_scope(name, var);
+    SAFE_FREE(var);
 }
 
-bool set_short_variable(const char *name, short value, TypeModifiers mods)
+/*
+ * chad4, gigachad4 and rizz8 variables are 1D arrays of their lanes, so
+ * v[i] and len(v) work as for any array. Assigning to one evaluates the
+ * right side a whole vector at a time (see evaluate_simd).
+ */
+ASTNode *create_simd_declaration_node(char *name, VarType type, ASTNode *init)
 {
-    return set_variable(name, &value, VAR_SHORT, mods);
+    ASTNode *node = ARENA_ALLOC(ASTNode);
+    node->type = NODE_SIMD_DECLARATION;
+    node->var_type = type;
+    node->modifiers = get_current_modifiers();
+    node->data.simd_decl.name = ARENA_STRDUP(name);
+    node->data.simd_decl.init = init;
+    return node;
 }
 
-bool set_float_variable(const char *name, float value, TypeModifiers mods)
+static SimdKind simd_kind(VarType type)
 {
-    return set_variable(name, &value, VAR_FLOAT, mods);
+    return type == VAR_FLOAT ? SIMD_F32X4 : type == VAR_DOUBLE ? SIMD_F64X4 : SIMD_I32X8;
 }
 
-bool set_double_variable(const char *name, double value, TypeModifiers mods)
+static const char *simd_type_name(VarType type)
 {
-    return set_variable(name, &value, VAR_DOUBLE, mods);
+    return type == VAR_FLOAT ? "chad4" : type == VAR_DOUBLE ? "gigachad4" : "rizz8";
 }
 
-bool set_bool_variable(const char *name, bool value, TypeModifiers mods)
+static bool is_vector_builtin(const char *name)
 {
-    return set_variable(name, &value, VAR_BOOL, mods);
+    return strcmp(name, "vload") == 0 || strcmp(name, "vselect") == 0 ||
+           strcmp(name, "vmin") == 0 || strcmp(name, "vmax") == 0;
 }
 
-void reset_modifiers(void)
+// Whether an expression has a vector value rather than a scalar one
+static bool is_simd_expression(ASTNode *node)
 {
-    current_modifiers.is_volatile = false;
-    current_modifiers.is_signed = false;
-    current_modifiers.is_unsigned = false;
-    current_modifiers.is_const = false;
+    switch (node->type)
+    {
+    case NODE_IDENTIFIER:
+    {
+        Variable *var = get_variable(node->data.name);
+        return var != NULL && var->is_simd;
+    }
+    case NODE_OPERATION:
+        return is_simd_expression(node->data.op.left) || is_simd_expression(node->data.op.right);
+    case NODE_UNARY_OPERATION:
+        return node->data.unary.op == OP_NEG && is_simd_expression(node->data.unary.operand);
+    case NODE_FUNC_CALL:
+        return is_vector_builtin(node->data.func_call.function_name);
+    default:
+        return false;
+    }
 }
 
-TypeModifiers get_current_modifiers(void)
+static void simd_error(const char *msg, const char *name)
 {
-    TypeModifiers mods = current_modifiers;
-    reset_modifiers(); // Reset for next declaration
-    return mods;
+    char error_msg[200];
+    snprintf(error_msg, sizeof(error_msg), msg, name);
+    yyerror(error_msg);
+    interpreter_exit(EXIT_FAILURE);
 }
 
+static void evaluate_simd(ASTNode *node, VarType type, SimdVec *out);
 
-/* Function implementations */
+// vload(arr, i): lanes arr[i] .. arr[i + lanes - 1]
+static void evaluate_vload(ArgumentList *args, VarType type, SimdVec *out)
+{
+    if (!args || !args->next || args->next->next)
+        simd_error("vload expects 2 arguments: vload(arr, i)%s", "");
+    Variable *var = get_array_argument(args->expr, "vload");
+    if (var->var_type != type)
+        simd_error("vload from '%s' does not match the vector's lane type", args->expr->data.name);
+
+    size_t lanes = simd_lanes(simd_kind(type));
+    int start = evaluate_expression_int(args->next->expr);
+    if (start < 0 || (size_t)start + lanes > var->array_dimensions.total_size)
+        simd_error("vload reads past the end of '%s'", args->expr->data.name);
+    simd_load(simd_kind(type), out, (char *)var->value.array_data + (size_t)start * get_element_size(type));
+}
 
-bool check_and_mark_identifier(ASTNode *node, const char *contextErrorMessage)
+static void evaluate_vector_call(ASTNode *node, VarType type, SimdVec *out)
 {
-    if (!node->already_checked)
+    const char *name = node->data.func_call.function_name;
+    ArgumentList *args = node->data.func_call.arguments;
+    SimdKind kind = simd_kind(type);
+    if (strcmp(name, "vload") == 0)
     {
-        node->already_checked = true;
-        node->is_valid_symbol = false;
-
-        // Do the table lookup
-        Variable *var = get_variable(node->data.name);
-        if (var != NULL)
-            node->is_valid_symbol = true;
+        evaluate_vload(args, type, out);
+    }
+    else if (strcmp(name, "vselect") == 0)
+    {
+        if (!args || !args->next || !args->next->next || args->next->next->next)
+            simd_error("vselect expects 3 arguments: vselect(mask, a, b)%s", "");
+        SimdVec mask, a, b;
+        evaluate_simd(args->expr, type, &mask);
+        evaluate_simd(args->next->expr, type, &a);
+        evaluate_simd(args->next->next->expr, type, &b);
+        simd_select(kind, out, &mask, &a, &b);
+    }
+    else
+    {
+        if (!args || !args->next || args->next->next)
+            simd_error("%s expects 2 arguments", name);
+        SimdVec a, b;
+        evaluate_simd(args->expr, type, &a);
+        evaluate_simd(args->next->expr, type, &b);
+        simd_binary(strcmp(name, "vmin") == 0 ? SIMD_MIN : SIMD_MAX, kind, out, &a, &b);
+    }
+}
 
-        if (!node->is_valid_symbol)
+static bool simd_operator(OperatorType op, SimdOp *out)
+{
+    static const struct
+    {
+        OperatorType op;
+        SimdOp simd;
+    } table[] = {
+        {OP_PLUS, SIMD_ADD}, {OP_MINUS, SIMD_SUB}, {OP_TIMES, SIMD_MUL}, {OP_DIVIDE, SIMD_DIV},
+        {OP_LT, SIMD_LT}, {OP_GT, SIMD_GT}, {OP_LE, SIMD_LE}, {OP_GE, SIMD_GE},
+        {OP_EQ, SIMD_EQ}, {OP_NE, SIMD_NE}, {OP_AND, SIMD_AND}, {OP_OR, SIMD_OR},
+    };
+    for (size_t i = 0; i < sizeof(table) / sizeof(table[0]); i++)
+    {
+        if (table[i].op == op)
         {
-            yylineno = yylineno - 2;
-            yyerror(contextErrorMessage);
+            *out = table[i].simd;
+            return true;
         }
     }
-
-    return node->is_valid_symbol;
+    return false;
 }
 
-void execute_switch_statement(ASTNode *node)
+/*
+ * Evaluates an expression as a vector of the given lane type. Scalar
+ * parts are evaluated as usual and copied into every lane, so `v * 2.0`
+ * scales each lane and `v + x` adds x to each.
+ */
+static void evaluate_simd(ASTNode *node, VarType type, SimdVec *out)
 {
-    int switch_value = evaluate_expression(node->data.switch_stmt.expression);
-    CaseNode *current_case = node->data.switch_stmt.cases;
-    int matched = 0;
-
-    PUSH_JUMP_BUFFER();
-    if (setjmp(CURRENT_JUMP_BUFFER()) == 0)
+    SimdKind kind = simd_kind(type);
+    if (!is_simd_expression(node))
     {
-        while (current_case)
+        simd_splat(kind, out, evaluate_expression_double(node));
+        return;
+    }
+
+    switch (node->type)
+    {
+    case NODE_IDENTIFIER:
+    {
+        Variable *var = get_variable(node->data.name);
+        if (var->var_type != type)
         {
-            if (current_case->value)
-            {
-                int case_value = evaluate_expression(current_case->value);
-                if (case_value == switch_value || matched)
-                {
-                    matched = 1;
-                    execute_statements(current_case->statements);
-                }
-            }
-            else
-            {
-                // Default case
-                if (matched || !matched)
-                {
-                    execute_statements(current_case->statements);
-                    break;
-                }
-            }
-            current_case = current_case->next;
+            char error_msg[160];
+            snprintf(error_msg, sizeof(error_msg), "Cannot mix %s '%s' with %s vectors",
+                     simd_type_name(var->var_type), node->data.name, simd_type_name(type));
+            yyerror(error_msg);
+            interpreter_exit(EXIT_FAILURE);
         }
+        simd_load(kind, out, var->value.array_data);
+        return;
     }
-    else
+    case NODE_UNARY_OPERATION:
     {
-        // Break encountered; do nothing
+        SimdVec a;
+        evaluate_simd(node->data.unary.operand, type, &a);
+        simd_neg(kind, out, &a);
+        return;
+    }
+    case NODE_FUNC_CALL:
+        evaluate_vector_call(node, type, out);
+        return;
+    default:
+        break;
     }
-    POP_JUMP_BUFFER();
-}
 
-static ASTNode *create_node(NodeType type, VarType var_type, TypeModifiers modifiers)
-{
-    ASTNode *node = ARENA_ALLOC(ASTNode);
-    if (!node)
+    SimdOp op;
+    if (!simd_operator(node->data.op.op, &op))
+        simd_error("Operator not supported on %s vectors", simd_type_name(type));
+    SimdVec a, b;
+    evaluate_simd(node->data.op.left, type, &a);
+    evaluate_simd(node->data.op.right, type, &b);
+    if (op == SIMD_DIV && kind == SIMD_I32X8)
     {
-        yyerror("Error: Memory allocation failed for ASTNode.\n");
-        exit(EXIT_FAILURE);
+        for (size_t i = 0; i < simd_lanes(kind); i++)
+        {
+            if (b.i32[i] == 0)
+                simd_error("Division by zero in %s lane", simd_type_name(type));
+        }
     }
-    node->type = type;
-    node->var_type = var_type;
-    node->modifiers = modifiers;
-    node->already_checked = false;
-    node->is_valid_symbol = false;
-    return node;
+    simd_binary(op, kind, out, &a, &b);
 }
 
-ASTNode *create_int_node(int value)
+static void declare_simd(ASTNode *node)
 {
-    ASTNode *node = create_node(NODE_INT, VAR_INT, current_modifiers);
-    SET_DATA_INT(node, value);
-    return node;
+    const char *name = node->data.simd_decl.name;
+    SimdKind kind = simd_kind(node->var_type);
+    size_t lanes = simd_lanes(kind);
+
+    SimdVec value;
+    if (node->data.simd_decl.init)
+        evaluate_simd(node->data.simd_decl.init, node->var_type, &value);
+    else
+        simd_splat(kind, &value, 0.0);
+
+    Variable *var = variable_new((char *)name);
+    var->is_array = true;
+    var->is_simd = true;
+    var->var_type = node->var_type;
+    var->modifiers = node->modifiers;
+    var->array_length = (int)lanes;
+    var->array_dimensions.num_dimensions = 1;
+    var->array_dimensions.dimensions[0] = (int)lanes;
+    var->array_dimensions.total_size = lanes;
+    var->value.array_data = safe_malloc_array(lanes, get_element_size(node->var_type));
+    simd_store(kind, var->value.array_data, &value);
+    add_variable_to_scope(name, var);
+    SAFE_FREE(var);
 }
 
-ASTNode *create_array_declaration_node(char *name, int length, VarType var_type)
+static void assign_simd(Variable *var, ASTNode *value)
 {
-    ASTNode *node = ARENA_ALLOC(ASTNode);
-    if (!node)
-        return NULL;
+    SimdVec result;
+    evaluate_simd(value, var->var_type, &result);
+    simd_store(simd_kind(var->var_type), var->value.array_data, &result);
+}
 
-    node->type = NODE_ARRAY_ACCESS;
-    node->var_type = var_type;
-    node->is_array = true;
-    node->array_length = length;
-    node->data.array.name = ARENA_STRDUP(name);
-    return node;
+// Bytes needed to hold `capacity` elements of a vector
+static size_t vector_bytes(VarType type, size_t capacity)
+{
+    if (type == VAR_BOOL)
+        return bitset_words(capacity) * sizeof(bitset_word);
+    if (type == VAR_CHAR)
+        return capacity + 1; // room for a terminator so %s works
+    return capacity * get_element_size(type);
 }
 
-ASTNode *create_array_access_node(char *name, ASTNode *index)
+// Storage a pending spawned call uses must not move before it syncs
+static void check_spawn_pins(const Variable *var, const char *func_name, const char *name)
 {
-    ASTNode *node = ARENA_ALLOC(ASTNode);
-    if (!node)
+    if (var->spawn_pins == 0)
+        return;
+    char error_msg[200];
+    snprintf(error_msg, sizeof(error_msg), "%s cannot move '%s' while a spawned call uses it; sync first", func_name,
+             name);
+    yyerror(error_msg);
+    interpreter_exit(EXIT_FAILURE);
+}
+
+static void vector_reserve(Variable *var, size_t capacity)
+{
+    if (capacity <= var->capacity)
+        return;
+    if (var->spawn_pins > 0)
     {
-        yyerror("Memory allocation failed");
-        exit(EXIT_FAILURE);
+        yyerror("Cannot grow a vector while a spawned call uses it; sync first");
+        interpreter_exit(EXIT_FAILURE);
     }
 
-    node->type = NODE_ARRAY_ACCESS;
-    node->data.array.name = ARENA_STRDUP(name);
-    node->data.array.index = index;
-    node->is_array = true;
-
-    // Look up and set the array's type from the symbol table
-    Variable *var = get_variable(name);
-    if (var != NULL)
+    void *data = safe_realloc(var->value.array_data, vector_bytes(var->var_type, capacity));
+    if (data == NULL)
     {
-        node->var_type = var->var_type;
-        node->array_length = var->array_length;
-        node->modifiers = var->modifiers;
+        yyerror("Out of memory growing vector");
+        interpreter_exit(EXIT_FAILURE);
     }
+    var->value.array_data = data;
+    var->capacity = capacity;
+}
 
-    return node;
+// A vector is a 1D array whose only dimension is its current length
+static void vector_set_length(Variable *var, size_t length)
+{
+    var->array_dimensions.dimensions[0] = (int)length;
+    var->array_dimensions.total_size = length;
+    var->array_length = (int)length;
 }
 
-ASTNode *create_short_node(short value)
+ASTNode *create_vector_declaration_node(char *name, VarType type)
 {
-    ASTNode *node = create_node(NODE_SHORT, VAR_SHORT, current_modifiers);
-    SET_DATA_SHORT(node, value);
+    ASTNode *node = ARENA_ALLOC(ASTNode);
+    node->type = NODE_VECTOR_DECLARATION;
+    node->var_type = type;
+    node->modifiers = get_current_modifiers();
+    node->data.name = ARENA_STRDUP(name);
     return node;
 }
 
-ASTNode *create_float_node(float value)
+// Each run of the declaration makes a new empty vector in the current scope
+static void declare_vector(ASTNode *node)
 {
-    ASTNode *node = create_node(NODE_FLOAT, VAR_FLOAT, current_modifiers);
-    SET_DATA_FLOAT(node, value);
-    return node;
+    Variable *var = variable_new(node->data.name);
+    var->is_array = true;
+    var->is_vector = true;
+    var->modifiers = node->modifiers;
+    var->var_type = node->var_type;
+    var->array_dimensions.num_dimensions = 1;
+    vector_set_length(var, 0);
+    vector_reserve(var, VECTOR_MIN_CAPACITY);
+    add_variable_to_scope(node->data.name, var);
+    SAFE_FREE(var);
 }
 
-ASTNode *create_char_node(char value)
+static StructDef *find_struct(const char *name)
 {
-    ASTNode *node = create_node(NODE_CHAR, VAR_CHAR, current_modifiers);
-    SET_DATA_INT(node, value); // Store char as integer
-    return node;
+    for (StructDef *def = current_interpreter->structs; def; def = def->next)
+    {
+        if (strcmp(def->name, name) == 0)
+            return def;
+    }
+    return NULL;
 }
 
-ASTNode *create_boolean_node(bool value)
+static StructField *find_struct_field(StructDef *def, const char *name)
 {
-    ASTNode *node = create_node(NODE_BOOLEAN, VAR_BOOL, current_modifiers);
-    SET_DATA_BOOL(node, value);
-    return node;
+    for (StructField *field = def->fields; field; field = field->next)
+    {
+        if (strcmp(field->name, name) == 0)
+            return field;
+    }
+    return NULL;
 }
 
-ASTNode *create_identifier_node(char *name)
+// Fields live in the scope as ordinary variables named "<var>.<field>"
+static void struct_field_name(char *buf, size_t size, const char *base, const char *field)
 {
-    ASTNode *node = create_node(NODE_IDENTIFIER, NONE, current_modifiers);
-    SET_DATA_NAME(node, name);
-    return node;
+    if ((size_t)snprintf(buf, size, "%s.%s", base, field) >= size)
+    {
+        yyerror("gang field name too long");
+        interpreter_exit(EXIT_FAILURE);
+    }
 }
 
-ASTNode *create_assignment_node(char *name, ASTNode *expr)
+StructField *append_struct_field(StructField *fields, char *name, VarType type, ArrayDimensions *dims)
 {
-    ASTNode *node = create_node(NODE_ASSIGNMENT, current_var_type, get_current_modifiers());
-    SET_DATA_OP(node, create_identifier_node(name), expr, OP_ASSIGN);
-    return node;
+    StructField *field = ARENA_ALLOC(StructField);
+    field->name = ARENA_STRDUP(name);
+    field->type = type;
+    field->dims.num_dimensions = 0;
+    field->dims.total_size = 1;
+    if (dims)
+        field->dims = *dims;
+
+    size_t count = 1;
+    for (int i = 0; i < field->dims.num_dimensions; i++)
+    {
+        count *= field->dims.dimensions[i];
+    }
+    field->dims.total_size = count;
+    field->size = count * get_element_size(type);
+    field->next = NULL;
+
+    if (!fields)
+        return field;
+
+    StructField *tail = fields;
+    for (;;)
+    {
+        if (strcmp(tail->name, name) == 0)
+        {
+            char error_msg[100];
+            snprintf(error_msg, sizeof(error_msg), "Duplicate gang field '%s'", name);
+            yyerror(error_msg);
+            interpreter_exit(EXIT_FAILURE);
+        }
+        if (!tail->next)
+            break;
+        tail = tail->next;
+    }
+    tail->next = field;
+    return fields;
 }
 
-ASTNode *create_declaration_node(char *name, ASTNode *expr)
+void define_struct(char *name, StructField *fields)
 {
-    ASTNode *node = create_node(NODE_DECLARATION, current_var_type, get_current_modifiers());
-    SET_DATA_OP(node, create_identifier_node(name), expr, OP_ASSIGN);
-    return node;
+    if (find_struct(name))
+    {
+        char error_msg[100];
+        snprintf(error_msg, sizeof(error_msg), "gang '%s' is already defined", name);
+        yyerror(error_msg);
+        interpreter_exit(EXIT_FAILURE);
+    }
+
+    StructDef *def = ARENA_ALLOC(StructDef);
+    def->name = ARENA_STRDUP(name);
+    def->fields = fields;
+
+    // Lay out interleaved records widest type first, so every field is
+    // naturally aligned without padding between fields.
+    size_t offset = 0;
+    size_t align = 1;
+    for (size_t width = sizeof(double); width > 0; width /= 2)
+    {
+        for (StructField *field = fields; field; field = field->next)
+        {
+            if (get_element_size(field->type) != width)
+                continue;
+            field->offset = offset;
+            offset += field->size;
+            if (width > align)
+                align = width;
+        }
+    }
+    def->data_size = offset;
+    def->size = (offset + align - 1) / align * align;
+
+    def->next = current_interpreter->structs;
+    current_interpreter->structs = def;
 }
 
-ASTNode *create_operation_node(OperatorType op, ASTNode *left, ASTNode *right)
+static Variable *add_field_variable(const char *name)
 {
-    ASTNode *node = create_node(NODE_OPERATION, NONE, current_modifiers);
-    SET_DATA_OP(node, left, right, op);
-    return node;
+    Variable *var = variable_new((char *)name);
+    add_variable_to_scope(name, var);
+    SAFE_FREE(var);
+    return get_variable(name);
 }
 
-ASTNode *create_unary_operation_node(OperatorType op, ASTNode *operand)
+static bool set_struct_variable(const char *name, StructDef *def, const ArrayDimensions *dims, bool split, TypeModifiers mods)
 {
-    ASTNode *node = create_node(NODE_UNARY_OPERATION, NONE, current_modifiers);
-    SET_DATA_UNARY_OP(node, operand, op);
-    return node;
+    Variable *owner = get_variable(name);
+    if (owner == NULL)
+        return false;
+
+    owner->struct_def = def;
+    owner->modifiers = mods;
+    owner->value.array_data = NULL;
+    owner->array_dimensions = *dims;
+    size_t count = 1;
+    for (int i = 0; i < owner->array_dimensions.num_dimensions; i++)
+    {
+        count *= owner->array_dimensions.dimensions[i];
+    }
+    owner->array_dimensions.total_size = count;
+    owner->array_length = (int)count;
+
+    // Interleaved arrays of records share one buffer owned by the gang
+    // variable itself; each field is a strided view into it.
+    bool interleaved = dims->num_dimensions > 0 && !split;
+    if (interleaved)
+    {
+        owner->value.array_data = safe_malloc_array(count, def->size);
+        if (owner->value.array_data == NULL)
+            return false;
+    }
+
+    for (StructField *field = def->fields; field; field = field->next)
+    {
+        char field_name[256];
+        struct_field_name(field_name, sizeof(field_name), name, field->name);
+        Variable *var = add_field_variable(field_name);
+
+        int num_dimensions = owner->array_dimensions.num_dimensions + field->dims.num_dimensions;
+        if (num_dimensions > MAX_DIMENSIONS)
+        {
+            yyerror("Maximum array dimensions exceeded");
+            interpreter_exit(EXIT_FAILURE);
+        }
+        if (num_dimensions == 0)
+        {
+            var->var_type = field->type;
+            var->modifiers = mods;
+            memset(&var->value, 0, sizeof(var->value));
+            continue;
+        }
+
+        int field_dims[MAX_DIMENSIONS];
+        memcpy(field_dims, owner->array_dimensions.dimensions,
+               owner->array_dimensions.num_dimensions * sizeof(int));
+        memcpy(field_dims + owner->array_dimensions.num_dimensions, field->dims.dimensions,
+               field->dims.num_dimensions * sizeof(int));
+
+        if (!interleaved)
+        {
+            if (!set_multi_array_variable(field_name, field_dims, num_dimensions, mods, field->type))
+                return false;
+            continue;
+        }
+
+        var->is_array = true;
+        var->is_view = true;
+        var->modifiers = mods;
+        var->var_type = field->type;
+        var->array_dimensions.num_dimensions = num_dimensions;
+        memcpy(var->array_dimensions.dimensions, field_dims, num_dimensions * sizeof(int));
+        var->array_dimensions.total_size = count * field->dims.total_size;
+        var->array_length = (int)var->array_dimensions.total_size;
+        var->value.array_data = (char *)owner->value.array_data + field->offset;
+        var->stride = def->size;
+        var->stride_span = field->dims.total_size;
+    }
+    return true;
 }
 
-ASTNode *create_for_statement_node(ASTNode *init, ASTNode *cond, ASTNode *incr, ASTNode *body)
+ASTNode *create_struct_declaration_node(char *name, char *struct_name, ArrayDimensions *dims, bool split)
 {
-    ASTNode *node = create_node(NODE_FOR_STATEMENT, NONE, current_modifiers);
-    SET_DATA_FOR(node, init, cond, incr, body);
+    StructDef *def = find_struct(struct_name);
+    if (def == NULL)
+    {
+        char error_msg[100];
+        snprintf(error_msg, sizeof(error_msg), "Unknown gang '%s'", struct_name);
+        yyerror(error_msg);
+        interpreter_exit(EXIT_FAILURE);
+    }
+
+    ASTNode *node = ARENA_ALLOC(ASTNode);
+    node->type = NODE_STRUCT_DECLARATION;
+    node->modifiers = get_current_modifiers();
+    node->array_dimensions.num_dimensions = 0;
+    if (dims)
+        node->array_dimensions = *dims;
+    node->data.struct_decl.name = ARENA_STRDUP(name);
+    node->data.struct_decl.def = def;
+    node->data.struct_decl.split = split;
+    node->data.struct_decl.previous = current_interpreter->gang_decls;
+    current_interpreter->gang_decls = node;
     return node;
 }
 
-ASTNode *create_while_statement_node(ASTNode *cond, ASTNode *body)
+// Gangs, like arrays, are made in the current scope each time the
+// declaration runs; the scope frees the records and field arrays
+static void declare_struct(ASTNode *node)
 {
-    ASTNode *node = create_node(NODE_WHILE_STATEMENT, NONE, current_modifiers);
-    SET_DATA_WHILE(node, cond, body);
-    return node;
+    const char *name = node->data.struct_decl.name;
+    Variable *var = variable_new((char *)name);
+    add_variable_to_scope(name, var);
+    SAFE_FREE(var);
+
+    if (!set_struct_variable(name, node->data.struct_decl.def, &node->array_dimensions,
+                             node->data.struct_decl.split, node->modifiers))
+    {
+        yyerror("Failed to create gang array");
+        interpreter_exit(EXIT_FAILURE);
+    }
 }
 
-ASTNode *create_do_while_statement_node(ASTNode *cond, ASTNode *body)
+// Field accesses are checked while parsing, before any gang exists, against
+// the closest gang declaration above them in the source
+static ASTNode *find_gang_declaration(const char *name)
 {
-    ASTNode *node = create_node(NODE_DO_WHILE_STATEMENT, NONE, current_modifiers);
-    SET_DATA_WHILE(node, cond, body);
-    return node;
+    for (ASTNode *decl = current_interpreter->gang_decls; decl; decl = decl->data.struct_decl.previous)
+    {
+        if (strcmp(decl->data.struct_decl.name, name) == 0)
+            return decl;
+    }
+    return NULL;
 }
 
-ASTNode *create_function_call_node(char *func_name, ArgumentList *args)
+// Bytes of storage behind an array variable
+static size_t array_storage_bytes(Variable *var)
 {
-    ASTNode *node = create_node(NODE_FUNC_CALL, NONE, current_modifiers);
-    SET_DATA_FUNC_CALL(node, func_name, args);
-    return node;
+    size_t n = var->array_dimensions.total_size;
+    if (var->var_type == VAR_BOOL)
+        return bitset_words(n) * sizeof(bitset_word);
+    return n * get_element_size(var->var_type);
 }
 
-ASTNode *create_double_node(double value)
+static bool same_array_shape(const Variable *a, const Variable *b)
 {
-    ASTNode *node = create_node(NODE_DOUBLE, VAR_DOUBLE, current_modifiers);
-    SET_DATA_DOUBLE(node, value);
-    return node;
+    if (a->array_dimensions.num_dimensions != b->array_dimensions.num_dimensions)
+        return false;
+    for (int i = 0; i < a->array_dimensions.num_dimensions; i++)
+    {
+        if (a->array_dimensions.dimensions[i] != b->array_dimensions.dimensions[i])
+            return false;
+    }
+    return true;
 }
 
-ASTNode *create_sizeof_node(ASTNode *expr)
+// a = b for whole arrays: one bulk copy instead of an element loop
+static void assign_whole_array(Variable *dst, ASTNode *value)
 {
-    ASTNode *node = create_node(NODE_SIZEOF, NONE, current_modifiers);
-    SET_SIZEOF(node, expr);
-    return node;
+    Variable *src = value->type == NODE_IDENTIFIER ? get_variable(value->data.name) : NULL;
+    if (src == NULL || !src->is_array)
+    {
+        yyerror("Only another array can be assigned to an array");
+        interpreter_exit(EXIT_FAILURE);
+    }
+    if (src->var_type != dst->var_type)
+    {
+        yyerror("Cannot assign arrays of different types");
+        interpreter_exit(EXIT_FAILURE);
+    }
+    if (src->stride || dst->stride)
+    {
+        yyerror("Interleaved gang fields cannot be assigned as a whole");
+        interpreter_exit(EXIT_FAILURE);
+    }
+
+    if (dst->is_vector)
+    {
+        // A vector takes on the length of whatever is assigned to it
+        size_t n = src->array_dimensions.total_size;
+        vector_reserve(dst, n);
+        vector_set_length(dst, n);
+        if (dst->var_type == VAR_CHAR)
+            ((char *)dst->value.array_data)[n] = '\0';
+    }
+    else if (!same_array_shape(dst, src))
+    {
+        yyerror("Cannot assign arrays of different shapes");
+        interpreter_exit(EXIT_FAILURE);
+    }
+
+    if (dst->value.array_data != src->value.array_data)
+        memcpy(dst->value.array_data, src->value.array_data, array_storage_bytes(src));
 }
 
-// @param promotion: 0 for no promotion, 1 for promotion to double 2 for promotion to float
-void *handle_identifier(ASTNode *node, const char *contextErrorMessage, int promote)
+/*
+ * p.x and ps[i].x become plain identifier and array access nodes on the
+ * field variable "p.x" / "ps.x"; the record indices come first, followed by
+ * any indices into an array field. A bare ps.x names the whole field array.
+ */
+ASTNode *create_field_access_node(char *base, ASTNode *outer[], int num_outer, char *field, ASTNode *inner[], int num_inner)
 {
-    if (!check_and_mark_identifier(node, contextErrorMessage))
-        exit(1);
+    char error_msg[160];
+    ASTNode *decl = find_gang_declaration(base);
+    if (decl == NULL)
+    {
+        snprintf(error_msg, sizeof(error_msg), "'%s' is not a gang", base);
+        yyerror(error_msg);
+        interpreter_exit(EXIT_FAILURE);
+    }
+    StructField *def = find_struct_field(decl->data.struct_decl.def, field);
+    if (def == NULL)
+    {
+        snprintf(error_msg, sizeof(error_msg), "gang %s has no field '%s'", decl->data.struct_decl.def->name, field);
+        yyerror(error_msg);
+        interpreter_exit(EXIT_FAILURE);
+    }
 
-    char *name = node->data.name;
-    Variable *var = get_variable(name);
-    if (var != NULL)
+    int record_dims = decl->array_dimensions.num_dimensions;
+    bool whole_field = num_outer == 0 && num_inner == 0;
+    if (!whole_field &&
+        (num_outer != record_dims || num_inner != def->dims.num_dimensions))
     {
-        static Value promoted_value;
-        if (promote == 1)
-        {
+        snprintf(error_msg, sizeof(error_msg), "Wrong number of indices for '%s.%s'", base, field);
+        yyerror(error_msg);
+        interpreter_exit(EXIT_FAILURE);
+    }
 
-            switch (var->var_type)
-            {
-            case VAR_DOUBLE:
-                return &var->value.dvalue;
-            case VAR_FLOAT:
-                promoted_value.dvalue = (double)var->value.fvalue;
-                return &promoted_value;
-            case VAR_INT:
-            case VAR_CHAR:
-            case VAR_SHORT:
-                promoted_value.dvalue = (double)var->value.svalue;
-                return &promoted_value;
-            case VAR_BOOL:
-                promoted_value.dvalue = (double)var->value.ivalue;
-                return &promoted_value;
-            default:
-                yyerror("Unsupported variable type");
-                return NULL;
-            }
-        }
-        else if (promote == 2)
-        {
-            switch (var->var_type)
-            {
-            case VAR_DOUBLE:
-                promoted_value.fvalue = (float)var->value.dvalue;
-                return &promoted_value.fvalue;
-            case VAR_FLOAT:
-                return &var->value.fvalue;
-            case VAR_INT:
-            case VAR_CHAR:
-            case VAR_SHORT:
-                promoted_value.fvalue = (float)var->value.svalue;
-                return &promoted_value.svalue;
-            case VAR_BOOL:
-                promoted_value.fvalue = (float)var->value.ivalue;
-                return &promoted_value.fvalue;
-            default:
-                yyerror("Unsupported variable type");
-                return NULL;
-            }
-        }
-        else
-        {
-            switch (var->var_type)
-            {
-            case VAR_DOUBLE:
-                return &var->value.dvalue;
-            case VAR_FLOAT:
-                return &var->value.fvalue;
-            case VAR_INT:
-            case VAR_CHAR:
-            case VAR_SHORT:
-                return &var->value.svalue;
-            case VAR_BOOL:
-                return &var->value.ivalue;
-            default:
-                yyerror("Unsupported variable type");
-                return NULL;
-            }
-        }
+    char name[256];
+    struct_field_name(name, sizeof(name), base, field);
+    if (num_outer + num_inner == 0)
+        return create_identifier_node(name);
+
+    ASTNode *indices[MAX_DIMENSIONS];
+    for (int i = 0; i < num_outer; i++)
+    {
+        indices[i] = outer[i];
     }
-    yyerror("Undefined variable");
-    return NULL;
+    for (int i = 0; i < num_inner; i++)
+    {
+        indices[num_outer + i] = inner[i];
+    }
+    return create_multi_array_access_node(name, indices, num_outer + num_inner);
 }
 
-int get_expression_type(ASTNode *node)
+ASTNode *create_field_assignment_node(ASTNode *target, ASTNode *value)
 {
-    if (!node)
-    {
-        yyerror("Null node in get_expression_type");
-        return NONE; // Return an unknown type if the node is null
+    if (target->type == NODE_IDENTIFIER)
+        return create_assignment_node(target->data.name, value);
+
+    ASTNode *node = ARENA_ALLOC(ASTNode);
+    node->type = NODE_ASSIGNMENT;
+    node->data.op.left = target;
+    node->data.op.right = value;
+    node->data.op.op = OP_ASSIGN;
+    return node;
+}
+
+ASTNode *create_multi_array_access_node(char *name, ASTNode *indices[], int num_indices) {
+    ASTNode *node = ARENA_ALLOC(ASTNode);
+    if (!node) {
+        yyerror("Memory allocation failed");
+        interpreter_exit(EXIT_FAILURE);
+    }
+    
+    node->type = NODE_ARRAY_ACCESS;
+    node->already_checked = false;
+    node->is_valid_symbol = false;
+    
+    // Store the array name
+    node->data.array.name = ARENA_STRDUP(name);
+    
+    // Store indices
+    node->data.array.num_dimensions = num_indices;
+    for (int i = 0; i < num_indices; i++) {
+        node->data.array.indices[i] = indices[i];
     }
+    
+    return node;
+} 
 
-    switch (node->type)
-    {
-    case NODE_INT:
-        return VAR_INT;
-    case NODE_SHORT:
-        return VAR_SHORT;
-    case NODE_FLOAT:
-        return VAR_FLOAT;
-    case NODE_DOUBLE:
-        return VAR_DOUBLE;
-    case NODE_BOOLEAN:
-        return VAR_BOOL;
-    case NODE_CHAR:
-        return VAR_INT;
-    case NODE_ARRAY_ACCESS:
-    {
-        // First, get the array's base type from symbol table
-        const char *array_name = node->data.array.name;
-        Variable *var = get_variable(array_name);
-        if (var != NULL)
-        {
-            void *element = evaluate_multi_array_access(node);
-            if (element == NULL)
-            {
-                yyerror("Undefined array in expression");
-                return NONE;
-            }
+// Function to rename the old create_array_access_node to maintain compatibility
+ASTNode *create_array_access_node_single(char *name, ASTNode *index) {
+    // Create a wrapper that calls the multi-dimensional version with a single index
+    ASTNode *indices[1] = {index};
+    return create_multi_array_access_node(name, indices, 1);
+}
 
-            // Return the array's element type
-            return var->var_type;
-        }
-        yyerror("Undefined array in expression");
-        return NONE;
+// Calculate the memory offset for multi-dimensional array access
+size_t calculate_array_offset(Variable *var, int indices[], int num_indices) {
+    // Validate that the number of indices matches the number of dimensions
+    if (num_indices != var->array_dimensions.num_dimensions) {
+        char error_msg[100];
+        sprintf(error_msg, "Array '%s' has %d dimensions but accessed with %d indices", 
+                var->name, var->array_dimensions.num_dimensions, num_indices);
+        yyerror(error_msg);
+        interpreter_exit(EXIT_FAILURE);
     }
-    case NODE_IDENTIFIER:
-    {
-        // Look up the variable type in the symbol table
-        const char *array_name = node->data.name;
-        Variable *var = get_variable(array_name);
-        if (var != NULL)
-        {
-            return var->var_type;
+    
+    // Calculate the offset using row-major order
+    size_t offset = 0;
+    size_t multiplier = 1;
+    
+    // Start from the rightmost dimension
+    for (int i = num_indices - 1; i >= 0; i--) {
+        // Check if the index is within bounds
+        if (indices[i] < 0 || indices[i] >= var->array_dimensions.dimensions[i]) {
+            char error_msg[100];
+            sprintf(error_msg, "Array index out of bounds: dimension %d", i + 1);
+            yyerror(error_msg);
+            interpreter_exit(EXIT_FAILURE);
+        }
+        
+        offset += indices[i] * multiplier;
+        
+        // Update multiplier for the next dimension
+        if (i > 0) {
+            multiplier *= var->array_dimensions.dimensions[i];
         }
-        yyerror("Undefined variable in get_expression_type");
-        return NONE;
     }
-    case NODE_OPERATION:
-    {
-        // For binary operations, evaluate both operands to determine the highest type
-        int left_type = get_expression_type(node->data.op.left);
-        int right_type = get_expression_type(node->data.op.right);
+    
+    return offset;
+}
 
-        // Promote to the highest type (int -> float -> double)
-        if (left_type == VAR_DOUBLE || right_type == VAR_DOUBLE)
-            return VAR_DOUBLE;
-        else if (left_type == VAR_FLOAT || right_type == VAR_FLOAT)
-            return VAR_FLOAT;
-        else
-            return VAR_INT;
+// Look up the array an access node refers to and compute the element offset
+Variable *resolve_array_access(ASTNode *node, size_t *offset) {
+    // Get the variable
+    Variable *var = get_variable(node->data.array.name);
+    if (var == NULL || !var->is_array) {
+        char error_msg[100];
+        sprintf(error_msg, "Variable '%s' is not an array", node->data.array.name);
+        yyerror(error_msg);
+        interpreter_exit(EXIT_FAILURE);
     }
-    case NODE_UNARY_OPERATION:
-    {
-        return get_expression_type(node->data.unary.operand);
+    
+    // Extract the indices
+    int num_indices = node->data.array.num_dimensions;
+    int indices[MAX_DIMENSIONS];
+    
+    for (int i = 0; i < num_indices; i++) {
+        indices[i] = evaluate_expression_int(node->data.array.indices[i]);
     }
-    case NODE_SIZEOF:
-    {
-        return VAR_INT; // Sizeof always returns an integer
+    
+    // Calculate the offset
+    *offset = calculate_array_offset(var, indices, num_indices);
+    return var;
+}
+
+// Address of an element of an interleaved gang field, which skips a whole
+// record between consecutive record indices
+static void *strided_element_address(Variable *var, size_t offset) {
+    size_t record = offset / var->stride_span;
+    size_t index = offset % var->stride_span;
+    return (char *)var->value.array_data + record * var->stride +
+           index * get_element_size(var->var_type);
+}
+
+// Evaluate a multi-dimensional array access node
+void *evaluate_multi_array_access(ASTNode *node) {
+    size_t offset;
+    Variable *var = resolve_array_access(node, &offset);
+    if (var->stride)
+        return strided_element_address(var, offset);
+    
+    // Return a pointer to the element
+    switch (var->var_type) {
+        case VAR_INT:
+            return (int*)var->value.array_data + offset;
+        case VAR_SHORT:
+            return (short*)var->value.array_data + offset;
+        case VAR_FLOAT:
+            return (float*)var->value.array_data + offset;
+        case VAR_DOUBLE:
+            return (double*)var->value.array_data + offset;
+        case VAR_BOOL:
+            // Packed bits have no address; use evaluate_array_element and
+            // assign_array_element instead.
+            yyerror("Cannot take the address of a cap array element");
+            interpreter_exit(EXIT_FAILURE);
+        case VAR_CHAR:
+            return (char*)var->value.array_data + offset;
+        default:
+            yyerror("Unknown variable type");
+            interpreter_exit(EXIT_FAILURE);
     }
-    case NODE_FUNC_CALL:
-    {
-        // Look up the function in the symbol table
-        const char *func_name = node->data.func_call.function_name;
-        Function *func = get_function(func_name);
-        if (func != NULL)
-        {
-            return func->return_type;
+}
+
+// Read an array element converted from the array's own element type
+double evaluate_array_element(ASTNode *node) {
+    size_t offset;
+    Variable *var = resolve_array_access(node, &offset);
+
+    if (var->stride) {
+        void *element = strided_element_address(var, offset);
+        switch (var->var_type) {
+            case VAR_INT:
+                return *(int*)element;
+            case VAR_SHORT:
+                return *(short*)element;
+            case VAR_FLOAT:
+                return *(float*)element;
+            case VAR_DOUBLE:
+                return *(double*)element;
+            case VAR_BOOL:
+                return *(bool*)element;
+            case VAR_CHAR:
+                return *(char*)element;
+            default:
+                yyerror("Unknown variable type");
+                interpreter_exit(EXIT_FAILURE);
         }
-        yyerror("Undefined function in get_expression_type");
-        return NONE;
     }
-    default:
-        yyerror("Unknown node type in get_expression_type");
-        return NONE;
+
+    switch (var->var_type) {
+        case VAR_INT:
+            return ((int*)var->value.array_data)[offset];
+        case VAR_SHORT:
+            return ((short*)var->value.array_data)[offset];
+        case VAR_FLOAT:
+            return ((float*)var->value.array_data)[offset];
+        case VAR_DOUBLE:
+            return ((double*)var->value.array_data)[offset];
+        case VAR_BOOL:
+            return bitset_get(var->value.array_data, offset);
+        case VAR_CHAR:
+            return ((char*)var->value.array_data)[offset];
+        default:
+            yyerror("Unknown variable type");
+            interpreter_exit(EXIT_FAILURE);
     }
 }
 
-void *handle_binary_operation(ASTNode *node)
+bool set_int_variable(const char *name, int value, TypeModifiers mods)
 {
-    if (!node || node->type != NODE_OPERATION)
-    {
-        yyerror("Invalid binary operation node");
-        return NULL;
+    return set_variable(name, &value, VAR_INT, mods);
+}
+
+bool set_char_variable(const char *name, int value, TypeModifiers mods)
+{
+    return set_variable(name, &value, VAR_CHAR, mods);
+}
+
+bool set_array_variable(char *name, int length, TypeModifiers mods, VarType type)
+{
+    // search for an existing variable
+    Variable *var = get_variable(name);
+    if (var != NULL)
+    {
+        if (var->is_array)
+        {
+            // free the old array
+            SAFE_FREE(var->value.array_data);
+        }
+        var->var_type = type;
+        var->is_array = true;
+        var->array_length = length;
+        var->modifiers = mods;
+        // safe_malloc hands out zeroed memory, so nothing is cleared here
+        switch (type)
+        {
+        case VAR_INT:
+            var->value.array_data = SAFE_MALLOC_ARRAY(int, length);
+            break;
+        case VAR_SHORT:
+            var->value.array_data = SAFE_MALLOC_ARRAY(short, length);
+            break;
+        case VAR_FLOAT:
+            var->value.array_data = SAFE_MALLOC_ARRAY(float, length);
+            break;
+        case VAR_DOUBLE:
+            var->value.array_data = SAFE_MALLOC_ARRAY(double, length);
+            break;
+        case VAR_BOOL:
+            var->value.array_data = SAFE_MALLOC_ARRAY(bitset_word, bitset_words(length));
+            break;
+        case VAR_CHAR:
+            var->value.array_data = SAFE_MALLOC_ARRAY(char, length);
+            break;
+        default:
+            break;
+        }
+        return true;
     }
 
-    // Evaluate left and right operands.
-    void *left_value = NULL;
-    void *right_value = NULL;
+    return false; // no space
+}
 
-    // Determine the actual types of the operands.
-    int left_type = get_expression_type(node->data.op.left);
-    int right_type = get_expression_type(node->data.op.right);
+bool set_short_variable(const char *name, short value, TypeModifiers mods)
+{
+    return set_variable(name, &value, VAR_SHORT, mods);
+}
 
-    // Promote types if necessary (short -> int -> float -> double).
-    int promoted_type = VAR_SHORT;
-    if (left_type == VAR_DOUBLE || right_type == VAR_DOUBLE)
-        promoted_type = VAR_DOUBLE;
-    else if (left_type == VAR_FLOAT || right_type == VAR_FLOAT)
-        promoted_type = VAR_FLOAT;
-    else if (left_type == VAR_INT || right_type == VAR_INT)
-        promoted_type = VAR_INT;
+bool set_float_variable(const char *name, float value, TypeModifiers mods)
+{
+    return set_variable(name, &value, VAR_FLOAT, mods);
+}
 
-    // Allocate and evaluate operands based on promoted type.
-    switch (promoted_type)
-    {
-    case VAR_INT:
-        left_value = SAFE_MALLOC(int);
-        right_value = SAFE_MALLOC(int);
-        *(int *)left_value = evaluate_expression_int(node->data.op.left);
-        *(int *)right_value = evaluate_expression_int(node->data.op.right);
-        break;
+bool set_double_variable(const char *name, double value, TypeModifiers mods)
+{
+    return set_variable(name, &value, VAR_DOUBLE, mods);
+}
 
-    case VAR_FLOAT:
-        left_value = SAFE_MALLOC(float);
-        right_value = SAFE_MALLOC(float);
-        *(float *)left_value = (left_type == VAR_INT)
-                                   ? (float)evaluate_expression_int(node->data.op.left)
-                                   : evaluate_expression_float(node->data.op.left);
-        *(float *)right_value = (right_type == VAR_INT)
-                                    ? (float)evaluate_expression_int(node->data.op.right)
-                                    : evaluate_expression_float(node->data.op.right);
-        break;
+bool set_bool_variable(const char *name, bool value, TypeModifiers mods)
+{
+    return set_variable(name, &value, VAR_BOOL, mods);
+}
 
-    case VAR_DOUBLE:
-        left_value = SAFE_MALLOC(double);
-        right_value = SAFE_MALLOC(double);
-        *(double *)left_value = (left_type == VAR_INT)
-                                    ? (double)evaluate_expression_int(node->data.op.left)
-                                : (left_type == VAR_FLOAT)
-                                    ? (double)evaluate_expression_float(node->data.op.left)
-                                    : evaluate_expression_double(node->data.op.left);
-        *(double *)right_value = (right_type == VAR_INT)
-                                     ? (double)evaluate_expression_int(node->data.op.right)
-                                 : (right_type == VAR_FLOAT)
-                                     ? (double)evaluate_expression_float(node->data.op.right)
-                                     : evaluate_expression_double(node->data.op.right);
-        break;
-    case VAR_SHORT:
-        left_value = SAFE_MALLOC(short);
-        right_value = SAFE_MALLOC(short);
-        *(short *)left_value = evaluate_expression_short(node->data.op.left);
-        *(short *)right_value = evaluate_expression_short(node->data.op.right);
-        break;
+void reset_modifiers(void)
+{
+    current_interpreter->modifiers.is_volatile = false;
+    current_interpreter->modifiers.is_signed = false;
+    current_interpreter->modifiers.is_unsigned = false;
+    current_interpreter->modifiers.is_const = false;
+}
 
-    default:
-        yyerror("Unsupported type promotion");
-        return NULL;
-    }
+TypeModifiers get_current_modifiers(void)
+{
+    TypeModifiers mods = current_interpreter->modifiers;
+    reset_modifiers(); // Reset for next declaration
+    return mods;
+}
 
-    
-    // Perform the operation and allocate the result.
-    void *result;
-    if (promoted_type == VAR_DOUBLE)
-    {
-        result = SAFE_MALLOC(double);
-    }
-    else if (promoted_type == VAR_FLOAT)
-    {
-        result = SAFE_MALLOC(float);
-    }
-    else if (promoted_type == VAR_SHORT)
-    {
-        result = SAFE_MALLOC(short);
-    }
+
+/* Function implementations */
+
+// Errors about identifiers report two lines above the current one
+static void step_back_error_line(void)
+{
+    if (current_interpreter->parsed)
+        current_interpreter->lineno -= 2;
     else
-    {
-        result = SAFE_MALLOC(int);
-    }
+        yylineno -= 2;
+}
 
-    switch (node->data.op.op)
-    {
-    case OP_PLUS:
-        if (promoted_type == VAR_INT)
-            *(int *)result = *(int *)left_value + *(int *)right_value;
-        else if (promoted_type == VAR_FLOAT)
-            *(float *)result = *(float *)left_value + *(float *)right_value;
-        else if (promoted_type == VAR_DOUBLE)
-            *(double *)result = *(double *)left_value + *(double *)right_value;
-        else if (promoted_type == VAR_SHORT)
-            *(short *)result = *(short *)left_value + *(short *)right_value;
-        break;
+bool check_and_mark_identifier(ASTNode *node, const char *contextErrorMessage)
+{
+    // Only a successful lookup is cached, and squad flex slices may get here
+    // together, so the flag is read and written atomically.
+    if (__atomic_load_n(&node->already_checked, __ATOMIC_ACQUIRE))
+        return true;
 
-    case OP_MINUS:
-        if (promoted_type == VAR_INT)
-            *(int *)result = *(int *)left_value - *(int *)right_value;
-        else if (promoted_type == VAR_FLOAT)
-            *(float *)result = *(float *)left_value - *(float *)right_value;
-        else if (promoted_type == VAR_DOUBLE)
-            *(double *)result = *(double *)left_value - *(double *)right_value;
-        else if (promoted_type == VAR_SHORT)
-            *(short *)result = *(short *)left_value - *(short *)right_value;
+    // Do the table lookup
+    if (get_variable(node->data.name) == NULL)
+    {
+        step_back_error_line();
+        yyerror(contextErrorMessage);
+        return false;
+    }
 
-        break;
+    node->is_valid_symbol = true;
+    __atomic_store_n(&node->already_checked, true, __ATOMIC_RELEASE);
+    return true;
+}
 
-    case OP_TIMES:
-        if (promoted_type == VAR_INT)
-            *(int *)result = *(int *)left_value * *(int *)right_value;
-        else if (promoted_type == VAR_FLOAT)
-            *(float *)result = *(float *)left_value * *(float *)right_value;
-        else if (promoted_type == VAR_DOUBLE)
-            *(double *)result = *(double *)left_value * *(double *)right_value;
-        else if (promoted_type == VAR_SHORT)
-            *(short *)result = *(short *)left_value * *(short *)right_value;
-        break;
+void execute_switch_statement(ASTNode *node)
+{
+    int switch_value = evaluate_expression(node->data.switch_stmt.expression);
+    CaseNode *current_case = node->data.switch_stmt.cases;
+    int matched = 0;
+    Scope *saved_scope = current_scope;
 
-    case OP_DIVIDE:
-        if (promoted_type == VAR_INT)
-        {
-            if (*(int *)right_value == 0)
-            {
-                yyerror("Division by zero");
-                *(int *)result = 0; // Define a fallback behavior for int division by zero
-            }
-            else
-            {
-                *(int *)result = *(int *)left_value / *(int *)right_value;
-            }
-        }
-        else if (promoted_type == VAR_FLOAT)
+    PUSH_JUMP_BUFFER();
+    if (setjmp(CURRENT_JUMP_BUFFER()) == 0)
+    {
+        while (current_case)
         {
-            float right = *(float *)right_value;
-            float left = *(float *)left_value;
-
-            if (fabsf(right) < __FLT_MIN__)
+            if (current_case->value)
             {
-                if (fabsf(left) < __FLT_MIN__)
-                {
-                    *(float *)result = 0.0f / 0.0f; // NaN
-                }
-                else
+                int case_value = evaluate_expression(current_case->value);
+                if (case_value == switch_value || matched)
                 {
-                    *(float *)result = left > 0 ? __FLT_MAX__ : -__FLT_MAX__;
+                    matched = 1;
+                    execute_statements(current_case->statements);
                 }
             }
             else
             {
-                *(float *)result = left / right;
-            }
-        }
-        else if (promoted_type == VAR_DOUBLE)
-        {
-            double right = *(double *)right_value;
-            double left = *(double *)left_value;
-
-            if (fabs(right) < __DBL_MIN__)
-            {
-                if (fabs(left) < __DBL_MIN__)
-                {
-                    *(double *)result = 0.0 / 0.0; // NaN
-                }
-                else
+                // Default case
+                if (matched || !matched)
                 {
-                    *(double *)result = left > 0 ? __DBL_MAX__ : -__DBL_MAX__;
+                    execute_statements(current_case->statements);
+                    break;
                 }
             }
-            else
-            {
-                *(double *)result = left / right;
-            }
+            current_case = current_case->next;
+        }
+    }
+    else
+    {
+        // Break encountered; leave any scopes it jumped out of
+        while (current_scope != saved_scope)
+            exit_scope();
+    }
+    POP_JUMP_BUFFER();
+}
+
+static ASTNode *create_node(NodeType type, VarType var_type, TypeModifiers modifiers)
+{
+    ASTNode *node = ARENA_ALLOC(ASTNode);
+    if (!node)
+    {
+        yyerror("Error: Memory allocation failed for ASTNode.\n");
+        interpreter_exit(EXIT_FAILURE);
+    }
+    node->type = type;
+    node->var_type = var_type;
+    node->modifiers = modifiers;
+    node->already_checked = false;
+    node->is_valid_symbol = false;
+    return node;
+}
+
+ASTNode *create_int_node(int value)
+{
+    ASTNode *node = create_node(NODE_INT, VAR_INT, current_interpreter->modifiers);
+    SET_DATA_INT(node, value);
+    return node;
+}
+
+ASTNode *create_array_declaration_node(char *name, int length, VarType var_type)
+{
+    ASTNode *node = ARENA_ALLOC(ASTNode);
+    if (!node)
+        return NULL;
+
+    node->type = NODE_ARRAY_ACCESS;
+    node->var_type = var_type;
+    node->is_array = true;
+    node->array_length = length;
+    node->data.array.name = ARENA_STRDUP(name);
+    return node;
+}
+
+ASTNode *create_array_access_node(char *name, ASTNode *index)
+{
+    ASTNode *node = ARENA_ALLOC(ASTNode);
+    if (!node)
+    {
+        yyerror("Memory allocation failed");
+        interpreter_exit(EXIT_FAILURE);
+    }
+
+    node->type = NODE_ARRAY_ACCESS;
+    node->data.array.name = ARENA_STRDUP(name);
+    node->data.array.index = index;
+    node->is_array = true;
+
+    // Look up and set the array's type from the symbol table
+    Variable *var = get_variable(name);
+    if (var != NULL)
+    {
+        node->var_type = var->var_type;
+        node->array_length = var->array_length;
+        node->modifiers = var->modifiers;
+    }
+
+    return node;
+}
+
+ASTNode *create_short_node(short value)
+{
+    ASTNode *node = create_node(NODE_SHORT, VAR_SHORT, current_interpreter->modifiers);
+    SET_DATA_SHORT(node, value);
+    return node;
+}
+
+ASTNode *create_float_node(float value)
+{
+    ASTNode *node = create_node(NODE_FLOAT, VAR_FLOAT, current_interpreter->modifiers);
+    SET_DATA_FLOAT(node, value);
+    return node;
+}
+
+ASTNode *create_char_node(char value)
+{
+    ASTNode *node = create_node(NODE_CHAR, VAR_CHAR, current_interpreter->modifiers);
+    SET_DATA_INT(node, value); // Store char as integer
+    return node;
+}
+
+ASTNode *create_boolean_node(bool value)
+{
+    ASTNode *node = create_node(NODE_BOOLEAN, VAR_BOOL, current_interpreter->modifiers);
+    SET_DATA_BOOL(node, value);
+    return node;
+}
+
+ASTNode *create_identifier_node(char *name)
+{
+    ASTNode *node = create_node(NODE_IDENTIFIER, NONE, current_interpreter->modifiers);
+    SET_DATA_NAME(node, name);
+    return node;
+}
+
+ASTNode *create_assignment_node(char *name, ASTNode *expr)
+{
+    ASTNode *node = create_node(NODE_ASSIGNMENT, current_var_type, get_current_modifiers());
+    SET_DATA_OP(node, create_identifier_node(name), expr, OP_ASSIGN);
+    return node;
+}
+
+ASTNode *create_declaration_node(char *name, ASTNode *expr)
+{
+    ASTNode *node = create_node(NODE_DECLARATION, current_var_type, get_current_modifiers());
+    SET_DATA_OP(node, create_identifier_node(name), expr, OP_ASSIGN);
+    return node;
+}
+
+ASTNode *create_operation_node(OperatorType op, ASTNode *left, ASTNode *right)
+{
+    ASTNode *node = create_node(NODE_OPERATION, NONE, current_interpreter->modifiers);
+    SET_DATA_OP(node, left, right, op);
+    return node;
+}
+
+ASTNode *create_unary_operation_node(OperatorType op, ASTNode *operand)
+{
+    ASTNode *node = create_node(NODE_UNARY_OPERATION, NONE, current_interpreter->modifiers);
+    SET_DATA_UNARY_OP(node, operand, op);
+    return node;
+}
+
+ASTNode *create_for_statement_node(ASTNode *init, ASTNode *cond, ASTNode *incr, ASTNode *body)
+{
+    ASTNode *node = create_node(NODE_FOR_STATEMENT, NONE, current_interpreter->modifiers);
+    SET_DATA_FOR(node, init, cond, incr, body);
+    node->data.for_stmt.parallel = find_parallel_loop(node);
+    return node;
+}
+
+ASTNode *create_while_statement_node(ASTNode *cond, ASTNode *body)
+{
+    ASTNode *node = create_node(NODE_WHILE_STATEMENT, NONE, current_interpreter->modifiers);
+    SET_DATA_WHILE(node, cond, body);
+    return node;
+}
+
+ASTNode *create_do_while_statement_node(ASTNode *cond, ASTNode *body)
+{
+    ASTNode *node = create_node(NODE_DO_WHILE_STATEMENT, NONE, current_interpreter->modifiers);
+    SET_DATA_WHILE(node, cond, body);
+    return node;
+}
+
+ASTNode *create_function_call_node(char *func_name, ArgumentList *args)
+{
+    ASTNode *node = create_node(NODE_FUNC_CALL, NONE, current_interpreter->modifiers);
+    SET_DATA_FUNC_CALL(node, func_name, args);
+    return node;
+}
+
+ASTNode *create_double_node(double value)
+{
+    ASTNode *node = create_node(NODE_DOUBLE, VAR_DOUBLE, current_interpreter->modifiers);
+    SET_DATA_DOUBLE(node, value);
+    return node;
+}
+
+ASTNode *create_sizeof_node(ASTNode *expr)
+{
+    ASTNode *node = create_node(NODE_SIZEOF, NONE, current_interpreter->modifiers);
+    SET_SIZEOF(node, expr);
+    return node;
+}
+
+// @param promotion: 0 for no promotion, 1 for promotion to double 2 for promotion to float
+void *handle_identifier(ASTNode *node, const char *contextErrorMessage, int promote)
+{
+    if (!check_and_mark_identifier(node, contextErrorMessage))
+        interpreter_exit(1);
+
+    char *name = node->data.name;
+    Variable *var = get_variable(name);
+    if (var != NULL && var->is_simd)
+        simd_error("'%s' is a vector; read one lane with [i] or reduce it with hsum, hmin or hmax", name);
+    if (var != NULL)
+    {
+        static _Thread_local Value promoted_value;
+        if (promote == 1)
+        {
+
+            switch (var->var_type)
+            {
+            case VAR_DOUBLE:
+                return &var->value.dvalue;
+            case VAR_FLOAT:
+                promoted_value.dvalue = (double)var->value.fvalue;
+                return &promoted_value;
+            case VAR_INT:
+            case VAR_CHAR:
+            case VAR_SHORT:
+                promoted_value.dvalue = (double)var->value.svalue;
+                return &promoted_value;
+            case VAR_BOOL:
+                promoted_value.dvalue = (double)var->value.ivalue;
+                return &promoted_value;
+            default:
+                yyerror("Unsupported variable type");
+                return NULL;
+            }
+        }
+        else if (promote == 2)
+        {
+            switch (var->var_type)
+            {
+            case VAR_DOUBLE:
+                promoted_value.fvalue = (float)var->value.dvalue;
+                return &promoted_value.fvalue;
+            case VAR_FLOAT:
+                return &var->value.fvalue;
+            case VAR_INT:
+            case VAR_CHAR:
+            case VAR_SHORT:
+                promoted_value.fvalue = (float)var->value.svalue;
+                return &promoted_value.svalue;
+            case VAR_BOOL:
+                promoted_value.fvalue = (float)var->value.ivalue;
+                return &promoted_value.fvalue;
+            default:
+                yyerror("Unsupported variable type");
+                return NULL;
+            }
+        }
+        else
+        {
+            switch (var->var_type)
+            {
+            case VAR_DOUBLE:
+                return &var->value.dvalue;
+            case VAR_FLOAT:
+                return &var->value.fvalue;
+            case VAR_INT:
+            case VAR_CHAR:
+            case VAR_SHORT:
+                return &var->value.svalue;
+            case VAR_BOOL:
+                return &var->value.ivalue;
+            default:
+                yyerror("Unsupported variable type");
+                return NULL;
+            }
+        }
+    }
+    yyerror("Undefined variable");
+    return NULL;
+}
+
+int get_expression_type(ASTNode *node)
+{
+    if (!node)
+    {
+        yyerror("Null node in get_expression_type");
+        return NONE; // Return an unknown type if the node is null
+    }
+
+    switch (node->type)
+    {
+    case NODE_INT:
+        return VAR_INT;
+    case NODE_SHORT:
+        return VAR_SHORT;
+    case NODE_FLOAT:
+        return VAR_FLOAT;
+    case NODE_DOUBLE:
+        return VAR_DOUBLE;
+    case NODE_BOOLEAN:
+        return VAR_BOOL;
+    case NODE_CHAR:
+        return VAR_INT;
+    case NODE_ARRAY_ACCESS:
+    {
+        // First, get the array's base type from symbol table
+        const char *array_name = node->data.array.name;
+        Variable *var = get_variable(array_name);
+        if (var != NULL)
+        {
+            size_t offset;
+            resolve_array_access(node, &offset);
+
+            // Return the array's element type
+            return var->var_type;
+        }
+        yyerror("Undefined array in expression");
+        return NONE;
+    }
+    case NODE_IDENTIFIER:
+    {
+        // Look up the variable type in the symbol table
+        const char *array_name = node->data.name;
+        Variable *var = get_variable(array_name);
+        if (var != NULL)
+        {
+            return var->var_type;
+        }
+        yyerror("Undefined variable in get_expression_type");
+        return NONE;
+    }
+    case NODE_OPERATION:
+    {
+        // For binary operations, evaluate both operands to determine the highest type
+        int left_type = get_expression_type(node->data.op.left);
+        int right_type = get_expression_type(node->data.op.right);
+
+        // Promote to the highest type (int -> float -> double)
+        if (left_type == VAR_DOUBLE || right_type == VAR_DOUBLE)
+            return VAR_DOUBLE;
+        else if (left_type == VAR_FLOAT || right_type == VAR_FLOAT)
+            return VAR_FLOAT;
+        else
+            return VAR_INT;
+    }
+    case NODE_UNARY_OPERATION:
+    {
+        return get_expression_type(node->data.unary.operand);
+    }
+    case NODE_SIZEOF:
+    {
+        return VAR_INT; // Sizeof always returns an integer
+    }
+    case NODE_FUNC_CALL:
+    {
+        // Look up the function in the symbol table
+        const char *func_name = node->data.func_call.function_name;
+        const Builtin *builtin = get_builtin(func_name);
+        if (builtin != NULL)
+        {
+            return get_builtin_return_type(builtin, node->data.func_call.arguments);
+        }
+        Function *func = get_function(func_name);
+        if (func != NULL)
+        {
+            return func->return_type;
+        }
+        yyerror("Undefined function in get_expression_type");
+        return NONE;
+    }
+    default:
+        yyerror("Unknown node type in get_expression_type");
+        return NONE;
+    }
+}
+
+void *handle_binary_operation(ASTNode *node)
+{
+    if (!node || node->type != NODE_OPERATION)
+    {
+        yyerror("Invalid binary operation node");
+        return NULL;
+    }
+
+    // Evaluate left and right operands.
+    void *left_value = NULL;
+    void *right_value = NULL;
+
+    // Determine the actual types of the operands.
+    int left_type = get_expression_type(node->data.op.left);
+    int right_type = get_expression_type(node->data.op.right);
+
+    // Promote types if necessary (short -> int -> float -> double).
+    int promoted_type = VAR_SHORT;
+    if (left_type == VAR_DOUBLE || right_type == VAR_DOUBLE)
+        promoted_type = VAR_DOUBLE;
+    else if (left_type == VAR_FLOAT || right_type == VAR_FLOAT)
+        promoted_type = VAR_FLOAT;
+    else if (left_type == VAR_INT || right_type == VAR_INT)
+        promoted_type = VAR_INT;
+
+    // Allocate and evaluate operands based on promoted type.
+    switch (promoted_type)
+    {
+    case VAR_INT:
+        left_value = SAFE_MALLOC(int);
+        right_value = SAFE_MALLOC(int);
+        *(int *)left_value = evaluate_expression_int(node->data.op.left);
+        *(int *)right_value = evaluate_expression_int(node->data.op.right);
+        break;
+
+    case VAR_FLOAT:
+        left_value = SAFE_MALLOC(float);
+        right_value = SAFE_MALLOC(float);
+        *(float *)left_value = (left_type == VAR_INT)
+                                   ? (float)evaluate_expression_int(node->data.op.left)
+                                   : evaluate_expression_float(node->data.op.left);
+        *(float *)right_value = (right_type == VAR_INT)
+                                    ? (float)evaluate_expression_int(node->data.op.right)
+                                    : evaluate_expression_float(node->data.op.right);
+        break;
+
+    case VAR_DOUBLE:
+        left_value = SAFE_MALLOC(double);
+        right_value = SAFE_MALLOC(double);
+        *(double *)left_value = (left_type == VAR_INT)
+                                    ? (double)evaluate_expression_int(node->data.op.left)
+                                : (left_type == VAR_FLOAT)
+                                    ? (double)evaluate_expression_float(node->data.op.left)
+                                    : evaluate_expression_double(node->data.op.left);
+        *(double *)right_value = (right_type == VAR_INT)
+                                     ? (double)evaluate_expression_int(node->data.op.right)
+                                 : (right_type == VAR_FLOAT)
+                                     ? (double)evaluate_expression_float(node->data.op.right)
+                                     : evaluate_expression_double(node->data.op.right);
+        break;
+    case VAR_SHORT:
+        left_value = SAFE_MALLOC(short);
+        right_value = SAFE_MALLOC(short);
+        *(short *)left_value = evaluate_expression_short(node->data.op.left);
+        *(short *)right_value = evaluate_expression_short(node->data.op.right);
+        break;
+
+    default:
+        yyerror("Unsupported type promotion");
+        return NULL;
+    }
+
+    
+    // Perform the operation and allocate the result.
+    void *result;
+    if (promoted_type == VAR_DOUBLE)
+    {
+        result = SAFE_MALLOC(double);
+    }
+    else if (promoted_type == VAR_FLOAT)
+    {
+        result = SAFE_MALLOC(float);
+    }
+    else if (promoted_type == VAR_SHORT)
+    {
+        result = SAFE_MALLOC(short);
+    }
+    else
+    {
+        result = SAFE_MALLOC(int);
+    }
+
+    switch (node->data.op.op)
+    {
+    case OP_PLUS:
+        if (promoted_type == VAR_INT)
+            *(int *)result = *(int *)left_value + *(int *)right_value;
+        else if (promoted_type == VAR_FLOAT)
+            *(float *)result = *(float *)left_value + *(float *)right_value;
+        else if (promoted_type == VAR_DOUBLE)
+            *(double *)result = *(double *)left_value + *(double *)right_value;
+        else if (promoted_type == VAR_SHORT)
+            *(short *)result = *(short *)left_value + *(short *)right_value;
+        break;
+
+    case OP_MINUS:
+        if (promoted_type == VAR_INT)
+            *(int *)result = *(int *)left_value - *(int *)right_value;
+        else if (promoted_type == VAR_FLOAT)
+            *(float *)result = *(float *)left_value - *(float *)right_value;
+        else if (promoted_type == VAR_DOUBLE)
+            *(double *)result = *(double *)left_value - *(double *)right_value;
+        else if (promoted_type == VAR_SHORT)
+            *(short *)result = *(short *)left_value - *(short *)right_value;
+
+        break;
+
+    case OP_TIMES:
+        if (promoted_type == VAR_INT)
+            *(int *)result = *(int *)left_value * *(int *)right_value;
+        else if (promoted_type == VAR_FLOAT)
+            *(float *)result = *(float *)left_value * *(float *)right_value;
+        else if (promoted_type == VAR_DOUBLE)
+            *(double *)result = *(double *)left_value * *(double *)right_value;
+        else if (promoted_type == VAR_SHORT)
+            *(short *)result = *(short *)left_value * *(short *)right_value;
+        break;
+
+    case OP_DIVIDE:
+        if (promoted_type == VAR_INT)
+        {
+            if (*(int *)right_value == 0)
+            {
+                yyerror("Division by zero");
+                *(int *)result = 0; // Define a fallback behavior for int division by zero
+            }
+            else
+            {
+                *(int *)result = *(int *)left_value / *(int *)right_value;
+            }
+        }
+        else if (promoted_type == VAR_FLOAT)
+        {
+            float right = *(float *)right_value;
+            float left = *(float *)left_value;
+
+            if (fabsf(right) < __FLT_MIN__)
+            {
+                if (fabsf(left) < __FLT_MIN__)
+                {
+                    *(float *)result = 0.0f / 0.0f; // NaN
+                }
+                else
+                {
+                    *(float *)result = left > 0 ? __FLT_MAX__ : -__FLT_MAX__;
+                }
+            }
+            else
+            {
+                *(float *)result = left / right;
+            }
+        }
+        else if (promoted_type == VAR_DOUBLE)
+        {
+            double right = *(double *)right_value;
+            double left = *(double *)left_value;
+
+            if (fabs(right) < __DBL_MIN__)
+            {
+                if (fabs(left) < __DBL_MIN__)
+                {
+                    *(double *)result = 0.0 / 0.0; // NaN
+                }
+                else
+                {
+                    *(double *)result = left > 0 ? __DBL_MAX__ : -__DBL_MAX__;
+                }
+            }
+            else
+            {
+                *(double *)result = left / right;
+            }
+        }
+        else if (promoted_type == VAR_SHORT)
+        {
+            if (*(short *)right_value == 0)
+            {
+                yyerror("Division by zero");
+                *(short *)result = 0; // Define a fallback behavior for short division by zero
+            }
+            else
+            {
+                *(short *)result = *(short *)left_value / *(short *)right_value;
+            }
+        }
+        break;
+    case OP_MOD:
+        if (promoted_type == VAR_INT)
+        {
+            int left = *(int *)left_value;
+            int right = *(int *)right_value;
+
+            if (right == 0)
+            {
+                yyerror("Modulo by zero");
+                *(int *)result = 0; // Define fallback for modulo by zero
+            }
+            else if (node->modifiers.is_unsigned)
+            {
+                // Explicitly handle unsigned modulo
+                unsigned int ul = (unsigned int)left;
+                unsigned int ur = (unsigned int)right;
+                *(int *)result = (int)(ul % ur);
+            }
+            else
+            {
+                *(int *)result = left % right;
+            }
+        }
+        else if (promoted_type == VAR_FLOAT)
+        {
+            *(float *)result = fmod(*(float *)left_value, *(float *)right_value);
+        }
+        else if (promoted_type == VAR_DOUBLE)
+        {
+            *(double *)result = fmod(*(double *)left_value, *(double *)right_value);
+        }
+        else if (promoted_type == VAR_SHORT)
+        {
+            *(short *)result = *(short *)left_value % *(short *)right_value;
+        }
+        break;
+    case OP_LT:
+        if (promoted_type == VAR_INT)
+            *(int *)result = *(int *)left_value < *(int *)right_value;
+        else if (promoted_type == VAR_FLOAT)
+            *(float *)result = *(float *)left_value < *(float *)right_value;
+        else if (promoted_type == VAR_DOUBLE)
+            *(double *)result = *(double *)left_value < *(double *)right_value;
+        else if (promoted_type == VAR_SHORT)
+            *(short *)result = *(short *)left_value < *(short *)right_value;
+        break;
+
+    case OP_GT:
+        if (promoted_type == VAR_INT)
+            *(int *)result = *(int *)left_value > *(int *)right_value;
+        else if (promoted_type == VAR_FLOAT)
+            *(float *)result = *(float *)left_value > *(float *)right_value;
+        else if (promoted_type == VAR_DOUBLE)
+            *(double *)result = *(double *)left_value > *(double *)right_value;
+        else if (promoted_type == VAR_SHORT)
+            *(short *)result = *(short *)left_value > *(short *)right_value;
+        break;
+
+    case OP_LE:
+        if (promoted_type == VAR_INT)
+            *(int *)result = *(int *)left_value <= *(int *)right_value;
+        else if (promoted_type == VAR_FLOAT)
+            *(float *)result = *(float *)left_value <= *(float *)right_value;
+        else if (promoted_type == VAR_DOUBLE)
+            *(double *)result = *(double *)left_value <= *(double *)right_value;
+        else if (promoted_type == VAR_SHORT)
+            *(short *)result = *(short *)left_value <= *(short *)right_value;
+        else if (promoted_type == VAR_SHORT)
+            *(short *)result = *(short *)left_value <= *(short *)right_value;
+        break;
+
+    case OP_GE:
+        if (promoted_type == VAR_INT)
+            *(int *)result = *(int *)left_value >= *(int *)right_value;
+        else if (promoted_type == VAR_FLOAT)
+            *(float *)result = *(float *)left_value >= *(float *)right_value;
+        else if (promoted_type == VAR_DOUBLE)
+            *(double *)result = *(double *)left_value >= *(double *)right_value;
+        else if (promoted_type == VAR_SHORT)
+            *(short *)result = *(short *)left_value >= *(short *)right_value;
+        else if (promoted_type == VAR_SHORT)
+            *(short *)result = *(short *)left_value >= *(short *)right_value;
+        break;
+
+    case OP_EQ:
+
+        if (promoted_type == VAR_INT)
+            *(int *)result = *(int *)left_value == *(int *)right_value;
+        else if (promoted_type == VAR_FLOAT)
+            *(float *)result = *(float *)left_value == *(float *)right_value;
+        else if (promoted_type == VAR_DOUBLE)
+            *(double *)result = *(double *)left_value == *(double *)right_value;
+        else if (promoted_type == VAR_SHORT)
+            *(short *)result = *(short *)left_value == *(short *)right_value;
+        break;
+
+    case OP_NE:
+        if (promoted_type == VAR_INT)
+            *(int *)result = *(int *)left_value != *(int *)right_value;
+        else if (promoted_type == VAR_FLOAT)
+            *(float *)result = *(float *)left_value != *(float *)right_value;
+        else if (promoted_type == VAR_DOUBLE)
+            *(double *)result = *(double *)left_value != *(double *)right_value;
+        else if (promoted_type == VAR_SHORT)
+            *(short *)result = *(short *)left_value != *(short *)right_value;
+        break;
+
+    case OP_AND:
+        if (promoted_type == VAR_INT)
+            *(int *)result = *(int *)left_value && *(int *)right_value;
+        else if (promoted_type == VAR_FLOAT)
+            *(float *)result = *(float *)left_value && *(float *)right_value;
+        else if (promoted_type == VAR_DOUBLE)
+            *(double *)result = *(double *)left_value && *(double *)right_value;
+        else if (promoted_type == VAR_SHORT)
+            *(short *)result = *(short *)left_value && *(short *)right_value;
+        break;
+
+    case OP_OR:
+        if (promoted_type == VAR_INT)
+            *(int *)result = *(int *)left_value || *(int *)right_value;
+        else if (promoted_type == VAR_FLOAT)
+            *(float *)result = *(float *)left_value || *(float *)right_value;
+        else if (promoted_type == VAR_DOUBLE)
+            *(double *)result = *(double *)left_value || *(double *)right_value;
+        else if (promoted_type == VAR_SHORT)
+            *(short *)result = *(short *)left_value || *(short *)right_value;
+        break;
+
+    default:
+        yyerror("Unsupported binary operator");
+        SAFE_FREE(result);
+        result = NULL;
+    }
+
+    SAFE_FREE(left_value);
+    SAFE_FREE(right_value);
+
+    return result;
+}
+
+void *handle_unary_expression(ASTNode *node, void *operand_value, int operand_type)
+{
+    switch (node->data.unary.op)
+    {
+    case OP_NEG:
+        if (operand_type == VAR_INT)
+        {
+            int *result = SAFE_MALLOC(int);
+            *result = -(*(int *)operand_value);
+            return result;
+        }
+        else if (operand_type == VAR_SHORT)
+        {
+            short *result = SAFE_MALLOC(short);
+            *result = !(*(short *)operand_value);
+            return result;
+        }
+        else if (operand_type == VAR_FLOAT)
+        {
+            float *result = SAFE_MALLOC(float);
+            *result = -(*(float *)operand_value);
+            return result;
+        }
+        else if (operand_type == VAR_DOUBLE)
+        {
+            double *result = SAFE_MALLOC(double);
+            *result = -(*(double *)operand_value);
+            return result;
+        }
+        else if (operand_type == VAR_BOOL)
+        {
+            bool *result = SAFE_MALLOC(bool);
+            *result = !(*(bool *)operand_value);
+            return result;
+        }
+        else
+        {
+            yyerror("Invalid type for unary negation");
+            return NULL;
+        }
+
+    case OP_PRE_INC:
+        if (operand_type == VAR_INT)
+        {
+            int *result = SAFE_MALLOC(int);
+            *result = *(int *)operand_value + 1;
+            set_int_variable(node->data.unary.operand->data.name, *result, get_variable_modifiers(node->data.unary.operand->data.name));
+            return result;
+        }
+        else if (operand_type == VAR_SHORT)
+        {
+            short *result = SAFE_MALLOC(short);
+            *result = *(short *)operand_value + 1;
+            set_short_variable(node->data.unary.operand->data.name, *result, get_variable_modifiers(node->data.unary.operand->data.name));
+            return result;
+        }
+        else if (operand_type == VAR_FLOAT)
+        {
+            float *result = SAFE_MALLOC(float);
+            *result = *(float *)operand_value + 1;
+            set_float_variable(node->data.unary.operand->data.name, *result, get_variable_modifiers(node->data.unary.operand->data.name));
+            return result;
+        }
+        else if (operand_type == VAR_DOUBLE)
+        {
+            double *result = SAFE_MALLOC(double);
+            *result = *(double *)operand_value + 1;
+            set_double_variable(node->data.unary.operand->data.name, *result, get_variable_modifiers(node->data.unary.operand->data.name));
+            return result;
+        }
+        else
+        {
+            yyerror("Invalid type for pre-increment");
+            return NULL;
+        }
+    case OP_PRE_DEC:
+        if (operand_type == VAR_INT)
+        {
+            int *result = SAFE_MALLOC(int);
+            *result = *(int *)operand_value - 1;
+            set_int_variable(node->data.unary.operand->data.name, *result, get_variable_modifiers(node->data.unary.operand->data.name));
+            return result;
+        }
+        else if (operand_type == VAR_SHORT)
+        {
+            short *result = SAFE_MALLOC(short);
+            *result = *(short *)operand_value - 1;
+            set_short_variable(node->data.unary.operand->data.name, *result, get_variable_modifiers(node->data.unary.operand->data.name));
+            return result;
+        }
+        else if (operand_type == VAR_FLOAT)
+        {
+            float *result = SAFE_MALLOC(float);
+            *result = *(float *)operand_value - 1;
+            set_float_variable(node->data.unary.operand->data.name, *result, get_variable_modifiers(node->data.unary.operand->data.name));
+            return result;
+        }
+        else if (operand_type == VAR_DOUBLE)
+        {
+            double *result = SAFE_MALLOC(double);
+            *result = *(double *)operand_value - 1;
+            set_double_variable(node->data.unary.operand->data.name, *result, get_variable_modifiers(node->data.unary.operand->data.name));
+            return result;
+        }
+        else
+        {
+            yyerror("Invalid type for pre-decrement");
+            return NULL;
+        }
+    case OP_POST_INC:
+        if (operand_type == VAR_INT)
+        {
+            int *result = SAFE_MALLOC(int);
+            *result = *(int *)operand_value;
+            set_int_variable(node->data.unary.operand->data.name, *result + 1, get_variable_modifiers(node->data.unary.operand->data.name));
+            return result;
+        }
+        else if (operand_type == VAR_SHORT)
+        {
+            short *result = SAFE_MALLOC(short);
+            *result = *(short *)operand_value;
+            set_short_variable(node->data.unary.operand->data.name, *result + 1, get_variable_modifiers(node->data.unary.operand->data.name));
+            return result;
+        }
+        else if (operand_type == VAR_FLOAT)
+        {
+            float *result = SAFE_MALLOC(float);
+            *result = *(float *)operand_value;
+            set_float_variable(node->data.unary.operand->data.name, *result + 1, get_variable_modifiers(node->data.unary.operand->data.name));
+            return result;
+        }
+        else if (operand_type == VAR_DOUBLE)
+        {
+            double *result = SAFE_MALLOC(double);
+            *result = *(double *)operand_value;
+            set_double_variable(node->data.unary.operand->data.name, *result + 1, get_variable_modifiers(node->data.unary.operand->data.name));
+            return result;
+        }
+        else
+        {
+            yyerror("Invalid type for post-increment");
+            return NULL;
+        }
+    case OP_POST_DEC:
+        if (operand_type == VAR_INT)
+        {
+            int *result = SAFE_MALLOC(int);
+            *result = *(int *)operand_value;
+            set_int_variable(node->data.unary.operand->data.name, *result - 1, get_variable_modifiers(node->data.unary.operand->data.name));
+            return result;
+        }
+        else if (operand_type == VAR_SHORT)
+        {
+            short *result = SAFE_MALLOC(short);
+            *result = *(short *)operand_value;
+            set_short_variable(node->data.unary.operand->data.name, *result - 1, get_variable_modifiers(node->data.unary.operand->data.name));
+            return result;
+        }
+        else if (operand_type == VAR_FLOAT)
+        {
+            float *result = SAFE_MALLOC(float);
+            *result = *(float *)operand_value;
+            set_float_variable(node->data.unary.operand->data.name, *result - 1, get_variable_modifiers(node->data.unary.operand->data.name));
+            return result;
+        }
+        else if (operand_type == VAR_DOUBLE)
+        {
+            double *result = SAFE_MALLOC(double);
+            *result = *(double *)operand_value;
+            set_double_variable(node->data.unary.operand->data.name, *result - 1, get_variable_modifiers(node->data.unary.operand->data.name));
+            return result;
+        }
+        else
+        {
+            yyerror("Invalid type for post-decrement");
+            return NULL;
+        }
+    default:
+        yyerror("Unknown unary operator");
+        return NULL;
+    }
+}
+
+float evaluate_expression_float(ASTNode *node)
+{
+    if (!node)
+        return 0.0f;
+
+    switch (node->type)
+    {
+    case NODE_ARRAY_ACCESS:
+    {
+        return (float)evaluate_array_element(node);
+    }
+    case NODE_FLOAT:
+        return node->data.fvalue;
+    case NODE_DOUBLE:
+        return (float)node->data.dvalue;
+    case NODE_INT:
+        return (float)node->data.ivalue;
+    case NODE_IDENTIFIER:
+    {
+        return *(float *)handle_identifier(node, "Undefined variable", 2);
+    }
+    case NODE_OPERATION:
+    {
+        int result_type = get_expression_type(node);
+        void *result = handle_binary_operation(node);
+        float result_float = 0.0f;
+        result_float = (result_type == VAR_INT)
+                           ? (float)(*(int *)result)
+                       : (result_type == VAR_FLOAT)
+                           ? *(float *)result
+                           : (float)(*(double *)result);
+        SAFE_FREE(result);
+        return result_float;
+    }
+    case NODE_UNARY_OPERATION:
+    {
+        float operand = evaluate_expression_float(node->data.unary.operand);
+        float *result = (float *)handle_unary_expression(node, &operand, VAR_FLOAT);
+        float return_val = *result;
+        SAFE_FREE(result);
+        return return_val;
+    }
+    case NODE_SIZEOF:
+    {
+        return (float)handle_sizeof(node);
+    }
+    case NODE_FUNC_CALL:
+    {
+        return (float)return_value_as_double(handle_function_call(node));
+    }
+    default:
+        yyerror("Invalid float expression");
+        return 0.0f;
+    }
+}
+
+double evaluate_expression_double(ASTNode *node)
+{
+    if (!node)
+        return 0.0L;
+
+    switch (node->type)
+    {
+    case NODE_ARRAY_ACCESS:
+    {
+        return evaluate_array_element(node);
+    }
+    case NODE_DOUBLE:
+        return node->data.dvalue;
+    case NODE_FLOAT:
+        return (double)node->data.fvalue;
+    case NODE_INT:
+        return (double)node->data.ivalue;
+    case NODE_IDENTIFIER:
+    {
+        return *(double *)handle_identifier(node, "Undefined variable", 1);
+    }
+    case NODE_OPERATION:
+    {
+        int result_type = get_expression_type(node);
+        void *result = handle_binary_operation(node);
+        double result_double = 0.0L;
+        result_double = (result_type == VAR_INT)
+                            ? (double)(*(int *)result)
+                        : (result_type == VAR_FLOAT)
+                            ? (double)(*(float *)result)
+                            : *(double *)result;
+        SAFE_FREE(result);
+        return result_double;
+    }
+    case NODE_UNARY_OPERATION:
+    {
+        double operand = evaluate_expression_double(node->data.unary.operand);
+        double *result = (double *)handle_unary_expression(node, &operand, VAR_DOUBLE);
+        double return_val = *result;
+        SAFE_FREE(result);
+        return return_val;
+    }
+    case NODE_SIZEOF:
+    {
+        return (double)handle_sizeof(node);
+    }
+    case NODE_FUNC_CALL:
+    {
+        return return_value_as_double(handle_function_call(node));
+    }
+    default:
+        yyerror("Invalid double expression");
+        return 0.0L;
+    }
+}
+size_t get_type_size(char *name)
+{
+    Variable *var = get_variable(name);
+    if (var != NULL)
+    {
+        if (var->struct_def)
+        {
+            // Interleaved records include their padding
+            size_t record = var->value.array_data ? var->struct_def->size : var->struct_def->data_size;
+            return record * var->array_dimensions.total_size;
+        }
+        if (var->var_type == VAR_FLOAT)
+        {
+            if (var->is_array)
+            {
+                return sizeof(float) * var->array_length;
+            }
+            return sizeof(float);
+        }
+        else if (var->var_type == VAR_DOUBLE)
+        {
+            if (var->is_array)
+            {
+                return sizeof(double) * var->array_length;
+            }
+            return sizeof(double);
+        }
+        else if (var->modifiers.is_unsigned && var->var_type == VAR_INT)
+        {
+            if (var->is_array)
+            {
+                return sizeof(unsigned int) * var->array_length;
+            }
+            return sizeof(unsigned int);
+        }
+        else if (var->var_type == VAR_BOOL)
+        {
+            if (var->is_array)
+            {
+                return sizeof(bool) * var->array_length;
+            }
+            return sizeof(bool);
+        }
+        else if (var->modifiers.is_unsigned && var->var_type == VAR_SHORT)
+        {
+            if (var->is_array)
+            {
+                return sizeof(unsigned short) * var->array_length;
+            }
+            return sizeof(unsigned short);
+        }
+        else if (var->var_type == VAR_SHORT)
+        {
+            if (var->is_array)
+            {
+                return sizeof(short) * var->array_length;
+            }
+            return sizeof(short);
+        }
+        else if (var->var_type == VAR_INT)
+        {
+            if (var->is_array)
+            {
+                return sizeof(int) * var->array_length;
+            }
+            return sizeof(int);
+        }
+        else if (var->var_type == VAR_CHAR)
+        {
+            if (var->is_array)
+            {
+                return sizeof(char) * var->array_length;
+            }
+            return sizeof(char);
+        }
+        else
+        {
+            yyerror("Undefined variable in sizeof");
+        }
+    }
+    yyerror("Undefined variable in sizeof");
+    return 0;
+}
+
+size_t handle_sizeof(ASTNode *node)
+{
+    ASTNode *expr = node->data.sizeof_stmt.expr;
+    VarType type = get_expression_type(node->data.sizeof_stmt.expr);
+    if (expr->type == NODE_IDENTIFIER)
+    {
+        return get_type_size(expr->data.name);
+    }
+    switch (type)
+    {
+    case VAR_INT:
+        return sizeof(int);
+    case VAR_FLOAT:
+        return sizeof(float);
+    case VAR_DOUBLE:
+        return sizeof(double);
+    case VAR_SHORT:
+        return sizeof(short);
+    case VAR_BOOL:
+        return sizeof(bool);
+    case VAR_CHAR:
+        return sizeof(char);
+    default:
+        yyerror("Invalid type in sizeof");
+        return 0;
+    }
+    yyerror("Invalid type in sizeof");
+    return 0;
+}
+
+short evaluate_expression_short(ASTNode *node)
+{
+    if (!node)
+        return 0;
+
+    switch (node->type)
+    {
+    case NODE_INT:
+        return (short)node->data.ivalue;
+    case NODE_BOOLEAN:
+        return (short)node->data.bvalue; // Already 1 or 0
+    case NODE_CHAR:                      // Add explicit handling for characters
+        return (short)node->data.ivalue;
+    case NODE_SHORT:
+        return node->data.svalue;
+    case NODE_FLOAT:
+        yyerror("Cannot use float in integer context");
+        return (short)node->data.fvalue;
+    case NODE_DOUBLE:
+        yyerror("Cannot use double in integer context");
+        return (short)node->data.dvalue;
+    case NODE_SIZEOF:
+    {
+        return handle_sizeof(node);
+    }
+    case NODE_IDENTIFIER:
+    {
+        return *(short *)handle_identifier(node, "Undefined variable", 0);
+    }
+    case NODE_OPERATION:
+    {
+        // Special handling for logical operations
+        if (node->data.op.op == OP_AND || node->data.op.op == OP_OR)
+        {
+            short left = evaluate_expression_short(node->data.op.left);
+            short right = evaluate_expression_short(node->data.op.right);
+
+            switch (node->data.op.op)
+            {
+            case OP_AND:
+                return left && right;
+            case OP_OR:
+                return left || right;
+            default:
+                break;
+            }
+        }
+
+        // Regular integer operations
+        int result_type = get_expression_type(node);
+        void *result = handle_binary_operation(node);
+        short result_short = 0;
+        result_short = (result_type == VAR_SHORT)
+                           ? *(short *)result
+                       : (result_type == VAR_FLOAT)
+                           ? (short)(*(float *)result)
+                       : (result_type == VAR_DOUBLE)
+                           ? (short)(*(double *)result)
+                           : (short)(*(int *)result);
+        SAFE_FREE(result);
+        return result_short;
+    }
+    case NODE_UNARY_OPERATION:
+    {
+        short operand = evaluate_expression_short(node->data.unary.operand);
+        short *result = (short *)handle_unary_expression(node, &operand, VAR_SHORT);
+        short return_val = *result;
+        SAFE_FREE(result);
+        return return_val;
+    }
+    case NODE_ARRAY_ACCESS:
+    {
+      
+        return (short)evaluate_array_element(node);
+    }
+    case NODE_FUNC_CALL:
+    {
+        return (short)return_value_as_double(handle_function_call(node));
+    }
+    default:
+        yyerror("Invalid short expression");
+        return 0;
+    }
+}
+
+int evaluate_expression_int(ASTNode *node)
+{
+    if (!node)
+        return 0;
+
+    switch (node->type)
+    {
+    case NODE_INT:
+        return node->data.ivalue;
+    case NODE_BOOLEAN:
+        return node->data.bvalue; // Already 1 or 0
+    case NODE_CHAR:               // Add explicit handling for characters
+        return node->data.ivalue;
+    case NODE_SHORT:
+        return node->data.svalue;
+    case NODE_FLOAT:
+        yyerror("Cannot use float in integer context");
+        return (int)node->data.fvalue;
+    case NODE_DOUBLE:
+        yyerror("Cannot use double in integer context");
+        return (int)node->data.dvalue;
+    case NODE_SIZEOF:
+    {
+        return handle_sizeof(node);
+    }
+    case NODE_IDENTIFIER:
+    {
+        return *(int *)handle_identifier(node, "Undefined variable", 0);
+    }
+    case NODE_OPERATION:
+    {
+        // Special handling for logical operations
+        if (node->data.op.op == OP_AND || node->data.op.op == OP_OR)
+        {
+            int left = evaluate_expression_int(node->data.op.left);
+            int right = evaluate_expression_int(node->data.op.right);
+
+            switch (node->data.op.op)
+            {
+            case OP_AND:
+                return left && right;
+            case OP_OR:
+                return left || right;
+            default:
+                break;
+            }
+        }
+
+        // Regular integer operations
+        int result_type = get_expression_type(node);
+        void *result = handle_binary_operation(node);
+        int result_int = 0;
+        result_int = (result_type == VAR_INT)
+                         ? *(int *)result
+                     : (result_type == VAR_FLOAT)
+                         ? (int)(*(float *)result)
+                         : (int)(*(double *)result);
+        SAFE_FREE(result);
+        return result_int;
+    }
+    case NODE_UNARY_OPERATION:
+    {
+        int operand = evaluate_expression_int(node->data.unary.operand);
+        int *result = (int *)handle_unary_expression(node, &operand, VAR_INT);
+        int return_val = *result;
+        SAFE_FREE(result);
+        return return_val;
+    }
+    case NODE_ARRAY_ACCESS:
+    {
+        return (int)evaluate_array_element(node);
+    }
+    case NODE_FUNC_CALL:
+    {
+        return (int)return_value_as_double(handle_function_call(node));
+    }
+    default:
+        yyerror("Invalid integer expression");
+        return 0;
+    }
+}
+
+ReturnValue handle_function_call(ASTNode *node)
+{
+    const Builtin *builtin = get_builtin(node->data.func_call.function_name);
+    if (builtin != NULL)
+    {
+        return call_builtin(builtin, node->data.func_call.arguments);
+    }
+
+    execute_function_call(
+        node->data.func_call.function_name,
+        node->data.func_call.arguments);
+    return current_return_value;
+}
+
+/*
+ * Call results are converted by their actual type rather than reinterpreted,
+ * so e.g. a gigachad-returning sqrt() can be printed with %d or stored in a
+ * rizz. A call that returned nothing evaluates to 0.
+ */
+double return_value_as_double(ReturnValue result)
+{
+    if (!result.has_value)
+    {
+        return 0.0;
+    }
+    switch (result.type)
+    {
+    case VAR_INT:
+    case VAR_CHAR:
+        return result.value.ivalue;
+    case VAR_SHORT:
+        return result.value.svalue;
+    case VAR_FLOAT:
+        return result.value.fvalue;
+    case VAR_DOUBLE:
+        return result.value.dvalue;
+    case VAR_BOOL:
+        return result.value.bvalue;
+    case NONE:
+        break;
+    }
+    return 0.0;
+}
+
+// Stores a number into a scalar variable, converted to the variable's type
+void store_scalar(Variable *var, double value)
+{
+    switch (var->var_type)
+    {
+    case VAR_INT:
+    case VAR_CHAR:
+        var->value.ivalue = (int)value;
+        break;
+    case VAR_SHORT:
+        var->value.svalue = (short)value;
+        break;
+    case VAR_FLOAT:
+        var->value.fvalue = (float)value;
+        break;
+    case VAR_DOUBLE:
+        var->value.dvalue = value;
+        break;
+    case VAR_BOOL:
+        var->value.bvalue = value != 0;
+        break;
+    case NONE:
+        break;
+    }
+}
+
+bool evaluate_expression_bool(ASTNode *node)
+{
+    if (!node)
+        return 0;
+
+    switch (node->type)
+    {
+    case NODE_INT:
+        return (bool)node->data.ivalue;
+    case NODE_SHORT:
+        return (bool)node->data.svalue;
+    case NODE_BOOLEAN:
+        return node->data.bvalue;
+    case NODE_CHAR:
+        return (bool)node->data.ivalue;
+    case NODE_FLOAT:
+        return (bool)node->data.fvalue;
+    case NODE_DOUBLE:
+        return (bool)node->data.dvalue;
+    case NODE_IDENTIFIER:
+    {
+        return *(bool *)handle_identifier(node, "Undefined variable", 0);
+    }
+    case NODE_OPERATION:
+    {
+        // Special handling for logical operations
+        if (node->data.op.op == OP_AND || node->data.op.op == OP_OR)
+        {
+            bool left = evaluate_expression_bool(node->data.op.left);
+            bool right = evaluate_expression_bool(node->data.op.right);
+
+            switch (node->data.op.op)
+            {
+            case OP_AND:
+                return left && right;
+            case OP_OR:
+                return left || right;
+            default:
+                break;
+            }
+        }
+
+        // Regular integer operations
+        int result_type = get_expression_type(node);
+        void *result = handle_binary_operation(node);
+        bool result_bool = 0;
+        result_bool = (result_type == VAR_INT)
+                          ? (bool)(*(int *)result)
+                      : (result_type == VAR_FLOAT)
+                          ? (bool)(*(float *)result)
+                          : (bool)(*(double *)result);
+        SAFE_FREE(result);
+        return result_bool;
+    }
+    case NODE_UNARY_OPERATION:
+    {
+        bool operand = evaluate_expression_bool(node->data.unary.operand);
+        bool *result = (bool *)handle_unary_expression(node, &operand, VAR_BOOL);
+        bool return_val = *result;
+        SAFE_FREE(result);
+        return return_val;
+    }
+    case NODE_ARRAY_ACCESS:
+    {
+        return (bool)evaluate_array_element(node);
+    }
+    case NODE_FUNC_CALL:
+    {
+        return (bool)return_value_as_double(handle_function_call(node));
+    }
+    default:
+        yyerror("Invalid boolean expression");
+        return 0;
+    }
+}
+
+ArgumentList *create_argument_list(ASTNode *expr, ArgumentList *existing_list)
+{
+    ArgumentList *new_node = ARENA_ALLOC(ArgumentList);
+    new_node->expr = expr;
+    new_node->next = NULL;
+
+    if (!existing_list)
+    {
+        return new_node;
+    }
+    else
+    {
+        /* Append to the end of existing_list */
+        ArgumentList *temp = existing_list;
+        while (temp->next)
+        {
+            temp = temp->next;
+        }
+        temp->next = new_node;
+        return existing_list;
+    }
+}
+
+ASTNode *create_print_statement_node(ASTNode *expr)
+{
+    ASTNode *node = ARENA_ALLOC(ASTNode);
+    node->type = NODE_PRINT_STATEMENT;
+    node->data.op.left = expr;
+    return node;
+}
+
+ASTNode *create_error_statement_node(ASTNode *expr)
+{
+    ASTNode *node = ARENA_ALLOC(ASTNode);
+    node->type = NODE_ERROR_STATEMENT;
+    node->data.op.left = expr;
+    return node;
+}
+
+ASTNode *create_statement_list(ASTNode *statement, ASTNode *existing_list)
+{
+    if (!existing_list)
+    {
+        // If there's no existing list, create a new one
+        ASTNode *node = ARENA_ALLOC(ASTNode);
+        if (!node)
+        {
+            yyerror("Memory allocation failed");
+            return NULL;
+        }
+        node->type = NODE_STATEMENT_LIST;
+        node->data.statements = ARENA_ALLOC(StatementList);
+        if (!node->data.statements)
+        {
+            SAFE_FREE(node);
+            yyerror("Memory allocation failed");
+            return NULL;
+        }
+        node->data.statements->statement = statement;
+        node->data.statements->next = NULL;
+        return node;
+    }
+    else
+    {
+        // Append at the end of existing_list
+        StatementList *sl = existing_list->data.statements;
+        while (sl->next)
+        {
+            sl = sl->next;
+        }
+        // Now sl is the last element; append the new statement
+        StatementList *new_item = ARENA_ALLOC(StatementList);
+        if (!new_item)
+        {
+            yyerror("Memory allocation failed");
+            return existing_list;
+        }
+        new_item->statement = statement;
+        new_item->next = NULL;
+        sl->next = new_item;
+        return existing_list;
+    }
+}
+
+bool is_const_variable(const char *name)
+{
+    Variable *var = get_variable(name);
+    if (var != NULL)
+    {
+        return var->modifiers.is_const;
+    }
+    return false;
+}
+
+void check_const_assignment(const char *name)
+{
+    if (is_const_variable(name))
+    {
+        step_back_error_line();
+        yyerror("Cannot modify const variable");
+        interpreter_exit(EXIT_FAILURE);
+    }
+}
+
+bool is_short_expression(ASTNode *node)
+{
+    if (!node)
+        return false;
+
+    switch (node->type)
+    {
+    case NODE_SHORT:
+        return true;
+    case NODE_FLOAT:
+        return false;
+    case NODE_INT:
+        return false;
+    case NODE_DOUBLE:
+        return false;
+    case NODE_ARRAY_ACCESS:
+    {
+        Variable *var = get_variable(node->data.name);
+        if (var != NULL)
+        {
+            return var->var_type == VAR_SHORT;
+        }
+        yyerror("Undefined variable in type check");
+        return false;
+
+    }
+    case NODE_IDENTIFIER:
+    {
+        if (!check_and_mark_identifier(node, "Undefined variable in type check"))
+            interpreter_exit(1);
+        Variable *var = get_variable(node->data.name);
+        if (var != NULL)
+        {
+            return var->var_type == VAR_SHORT;
+        }
+        yyerror("Undefined variable in type check");
+        return false;
+    }
+    case NODE_OPERATION:
+    {
+        // If either operand is short, result is short
+        return is_short_expression(node->data.op.left) ||
+               is_short_expression(node->data.op.right);
+    }
+    case NODE_FUNC_CALL:
+    {
+        return get_function_return_type(node) == VAR_SHORT;
+    }
+    default:
+        return false;
+    }
+}
+
+Function *get_function(const char *name)
+{
+    Function *func = current_interpreter->functions;
+    while (func != NULL)
+    {
+        if (strcmp(func->name, name) == 0)
+        {
+            return func;
+        }
+        func = func->next;
+    }
+    return NULL;
+}
+
+VarType get_function_return_type(ASTNode *call)
+{
+    const char *name = call->data.func_call.function_name;
+    const Builtin *builtin = get_builtin(name);
+    if (builtin != NULL)
+    {
+        return get_builtin_return_type(builtin, call->data.func_call.arguments);
+    }
+    Function *func = get_function(name);
+    if (func != NULL)
+    {
+        return func->return_type;
+    }
+    yyerror("Undefined function in type check");
+    return NONE;
+}
+
+bool is_float_expression(ASTNode *node)
+{
+    if (!node)
+        return false;
+
+    switch (node->type)
+    {
+    case NODE_FLOAT:
+        return true;
+    case NODE_INT:
+        return false;
+    case NODE_DOUBLE:
+        return false;
+    case NODE_ARRAY_ACCESS:
+    case NODE_IDENTIFIER:
+    {
+        if (!check_and_mark_identifier(node, "Undefined variable in type check"))
+            interpreter_exit(1);
+        Variable *var = get_variable(node->data.name);
+        if (var != NULL)
+        {
+            return var->var_type == VAR_FLOAT;
+        }
+        yyerror("Undefined variable in type check");
+        return false;
+    }
+    case NODE_OPERATION:
+    {
+        // If either operand is float, result is float
+        return is_float_expression(node->data.op.left) ||
+               is_float_expression(node->data.op.right);
+    }
+    case NODE_FUNC_CALL:
+    {
+        return get_function_return_type(node) == VAR_FLOAT;
+    }
+    default:
+        return false;
+    }
+}
+
+bool is_double_expression(ASTNode *node)
+{
+    if (!node)
+        return false;
+
+    switch (node->type)
+    {
+    case NODE_DOUBLE:
+        return true;
+    case NODE_FLOAT:
+        return false;
+    case NODE_INT:
+        return false;
+    case NODE_ARRAY_ACCESS:
+    case NODE_IDENTIFIER:
+    {
+        if (!check_and_mark_identifier(node, "Undefined variable in type check"))
+            interpreter_exit(1);
+        Variable *var = get_variable(node->data.name);
+        if (var != NULL)
+        {
+            return var->var_type == VAR_DOUBLE;
+        }
+        yyerror("Undefined variable in type check");
+        return false;
+    }
+    case NODE_OPERATION:
+    {
+        // If either operand is double, result is double
+        return is_double_expression(node->data.op.left) ||
+               is_double_expression(node->data.op.right);
+    }
+    case NODE_FUNC_CALL:
+    {
+        return get_function_return_type(node) == VAR_DOUBLE;
+    }
+    default:
+        return false;
+    }
+}
+
+int evaluate_expression(ASTNode *node)
+{
+    if (is_short_expression(node))
+    {
+        return (short)evaluate_expression_short(node);
+    }
+    if (is_float_expression(node))
+    {
+        return (int)evaluate_expression_float(node);
+    }
+    if (is_double_expression(node))
+    {
+        return (int)evaluate_expression_double(node);
+    }
+    return evaluate_expression_int(node);
+}
+
+void execute_assignment(ASTNode *node)
+{
+    if (node->type != NODE_ASSIGNMENT)
+    {
+        yyerror("Expected assignment node");
+        return;
+    }
+
+    char *name = node->data.op.left->data.name;
+    check_const_assignment(name);
+
+    ASTNode *value_node = node->data.op.right;
+    TypeModifiers mods = node->modifiers;
+
+    if (node->data.op.left->type == NODE_ARRAY_ACCESS)
+    {
+        // Evaluate the right side with proper type handling
+        const char *array_name = node->data.op.left->data.array.name;
+        int idx = evaluate_expression_int(node->data.op.left->data.array.index);
+
+        // Find array in symbol table
+        Variable *var = get_variable(array_name);
+        if (var != NULL)
+        {
+            if (!var->is_array)
+            {
+                yyerror("Not an array!");
+                return;
+            }
+            if (idx < 0 || idx >= var->array_length)
+            {
+                yyerror("Array index out of bounds!");
+                return;
+            }
+
+            // Use the array's actual type for assignment
+            switch (var->var_type)
+            {
+            case VAR_FLOAT:
+                ((float *)var->value.array_data)[idx] = evaluate_expression_float(node->data.op.right);
+                break;
+            case VAR_DOUBLE:
+                ((double *)var->value.array_data)[idx] = evaluate_expression_double(node->data.op.right);
+                break;
+            case VAR_INT:
+                ((int *)var->value.array_data)[idx] = evaluate_expression_int(node->data.op.right);
+                break;
+            case VAR_SHORT:
+                ((short *)var->value.array_data)[idx] = evaluate_expression_short(node->data.op.right);
+                break;
+            default:
+                yyerror("Unsupported array type");
+                return;
+            }
+            return;
+        }
+        yyerror("Undefined array variable");
+        return;
+    }
+
+    // Handle type conversion for float to int
+    if (value_node->type == NODE_FLOAT || is_float_expression(value_node))
+    {
+        float value = evaluate_expression_float(value_node);
+        if (node->data.op.left->type == NODE_INT)
+        {
+            // Check for overflow
+            if (value > INT_MAX || value < INT_MIN)
+            {
+                yyerror("Float to int conversion overflow");
+                value = INT_MAX;
+            }
+            if (!set_int_variable(name, (int)value, mods))
+            {
+                yyerror("Failed to set integer variable");
+            }
+            return;
+        }
+    }
+
+    if (is_float_expression(value_node))
+    {
+        float value = evaluate_expression_float(value_node);
+        if (!set_float_variable(name, value, mods))
+        {
+            yyerror("Failed to set float variable");
+        }
+    }
+    else if (is_double_expression(value_node))
+    {
+        double value = evaluate_expression_double(value_node);
+        if (!set_double_variable(name, value, mods))
+        {
+            yyerror("Failed to set double variable");
+        }
+    }
+    else if (is_short_expression(value_node))
+    {
+        short value = evaluate_expression_short(value_node);
+        if (!set_short_variable(name, value, mods))
+        {
+            yyerror("Failed to set short variable");
+        }
+    }
+    else
+    {
+        int value = evaluate_expression_int(value_node);
+        if (!set_int_variable(name, value, mods))
+        {
+            yyerror("Failed to set integer variable");
+        }
+    }
+}
+
+void execute_statement(ASTNode *node)
+{
+    if (!node)
+        return;
+    switch (node->type)
+    {
+    case NODE_DECLARATION:
+    {
+       char *name = node->data.op.left->data.name;
+       Variable *var = variable_new(name);
+       add_variable_to_scope(name, var);
+       SAFE_FREE(var);
+    }
+        __attribute__((fallthrough));
+    case NODE_ASSIGNMENT:
+    {
+        char *name = node->data.op.left->data.name;
+        check_const_assignment(name);
+
+        // Whole-array assignment
+        if (node->type == NODE_ASSIGNMENT && node->data.op.left->type == NODE_IDENTIFIER)
+        {
+            Variable *var = get_variable(name);
+            if (var != NULL && var->is_simd)
+            {
+                assign_simd(var, node->data.op.right);
+                return;
+            }
+            if (var != NULL && var->is_array)
+            {
+                assign_whole_array(var, node->data.op.right);
+                return;
+            }
         }
-        else if (promoted_type == VAR_SHORT)
+
+        // Handle array assignment
+        if (node->data.op.left->type == NODE_ARRAY_ACCESS)
         {
-            if (*(short *)right_value == 0)
+            ASTNode *array_node = node->data.op.left;
+            Variable *var = get_variable(array_node->data.name);
+            if (var != NULL && var->is_array && var->var_type == VAR_BOOL && !var->stride)
             {
-                yyerror("Division by zero");
-                *(short *)result = 0; // Define a fallback behavior for short division by zero
+                size_t offset;
+                resolve_array_access(array_node, &offset);
+                bool value = evaluate_expression_bool(node->data.op.right);
+                // squad flex iterations and spawned calls may share a word
+                if (pool_in_task())
+                    bitset_set_atomic(var->value.array_data, offset, value);
+                else
+                    bitset_set(var->value.array_data, offset, value);
+                return;
             }
-            else
+            void *element = evaluate_multi_array_access(array_node);
+            switch (var->var_type)
             {
-                *(short *)result = *(short *)left_value / *(short *)right_value;
+            case VAR_FLOAT:
+                *(float *)element = evaluate_expression_float(node->data.op.right);
+                break;
+            case VAR_DOUBLE:
+                *(double *)element = evaluate_expression_double(node->data.op.right);
+                break;
+            case VAR_INT:
+                *(int *)element = evaluate_expression_int(node->data.op.right);
+                break;
+            case VAR_SHORT:
+                *(short *)element = evaluate_expression_short(node->data.op.right);
+                break;
+            case VAR_CHAR:
+                *(char *)element = evaluate_expression_int(node->data.op.right);
+                break;
+            case VAR_BOOL:
+                *(bool *)element = evaluate_expression_bool(node->data.op.right);
+                break;
+            default:
+                yyerror("Unsupported array type");
+                return;
+            }
+            return;
+        }
+
+        ASTNode *value_node = node->data.op.right;
+        TypeModifiers mods = node->modifiers;
+
+        if (value_node->type == NODE_CHAR)
+        {
+            // Handle character assignments directly
+            if (!set_char_variable(name, value_node->data.ivalue, mods))
+            {
+                yyerror("Failed to set character variable");
+            }
+        }
+        else if (value_node->type == NODE_BOOLEAN)
+        {
+            if (!set_bool_variable(name, value_node->data.bvalue, mods))
+            {
+                yyerror("Failed to set boolean variable");
+            }
+        }
+        else if (value_node->type == NODE_SHORT)
+        {
+            if (!set_short_variable(name, value_node->data.svalue, mods))
+            {
+                yyerror("Failed to set short variable");
+            }
+        }
+        else if (node->var_type == VAR_FLOAT || is_float_expression(value_node))
+        {
+            float value = evaluate_expression_float(value_node);
+            if (!set_float_variable(name, value, mods))
+            {
+                yyerror("Failed to set float variable");
+            }
+        }
+        else if (node->var_type == VAR_DOUBLE || is_double_expression(value_node))
+        {
+            double value = evaluate_expression_double(value_node);
+            if (!set_double_variable(name, value, mods))
+            {
+                yyerror("Failed to set double variable");
+            }
+        }
+        else
+        {
+            int value = evaluate_expression_int(value_node);
+            if (!set_int_variable(name, value, mods))
+            {
+                yyerror("Failed to set integer variable");
             }
         }
         break;
-    case OP_MOD:
-        if (promoted_type == VAR_INT)
+    }
+    case NODE_ARRAY_ACCESS:
+        if (node->data.array.name && node->data.array.index)
         {
-            int left = *(int *)left_value;
-            int right = *(int *)right_value;
+            if (!(node->data.array.name))
+            {
+                yyerror("Failed to create array");
+            }
+        }
+        break;
+    case NODE_OPERATION:
+    case NODE_UNARY_OPERATION:
+    case NODE_INT:
+    case NODE_SHORT:
+    case NODE_FLOAT:
+    case NODE_DOUBLE:
+    case NODE_CHAR:
+    case NODE_IDENTIFIER:
+        evaluate_expression(node);
+        break;
+    case NODE_FUNC_CALL:
+    {
+        const Builtin *builtin = get_builtin(node->data.func_call.function_name);
+        if (builtin != NULL)
+        {
+            call_builtin(builtin, node->data.func_call.arguments);
+        }
+        else
+        {
+            execute_function_call(
+                node->data.func_call.function_name,
+                node->data.func_call.arguments);
+        }
+        break;
+    }
+    case NODE_FOR_STATEMENT:
+        execute_for_statement(node);
+        break;
+    case NODE_PARALLEL_FOR:
+        execute_parallel_for(node);
+        break;
+    case NODE_WHILE_STATEMENT:
+        execute_while_statement(node);
+        break;
+    case NODE_DO_WHILE_STATEMENT:
+        execute_do_while_statement(node);
+        break;
+    case NODE_PRINT_STATEMENT:
+    {
+        ASTNode *expr = node->data.op.left;
+        if (expr->type == NODE_STRING_LITERAL)
+        {
+            yapping("%s\n", expr->data.name);
+        }
+        else
+        {
+            int value = evaluate_expression(expr);
+            yapping("%d\n", value);
+        }
+        break;
+    }
+    case NODE_ERROR_STATEMENT:
+    {
+        ASTNode *expr = node->data.op.left;
+        if (expr->type == NODE_STRING_LITERAL)
+        {
+            baka("%s\n", expr->data.name);
+        }
+        else
+        {
+            int value = evaluate_expression(expr);
+            baka("%d\n", value);
+        }
+        break;
+    }
+    case NODE_STATEMENT_LIST:
+        execute_statements(node);
+        break;
+    case NODE_IF_STATEMENT:
+        enter_scope();
+        if (evaluate_expression(node->data.if_stmt.condition))
+        {
+            execute_statement(node->data.if_stmt.then_branch);
+        }
+        else if (node->data.if_stmt.else_branch)
+        {
+            execute_statement(node->data.if_stmt.else_branch);
+        }
+        exit_scope();
+        break;
+    case NODE_SWITCH_STATEMENT:
+        execute_switch_statement(node);
+        break;
+    case NODE_BREAK_STATEMENT:
+        // Signal to break out of the current loop/switch
+        bruh();
+        break;
+    case NODE_FUNCTION_DEF:
+    {
+        Function *func = create_function(
+            node->data.function_def.name,
+            node->data.function_def.return_type,
+            node->data.function_def.parameters,
+            node->data.function_def.body);
+        if (!func)
+        {
+            yyerror("Failed to create function");
+            interpreter_exit(1);
+        }
+        break;
+    }
+    case NODE_RETURN:
+    {
+        handle_return_statement(node->data.op.left);
+        break;
+    }
+    case NODE_SPAWN:
+        execute_spawn(node);
+        break;
+    case NODE_SYNC:
+        execute_sync();
+        break;
+    case NODE_MAP_DECLARATION:
+        declare_map(node);
+        break;
+    case NODE_STRUCT_DECLARATION:
+        declare_struct(node);
+        break;
+    case NODE_ARRAY_DECLARATION:
+        declare_array(node);
+        break;
+    case NODE_CHANNEL_DECLARATION:
+        declare_channel(node);
+        break;
+    case NODE_SIMD_DECLARATION:
+        declare_simd(node);
+        break;
+    case NODE_VECTOR_DECLARATION:
+        declare_vector(node);
+        break;
+    default:
+        yyerror("Unknown statement type");
+        break;
+    }
+}
 
-            if (right == 0)
+void execute_statements(ASTNode *node)
+{
+    if (!node)
+        return;
+    if (node->type != NODE_STATEMENT_LIST)
+    {
+        execute_statement(node);
+        return;
+    }
+    StatementList *current = node->data.statements;
+    while (current)
+    {
+        execute_statement(current->statement);
+        current = current->next;
+    }
+}
+
+void execute_for_statement(ASTNode *node)
+{
+    if (node->data.for_stmt.parallel && execute_parallel_for(node->data.for_stmt.parallel))
+        return;
+
+    Scope *saved_scope = current_scope;
+    PUSH_JUMP_BUFFER();
+    if (setjmp(CURRENT_JUMP_BUFFER()) == 0)
+    {
+        // Execute initialization once
+        enter_scope();
+        if (node->data.for_stmt.init)
+        {
+            execute_statement(node->data.for_stmt.init);
+        }
+
+        while (1)
+        {
+            // Evaluate condition
+            enter_scope();
+            if (node->data.for_stmt.cond)
             {
-                yyerror("Modulo by zero");
-                *(int *)result = 0; // Define fallback for modulo by zero
+                int cond_result = evaluate_expression(node->data.for_stmt.cond);
+                if (!cond_result)
+                {
+                    exit_scope();
+                    break;
+                }
             }
-            else if (node->modifiers.is_unsigned)
+
+            // Execute body
+            if (node->data.for_stmt.body)
             {
-                // Explicitly handle unsigned modulo
-                unsigned int ul = (unsigned int)left;
-                unsigned int ur = (unsigned int)right;
-                *(int *)result = (int)(ul % ur);
+                execute_statement(node->data.for_stmt.body);
             }
-            else
+
+            // Execute increment
+            if (node->data.for_stmt.incr)
             {
-                *(int *)result = left % right;
+                execute_statement(node->data.for_stmt.incr);
             }
+            exit_scope();
         }
-        else if (promoted_type == VAR_FLOAT)
+        exit_scope();
+    }
+    // A bruh lands here from wherever it was in the body
+    while (current_scope != saved_scope)
+        exit_scope();
+    POP_JUMP_BUFFER();
+}
+
+void execute_while_statement(ASTNode *node)
+{
+    PUSH_JUMP_BUFFER();
+    enter_scope();
+    Scope *loop_scope = current_scope;
+    while (evaluate_expression(node->data.while_stmt.cond) && setjmp(CURRENT_JUMP_BUFFER()) == 0)
+    {
+        enter_scope();
+        execute_statement(node->data.while_stmt.body);
+        exit_scope();
+    }
+    while (current_scope != loop_scope)
+        exit_scope();
+    exit_scope();
+    POP_JUMP_BUFFER();
+}
+
+void execute_do_while_statement(ASTNode *node)
+{
+    PUSH_JUMP_BUFFER();
+    enter_scope();
+    Scope *loop_scope = current_scope;
+    // Set the landing point before the first pass, which may already bruh
+    if (setjmp(CURRENT_JUMP_BUFFER()) == 0)
+    {
+        do
         {
-            *(float *)result = fmod(*(float *)left_value, *(float *)right_value);
+            enter_scope();
+            execute_statement(node->data.while_stmt.body);
+            exit_scope();
+        } while (evaluate_expression(node->data.while_stmt.cond));
+    }
+    while (current_scope != loop_scope)
+        exit_scope();
+    exit_scope();
+    POP_JUMP_BUFFER();
+}
+
+Reduction *create_reduction(const char *op, char *name, Reduction *next)
+{
+    Reduction *r = ARENA_ALLOC(Reduction);
+    if (strcmp(op, "+") == 0)
+        r->op = REDUCE_SUM;
+    else if (strcmp(op, "min") == 0)
+        r->op = REDUCE_MIN;
+    else if (strcmp(op, "max") == 0)
+        r->op = REDUCE_MAX;
+    else
+    {
+        char error_msg[100];
+        snprintf(error_msg, sizeof(error_msg), "Unknown reduction '%s'; use +, min or max", op);
+        yyerror(error_msg);
+        interpreter_exit(EXIT_FAILURE);
+    }
+    r->name = ARENA_STRDUP(name);
+    r->next = next;
+    return r;
+}
+
+/* Calls fn on each direct child of node, statements and expressions alike */
+static void for_each_child(ASTNode *node, void (*fn)(ASTNode *child, void *ctx), void *ctx)
+{
+    switch (node->type)
+    {
+    case NODE_ASSIGNMENT:
+    case NODE_DECLARATION:
+    case NODE_OPERATION:
+    case NODE_PRINT_STATEMENT:
+    case NODE_ERROR_STATEMENT:
+    case NODE_RETURN:
+        if (node->data.op.left)
+            fn(node->data.op.left, ctx);
+        if (node->type != NODE_RETURN && node->type != NODE_PRINT_STATEMENT &&
+            node->type != NODE_ERROR_STATEMENT && node->data.op.right)
+            fn(node->data.op.right, ctx);
+        break;
+    case NODE_UNARY_OPERATION:
+        fn(node->data.unary.operand, ctx);
+        break;
+    case NODE_FOR_STATEMENT:
+        if (node->data.for_stmt.init)
+            fn(node->data.for_stmt.init, ctx);
+        if (node->data.for_stmt.cond)
+            fn(node->data.for_stmt.cond, ctx);
+        if (node->data.for_stmt.incr)
+            fn(node->data.for_stmt.incr, ctx);
+        if (node->data.for_stmt.body)
+            fn(node->data.for_stmt.body, ctx);
+        break;
+    case NODE_WHILE_STATEMENT:
+    case NODE_DO_WHILE_STATEMENT:
+        fn(node->data.while_stmt.cond, ctx);
+        if (node->data.while_stmt.body)
+            fn(node->data.while_stmt.body, ctx);
+        break;
+    case NODE_STATEMENT_LIST:
+        for (StatementList *sl = node->data.statements; sl; sl = sl->next)
+        {
+            if (sl->statement)
+                fn(sl->statement, ctx);
         }
-        else if (promoted_type == VAR_DOUBLE)
+        break;
+    case NODE_IF_STATEMENT:
+        fn(node->data.if_stmt.condition, ctx);
+        if (node->data.if_stmt.then_branch)
+            fn(node->data.if_stmt.then_branch, ctx);
+        if (node->data.if_stmt.else_branch)
+            fn(node->data.if_stmt.else_branch, ctx);
+        break;
+    case NODE_SWITCH_STATEMENT:
+        fn(node->data.switch_stmt.expression, ctx);
+        for (CaseNode *c = node->data.switch_stmt.cases; c; c = c->next)
         {
-            *(double *)result = fmod(*(double *)left_value, *(double *)right_value);
+            if (c->value)
+                fn(c->value, ctx);
+            if (c->statements)
+                fn(c->statements, ctx);
         }
-        else if (promoted_type == VAR_SHORT)
+        break;
+    case NODE_SIZEOF:
+        fn(node->data.sizeof_stmt.expr, ctx);
+        break;
+    case NODE_ARRAY_ACCESS:
+        for (int i = 0; i < node->data.array.num_dimensions; i++)
+            fn(node->data.array.indices[i], ctx);
+        break;
+    case NODE_FUNC_CALL:
+        for (ArgumentList *a = node->data.func_call.arguments; a; a = a->next)
+            fn(a->expr, ctx);
+        break;
+    case NODE_ARRAY_DECLARATION:
+    {
+        for (int i = 0; i < node->data.array_decl.num_dimensions; i++)
+            fn(node->data.array_decl.dimensions[i], ctx);
+        ExpressionList *first = node->data.array_decl.init;
+        ExpressionList *e = first;
+        if (e)
         {
-            *(short *)result = *(short *)left_value % *(short *)right_value;
+            do
+            {
+                fn(e->expr, ctx);
+                e = e->next;
+            } while (e && e != first);
         }
         break;
-    case OP_LT:
-        if (promoted_type == VAR_INT)
-            *(int *)result = *(int *)left_value < *(int *)right_value;
-        else if (promoted_type == VAR_FLOAT)
-            *(float *)result = *(float *)left_value < *(float *)right_value;
-        else if (promoted_type == VAR_DOUBLE)
-            *(double *)result = *(double *)left_value < *(double *)right_value;
-        else if (promoted_type == VAR_SHORT)
-            *(short *)result = *(short *)left_value < *(short *)right_value;
+    }
+    case NODE_SIMD_DECLARATION:
+        if (node->data.simd_decl.init)
+            fn(node->data.simd_decl.init, ctx);
         break;
-
-    case OP_GT:
-        if (promoted_type == VAR_INT)
-            *(int *)result = *(int *)left_value > *(int *)right_value;
-        else if (promoted_type == VAR_FLOAT)
-            *(float *)result = *(float *)left_value > *(float *)right_value;
-        else if (promoted_type == VAR_DOUBLE)
-            *(double *)result = *(double *)left_value > *(double *)right_value;
-        else if (promoted_type == VAR_SHORT)
-            *(short *)result = *(short *)left_value > *(short *)right_value;
+    case NODE_PARALLEL_FOR:
+        fn(node->data.parallel_for.loop, ctx);
         break;
-
-    case OP_LE:
-        if (promoted_type == VAR_INT)
-            *(int *)result = *(int *)left_value <= *(int *)right_value;
-        else if (promoted_type == VAR_FLOAT)
-            *(float *)result = *(float *)left_value <= *(float *)right_value;
-        else if (promoted_type == VAR_DOUBLE)
-            *(double *)result = *(double *)left_value <= *(double *)right_value;
-        else if (promoted_type == VAR_SHORT)
-            *(short *)result = *(short *)left_value <= *(short *)right_value;
-        else if (promoted_type == VAR_SHORT)
-            *(short *)result = *(short *)left_value <= *(short *)right_value;
+    case NODE_SPAWN:
+        if (node->data.spawn.declaration)
+            fn(node->data.spawn.declaration, ctx);
+        if (node->data.spawn.target)
+            fn(node->data.spawn.target, ctx);
+        fn(node->data.spawn.call, ctx);
         break;
-
-    case OP_GE:
-        if (promoted_type == VAR_INT)
-            *(int *)result = *(int *)left_value >= *(int *)right_value;
-        else if (promoted_type == VAR_FLOAT)
-            *(float *)result = *(float *)left_value >= *(float *)right_value;
-        else if (promoted_type == VAR_DOUBLE)
-            *(double *)result = *(double *)left_value >= *(double *)right_value;
-        else if (promoted_type == VAR_SHORT)
-            *(short *)result = *(short *)left_value >= *(short *)right_value;
-        else if (promoted_type == VAR_SHORT)
-            *(short *)result = *(short *)left_value >= *(short *)right_value;
+    default:
         break;
+    }
+}
 
-    case OP_EQ:
+typedef struct
+{
+    const char **names;
+    size_t count;
+    size_t capacity;
+} NameSet;
 
-        if (promoted_type == VAR_INT)
-            *(int *)result = *(int *)left_value == *(int *)right_value;
-        else if (promoted_type == VAR_FLOAT)
-            *(float *)result = *(float *)left_value == *(float *)right_value;
-        else if (promoted_type == VAR_DOUBLE)
-            *(double *)result = *(double *)left_value == *(double *)right_value;
-        else if (promoted_type == VAR_SHORT)
-            *(short *)result = *(short *)left_value == *(short *)right_value;
+static void name_set_add(NameSet *set, const char *name)
+{
+    if (set->count == set->capacity)
+    {
+        set->capacity = set->capacity ? set->capacity * 2 : 16;
+        set->names = safe_realloc(set->names, set->capacity * sizeof(*set->names));
+    }
+    set->names[set->count++] = name;
+}
+
+// True if name is in the set, or is a field "g.f" of a gang g in the set
+static bool name_set_covers(const NameSet *set, const char *name)
+{
+    for (size_t i = 0; i < set->count; i++)
+    {
+        size_t len = strlen(set->names[i]);
+        if (strncmp(set->names[i], name, len) == 0 && (name[len] == '\0' || name[len] == '.'))
+            return true;
+    }
+    return false;
+}
+
+static void collect_declared_names(ASTNode *node, void *ctx)
+{
+    NameSet *declared = ctx;
+    switch (node->type)
+    {
+    case NODE_DECLARATION:
+        name_set_add(declared, node->data.op.left->data.name);
+        break;
+    case NODE_ARRAY_DECLARATION:
+        name_set_add(declared, node->data.array_decl.name);
+        break;
+    case NODE_SIMD_DECLARATION:
+        name_set_add(declared, node->data.simd_decl.name);
+        break;
+    case NODE_MAP_DECLARATION:
+        name_set_add(declared, node->data.map_decl.name);
+        break;
+    case NODE_VECTOR_DECLARATION:
+        name_set_add(declared, node->data.name);
         break;
+    case NODE_STRUCT_DECLARATION:
+        name_set_add(declared, node->data.struct_decl.name);
+        break;
+    case NODE_CHANNEL_DECLARATION:
+        name_set_add(declared, node->data.channel_decl.name);
+        break;
+    default:
+        break;
+    }
+    for_each_child(node, collect_declared_names, ctx);
+}
 
-    case OP_NE:
-        if (promoted_type == VAR_INT)
-            *(int *)result = *(int *)left_value != *(int *)right_value;
-        else if (promoted_type == VAR_FLOAT)
-            *(float *)result = *(float *)left_value != *(float *)right_value;
-        else if (promoted_type == VAR_DOUBLE)
-            *(double *)result = *(double *)left_value != *(double *)right_value;
-        else if (promoted_type == VAR_SHORT)
-            *(short *)result = *(short *)left_value != *(short *)right_value;
+static void collect_dm_channels(ASTNode *node, void *ctx)
+{
+    if (node->type == NODE_CHANNEL_DECLARATION && node->data.channel_decl.single)
+        name_set_add(ctx, node->data.channel_decl.name);
+    for_each_child(node, collect_dm_channels, ctx);
+}
+
+typedef struct
+{
+    const char *counter; // NULL in a called function
+    Reduction *reductions;
+    NameSet declared;    // everything the body declares, so private to an iteration
+    int nesting;         // loops and switches entered inside the body
+    const char *callee;  // user function checked on the loop's behalf, or NULL for the body
+    NameSet *followed;   // calls already checked, or NULL to leave user calls alone
+    NameSet dm_channels; // dm channels in sight, filled once the program is parsed
+} SquadCheck;
+
+static void squad_error(const char *msg, const char *name)
+{
+    char error_msg[200];
+    snprintf(error_msg, sizeof(error_msg), msg, name);
+    yyerror(error_msg);
+    interpreter_exit(EXIT_FAILURE);
+}
+
+static void check_squad_write(SquadCheck *check, ASTNode *target)
+{
+    if (target->type != NODE_IDENTIFIER)
+        return; // array elements may be written from any iteration
+    const char *name = target->data.name;
+    if (check->counter && strcmp(name, check->counter) == 0)
+        squad_error("squad flex cannot change its counter '%s' inside the loop", name);
+    if (name_set_covers(&check->declared, name))
+        return;
+    if (check->callee)
+    {
+        char error_msg[200];
+        snprintf(error_msg, sizeof(error_msg),
+                 "squad flex calls %s, which assigns array parameter '%s' that all iterations share",
+                 check->callee, name);
+        yyerror(error_msg);
+        interpreter_exit(EXIT_FAILURE);
+    }
+    for (Reduction *r = check->reductions; r; r = r->next)
+    {
+        if (strcmp(r->name, name) == 0)
+            return;
+    }
+    squad_error("squad flex assigns '%s', which all iterations share; declare it inside the loop "
+                "or list it as a reduction",
+                name);
+}
+
+// Builtins that resize or overwrite the container named by their first argument
+static const char *const mutating_builtins[] = {
+    "push", "pop", "reserve", "clear", "swap", "sort", "stable_sort", "sort_range", "unique",
+    "map_put", "map_delete", "bind_file", "bind_file_rw", "read_bin", "matmul", "transpose", NULL};
+
+/*
+ * If the call is to a builtin that changes arrays passed to it, sets
+ * [*first, *last) to those arguments and returns true.
+ */
+static bool builtin_mutated_args(ASTNode *call, ArgumentList **first, ArgumentList **last)
+{
+    const char *name = call->data.func_call.function_name;
+    ArgumentList *args = call->data.func_call.arguments;
+
+    bool mutating = strcmp(name, "read_csv") == 0;
+    for (int i = 0; mutating_builtins[i] && !mutating; i++)
+        mutating = strcmp(name, mutating_builtins[i]) == 0;
+    size_t len = strlen(name);
+    mutating = mutating || (len > 6 && strcmp(name + len - 6, "_array") == 0);
+    if (!mutating || args == NULL)
+        return false;
+
+    // read_csv fills every array after the path; swap changes both arguments.
+    if (strcmp(name, "read_csv") == 0)
+    {
+        *first = args->next;
+        *last = NULL;
+    }
+    else
+    {
+        *first = args;
+        *last = strcmp(name, "swap") == 0 && args->next ? args->next->next : args->next;
+    }
+    return true;
+}
+
+// slorp, and read_csv or read_bin given "-" as the path
+static bool call_reads_stdin(ASTNode *call)
+{
+    const char *name = call->data.func_call.function_name;
+    ArgumentList *args = call->data.func_call.arguments;
+    if (strcmp(name, "slorp") == 0)
+        return true;
+    ArgumentList *path = strcmp(name, "read_csv") == 0                ? args
+                         : strcmp(name, "read_bin") == 0 && args != NULL ? args->next
+                                                                         : NULL;
+    return path != NULL && path->expr->type == NODE_STRING_LITERAL && strcmp(path->expr->data.name, "-") == 0;
+}
+
+static void check_squad_node(ASTNode *node, void *ctx);
+
+/*
+ * Checks a user function called from a squad flex body as if its body were
+ * inlined there. Scalars are passed by value and functions see no outer
+ * variables, so only array parameters bound to arrays all iterations share
+ * need checking; calls binding none of those are skipped.
+ */
+static void follow_squad_call(SquadCheck *check, ASTNode *call)
+{
+    const char *name = call->data.func_call.function_name;
+    Function *func = get_builtin(name) ? NULL : get_function(name);
+    if (func == NULL || func->body == NULL)
+        return;
+
+    SquadCheck callee = {.callee = func->name, .followed = check->followed};
+    collect_dm_channels(func->body, &callee.dm_channels);
+    char key[MAX_ARGUMENTS + 256];
+    int len = snprintf(key, sizeof(key), "%s/", func->name);
+    bool shares = false;
+    ArgumentList *arg = call->data.func_call.arguments;
+    for (Parameter *param = func->parameters; param && arg && len < (int)sizeof(key) - 1;
+         param = param->next, arg = arg->next)
+    {
+        bool shared = (param->is_array || param->is_channel) && arg->expr->type == NODE_IDENTIFIER &&
+                      !name_set_covers(&check->declared, arg->expr->data.name);
+        if (!shared)
+            name_set_add(&callee.declared, param->name);
+        if (param->is_channel && param->is_single)
+            name_set_add(&callee.dm_channels, param->name);
+        shares = shares || shared;
+        key[len++] = shared ? '1' : '0';
+        key[len] = '\0';
+    }
+    // The key records which parameters are shared, so recursion ends
+    if (shares && !name_set_covers(check->followed, key))
+    {
+        name_set_add(check->followed, safe_strdup(key));
+        collect_declared_names(func->body, &callee.declared);
+        check_squad_node(func->body, &callee);
+    }
+    SAFE_FREE(callee.declared.names);
+    SAFE_FREE(callee.dm_channels.names);
+}
+
+static void check_squad_call(SquadCheck *check, ASTNode *node)
+{
+    const char *name = node->data.func_call.function_name;
+    if (call_reads_stdin(node))
+        squad_error("%s cannot read stdin inside squad flex; stdin has a single reader", name);
+    if (check->followed)
+        follow_squad_call(check, node);
+
+    // A dm channel's ring takes one sender and one receiver at a time
+    ArgumentList *channel = node->data.func_call.arguments;
+    if ((strcmp(name, "send") == 0 || strcmp(name, "recv") == 0) && channel &&
+        channel->expr->type == NODE_IDENTIFIER && name_set_covers(&check->dm_channels, channel->expr->data.name) &&
+        !name_set_covers(&check->declared, channel->expr->data.name))
+    {
+        char error_msg[200];
+        if (check->callee)
+            snprintf(error_msg, sizeof(error_msg),
+                     "squad flex calls %s, which uses dm channel '%s' that all iterations share", check->callee,
+                     channel->expr->data.name);
+        else
+            snprintf(error_msg, sizeof(error_msg),
+                     "squad flex uses dm channel '%s', which takes one sender and one receiver; use a gc channel",
+                     channel->expr->data.name);
+        yyerror(error_msg);
+        interpreter_exit(EXIT_FAILURE);
+    }
+
+    // recv(ch, x) assigns x like x = ... would
+    ArgumentList *args = node->data.func_call.arguments;
+    if (strcmp(name, "recv") == 0 && args && args->next)
+        check_squad_write(check, args->next->expr);
+
+    ArgumentList *first, *last;
+    if (!builtin_mutated_args(node, &first, &last))
+        return;
+    for (ArgumentList *a = first; a && a != last; a = a->next)
+    {
+        if (a->expr->type == NODE_IDENTIFIER && !name_set_covers(&check->declared, a->expr->data.name))
+        {
+            char error_msg[200];
+            if (check->callee)
+                snprintf(error_msg, sizeof(error_msg),
+                         "squad flex calls %s, which calls %s on array parameter '%s' that all iterations share",
+                         check->callee, name, a->expr->data.name);
+            else
+                snprintf(error_msg, sizeof(error_msg),
+                         "squad flex calls %s on '%s', which all iterations share; declare it inside the loop",
+                         name, a->expr->data.name);
+            yyerror(error_msg);
+            interpreter_exit(EXIT_FAILURE);
+        }
+    }
+}
+
+static void check_squad_node(ASTNode *node, void *ctx)
+{
+    SquadCheck *check = ctx;
+    switch (node->type)
+    {
+    case NODE_RETURN:
+        if (check->callee == NULL)
+            squad_error("bussin cannot leave a squad flex loop%s", "");
+        break;
+    case NODE_SPAWN:
+    case NODE_SYNC:
+        if (check->callee == NULL)
+            squad_error("spawn and sync cannot be used inside a squad flex loop%s", "");
+        break;
+    case NODE_BREAK_STATEMENT:
+        if (check->nesting == 0 && check->callee == NULL)
+            squad_error("bruh cannot leave a squad flex loop%s", "");
+        break;
+    case NODE_ASSIGNMENT:
+        check_squad_write(check, node->data.op.left);
+        break;
+    case NODE_UNARY_OPERATION:
+        if (node->data.unary.op == OP_POST_INC || node->data.unary.op == OP_POST_DEC ||
+            node->data.unary.op == OP_PRE_INC || node->data.unary.op == OP_PRE_DEC)
+            check_squad_write(check, node->data.unary.operand);
+        break;
+    case NODE_FUNC_CALL:
+        check_squad_call(check, node);
         break;
-
     default:
-        yyerror("Unsupported binary operator");
-        SAFE_FREE(result);
-        result = NULL;
+        break;
     }
 
-    SAFE_FREE(left_value);
-    SAFE_FREE(right_value);
+    bool nests = node->type == NODE_FOR_STATEMENT || node->type == NODE_WHILE_STATEMENT ||
+                 node->type == NODE_DO_WHILE_STATEMENT || node->type == NODE_SWITCH_STATEMENT;
+    check->nesting += nests;
+    for_each_child(node, check_squad_node, ctx);
+    check->nesting -= nests;
+}
 
-    return result;
+static bool is_identifier_named(ASTNode *node, const char *name)
+{
+    return node && node->type == NODE_IDENTIFIER && strcmp(node->data.name, name) == 0;
 }
 
-void *handle_unary_expression(ASTNode *node, void *operand_value, int operand_type)
+typedef struct
 {
-    switch (node->data.unary.op)
+    NameSet followed; // user functions already searched, so recursion ends
+    bool found;
+} InputSearch;
+
+// Looks for a stdin read in node or in any user function it can call
+static void find_stdin_read(ASTNode *node, void *ctx)
+{
+    InputSearch *search = ctx;
+    if (search->found)
+        return;
+    if (node->type == NODE_FUNC_CALL)
     {
-    case OP_NEG:
-        if (operand_type == VAR_INT)
-        {
-            int *result = SAFE_MALLOC(int);
-            *result = -(*(int *)operand_value);
-            return result;
-        }
-        else if (operand_type == VAR_SHORT)
-        {
-            short *result = SAFE_MALLOC(short);
-            *result = !(*(short *)operand_value);
-            return result;
-        }
-        else if (operand_type == VAR_FLOAT)
-        {
-            float *result = SAFE_MALLOC(float);
-            *result = -(*(float *)operand_value);
-            return result;
-        }
-        else if (operand_type == VAR_DOUBLE)
-        {
-            double *result = SAFE_MALLOC(double);
-            *result = -(*(double *)operand_value);
-            return result;
-        }
-        else if (operand_type == VAR_BOOL)
+        if (call_reads_stdin(node))
         {
-            bool *result = SAFE_MALLOC(bool);
-            *result = !(*(bool *)operand_value);
-            return result;
+            search->found = true;
+            return;
         }
-        else
+        const char *name = node->data.func_call.function_name;
+        Function *func = get_builtin(name) ? NULL : get_function(name);
+        if (func != NULL && func->body != NULL && !name_set_covers(&search->followed, name))
         {
-            yyerror("Invalid type for unary negation");
-            return NULL;
+            name_set_add(&search->followed, func->name);
+            find_stdin_read(func->body, ctx);
         }
+    }
+    for_each_child(node, find_stdin_read, ctx);
+}
 
-    case OP_PRE_INC:
-        if (operand_type == VAR_INT)
-        {
-            int *result = SAFE_MALLOC(int);
-            *result = *(int *)operand_value + 1;
-            set_int_variable(node->data.unary.operand->data.name, *result, get_variable_modifiers(node->data.unary.operand->data.name));
-            return result;
-        }
-        else if (operand_type == VAR_SHORT)
-        {
-            short *result = SAFE_MALLOC(short);
-            *result = *(short *)operand_value + 1;
-            set_short_variable(node->data.unary.operand->data.name, *result, get_variable_modifiers(node->data.unary.operand->data.name));
-            return result;
-        }
-        else if (operand_type == VAR_FLOAT)
-        {
-            float *result = SAFE_MALLOC(float);
-            *result = *(float *)operand_value + 1;
-            set_float_variable(node->data.unary.operand->data.name, *result, get_variable_modifiers(node->data.unary.operand->data.name));
-            return result;
-        }
-        else if (operand_type == VAR_DOUBLE)
-        {
-            double *result = SAFE_MALLOC(double);
-            *result = *(double *)operand_value + 1;
-            set_double_variable(node->data.unary.operand->data.name, *result, get_variable_modifiers(node->data.unary.operand->data.name));
-            return result;
-        }
-        else
-        {
-            yyerror("Invalid type for pre-increment");
-            return NULL;
-        }
-    case OP_PRE_DEC:
-        if (operand_type == VAR_INT)
-        {
-            int *result = SAFE_MALLOC(int);
-            *result = *(int *)operand_value - 1;
-            set_int_variable(node->data.unary.operand->data.name, *result, get_variable_modifiers(node->data.unary.operand->data.name));
-            return result;
-        }
-        else if (operand_type == VAR_SHORT)
-        {
-            short *result = SAFE_MALLOC(short);
-            *result = *(short *)operand_value - 1;
-            set_short_variable(node->data.unary.operand->data.name, *result, get_variable_modifiers(node->data.unary.operand->data.name));
-            return result;
-        }
-        else if (operand_type == VAR_FLOAT)
-        {
-            float *result = SAFE_MALLOC(float);
-            *result = *(float *)operand_value - 1;
-            set_float_variable(node->data.unary.operand->data.name, *result, get_variable_modifiers(node->data.unary.operand->data.name));
-            return result;
-        }
-        else if (operand_type == VAR_DOUBLE)
-        {
-            double *result = SAFE_MALLOC(double);
-            *result = *(double *)operand_value - 1;
-            set_double_variable(node->data.unary.operand->data.name, *result, get_variable_modifiers(node->data.unary.operand->data.name));
-            return result;
-        }
-        else
-        {
-            yyerror("Invalid type for pre-decrement");
-            return NULL;
-        }
-    case OP_POST_INC:
-        if (operand_type == VAR_INT)
-        {
-            int *result = SAFE_MALLOC(int);
-            *result = *(int *)operand_value;
-            set_int_variable(node->data.unary.operand->data.name, *result + 1, get_variable_modifiers(node->data.unary.operand->data.name));
-            return result;
-        }
-        else if (operand_type == VAR_SHORT)
-        {
-            short *result = SAFE_MALLOC(short);
-            *result = *(short *)operand_value;
-            set_short_variable(node->data.unary.operand->data.name, *result + 1, get_variable_modifiers(node->data.unary.operand->data.name));
-            return result;
-        }
-        else if (operand_type == VAR_FLOAT)
-        {
-            float *result = SAFE_MALLOC(float);
-            *result = *(float *)operand_value;
-            set_float_variable(node->data.unary.operand->data.name, *result + 1, get_variable_modifiers(node->data.unary.operand->data.name));
-            return result;
-        }
-        else if (operand_type == VAR_DOUBLE)
-        {
-            double *result = SAFE_MALLOC(double);
-            *result = *(double *)operand_value;
-            set_double_variable(node->data.unary.operand->data.name, *result + 1, get_variable_modifiers(node->data.unary.operand->data.name));
-            return result;
-        }
-        else
-        {
-            yyerror("Invalid type for post-increment");
-            return NULL;
-        }
-    case OP_POST_DEC:
-        if (operand_type == VAR_INT)
-        {
-            int *result = SAFE_MALLOC(int);
-            *result = *(int *)operand_value;
-            set_int_variable(node->data.unary.operand->data.name, *result - 1, get_variable_modifiers(node->data.unary.operand->data.name));
-            return result;
-        }
-        else if (operand_type == VAR_SHORT)
-        {
-            short *result = SAFE_MALLOC(short);
-            *result = *(short *)operand_value;
-            set_short_variable(node->data.unary.operand->data.name, *result - 1, get_variable_modifiers(node->data.unary.operand->data.name));
-            return result;
-        }
-        else if (operand_type == VAR_FLOAT)
+// True if the user function called here can reach slorp or another stdin read
+static bool calls_stdin_reader(ASTNode *call)
+{
+    const char *name = call->data.func_call.function_name;
+    Function *func = get_builtin(name) ? NULL : get_function(name);
+    InputSearch search = {0};
+    if (func != NULL && func->body != NULL)
+    {
+        name_set_add(&search.followed, func->name);
+        find_stdin_read(func->body, &search);
+    }
+    SAFE_FREE(search.followed.names);
+    return search.found;
+}
+
+// A call in a squad flex body to a user function that can reach slorp
+static void check_squad_input_call(ASTNode *node, void *ctx)
+{
+    if (node->type == NODE_FUNC_CALL && calls_stdin_reader(node))
+        squad_error("squad flex calls %s, which reads stdin; stdin has a single reader",
+                    node->data.func_call.function_name);
+    for_each_child(node, check_squad_input_call, ctx);
+}
+
+// ctx is the dm channels of the function the loops are in
+static void check_concurrent_nodes(ASTNode *node, void *ctx)
+{
+    const NameSet *dm_channels = ctx;
+    // A spawned call runs beside its spawner, which may read stdin too
+    if (node->type == NODE_SPAWN && calls_stdin_reader(node->data.spawn.call))
+        squad_error("spawn calls %s, which reads stdin; stdin has a single reader",
+                    node->data.spawn.call->data.func_call.function_name);
+
+    ASTNode *body = node->type == NODE_PARALLEL_FOR && !node->data.parallel_for.automatic
+                        ? node->data.parallel_for.loop->data.for_stmt.body
+                        : NULL;
+    if (body)
+    {
+        check_squad_input_call(body, NULL);
+        // The body checks again, now following calls and knowing the dm channels
+        NameSet followed = {0};
+        SquadCheck check = {.counter = node->data.parallel_for.var,
+                            .reductions = node->data.parallel_for.reductions,
+                            .followed = &followed};
+        for (size_t i = 0; i < dm_channels->count; i++)
+            name_set_add(&check.dm_channels, dm_channels->names[i]);
+        collect_declared_names(body, &check.declared);
+        check_squad_node(body, &check);
+        SAFE_FREE(check.declared.names);
+        SAFE_FREE(check.dm_channels.names);
+        for (size_t i = 0; i < followed.count; i++)
         {
-            float *result = SAFE_MALLOC(float);
-            *result = *(float *)operand_value;
-            set_float_variable(node->data.unary.operand->data.name, *result - 1, get_variable_modifiers(node->data.unary.operand->data.name));
-            return result;
+            char *key = (char *)followed.names[i];
+            SAFE_FREE(key);
         }
-        else if (operand_type == VAR_DOUBLE)
+        SAFE_FREE(followed.names);
+    }
+    for_each_child(node, check_concurrent_nodes, ctx);
+}
+
+/*
+ * Rejects squad flex loops that read stdin, change shared arrays or use a
+ * shared dm channel through a user function, and spawned calls that read
+ * stdin. This runs once the whole program is parsed, since a loop or spawn
+ * may call functions defined after it, or the function it is in.
+ */
+void check_concurrent_calls(void)
+{
+    NameSet dm_channels = {0};
+    if (current_interpreter->root)
+    {
+        collect_dm_channels(current_interpreter->root, &dm_channels);
+        check_concurrent_nodes(current_interpreter->root, &dm_channels);
+    }
+    for (Function *func = current_interpreter->functions; func; func = func->next)
+    {
+        dm_channels.count = 0;
+        for (Parameter *param = func->parameters; param; param = param->next)
         {
-            double *result = SAFE_MALLOC(double);
-            *result = *(double *)operand_value;
-            set_double_variable(node->data.unary.operand->data.name, *result - 1, get_variable_modifiers(node->data.unary.operand->data.name));
-            return result;
+            if (param->is_channel && param->is_single)
+                name_set_add(&dm_channels, param->name);
         }
-        else
+        if (func->body)
         {
-            yyerror("Invalid type for post-decrement");
-            return NULL;
+            collect_dm_channels(func->body, &dm_channels);
+            check_concurrent_nodes(func->body, &dm_channels);
         }
-    default:
-        yyerror("Unknown unary operator");
-        return NULL;
     }
+    SAFE_FREE(dm_channels.names);
+}
+
+/*
+ * Fills in the counter, bounds and step of a NODE_PARALLEL_FOR from a
+ * counted flex loop: flex (rizz i = a; i < b; i = i + s), with any of <,
+ * <=, >, >= and an increment of i = i + s, i = i - s, i++ or i--. Returns
+ * NULL, or a message (taking the counter name) saying what does not fit.
+ */
+static const char *match_counted_loop(ASTNode *loop, ASTNode *node)
+{
+    ASTNode *init = loop->data.for_stmt.init;
+    ASTNode *cond = loop->data.for_stmt.cond;
+    ASTNode *incr = loop->data.for_stmt.incr;
+
+    if (!init || init->type != NODE_DECLARATION || init->var_type != VAR_INT || !init->data.op.right)
+        return "squad flex needs a counter declared by the loop, like flex (rizz i = 0; ...)";
+    char *var = init->data.op.left->data.name;
+
+    if (!cond || cond->type != NODE_OPERATION || !is_identifier_named(cond->data.op.left, var) ||
+        (cond->data.op.op != OP_LT && cond->data.op.op != OP_LE && cond->data.op.op != OP_GT &&
+         cond->data.op.op != OP_GE))
+        return "squad flex needs a condition comparing '%s' with <, <=, > or >=";
+
+    ASTNode *step = NULL;
+    bool step_negated = false;
+    if (incr && incr->type == NODE_UNARY_OPERATION && is_identifier_named(incr->data.unary.operand, var) &&
+        incr->data.unary.op != OP_NEG)
+    {
+        step = create_int_node(1);
+        step_negated = incr->data.unary.op == OP_POST_DEC || incr->data.unary.op == OP_PRE_DEC;
+    }
+    else if (incr && incr->type == NODE_ASSIGNMENT && is_identifier_named(incr->data.op.left, var) &&
+             incr->data.op.right->type == NODE_OPERATION &&
+             (incr->data.op.right->data.op.op == OP_PLUS || incr->data.op.right->data.op.op == OP_MINUS) &&
+             is_identifier_named(incr->data.op.right->data.op.left, var))
+    {
+        step = incr->data.op.right->data.op.right;
+        step_negated = incr->data.op.right->data.op.op == OP_MINUS;
+    }
+    else
+    {
+        return "squad flex needs an increment like %1$s = %1$s + 1";
+    }
+
+    node->data.parallel_for.loop = loop;
+    node->data.parallel_for.reductions = NULL;
+    node->data.parallel_for.var = var;
+    node->data.parallel_for.start = init->data.op.right;
+    node->data.parallel_for.cmp = cond->data.op.op;
+    node->data.parallel_for.bound = cond->data.op.right;
+    node->data.parallel_for.step = step;
+    node->data.parallel_for.step_negated = step_negated;
+    node->data.parallel_for.automatic = false;
+    memset(&node->data.parallel_for.arrays, 0, sizeof(NameList));
+    memset(&node->data.parallel_for.written, 0, sizeof(NameList));
+    memset(&node->data.parallel_for.integral, 0, sizeof(NameList));
+    return NULL;
+}
+
+/*
+ * Wraps a counted flex loop to run its iterations across the thread pool.
+ * The body is checked here so that a loop that would race fails to parse
+ * rather than giving wrong answers.
+ */
+ASTNode *create_parallel_for_node(ASTNode *loop, Reduction *reductions)
+{
+    ASTNode *node = create_node(NODE_PARALLEL_FOR, NONE, current_interpreter->modifiers);
+    const char *mismatch = match_counted_loop(loop, node);
+    const char *var = loop->data.for_stmt.init && loop->data.for_stmt.init->type == NODE_DECLARATION
+                          ? loop->data.for_stmt.init->data.op.left->data.name
+                          : "";
+    if (mismatch)
+        squad_error(mismatch, var);
+
+    for (Reduction *r = reductions; r; r = r->next)
+    {
+        if (strcmp(r->name, var) == 0)
+            squad_error("squad flex cannot reduce its counter '%s'", var);
+    }
+
+    SquadCheck check = {.counter = var, .reductions = reductions};
+    if (loop->data.for_stmt.body)
+    {
+        collect_declared_names(loop->data.for_stmt.body, &check.declared);
+        check_squad_node(loop->data.for_stmt.body, &check);
+    }
+    SAFE_FREE(check.declared.names);
+
+    node->data.parallel_for.reductions = reductions;
+    return node;
+}
+
+/*
+ * Automatic parallelization. A plain flex loop of the counted shape runs
+ * like squad flex when its body provably has no loop-carried dependence:
+ *  - every outer scalar it assigns is only added into (s = s + e, s++), or
+ *    is assigned at the top level of the body before any other use, in
+ *    which case the final iteration's value is kept;
+ *  - every outer array it writes is indexed, at each use, by the counter
+ *    plus the same constant in the same dimension, so each iteration owns
+ *    a disjoint slice of it;
+ *  - every call is to a builtin without side effects outside the iteration.
+ * What the parser cannot see (types, aliasing, trip count) is checked when
+ * the loop starts; if anything fails the loop simply runs serially.
+ */
+
+typedef struct
+{
+    const char *name;
+    VarType type;
+} LocalName;
+
+typedef struct
+{
+    const char *name;
+    int uses;          // occurrences in the body
+    int sum_uses;      // ...of which in s = s + e, s = s - e, s++ or s--
+    bool first_is_def; // first use assigns it at the top level of the body
+    bool scalar_write; // assigned as a whole
+    bool element_write;
+    bool indexed;      // used with []
+    bool bare;         // used without []
+    int num_dimensions;
+    bool aligned[MAX_DIMENSIONS]; // dimension d is always counter + offset[d]
+    int offset[MAX_DIMENSIONS];
+} OuterName;
+
+typedef struct
+{
+    const char *counter;
+    LocalName *locals; // declarations in scope at the current point of the body
+    size_t num_locals;
+    size_t locals_capacity;
+    OuterName *outer;
+    size_t num_outer;
+    size_t outer_capacity;
+    NameList integral;
+    ASTNode *body;
+    ASTNode *statement; // statement being visited, for statement-only forms
+    bool top_level;     // ...and it is one of the body's own statements
+    int nesting;        // loops and switches entered inside the body
+    bool ok;
+} LoopAnalysis;
+
+// Builtins that neither change their arguments nor do I/O
+static const char *const pure_builtins[] = {
+    "len", "binary_search", "popcount", "find_next_set", "map_get", "map_contains", "map_size",
+    "sqrt", "exp", "log", "sin", "cos", "pow", "floor", "abs", NULL};
+
+static bool is_pure_builtin(const char *name)
+{
+    for (int i = 0; pure_builtins[i]; i++)
+    {
+        if (strcmp(name, pure_builtins[i]) == 0)
+            return true;
+    }
+    return false;
+}
+
+static void name_list_add(NameList *list, char *name)
+{
+    list->names = safe_realloc(list->names, (list->count + 1) * sizeof(char *));
+    list->names[list->count++] = name;
+}
+
+// Local declaration visible at this point, or NULL for the counter and outer names
+static LocalName *find_local(LoopAnalysis *an, const char *name)
+{
+    for (size_t i = an->num_locals; i > 0; i--)
+    {
+        size_t len = strlen(an->locals[i - 1].name);
+        if (strncmp(an->locals[i - 1].name, name, len) == 0 && (name[len] == '\0' || name[len] == '.'))
+            return &an->locals[i - 1];
+    }
+    return NULL;
+}
+
+static bool is_counter(LoopAnalysis *an, const char *name)
+{
+    return strcmp(name, an->counter) == 0 && find_local(an, name) == NULL;
+}
+
+static void add_local(LoopAnalysis *an, const char *name, VarType type)
+{
+    if (an->num_locals == an->locals_capacity)
+    {
+        an->locals_capacity = an->locals_capacity ? an->locals_capacity * 2 : 16;
+        an->locals = safe_realloc(an->locals, an->locals_capacity * sizeof(LocalName));
+    }
+    an->locals[an->num_locals++] = (LocalName){name, type};
 }
 
-float evaluate_expression_float(ASTNode *node)
+// Record for a name that refers outside the body, or NULL for locals and the counter
+static OuterName *find_outer(LoopAnalysis *an, const char *name)
 {
-    if (!node)
-        return 0.0f;
+    if (find_local(an, name) || strcmp(name, an->counter) == 0)
+        return NULL;
+    for (size_t i = 0; i < an->num_outer; i++)
+    {
+        if (strcmp(an->outer[i].name, name) == 0)
+            return &an->outer[i];
+    }
+    if (an->num_outer == an->outer_capacity)
+    {
+        an->outer_capacity = an->outer_capacity ? an->outer_capacity * 2 : 16;
+        an->outer = safe_realloc(an->outer, an->outer_capacity * sizeof(OuterName));
+    }
+    OuterName *outer = &an->outer[an->num_outer++];
+    memset(outer, 0, sizeof(*outer));
+    outer->name = name;
+    outer->num_dimensions = -1;
+    return outer;
+}
 
-    switch (node->type)
+// Matches counter, counter + k, k + counter and counter - k
+static bool counter_offset(LoopAnalysis *an, ASTNode *index, int *offset)
+{
+    if (index->type == NODE_IDENTIFIER)
     {
-    case NODE_ARRAY_ACCESS:
+        *offset = 0;
+        return is_counter(an, index->data.name);
+    }
+    if (index->type != NODE_OPERATION || (index->data.op.op != OP_PLUS && index->data.op.op != OP_MINUS))
+        return false;
+    ASTNode *left = index->data.op.left;
+    ASTNode *right = index->data.op.right;
+    if (left->type == NODE_IDENTIFIER && is_counter(an, left->data.name) && right->type == NODE_INT)
     {
-        return *(float*)evaluate_multi_array_access(node);
+        *offset = index->data.op.op == OP_PLUS ? right->data.ivalue : -right->data.ivalue;
+        return true;
     }
-    case NODE_FLOAT:
-        return node->data.fvalue;
-    case NODE_DOUBLE:
-        return (float)node->data.dvalue;
-    case NODE_INT:
-        return (float)node->data.ivalue;
-    case NODE_IDENTIFIER:
+    if (index->data.op.op == OP_PLUS && left->type == NODE_INT && right->type == NODE_IDENTIFIER &&
+        is_counter(an, right->data.name))
     {
-        return *(float *)handle_identifier(node, "Undefined variable", 2);
+        *offset = left->data.ivalue;
+        return true;
     }
-    case NODE_OPERATION:
+    return false;
+}
+
+static void analyze_node(ASTNode *node, void *ctx);
+
+static void record_access(LoopAnalysis *an, ASTNode *access, bool write)
+{
+    for (int d = 0; d < access->data.array.num_dimensions; d++)
+        analyze_node(access->data.array.indices[d], an);
+
+    if (is_counter(an, access->data.array.name))
     {
-        int result_type = get_expression_type(node);
-        void *result = handle_binary_operation(node);
-        float result_float = 0.0f;
-        result_float = (result_type == VAR_INT)
-                           ? (float)(*(int *)result)
-                       : (result_type == VAR_FLOAT)
-                           ? *(float *)result
-                           : (float)(*(double *)result);
-        SAFE_FREE(result);
-        return result_float;
+        an->ok = false;
+        return;
     }
-    case NODE_UNARY_OPERATION:
+    OuterName *outer = find_outer(an, access->data.array.name);
+    if (outer == NULL)
+        return;
+    outer->uses++;
+    outer->indexed = true;
+    outer->element_write |= write;
+
+    int n = access->data.array.num_dimensions;
+    if (outer->num_dimensions == -1)
     {
-        float operand = evaluate_expression_float(node->data.unary.operand);
-        float *result = (float *)handle_unary_expression(node, &operand, VAR_FLOAT);
-        float return_val = *result;
-        SAFE_FREE(result);
-        return return_val;
+        outer->num_dimensions = n;
+        for (int d = 0; d < n; d++)
+            outer->aligned[d] = counter_offset(an, access->data.array.indices[d], &outer->offset[d]);
     }
-    case NODE_SIZEOF:
+    else if (outer->num_dimensions != n)
     {
-        return (float)handle_sizeof(node);
+        an->ok = false;
     }
-    case NODE_FUNC_CALL:
+    else
     {
-        float *res = (float *)handle_function_call(node);
-        if (res != NULL)
+        for (int d = 0; d < n; d++)
         {
-            float result = *res;
-            SAFE_FREE(res);
-            return result;
+            int offset;
+            if (!counter_offset(an, access->data.array.indices[d], &offset) || offset != outer->offset[d])
+                outer->aligned[d] = false;
         }
-        return 0.0f;
-    }
-    default:
-        yyerror("Invalid float expression");
-        return 0.0f;
     }
 }
 
-double evaluate_expression_double(ASTNode *node)
+static void record_scalar_use(LoopAnalysis *an, const char *name, bool write, bool sum, bool def)
 {
-    if (!node)
-        return 0.0L;
-
-    switch (node->type)
-    {
-    case NODE_ARRAY_ACCESS:
+    if (is_counter(an, name))
     {
-        return *(double*)evaluate_multi_array_access(node);
+        an->ok = an->ok && !write;
+        return;
     }
-    case NODE_DOUBLE:
-        return node->data.dvalue;
-    case NODE_FLOAT:
-        return (double)node->data.fvalue;
+    OuterName *outer = find_outer(an, name);
+    if (outer == NULL)
+        return;
+    if (outer->uses == 0)
+        outer->first_is_def = def;
+    outer->uses++;
+    outer->sum_uses += sum;
+    outer->bare = true;
+    outer->scalar_write |= write;
+}
+
+/*
+ * Whether an expression added into a rizz sum is an integer, so the sum can
+ * be regrouped. Outer names are collected and checked when the loop starts.
+ */
+static bool integral_term(LoopAnalysis *an, ASTNode *term)
+{
+    switch (term->type)
+    {
     case NODE_INT:
-        return (double)node->data.ivalue;
+    case NODE_SHORT:
+    case NODE_CHAR:
+    case NODE_BOOLEAN:
+        return true;
     case NODE_IDENTIFIER:
+    case NODE_ARRAY_ACCESS:
     {
-        return *(double *)handle_identifier(node, "Undefined variable", 1);
+        const char *name = term->data.name;
+        LocalName *local = find_local(an, name);
+        if (local)
+            return local->type == VAR_INT || local->type == VAR_SHORT || local->type == VAR_BOOL ||
+                   local->type == VAR_CHAR;
+        if (!is_counter(an, name))
+            name_list_add(&an->integral, (char *)name);
+        return true;
     }
     case NODE_OPERATION:
+        return integral_term(an, term->data.op.left) && integral_term(an, term->data.op.right);
+    case NODE_UNARY_OPERATION:
+        return integral_term(an, term->data.unary.operand);
+    case NODE_FUNC_CALL:
     {
-        int result_type = get_expression_type(node);
-        void *result = handle_binary_operation(node);
-        double result_double = 0.0L;
-        result_double = (result_type == VAR_INT)
-                            ? (double)(*(int *)result)
-                        : (result_type == VAR_FLOAT)
-                            ? (double)(*(float *)result)
-                            : *(double *)result;
-        SAFE_FREE(result);
-        return result_double;
+        const Builtin *builtin = get_builtin(term->data.func_call.function_name);
+        return builtin && builtin->return_type == VAR_INT;
     }
-    case NODE_UNARY_OPERATION:
+    default:
+        return false;
+    }
+}
+
+static bool is_step(OperatorType op)
+{
+    return op == OP_POST_INC || op == OP_POST_DEC || op == OP_PRE_INC || op == OP_PRE_DEC;
+}
+
+static void analyze_assignment(LoopAnalysis *an, ASTNode *node)
+{
+    ASTNode *left = node->data.op.left;
+    ASTNode *right = node->data.op.right;
+    if (left->type == NODE_ARRAY_ACCESS)
     {
-        double operand = evaluate_expression_double(node->data.unary.operand);
-        double *result = (double *)handle_unary_expression(node, &operand, VAR_DOUBLE);
-        double return_val = *result;
-        SAFE_FREE(result);
-        return return_val;
+        analyze_node(right, an);
+        record_access(an, left, true);
+        return;
     }
-    case NODE_SIZEOF:
+    if (left->type != NODE_IDENTIFIER)
     {
-        return (double)handle_sizeof(node);
+        an->ok = false;
+        return;
     }
-    case NODE_FUNC_CALL:
+
+    // s = s + e, s = e + s and s = s - e, written as a statement of their own
+    const char *name = left->data.name;
+    if (node == an->statement && find_outer(an, name) && right->type == NODE_OPERATION &&
+        (right->data.op.op == OP_PLUS || right->data.op.op == OP_MINUS))
     {
-        double *res = (double *)handle_function_call(node);
-        if (res != NULL)
+        ASTNode *term = NULL;
+        if (is_identifier_named(right->data.op.left, name))
+            term = right->data.op.right;
+        else if (right->data.op.op == OP_PLUS && is_identifier_named(right->data.op.right, name))
+            term = right->data.op.left;
+        if (term)
         {
-            double result = *res;
-            SAFE_FREE(res);
-            return result;
+            analyze_node(term, an);
+            if (!integral_term(an, term))
+                an->ok = false;
+            record_scalar_use(an, name, true, true, false);
+            record_scalar_use(an, name, true, true, false);
+            return;
         }
-        return 0.0L;
-    }
-    default:
-        yyerror("Invalid double expression");
-        return 0.0L;
     }
+
+    // The right side is visited first, so x = x * 2 does not count as a definition
+    analyze_node(right, an);
+    record_scalar_use(an, name, true, false, an->top_level && node == an->statement);
 }
-size_t get_type_size(char *name)
+
+static void analyze_call(LoopAnalysis *an, ASTNode *node)
 {
-    Variable *var = get_variable(name);
-    if (var != NULL)
-    {
-        if (var->var_type == VAR_FLOAT)
-        {
-            if (var->is_array)
-            {
-                return sizeof(float) * var->array_length;
-            }
-            return sizeof(float);
-        }
-        else if (var->var_type == VAR_DOUBLE)
-        {
-            if (var->is_array)
-            {
-                return sizeof(double) * var->array_length;
-            }
-            return sizeof(double);
-        }
-        else if (var->modifiers.is_unsigned && var->var_type == VAR_INT)
-        {
-            if (var->is_array)
-            {
-                return sizeof(unsigned int) * var->array_length;
-            }
-            return sizeof(unsigned int);
-        }
-        else if (var->var_type == VAR_BOOL)
+    const char *name = node->data.func_call.function_name;
+    if (!is_pure_builtin(name))
+    {
+        // Builtins that change a container are fine on one the body declared
+        ArgumentList *first, *last;
+        bool io = strcmp(name, "read_csv") == 0 || strcmp(name, "read_bin") == 0 ||
+                  strncmp(name, "bind_file", 9) == 0;
+        if (io || !builtin_mutated_args(node, &first, &last))
         {
-            if (var->is_array)
-            {
-                return sizeof(bool) * var->array_length;
-            }
-            return sizeof(bool);
-        }
-        else if (var->modifiers.is_unsigned && var->var_type == VAR_SHORT)
-        {
-            if (var->is_array)
-            {
-                return sizeof(unsigned short) * var->array_length;
-            }
-            return sizeof(unsigned short);
-        }
-        else if (var->var_type == VAR_SHORT)
-        {
-            if (var->is_array)
-            {
-                return sizeof(short) * var->array_length;
-            }
-            return sizeof(short);
-        }
-        else if (var->var_type == VAR_INT)
-        {
-            if (var->is_array)
-            {
-                return sizeof(int) * var->array_length;
-            }
-            return sizeof(int);
+            an->ok = false;
+            return;
         }
-        else
+        for (ArgumentList *a = first; a && a != last; a = a->next)
         {
-            yyerror("Undefined variable in sizeof");
+            if (a->expr->type != NODE_IDENTIFIER || !find_local(an, a->expr->data.name))
+                an->ok = false;
         }
     }
-    yyerror("Undefined variable in sizeof");
-    return 0;
+    for (ArgumentList *a = node->data.func_call.arguments; a; a = a->next)
+        analyze_node(a->expr, an);
 }
 
-size_t handle_sizeof(ASTNode *node)
+static void analyze_node(ASTNode *node, void *ctx)
 {
-    ASTNode *expr = node->data.sizeof_stmt.expr;
-    VarType type = get_expression_type(node->data.sizeof_stmt.expr);
-    if (expr->type == NODE_IDENTIFIER)
+    LoopAnalysis *an = ctx;
+    if (!an->ok)
+        return;
+
+    size_t saved_locals = an->num_locals;
+    switch (node->type)
     {
-        return get_type_size(expr->data.name);
+    case NODE_RETURN:
+    case NODE_PRINT_STATEMENT:
+    case NODE_ERROR_STATEMENT:
+    case NODE_PARALLEL_FOR:
+    case NODE_SPAWN:
+    case NODE_SYNC:
+    case NODE_SIMD_DECLARATION: // hand-vectorized loops are left as written
+        an->ok = false;
+        return;
+    case NODE_BREAK_STATEMENT:
+        an->ok = an->nesting > 0;
+        return;
+    case NODE_IDENTIFIER:
+        record_scalar_use(an, node->data.name, false, false, false);
+        return;
+    case NODE_ARRAY_ACCESS:
+        record_access(an, node, false);
+        return;
+    case NODE_ASSIGNMENT:
+        analyze_assignment(an, node);
+        return;
+    case NODE_UNARY_OPERATION:
+        if (!is_step(node->data.unary.op))
+            break;
+        if (node->data.unary.operand->type == NODE_ARRAY_ACCESS)
+            record_access(an, node->data.unary.operand, true);
+        else if (node->data.unary.operand->type == NODE_IDENTIFIER)
+            record_scalar_use(an, node->data.unary.operand->data.name, true, node == an->statement, false);
+        else
+            an->ok = false;
+        return;
+    case NODE_FUNC_CALL:
+        analyze_call(an, node);
+        return;
+    case NODE_DECLARATION:
+        if (node->data.op.right)
+            analyze_node(node->data.op.right, an);
+        add_local(an, node->data.op.left->data.name, node->var_type);
+        return;
+    case NODE_ARRAY_DECLARATION:
+        for_each_child(node, analyze_node, an);
+        add_local(an, node->data.array_decl.name, node->var_type);
+        return;
+    case NODE_MAP_DECLARATION:
+        add_local(an, node->data.map_decl.name, NONE);
+        return;
+    case NODE_VECTOR_DECLARATION:
+        add_local(an, node->data.name, NONE);
+        return;
+    case NODE_STRUCT_DECLARATION:
+        add_local(an, node->data.struct_decl.name, NONE);
+        return;
+    case NODE_STATEMENT_LIST:
+    {
+        ASTNode *saved_statement = an->statement;
+        bool saved_top_level = an->top_level;
+        for (StatementList *sl = node->data.statements; sl; sl = sl->next)
+        {
+            if (sl->statement == NULL)
+                continue;
+            // Only the loop body's own statements run on every iteration
+            an->statement = sl->statement;
+            an->top_level = node == an->body;
+            analyze_node(sl->statement, an);
+        }
+        an->statement = saved_statement;
+        an->top_level = saved_top_level;
+        an->num_locals = saved_locals;
+        return;
     }
-    switch (type)
+    case NODE_FOR_STATEMENT:
     {
-    case VAR_INT:
-        return sizeof(int);
-    case VAR_FLOAT:
-        return sizeof(float);
-    case VAR_DOUBLE:
-        return sizeof(double);
-    case VAR_SHORT:
-        return sizeof(short);
-    case VAR_BOOL:
-        return sizeof(bool);
-    case VAR_CHAR:
-        return sizeof(char);
+        an->nesting++;
+        if (node->data.for_stmt.init)
+            analyze_node(node->data.for_stmt.init, an);
+        if (node->data.for_stmt.cond)
+            analyze_node(node->data.for_stmt.cond, an);
+        if (node->data.for_stmt.body)
+            analyze_node(node->data.for_stmt.body, an);
+        ASTNode *saved_statement = an->statement;
+        bool saved_top_level = an->top_level;
+        an->statement = node->data.for_stmt.incr;
+        an->top_level = false;
+        if (node->data.for_stmt.incr)
+            analyze_node(node->data.for_stmt.incr, an);
+        an->statement = saved_statement;
+        an->top_level = saved_top_level;
+        an->nesting--;
+        an->num_locals = saved_locals;
+        return;
+    }
+    case NODE_WHILE_STATEMENT:
+    case NODE_DO_WHILE_STATEMENT:
+    case NODE_SWITCH_STATEMENT:
+        an->nesting++;
+        for_each_child(node, analyze_node, an);
+        an->nesting--;
+        an->num_locals = saved_locals;
+        return;
+    case NODE_IF_STATEMENT:
+        for_each_child(node, analyze_node, an);
+        an->num_locals = saved_locals;
+        return;
     default:
-        yyerror("Invalid type in sizeof");
-        return 0;
+        break;
     }
-    yyerror("Invalid type in sizeof");
-    return 0;
+    for_each_child(node, analyze_node, an);
 }
 
-short evaluate_expression_short(ASTNode *node)
+static OuterName *lookup_outer(LoopAnalysis *an, const char *name)
 {
-    if (!node)
-        return 0;
+    for (size_t i = 0; i < an->num_outer; i++)
+    {
+        if (strcmp(an->outer[i].name, name) == 0)
+            return &an->outer[i];
+    }
+    return NULL;
+}
 
-    switch (node->type)
+// Loop header expressions must give the same value on every iteration
+static bool invariant_expression(LoopAnalysis *an, ASTNode *expr)
+{
+    switch (expr->type)
     {
     case NODE_INT:
-        return (short)node->data.ivalue;
-    case NODE_BOOLEAN:
-        return (short)node->data.bvalue; // Already 1 or 0
-    case NODE_CHAR:                      // Add explicit handling for characters
-        return (short)node->data.ivalue;
     case NODE_SHORT:
-        return node->data.svalue;
     case NODE_FLOAT:
-        yyerror("Cannot use float in integer context");
-        return (short)node->data.fvalue;
     case NODE_DOUBLE:
-        yyerror("Cannot use double in integer context");
-        return (short)node->data.dvalue;
-    case NODE_SIZEOF:
-    {
-        return handle_sizeof(node);
-    }
+    case NODE_CHAR:
+    case NODE_BOOLEAN:
+        return true;
     case NODE_IDENTIFIER:
+    case NODE_ARRAY_ACCESS:
     {
-        return *(short *)handle_identifier(node, "Undefined variable", 0);
-    }
-    case NODE_OPERATION:
-    {
-        // Special handling for logical operations
-        if (node->data.op.op == OP_AND || node->data.op.op == OP_OR)
+        OuterName *outer = lookup_outer(an, expr->data.name);
+        if (strcmp(expr->data.name, an->counter) == 0 || (outer && (outer->scalar_write || outer->element_write)))
+            return false;
+        if (expr->type == NODE_ARRAY_ACCESS)
         {
-            short left = evaluate_expression_short(node->data.op.left);
-            short right = evaluate_expression_short(node->data.op.right);
-
-            switch (node->data.op.op)
+            for (int d = 0; d < expr->data.array.num_dimensions; d++)
             {
-            case OP_AND:
-                return left && right;
-            case OP_OR:
-                return left || right;
-            default:
-                break;
+                if (!invariant_expression(an, expr->data.array.indices[d]))
+                    return false;
             }
         }
-
-        // Regular integer operations
-        int result_type = get_expression_type(node);
-        void *result = handle_binary_operation(node);
-        short result_short = 0;
-        result_short = (result_type == VAR_SHORT)
-                           ? *(short *)result
-                       : (result_type == VAR_FLOAT)
-                           ? (short)(*(float *)result)
-                       : (result_type == VAR_DOUBLE)
-                           ? (short)(*(double *)result)
-                           : (short)(*(int *)result);
-        SAFE_FREE(result);
-        return result_short;
+        return true;
     }
+    case NODE_OPERATION:
+        return invariant_expression(an, expr->data.op.left) && invariant_expression(an, expr->data.op.right);
     case NODE_UNARY_OPERATION:
-    {
-        short operand = evaluate_expression_short(node->data.unary.operand);
-        short *result = (short *)handle_unary_expression(node, &operand, VAR_SHORT);
-        short return_val = *result;
-        SAFE_FREE(result);
-        return return_val;
+        return !is_step(expr->data.unary.op) && invariant_expression(an, expr->data.unary.operand);
+    case NODE_FUNC_CALL:
+        if (!is_pure_builtin(expr->data.func_call.function_name))
+            return false;
+        for (ArgumentList *a = expr->data.func_call.arguments; a; a = a->next)
+        {
+            if (!invariant_expression(an, a->expr))
+                return false;
+        }
+        return true;
+    default:
+        return false;
     }
-    case NODE_ARRAY_ACCESS:
+}
+
+// Moves a list built with safe_realloc into the arena, next to the AST
+static NameList arena_name_list(NameList *list)
+{
+    NameList copy = {NULL, list->count};
+    if (list->count > 0)
     {
-      
-        return *(short*)evaluate_multi_array_access(node);
+        copy.names = arena_alloc(&current_interpreter->arena, list->count * sizeof(char *));
+        memcpy(copy.names, list->names, list->count * sizeof(char *));
     }
-    case NODE_FUNC_CALL:
+    SAFE_FREE(list->names);
+    return copy;
+}
+
+/*
+ * Returns a NODE_PARALLEL_FOR that runs the loop in parallel, or NULL if
+ * the loop does not have the counted shape or its iterations may depend on
+ * each other.
+ */
+ASTNode *find_parallel_loop(ASTNode *loop)
+{
+    ASTNode *node = create_node(NODE_PARALLEL_FOR, NONE, current_interpreter->modifiers);
+    if (!loop->data.for_stmt.body || match_counted_loop(loop, node) != NULL)
+        return NULL;
+
+    LoopAnalysis an = {.counter = node->data.parallel_for.var, .body = loop->data.for_stmt.body, .ok = true};
+    analyze_node(an.body, &an);
+    an.ok = an.ok && invariant_expression(&an, node->data.parallel_for.start) &&
+            invariant_expression(&an, node->data.parallel_for.bound) &&
+            invariant_expression(&an, node->data.parallel_for.step);
+
+    NameList arrays = {0}, written = {0};
+    Reduction *reductions = NULL;
+    for (size_t i = 0; i < an.num_outer && an.ok; i++)
     {
-        short *res = (short *)handle_function_call(node);
-        if (res != NULL)
+        OuterName *outer = &an.outer[i];
+        if (outer->scalar_write)
+        {
+            if (outer->indexed || (outer->sum_uses != outer->uses && !outer->first_is_def))
+            {
+                an.ok = false;
+                break;
+            }
+            reductions = create_reduction("+", (char *)outer->name, reductions);
+            if (outer->sum_uses != outer->uses)
+                reductions->op = REDUCE_LAST;
+            continue;
+        }
+        if (outer->element_write)
         {
-            short return_val = *res;
-            SAFE_FREE(res);
-            return return_val;
+            bool aligned = false;
+            for (int d = 0; d < outer->num_dimensions; d++)
+                aligned = aligned || outer->aligned[d];
+            if (outer->bare || !aligned)
+            {
+                an.ok = false;
+                break;
+            }
+            name_list_add(&written, (char *)outer->name);
         }
-        return 0;
+        // Bare names may be scalars; the overlap check skips those
+        name_list_add(&arrays, (char *)outer->name);
     }
-    default:
-        yyerror("Invalid short expression");
-        return 0;
+
+    SAFE_FREE(an.locals);
+    SAFE_FREE(an.outer);
+    if (!an.ok)
+    {
+        SAFE_FREE(an.integral.names);
+        SAFE_FREE(arrays.names);
+        SAFE_FREE(written.names);
+        return NULL;
     }
+
+    node->data.parallel_for.reductions = reductions;
+    node->data.parallel_for.automatic = true;
+    node->data.parallel_for.arrays = arena_name_list(&arrays);
+    node->data.parallel_for.written = arena_name_list(&written);
+    node->data.parallel_for.integral = arena_name_list(&an.integral);
+    return node;
 }
 
-int evaluate_expression_int(ASTNode *node)
+typedef struct
 {
-    if (!node)
-        return 0;
+    Variable *partials; // each reduction variable as this chunk left it
+    char *output;       // what the chunk yapped, written out in chunk order
+    size_t output_len;
+    FILE *stream;       // open while the chunk runs
+    bool failed;        // an error or ragequit stopped the chunk
+} SquadChunk;
+
+typedef struct
+{
+    Interpreter *interpreter;
+    ASTNode *node;
+    Scope *parent;
+    long long start;
+    long long step;
+    size_t iterations;
+    size_t nchunks;
+    SquadChunk *chunks;
+    Variable **shared; // reduction targets in the enclosing scope
+    size_t nreductions;
+    atomic_size_t first_failed; // lowest chunk that failed, nchunks if none
+} SquadLoop;
+
+static void declare_private(const char *name, Variable *like, bool zero)
+{
+    Variable *var = variable_new((char *)name);
+    var->var_type = like->var_type;
+    var->modifiers = like->modifiers;
+    var->value = like->value;
+    if (zero)
+        memset(&var->value, 0, sizeof(var->value));
+    add_variable_to_scope(name, var);
+    SAFE_FREE(var);
+}
 
-    switch (node->type)
-    {
-    case NODE_INT:
-        return node->data.ivalue;
-    case NODE_BOOLEAN:
-        return node->data.bvalue; // Already 1 or 0
-    case NODE_CHAR:               // Add explicit handling for characters
-        return node->data.ivalue;
-    case NODE_SHORT:
-        return node->data.svalue;
-    case NODE_FLOAT:
-        yyerror("Cannot use float in integer context");
-        return (int)node->data.fvalue;
-    case NODE_DOUBLE:
-        yyerror("Cannot use double in integer context");
-        return (int)node->data.dvalue;
-    case NODE_SIZEOF:
+// Runs one contiguous slice of the iterations
+static void run_squad_slice(void *ctx, size_t c)
+{
+    SquadLoop *loop = ctx;
+    SquadChunk *chunk = &loop->chunks[c];
+    ASTNode *node = loop->node;
+    ASTNode *body = node->data.parallel_for.loop->data.for_stmt.body;
+
+    chunk->stream = open_memstream(&chunk->output, &chunk->output_len);
+    if (chunk->stream == NULL)
     {
-        return handle_sizeof(node);
+        yyerror("Out of memory starting squad flex");
+        interpreter_exit(EXIT_FAILURE);
     }
-    case NODE_IDENTIFIER:
+    yap_stream = chunk->stream;
+    current_scope = create_scope(loop->parent);
+
+    // Reductions start from zero for +, or from the shared value for min
+    // and max, so combining the chunks in order gives the serial answer.
+    Reduction *r = node->data.parallel_for.reductions;
+    for (size_t k = 0; k < loop->nreductions; k++, r = r->next)
+        declare_private(r->name, loop->shared[k], r->op == REDUCE_SUM);
+
+    Variable counter_init = {.var_type = VAR_INT};
+    declare_private(node->data.parallel_for.var, &counter_init, true);
+    Variable *counter = get_variable(node->data.parallel_for.var);
+
+    size_t lo = c * loop->iterations / loop->nchunks;
+    size_t hi = (c + 1) * loop->iterations / loop->nchunks;
+    for (size_t k = lo; k < hi; k++)
     {
-        return *(int *)handle_identifier(node, "Undefined variable", 0);
+        // An earlier slice failed, so nothing from this one is used
+        if (atomic_load_explicit(&loop->first_failed, memory_order_relaxed) < c)
+            break;
+        counter->value.ivalue = (int)(loop->start + (long long)k * loop->step);
+        enter_scope();
+        execute_statement(body);
+        exit_scope();
     }
-    case NODE_OPERATION:
-    {
-        // Special handling for logical operations
-        if (node->data.op.op == OP_AND || node->data.op.op == OP_OR)
-        {
-            int left = evaluate_expression_int(node->data.op.left);
-            int right = evaluate_expression_int(node->data.op.right);
 
-            switch (node->data.op.op)
-            {
-            case OP_AND:
-                return left && right;
-            case OP_OR:
-                return left || right;
-            default:
-                break;
-            }
-        }
+    r = node->data.parallel_for.reductions;
+    for (size_t k = 0; k < loop->nreductions; k++, r = r->next)
+        chunk->partials[k] = *get_variable(r->name);
 
-        // Regular integer operations
-        int result_type = get_expression_type(node);
-        void *result = handle_binary_operation(node);
-        int result_int = 0;
-        result_int = (result_type == VAR_INT)
-                         ? *(int *)result
-                     : (result_type == VAR_FLOAT)
-                         ? (int)(*(float *)result)
-                         : (int)(*(double *)result);
-        SAFE_FREE(result);
-        return result_int;
+    exit_scope();
+}
+
+/* Runs one slice on the calling thread */
+static void run_squad_chunk(void *ctx, size_t c)
+{
+    SquadLoop *loop = ctx;
+    SquadChunk *chunk = &loop->chunks[c];
+
+    Interpreter *saved_interpreter = bind_interpreter(loop->interpreter);
+    Scope *saved_scope = current_scope;
+    JumpBuffer *saved_jump = jump_buffer;
+    ReturnValue saved_return = current_return_value;
+    FILE *saved_stream = yap_stream;
+
+    jump_buffer = NULL;
+    chunk->failed = !run_guarded(run_squad_slice, loop, c);
+    if (chunk->failed)
+    {
+        size_t first = atomic_load(&loop->first_failed);
+        while (c < first && !atomic_compare_exchange_weak(&loop->first_failed, &first, c))
+            ;
+    }
+
+    bind_interpreter(saved_interpreter);
+    current_scope = saved_scope;
+    jump_buffer = saved_jump;
+    current_return_value = saved_return;
+    yap_stream = saved_stream;
+    if (chunk->stream != NULL)
+        fclose(chunk->stream);
+}
+
+static void combine_reduction(Variable *var, ReductionOp op, const Variable *part)
+{
+#define COMBINE(field, type)                                                        \
+    do                                                                              \
+    {                                                                               \
+        type a = var->value.field, b = part->value.field;                           \
+        var->value.field = op == REDUCE_SUM ? (type)(a + b) : op == REDUCE_MIN ? (b < a ? b : a) \
+                                                                               : (b > a ? b : a); \
+    } while (0)
+
+    if (op == REDUCE_LAST)
+    {
+        var->value = part->value;
+        return;
     }
-    case NODE_UNARY_OPERATION:
+    switch (var->var_type)
     {
-        int operand = evaluate_expression_int(node->data.unary.operand);
-        int *result = (int *)handle_unary_expression(node, &operand, VAR_INT);
-        int return_val = *result;
-        SAFE_FREE(result);
-        return return_val;
+    case VAR_INT:
+        if (op == REDUCE_SUM)
+            var->value.ivalue = (int)((unsigned)var->value.ivalue + (unsigned)part->value.ivalue);
+        else
+            COMBINE(ivalue, int);
+        break;
+    case VAR_SHORT:
+        COMBINE(svalue, short);
+        break;
+    case VAR_FLOAT:
+        COMBINE(fvalue, float);
+        break;
+    default:
+        COMBINE(dvalue, double);
+        break;
     }
-    case NODE_ARRAY_ACCESS:
+#undef COMBINE
+}
+
+static bool is_integer_type(VarType type)
+{
+    return type == VAR_INT || type == VAR_SHORT || type == VAR_BOOL || type == VAR_CHAR;
+}
+
+// Bytes spanned by an array's storage
+static size_t array_extent(const Variable *var)
+{
+    size_t n = var->array_dimensions.total_size;
+    if (n < (size_t)var->array_length)
+        n = var->array_length;
+    if (var->is_vector && var->capacity > n)
+        n = var->capacity;
+    return var->stride ? n * var->stride : vector_bytes(var->var_type, n);
+}
+
+/*
+ * Checks what find_parallel_loop could not see in the source: that sums
+ * only add integers, and that no array the loop writes shares memory with
+ * another array it uses.
+ */
+static bool automatic_loop_is_safe(ASTNode *node)
+{
+    NameList *integral = &node->data.parallel_for.integral;
+    for (int i = 0; i < integral->count; i++)
     {
-        return *(int*)evaluate_multi_array_access(node);
+        Variable *var = get_variable(integral->names[i]);
+        if (var == NULL || var->is_map || !is_integer_type(var->var_type))
+            return false;
     }
-    case NODE_FUNC_CALL:
+
+    NameList *written = &node->data.parallel_for.written;
+    NameList *arrays = &node->data.parallel_for.arrays;
+    for (int w = 0; w < written->count; w++)
     {
-        int *res = (int *)handle_function_call(node);
-        if (res != NULL)
+        Variable *var = get_variable(written->names[w]);
+        // cap arrays pack 64 elements to a word, so neighbours would race
+        if (var == NULL || !var->is_array || var->var_type == VAR_BOOL || var->modifiers.is_const)
+            return false;
+        const char *lo = var->value.array_data;
+        const char *hi = lo + array_extent(var);
+        for (int a = 0; a < arrays->count; a++)
         {
-            int return_val = *res;
-            SAFE_FREE(res);
-            return return_val;
+            Variable *other = get_variable(arrays->names[a]);
+            if (other == NULL || other == var || !other->is_array)
+                continue;
+            const char *other_lo = other->value.array_data;
+            if (other_lo < hi && lo < other_lo + array_extent(other))
+                return false;
         }
-        return 0;
-    }
-    default:
-        yyerror("Invalid integer expression");
-        return 0;
     }
+    return true;
+}
+
+/*
+ * Runs a squad flex loop, or a plain flex loop the analyzer marked. For the
+ * latter, returns false without running anything if the loop turns out to
+ * be too short or unsafe to split, and the caller runs it serially.
+ */
+bool execute_parallel_for(ASTNode *node)
+{
+    bool automatic = node->data.parallel_for.automatic;
+    if (automatic && (pool_in_task() || pool_size() == 1))
+        return false;
+
+    ASTNode *start_expr = node->data.parallel_for.start;
+    ASTNode *bound_expr = node->data.parallel_for.bound;
+    ASTNode *step_expr = node->data.parallel_for.step;
+    // A plain loop compares i < 2.5 as a gigachad; leave those alone
+    if (automatic && (is_float_expression(bound_expr) || is_double_expression(bound_expr) ||
+                      is_float_expression(step_expr) || is_double_expression(step_expr)))
+        return false;
+
+    long long start = evaluate_expression(start_expr);
+    long long bound = evaluate_expression(bound_expr);
+    long long step = evaluate_expression(step_expr);
+    if (node->data.parallel_for.step_negated)
+        step = -step;
+
+    OperatorType cmp = node->data.parallel_for.cmp;
+    bool upward = cmp == OP_LT || cmp == OP_LE;
+    if (step == 0 || (step > 0) != upward)
+    {
+        if (automatic)
+            return false;
+        yyerror("squad flex step must move the counter toward its bound");
+        interpreter_exit(EXIT_FAILURE);
+    }
+
+    // Number of values the counter takes before the condition fails
+    long long span = upward ? bound - start : start - bound;
+    long long stride = upward ? step : -step;
+    if (cmp == OP_LE || cmp == OP_GE)
+        span++;
+    size_t iterations = span > 0 ? (size_t)((span + stride - 1) / stride) : 0;
+    if (automatic)
+    {
+        // The serial loop's final counter value must not overflow either
+        long long last = start + (long long)iterations * step;
+        if (iterations < AUTO_PARALLEL_MIN_ITERATIONS || last < INT_MIN || last > INT_MAX ||
+            !automatic_loop_is_safe(node))
+            return false;
+    }
+    if (iterations == 0)
+        return true;
+
+    SquadLoop loop = {
+        .interpreter = current_interpreter,
+        .node = node,
+        .parent = current_scope,
+        .start = start,
+        .step = step,
+        .iterations = iterations,
+        .nchunks = iterations < SQUAD_MAX_CHUNKS ? iterations : SQUAD_MAX_CHUNKS,
+    };
+    for (Reduction *r = node->data.parallel_for.reductions; r; r = r->next)
+        loop.nreductions++;
+    loop.shared = safe_malloc_array(loop.nreductions ? loop.nreductions : 1, sizeof(Variable *));
+    size_t k = 0;
+    for (Reduction *r = node->data.parallel_for.reductions; r; r = r->next, k++)
+    {
+        Variable *var = get_variable(r->name);
+        bool scalar = var != NULL && !var->is_array && !var->is_map && !var->struct_def;
+        if (automatic)
+        {
+            if (!scalar || var->modifiers.is_const ||
+                (r->op == REDUCE_SUM && var->var_type != VAR_INT && var->var_type != VAR_SHORT))
+            {
+                SAFE_FREE(loop.shared);
+                return false;
+            }
+        }
+        else if (!scalar || var->var_type == VAR_BOOL || var->var_type == VAR_CHAR)
+        {
+            squad_error("squad flex reduction '%s' must be a rizz, smol, chad or gigachad variable", r->name);
+        }
+        check_const_assignment(r->name);
+        loop.shared[k] = var;
+    }
+
+    atomic_init(&loop.first_failed, loop.nchunks);
+    loop.chunks = safe_malloc_array(loop.nchunks, sizeof(SquadChunk));
+    for (size_t c = 0; c < loop.nchunks; c++)
+    {
+        loop.chunks[c].partials = safe_malloc_array(loop.nreductions ? loop.nreductions : 1, sizeof(Variable));
+        loop.chunks[c].output = NULL;
+        loop.chunks[c].output_len = 0;
+        loop.chunks[c].stream = NULL;
+        loop.chunks[c].failed = false;
+    }
+
+    pool_run(loop.nchunks, run_squad_chunk, &loop);
+
+    // If a slice failed, what it and the slices before it yapped still
+    // comes out, as it would have from the serial loop
+    bool failed = false;
+    for (size_t c = 0; c < loop.nchunks; c++)
+    {
+        SquadChunk *chunk = &loop.chunks[c];
+        if (!failed)
+            yap_write(chunk->output, chunk->output_len);
+        free(chunk->output); // allocated by open_memstream, not safe_malloc
+        failed = failed || chunk->failed;
+        Reduction *r = node->data.parallel_for.reductions;
+        for (k = 0; k < loop.nreductions && !failed; k++, r = r->next)
+            combine_reduction(loop.shared[k], r->op, &chunk->partials[k]);
+        SAFE_FREE(chunk->partials);
+    }
+    SAFE_FREE(loop.chunks);
+    SAFE_FREE(loop.shared);
+    if (atomic_load(&current_interpreter->failed))
+        interpreter_exit(current_interpreter->status);
+    return true;
+}
+
+ASTNode *create_if_statement_node(ASTNode *condition, ASTNode *then_branch, ASTNode *else_branch)
+{
+    ASTNode *node = ARENA_ALLOC(ASTNode);
+    node->type = NODE_IF_STATEMENT;
+    node->data.if_stmt.condition = condition;
+    node->data.if_stmt.then_branch = then_branch;
+    node->data.if_stmt.else_branch = else_branch;
+    return node;
+}
+
+ASTNode *create_string_literal_node(char *string)
+{
+    ASTNode *node = ARENA_ALLOC(ASTNode);
+    node->type = NODE_STRING_LITERAL;
+    node->data.name = ARENA_STRDUP(string);
+    return node;
+}
+
+ASTNode *create_switch_statement_node(ASTNode *expression, CaseNode *cases)
+{
+    ASTNode *node = ARENA_ALLOC(ASTNode);
+    node->type = NODE_SWITCH_STATEMENT;
+    node->data.switch_stmt.expression = expression;
+    node->data.switch_stmt.cases = cases;
+    return node;
+}
+
+CaseNode *create_case_node(ASTNode *value, ASTNode *statements)
+{
+    CaseNode *node = ARENA_ALLOC(CaseNode);
+    node->value = value;
+    node->statements = statements;
+    node->next = NULL;
+    return node;
 }
 
-void *handle_function_call(ASTNode *node)
+CaseNode *create_default_case_node(ASTNode *statements)
 {
-    execute_function_call(
-        node->data.func_call.function_name,
-        node->data.func_call.arguments);
-    void *return_value = NULL;
-    if (current_return_value.has_value)
-    {
-        switch (current_return_value.type)
-        {
-        case VAR_INT:
-            return_value = SAFE_MALLOC(int);
-            *(int *)return_value = current_return_value.value.ivalue;
-            break;
-        case VAR_FLOAT:
-            return_value = SAFE_MALLOC(float);
-            *(float *)return_value = current_return_value.value.fvalue;
-            break;
-        case VAR_DOUBLE:
-            return_value = SAFE_MALLOC(double);
-            *(double *)return_value = current_return_value.value.dvalue;
-            break;
-        case VAR_BOOL:
-            return_value = SAFE_MALLOC(bool);
-            *(bool *)return_value = current_return_value.value.bvalue;
-            break;
-        case VAR_CHAR:
-            return_value = SAFE_MALLOC(char);
-            *(char *)return_value = current_return_value.value.ivalue;
-            break;
-        case VAR_SHORT:
-            return_value = SAFE_MALLOC(short);
-            *(short *)return_value = current_return_value.value.svalue;
-            break;
-        case NONE:
-            return NULL;
-        }
-    }
-    return return_value;
+    return create_case_node(NULL, statements); // NULL value indicates default case
 }
 
-bool evaluate_expression_bool(ASTNode *node)
+CaseNode *append_case_list(CaseNode *list, CaseNode *case_node)
 {
-    if (!node)
-        return 0;
+    if (!list)
+        return case_node;
+    CaseNode *current = list;
+    while (current->next)
+        current = current->next;
+    current->next = case_node;
+    return list;
+}
 
-    switch (node->type)
+ASTNode *create_break_node()
+{
+    ASTNode *node = ARENA_ALLOC(ASTNode);
+    node->type = NODE_BREAK_STATEMENT;
+    node->data.break_stmt = NULL;
+    return node;
+}
+
+void execute_yapping_call(ArgumentList *args)
+{
+    if (!args)
     {
-    case NODE_INT:
-        return (bool)node->data.ivalue;
-    case NODE_SHORT:
-        return (bool)node->data.svalue;
-    case NODE_BOOLEAN:
-        return node->data.bvalue;
-    case NODE_CHAR:
-        return (bool)node->data.ivalue;
-    case NODE_FLOAT:
-        return (bool)node->data.fvalue;
-    case NODE_DOUBLE:
-        return (bool)node->data.dvalue;
-    case NODE_IDENTIFIER:
+        yyerror("No arguments provided for yapping function call");
+        interpreter_exit(EXIT_FAILURE);
+    }
+
+    ASTNode *formatNode = args->expr;
+    if (formatNode->type != NODE_STRING_LITERAL)
     {
-        return *(bool *)handle_identifier(node, "Undefined variable", 0);
+        yyerror("First argument to yapping must be a string literal");
+        return;
     }
-    case NODE_OPERATION:
+
+    const char *format = formatNode->data.name; // The format string
+    char buffer[1024];                          // Buffer for the final formatted output
+    int buffer_offset = 0;
+
+    ArgumentList *cur = args->next;
+
+    while (*format != '\0')
     {
-        // Special handling for logical operations
-        if (node->data.op.op == OP_AND || node->data.op.op == OP_OR)
+        if (*format == '%' && cur != NULL)
         {
-            bool left = evaluate_expression_bool(node->data.op.left);
-            bool right = evaluate_expression_bool(node->data.op.right);
+            // Start extracting the format specifier
+            const char *start = format;
+            format++; // Move past '%'
 
-            switch (node->data.op.op)
+            // Extract until a valid specifier character is found
+            while (strchr("diouxXfFeEgGaAcspnb%", *format) == NULL && *format != '\0')
             {
-            case OP_AND:
-                return left && right;
-            case OP_OR:
-                return left || right;
-            default:
-                break;
+                format++;
             }
-        }
 
-        // Regular integer operations
-        int result_type = get_expression_type(node);
-        void *result = handle_binary_operation(node);
-        bool result_bool = 0;
-        result_bool = (result_type == VAR_INT)
-                          ? (bool)(*(int *)result)
-                      : (result_type == VAR_FLOAT)
-                          ? (bool)(*(float *)result)
-                          : (bool)(*(double *)result);
-        SAFE_FREE(result);
-        return result_bool;
-    }
-    case NODE_UNARY_OPERATION:
-    {
-        bool operand = evaluate_expression_bool(node->data.unary.operand);
-        bool *result = (bool *)handle_unary_expression(node, &operand, VAR_BOOL);
-        bool return_val = *result;
-        SAFE_FREE(result);
-        return return_val;
-    }
-    case NODE_ARRAY_ACCESS:
-    {
-        return *(bool*)evaluate_multi_array_access(node);
-    }
-    case NODE_FUNC_CALL:
-    {
-        bool *res = (bool *)handle_function_call(node);
-        if (res != NULL)
+            if (*format == '\0')
+            {
+                yyerror("Invalid format specifier");
+                interpreter_exit(EXIT_FAILURE);
+            }
+
+            // Copy the format specifier into a temporary buffer
+            char specifier[32];
+            int length = format - start + 1;
+            strncpy(specifier, start, length);
+            specifier[length] = '\0';
+
+            // Process the argument based on the format specifier
+            ASTNode *expr = cur->expr;
+            if (!expr)
+            {
+                yyerror("Invalid argument in yapping call");
+                interpreter_exit(EXIT_FAILURE);
+            }
+
+            if (*format == 'b')
+            {
+                // Handle boolean values
+                bool val = evaluate_expression_bool(expr);
+                buffer_offset += snprintf(buffer + buffer_offset, sizeof(buffer) - buffer_offset, "%s", val ? "W" : "L");
+            }
+            else if (strchr("diouxX", *format))
+            {
+                // Integer or unsigned integer
+                volatile bool is_unsigned = (expr->type == NODE_IDENTIFIER &&
+                                    get_variable_modifiers(expr->data.name).is_unsigned);
+                
+                if (is_unsigned)
+                {
+                    if (is_short_expression(expr))
+                    {
+                        unsigned short val = evaluate_expression_short(expr);
+                        buffer_offset += snprintf(buffer + buffer_offset, sizeof(buffer) - buffer_offset, specifier, val);
+                    }
+                    else
+                    {
+                        unsigned int val = (unsigned int)evaluate_expression_int(expr);
+                        buffer_offset += snprintf(buffer + buffer_offset, sizeof(buffer) - buffer_offset, specifier, val);
+                    }
+                }
+                else
+                {
+                    if (is_short_expression(expr))
+                    {
+                        short val = evaluate_expression_short(expr);
+                        buffer_offset += snprintf(buffer + buffer_offset, sizeof(buffer) - buffer_offset, specifier, val);
+                    }
+                    else
+                    {
+                        int val = evaluate_expression_int(expr);
+                        buffer_offset += snprintf(buffer + buffer_offset, sizeof(buffer) - buffer_offset, specifier, val);
+                    }
+                }
+            }
+            else if (strchr("fFeEgGa", *format))
+            {
+                // Floating-point numbers
+                if (expr->type == NODE_ARRAY_ACCESS)
+                {
+                    // Special handling for array access
+                    const char *array_name = expr->data.array.name;
+                    void *element = evaluate_multi_array_access(expr);
+                    if (!element)
+                    {
+                        yyerror("Invalid array access in floating-point format specifier");
+                        interpreter_exit(EXIT_FAILURE);
+                    }
+                    
+
+                    Variable *var = get_variable(array_name);
+                    if (var != NULL)
+                    {
+                        if (var->var_type == VAR_FLOAT)
+                        {
+                            float val = *(float*)element;
+                            buffer_offset += snprintf(buffer + buffer_offset,
+                                                      sizeof(buffer) - buffer_offset,
+                                                      specifier, val);
+                        }
+                        else if (var->var_type == VAR_DOUBLE)
+                        {
+                            double val = *(double*)element;
+                            buffer_offset += snprintf(buffer + buffer_offset,
+                                                      sizeof(buffer) - buffer_offset,
+                                                      specifier, val);
+                        }
+                    }
+                }
+                else if (is_float_expression(expr))
+                {
+                    float val = evaluate_expression_float(expr);
+                    buffer_offset += snprintf(buffer + buffer_offset, sizeof(buffer) - buffer_offset, specifier, val);
+                }
+                else if (is_double_expression(expr))
+                {
+                    double val = evaluate_expression_double(expr);
+                    buffer_offset += snprintf(buffer + buffer_offset, sizeof(buffer) - buffer_offset, specifier, val);
+                }
+                else
+                {
+                    yyerror("Invalid argument type for floating-point format specifier");
+                    interpreter_exit(EXIT_FAILURE);
+                }
+            }
+            else if (*format == 'c')
+            {
+                // Character
+                int val = evaluate_expression_int(expr);
+                buffer_offset += snprintf(buffer + buffer_offset, sizeof(buffer) - buffer_offset, specifier, val);
+            }
+            else if (*format == 's')
+            {
+                // String
+                const Variable *var = get_variable(expr->data.name);
+                if (var != NULL)
+                {
+                    if (!var->is_array)
+                    {
+                        yyerror("Invalid argument type for %s");
+                        interpreter_exit(EXIT_FAILURE);
+                    }
+                    buffer_offset += snprintf(buffer + buffer_offset, sizeof(buffer) - buffer_offset, specifier, var->value.array_data);
+                }
+                else if (expr->type != NODE_STRING_LITERAL)
+                {
+                    yyerror("Invalid argument type for %s");
+                    interpreter_exit(EXIT_FAILURE);
+                }
+                else
+                {
+                    buffer_offset += snprintf(buffer + buffer_offset, sizeof(buffer) - buffer_offset, specifier, expr->data.name);
+                }
+            }
+            else
+            {
+                yyerror("Unsupported format specifier");
+                interpreter_exit(EXIT_FAILURE);
+            }
+
+            cur = cur->next; // Move to the next argument
+            format++;        // Move past the format specifier
+        }
+        else
         {
-            bool return_val = *res;
-            SAFE_FREE(res);
-            return return_val;
+            // Copy non-format characters to the buffer
+            buffer[buffer_offset++] = *format++;
         }
-        return 0;
-    }
-    default:
-        yyerror("Invalid boolean expression");
-        return 0;
-    }
-}
-
-ArgumentList *create_argument_list(ASTNode *expr, ArgumentList *existing_list)
-{
-    ArgumentList *new_node = ARENA_ALLOC(ArgumentList);
-    new_node->expr = expr;
-    new_node->next = NULL;
 
-    if (!existing_list)
-    {
-        return new_node;
-    }
-    else
-    {
-        /* Append to the end of existing_list */
-        ArgumentList *temp = existing_list;
-        while (temp->next)
+        // Check for buffer overflow
+        if (buffer_offset >= (int)sizeof(buffer))
         {
-            temp = temp->next;
+            yyerror("Buffer overflow in yapping call");
+            interpreter_exit(EXIT_FAILURE);
         }
-        temp->next = new_node;
-        return existing_list;
     }
-}
 
-ASTNode *create_print_statement_node(ASTNode *expr)
-{
-    ASTNode *node = ARENA_ALLOC(ASTNode);
-    node->type = NODE_PRINT_STATEMENT;
-    node->data.op.left = expr;
-    return node;
-}
+    buffer[buffer_offset] = '\0'; // Null-terminate the string
 
-ASTNode *create_error_statement_node(ASTNode *expr)
-{
-    ASTNode *node = ARENA_ALLOC(ASTNode);
-    node->type = NODE_ERROR_STATEMENT;
-    node->data.op.left = expr;
-    return node;
+    // Print the final formatted output
+    yapping("%s", buffer);
 }
 
-ASTNode *create_statement_list(ASTNode *statement, ASTNode *existing_list)
+void execute_yappin_call(ArgumentList *args)
 {
-    if (!existing_list)
-    {
-        // If there's no existing list, create a new one
-        ASTNode *node = ARENA_ALLOC(ASTNode);
-        if (!node)
-        {
-            yyerror("Memory allocation failed");
-            return NULL;
-        }
-        node->type = NODE_STATEMENT_LIST;
-        node->data.statements = ARENA_ALLOC(StatementList);
-        if (!node->data.statements)
-        {
-            SAFE_FREE(node);
-            yyerror("Memory allocation failed");
-            return NULL;
-        }
-        node->data.statements->statement = statement;
-        node->data.statements->next = NULL;
-        return node;
-    }
-    else
+    if (!args)
     {
-        // Append at the end of existing_list
-        StatementList *sl = existing_list->data.statements;
-        while (sl->next)
-        {
-            sl = sl->next;
-        }
-        // Now sl is the last element; append the new statement
-        StatementList *new_item = ARENA_ALLOC(StatementList);
-        if (!new_item)
-        {
-            yyerror("Memory allocation failed");
-            return existing_list;
-        }
-        new_item->statement = statement;
-        new_item->next = NULL;
-        sl->next = new_item;
-        return existing_list;
+        yyerror("No arguments provided for yappin function call");
+        interpreter_exit(EXIT_FAILURE);
     }
-}
 
-bool is_const_variable(const char *name)
-{
-    Variable *var = get_variable(name);
-    if (var != NULL)
+    ASTNode *formatNode = args->expr;
+    if (formatNode->type != NODE_STRING_LITERAL)
     {
-        return var->modifiers.is_const;
+        yyerror("First argument to yappin must be a string literal");
+        interpreter_exit(EXIT_FAILURE);
     }
-    return false;
-}
 
-void check_const_assignment(const char *name)
-{
-    if (is_const_variable(name))
-    {
-        yylineno = yylineno - 2;
-        yyerror("Cannot modify const variable");
-        // TODO: make proper cleanup when error occurs
-        cleanup();
-        exit(EXIT_FAILURE);
-    }
-}
+    const char *format = formatNode->data.name; // The format string
+    char buffer[1024];                          // Buffer for the final formatted output
+    int buffer_offset = 0;
 
-bool is_short_expression(ASTNode *node)
-{
-    if (!node)
-        return false;
+    ArgumentList *cur = args->next;
 
-    switch (node->type)
-    {
-    case NODE_SHORT:
-        return true;
-    case NODE_FLOAT:
-        return false;
-    case NODE_INT:
-        return false;
-    case NODE_DOUBLE:
-        return false;
-    case NODE_ARRAY_ACCESS:
+    while (*format != '\0')
     {
-        Variable *var = get_variable(node->data.name);
-        if (var != NULL)
+        if (*format == '%' && cur != NULL)
         {
-            return var->var_type == VAR_SHORT;
-        }
-        yyerror("Undefined variable in type check");
-        return false;
+            // Start extracting the format specifier
+            const char *start = format;
+            format++; // Move past '%'
 
-    }
-    case NODE_IDENTIFIER:
-    {
-        if (!check_and_mark_identifier(node, "Undefined variable in type check"))
-            exit(1);
-        Variable *var = get_variable(node->data.name);
-        if (var != NULL)
+            // Extract until a valid specifier character is found
+            while (strchr("diouxXfFeEgGaAcspnb%", *format) == NULL && *format != '\0')
+            {
+                format++;
+            }
+
+            if (*format == '\0')
+            {
+                yyerror("Invalid format specifier");
+                interpreter_exit(EXIT_FAILURE);
+            }
+
+            // Copy the format specifier into a temporary buffer
+            char specifier[32];
+            int length = format - start + 1;
+            strncpy(specifier, start, length);
+            specifier[length] = '\0';
+
+            // Process the argument based on the format specifier
+            ASTNode *expr = cur->expr;
+            if (!expr)
+            {
+                yyerror("Invalid argument in yappin call");
+                interpreter_exit(EXIT_FAILURE);
+            }
+
+            if (*format == 'b')
+            {
+                // Handle boolean values
+                bool val = evaluate_expression_bool(expr);
+                buffer_offset += snprintf(buffer + buffer_offset, sizeof(buffer) - buffer_offset, "%s", val ? "W" : "L");
+            }
+            else if (strchr("diouxX", *format))
+            {
+                if (is_short_expression(expr))
+                {
+                    short val = evaluate_expression_short(expr);
+                    buffer_offset += snprintf(buffer + buffer_offset, sizeof(buffer) - buffer_offset, specifier, val);
+                }
+                else
+                {
+                    int val = evaluate_expression_int(expr);
+                    buffer_offset += snprintf(buffer + buffer_offset, sizeof(buffer) - buffer_offset, specifier, val);
+                }
+            }
+            else if (strchr("fFeEgGa", *format))
+            {
+                // Handle floating-point numbers
+                if (is_float_expression(expr))
+                {
+                    float val = evaluate_expression_float(expr);
+                    buffer_offset += snprintf(buffer + buffer_offset, sizeof(buffer) - buffer_offset, specifier, val);
+                }
+                else if (is_double_expression(expr))
+                {
+                    double val = evaluate_expression_double(expr);
+                    buffer_offset += snprintf(buffer + buffer_offset, sizeof(buffer) - buffer_offset, specifier, val);
+                }
+                else
+                {
+                    yyerror("Invalid argument type for floating-point format specifier");
+                    interpreter_exit(EXIT_FAILURE);
+                }
+            }
+            else if (*format == 'c')
+            {
+                // Handle character values
+                int val = evaluate_expression_int(expr);
+                buffer_offset += snprintf(buffer + buffer_offset, sizeof(buffer) - buffer_offset, specifier, val);
+            }
+            else if (*format == 's')
+            {
+                const Variable *var = get_variable(expr->data.name);
+                if (var != NULL)
+                {
+                    if (!var->is_array)
+                    {
+                        yyerror("Invalid argument type for %s");
+                        interpreter_exit(EXIT_FAILURE);
+                    }
+                    buffer_offset += snprintf(buffer + buffer_offset, sizeof(buffer) - buffer_offset, specifier, var->value.array_data);
+                }
+                else if (expr->type != NODE_STRING_LITERAL)
+                {
+                    yyerror("Invalid argument type for %s");
+                    interpreter_exit(EXIT_FAILURE);
+                }
+                else
+                {
+                    buffer_offset += snprintf(buffer + buffer_offset, sizeof(buffer) - buffer_offset, specifier, expr->data.name);
+                }
+            }
+            else
+            {
+                yyerror("Unsupported format specifier");
+                interpreter_exit(EXIT_FAILURE);
+            }
+
+            cur = cur->next; // Move to the next argument
+            format++;        // Move past the format specifier
+        }
+        else
+        {
+            // Copy non-format characters to the buffer
+            buffer[buffer_offset++] = *format++;
+        }
+
+        // Check for buffer overflow
+        if (buffer_offset >= (int)sizeof(buffer))
         {
-            return var->var_type == VAR_SHORT;
+            yyerror("Buffer overflow in yappin call");
+            interpreter_exit(EXIT_FAILURE);
         }
-        yyerror("Undefined variable in type check");
-        return false;
     }
-    case NODE_OPERATION:
+
+    buffer[buffer_offset] = '\0'; // Null-terminate the string
+
+    // Print the final formatted output
+    yappin("%s", buffer);
+}
+
+void execute_baka_call(ArgumentList *args)
+{
+    if (!args)
     {
-        // If either operand is short, result is short
-        return is_short_expression(node->data.op.left) ||
-               is_short_expression(node->data.op.right);
+        baka("\n");
+        return;
     }
-    case NODE_FUNC_CALL:
+
+    ASTNode *formatNode = args->expr;
+    if (formatNode->type != NODE_STRING_LITERAL)
     {
-        return get_function_return_type(node->data.func_call.function_name) == VAR_SHORT;
-    }
-    default:
-        return false;
+        yyerror("First argument to yapping must be a string literal");
+        return;
     }
+
+    baka(formatNode->data.name);
 }
 
-Function *get_function(const char *name)
+void execute_ragequit_call(ArgumentList *args)
 {
-    Function *func = function_table;
-    while (func != NULL)
+    if (!args)
     {
-        if (strcmp(func->name, name) == 0)
-        {
-            return func;
-        }
-        func = func->next;
+        yyerror("No arguments provided for ragequit function call");
+        interpreter_exit(EXIT_FAILURE);
     }
-    return NULL;
-}
 
-VarType get_function_return_type(const char *name)
-{
-    Function *func = get_function(name);
-    if (func != NULL)
+    ASTNode *formatNode = args->expr;
+    if (formatNode->type != NODE_INT)
     {
-        return func->return_type;
+        yyerror("First argument to ragequit must be a integer");
+        interpreter_exit(EXIT_FAILURE);
     }
-    yyerror("Undefined function in type check");
-    return NONE;
+
+    ragequit(formatNode->data.ivalue);
 }
 
-bool is_float_expression(ASTNode *node)
+void execute_chill_call(ArgumentList *args)
 {
-    if (!node)
-        return false;
-
-    switch (node->type)
-    {
-    case NODE_FLOAT:
-        return true;
-    case NODE_INT:
-        return false;
-    case NODE_DOUBLE:
-        return false;
-    case NODE_ARRAY_ACCESS:
-    case NODE_IDENTIFIER:
+    if (!args)
     {
-        if (!check_and_mark_identifier(node, "Undefined variable in type check"))
-            exit(1);
-        Variable *var = get_variable(node->data.name);
-        if (var != NULL)
-        {
-            return var->var_type == VAR_FLOAT;
-        }
-        yyerror("Undefined variable in type check");
-        return false;
+        yyerror("No arguments provided for chill function call");
+        interpreter_exit(EXIT_FAILURE);
     }
-    case NODE_OPERATION:
+
+    ASTNode *formatNode = args->expr;
+    if (formatNode->type != NODE_INT && !formatNode->modifiers.is_unsigned)
     {
-        // If either operand is float, result is float
-        return is_float_expression(node->data.op.left) ||
-               is_float_expression(node->data.op.right);
+        yyerror("First argument to chill must be a unsigned integer");
+        interpreter_exit(EXIT_FAILURE);
     }
-    case NODE_FUNC_CALL:
+
+    chill(formatNode->data.ivalue);
+}
+
+static input_status slorp_values(VarType type, void *dst, size_t count, size_t *values_read)
+{
+    switch (type)
     {
-        return get_function_return_type(node->data.func_call.function_name) == VAR_FLOAT;
-    }
+    case VAR_INT:
+        return input_int_array(dst, count, values_read);
+    case VAR_SHORT:
+        return input_short_array(dst, count, values_read);
+    case VAR_FLOAT:
+        return input_float_array(dst, count, values_read);
+    case VAR_DOUBLE:
+        return input_double_array(dst, count, values_read);
     default:
-        return false;
+        return INPUT_CONVERSION_ERROR;
     }
 }
 
-bool is_double_expression(ASTNode *node)
+/*
+ * Bulk slorp: fills a whole array with whitespace-separated numbers from
+ * stdin. A vector is cleared and then takes every value left in the input.
+ */
+static void slorp_array(const char *name, Variable *var)
 {
-    if (!node)
-        return false;
-
-    switch (node->type)
+    check_const_assignment(name);
+    if (var->stride || var->var_type == VAR_BOOL)
     {
-    case NODE_DOUBLE:
-        return true;
-    case NODE_FLOAT:
-        return false;
-    case NODE_INT:
-        return false;
-    case NODE_ARRAY_ACCESS:
-    case NODE_IDENTIFIER:
+        char error_msg[128];
+        snprintf(error_msg, sizeof(error_msg), "slorp cannot fill '%s'; it needs a contiguous number array", name);
+        yyerror(error_msg);
+        interpreter_exit(EXIT_FAILURE);
+    }
+
+    size_t elem_size = get_element_size(var->var_type);
+    size_t total = var->array_dimensions.total_size;
+    size_t got = 0;
+    input_status status;
+    if (var->is_vector)
     {
-        if (!check_and_mark_identifier(node, "Undefined variable in type check"))
-            exit(1);
-        Variable *var = get_variable(node->data.name);
-        if (var != NULL)
+        size_t length = 0;
+        for (;;)
         {
-            return var->var_type == VAR_DOUBLE;
+            if (length == var->capacity)
+                vector_reserve(var, var->capacity ? var->capacity * 2 : VECTOR_MIN_CAPACITY);
+            size_t room = var->capacity - length;
+            status = slorp_values(var->var_type, (char *)var->value.array_data + length * elem_size, room, &got);
+            length += got;
+            if (status != INPUT_SUCCESS || got < room || length >= INT_MAX)
+                break;
         }
-        yyerror("Undefined variable in type check");
-        return false;
+        vector_set_length(var, length);
     }
-    case NODE_OPERATION:
+    else
     {
-        // If either operand is double, result is double
-        return is_double_expression(node->data.op.left) ||
-               is_double_expression(node->data.op.right);
+        status = slorp_values(var->var_type, var->value.array_data, total, &got);
     }
-    case NODE_FUNC_CALL:
+
+    char error_msg[160];
+    switch (status)
     {
-        return get_function_return_type(node->data.func_call.function_name) == VAR_DOUBLE;
-    }
+    case INPUT_SUCCESS:
+        if (var->is_vector || got == total)
+            return;
+        snprintf(error_msg, sizeof(error_msg), "slorp expected %zu values for '%s' but input ended after %zu",
+                 total, name, got);
+        break;
+    case INPUT_CONVERSION_ERROR:
+        snprintf(error_msg, sizeof(error_msg), "slorp found an invalid number on input line %zu", input_line());
+        break;
+    case INPUT_IO_ERROR:
+        snprintf(error_msg, sizeof(error_msg), "slorp could not read input: %s", strerror(errno));
+        break;
     default:
-        return false;
+        snprintf(error_msg, sizeof(error_msg), "slorp found a value out of range on input line %zu", input_line());
+        break;
     }
+    yyerror(error_msg);
+    interpreter_exit(EXIT_FAILURE);
 }
 
-int evaluate_expression(ASTNode *node)
+void execute_slorp_call(ArgumentList *args)
 {
-    if (is_short_expression(node))
+    if (!args || args->expr->type != NODE_IDENTIFIER)
     {
-        return (short)evaluate_expression_short(node);
+        yyerror("slurp requires a variable identifier");
+        return;
     }
-    if (is_float_expression(node))
+
+    char *name = args->expr->data.name;
+    Variable *var = get_variable(name);
+    if (!var)
     {
-        return (int)evaluate_expression_float(node);
+        yyerror("Undefined variable");
+        return;
     }
-    if (is_double_expression(node))
+    if (var->is_array && var->var_type != VAR_CHAR)
     {
-        return (int)evaluate_expression_double(node);
+        slorp_array(name, var);
+        return;
     }
-    return evaluate_expression_int(node);
-}
 
-void execute_assignment(ASTNode *node)
-{
-    if (node->type != NODE_ASSIGNMENT)
+    switch (var->var_type)
     {
-        yyerror("Expected assignment node");
-        return;
+    case VAR_INT:
+    {
+        int val = 0;
+        val = slorp_int(val);
+        set_int_variable(name, val, var->modifiers);
+        break;
     }
-
-    char *name = node->data.op.left->data.name;
-    check_const_assignment(name);
-
-    ASTNode *value_node = node->data.op.right;
-    TypeModifiers mods = node->modifiers;
-
-    if (node->data.op.left->type == NODE_ARRAY_ACCESS)
+    case VAR_FLOAT:
     {
-        // Evaluate the right side with proper type handling
-        const char *array_name = node->data.op.left->data.array.name;
-        int idx = evaluate_expression_int(node->data.op.left->data.array.index);
-
-        // Find array in symbol table
-        Variable *var = get_variable(array_name);
-        if (var != NULL)
+        float val = 0.0f;
+        val = slorp_float(val);
+        set_float_variable(name, val, var->modifiers);
+        break;
+    }
+    case VAR_DOUBLE:
+    {
+        double val = 0.0;
+        val = slorp_double(val);
+        set_double_variable(name, val, var->modifiers);
+        break;
+    }
+    case VAR_SHORT:
+    {
+        short val = 0;
+        val = slorp_short(val);
+        set_short_variable(name, val, var->modifiers);
+        break;
+    }
+    case VAR_CHAR:
+    {
+        if (var->is_array)
         {
-            if (!var->is_array)
-            {
-                yyerror("Not an array!");
-                return;
-            }
-            if (idx < 0 || idx >= var->array_length)
-            {
-                yyerror("Array index out of bounds!");
-                return;
-            }
-
-            // Use the array's actual type for assignment
-            switch (var->var_type)
-            {
-            case VAR_FLOAT:
-                ((float *)var->value.array_data)[idx] = evaluate_expression_float(node->data.op.right);
-                break;
-            case VAR_DOUBLE:
-                ((double *)var->value.array_data)[idx] = evaluate_expression_double(node->data.op.right);
-                break;
-            case VAR_INT:
-                ((int *)var->value.array_data)[idx] = evaluate_expression_int(node->data.op.right);
-                break;
-            case VAR_SHORT:
-                ((short *)var->value.array_data)[idx] = evaluate_expression_short(node->data.op.right);
-                break;
-            default:
-                yyerror("Unsupported array type");
-                return;
-            }
+            char val[var->array_length];
+            slorp_string(val, sizeof(val));
+            strncpy(var->value.array_data, val, var->array_length - 1);
+            ((char *)var->value.array_data)[var->array_length - 1] = '\0';
             return;
         }
-        yyerror("Undefined array variable");
-        return;
+        char val = 0;
+        val = slorp_char(val);
+        set_int_variable(name, val, var->modifiers);
+        break;
+    }
+    default:
+        yyerror("Unsupported type for slorp");
+    }
+}
+
+Variable *get_array_argument(ASTNode *expr, const char *func_name)
+{
+    if (!expr || expr->type != NODE_IDENTIFIER)
+    {
+        char error_msg[100];
+        snprintf(error_msg, sizeof(error_msg), "%s expects an array name as argument", func_name);
+        yyerror(error_msg);
+        interpreter_exit(EXIT_FAILURE);
     }
 
-    // Handle type conversion for float to int
-    if (value_node->type == NODE_FLOAT || is_float_expression(value_node))
+    Variable *var = get_variable(expr->data.name);
+    if (var == NULL || !var->is_array)
     {
-        float value = evaluate_expression_float(value_node);
-        if (node->data.op.left->type == NODE_INT)
-        {
-            // Check for overflow
-            if (value > INT_MAX || value < INT_MIN)
-            {
-                yyerror("Float to int conversion overflow");
-                value = INT_MAX;
-            }
-            if (!set_int_variable(name, (int)value, mods))
-            {
-                yyerror("Failed to set integer variable");
-            }
-            return;
-        }
+        char error_msg[100];
+        snprintf(error_msg, sizeof(error_msg), "Variable '%s' is not an array", expr->data.name);
+        yyerror(error_msg);
+        interpreter_exit(EXIT_FAILURE);
     }
+    if (var->stride)
+    {
+        char error_msg[160];
+        snprintf(error_msg, sizeof(error_msg),
+                 "%s needs a contiguous array, but '%s' is interleaved; declare the gang array split",
+                 func_name, expr->data.name);
+        yyerror(error_msg);
+        interpreter_exit(EXIT_FAILURE);
+    }
+    return var;
+}
 
-    if (is_float_expression(value_node))
+void execute_matmul_call(ArgumentList *args)
+{
+    if (!args || !args->next || !args->next->next || args->next->next->next)
     {
-        float value = evaluate_expression_float(value_node);
-        if (!set_float_variable(name, value, mods))
-        {
-            yyerror("Failed to set float variable");
-        }
+        yyerror("matmul expects 3 arguments: matmul(C, A, B)");
+        interpreter_exit(EXIT_FAILURE);
     }
-    else if (is_double_expression(value_node))
+
+    Variable *c = get_array_argument(args->expr, "matmul");
+    Variable *a = get_array_argument(args->next->expr, "matmul");
+    Variable *b = get_array_argument(args->next->next->expr, "matmul");
+    check_const_assignment(args->expr->data.name);
+
+    if (c->array_dimensions.num_dimensions != 2 ||
+        a->array_dimensions.num_dimensions != 2 ||
+        b->array_dimensions.num_dimensions != 2)
     {
-        double value = evaluate_expression_double(value_node);
-        if (!set_double_variable(name, value, mods))
-        {
-            yyerror("Failed to set double variable");
-        }
+        yyerror("matmul requires 2D arrays");
+        interpreter_exit(EXIT_FAILURE);
     }
-    else if (is_short_expression(value_node))
+    if (a->var_type != b->var_type || a->var_type != c->var_type)
     {
-        short value = evaluate_expression_short(value_node);
-        if (!set_short_variable(name, value, mods))
-        {
-            yyerror("Failed to set short variable");
-        }
+        yyerror("matmul requires arrays of the same type");
+        interpreter_exit(EXIT_FAILURE);
     }
-    else
+
+    size_t m = a->array_dimensions.dimensions[0];
+    size_t k = a->array_dimensions.dimensions[1];
+    size_t n = b->array_dimensions.dimensions[1];
+    if ((size_t)b->array_dimensions.dimensions[0] != k ||
+        (size_t)c->array_dimensions.dimensions[0] != m ||
+        (size_t)c->array_dimensions.dimensions[1] != n)
     {
-        int value = evaluate_expression_int(value_node);
-        if (!set_int_variable(name, value, mods))
-        {
-            yyerror("Failed to set integer variable");
-        }
+        char error_msg[128];
+        snprintf(error_msg, sizeof(error_msg),
+                 "matmul dimension mismatch: [%d][%d] = [%d][%d] x [%d][%d]",
+                 c->array_dimensions.dimensions[0], c->array_dimensions.dimensions[1],
+                 a->array_dimensions.dimensions[0], a->array_dimensions.dimensions[1],
+                 b->array_dimensions.dimensions[0], b->array_dimensions.dimensions[1]);
+        yyerror(error_msg);
+        interpreter_exit(EXIT_FAILURE);
+    }
+
+    // The kernels assume C does not overlap its inputs, so matmul(A, A, B)
+    // is computed into a scratch buffer first.
+    size_t bytes = m * n * get_element_size(c->var_type);
+    bool aliased = c->value.array_data == a->value.array_data ||
+                   c->value.array_data == b->value.array_data;
+    void *out = aliased ? safe_malloc(bytes) : c->value.array_data;
+
+    switch (c->var_type)
+    {
+    case VAR_INT:
+        matmul_int(out, a->value.array_data, b->value.array_data, m, k, n);
+        break;
+    case VAR_FLOAT:
+        matmul_float(out, a->value.array_data, b->value.array_data, m, k, n);
+        break;
+    case VAR_DOUBLE:
+        matmul_double(out, a->value.array_data, b->value.array_data, m, k, n);
+        break;
+    default:
+        yyerror("matmul supports only rizz, chad and gigachad arrays");
+        interpreter_exit(EXIT_FAILURE);
+    }
+
+    if (aliased)
+    {
+        memcpy(c->value.array_data, out, bytes);
+        SAFE_FREE(out);
     }
 }
 
-void execute_statement(ASTNode *node)
+void execute_transpose_call(ArgumentList *args)
 {
-    if (!node)
-        return;
-    switch (node->type)
+    if (!args || !args->next || args->next->next)
     {
-    case NODE_DECLARATION:
+        yyerror("transpose expects 2 arguments: transpose(B, A)");
+        interpreter_exit(EXIT_FAILURE);
+    }
+
+    Variable *dst = get_array_argument(args->expr, "transpose");
+    Variable *src = get_array_argument(args->next->expr, "transpose");
+    check_const_assignment(args->expr->data.name);
+
+    if (dst->array_dimensions.num_dimensions != 2 || src->array_dimensions.num_dimensions != 2)
     {
-       char *name = node->data.op.left->data.name;
-       Variable *var = variable_new(name);
-       add_variable_to_scope(name, var);
-       SAFE_FREE(var);
+        yyerror("transpose requires 2D arrays");
+        interpreter_exit(EXIT_FAILURE);
     }
-        __attribute__((fallthrough));
-    case NODE_ASSIGNMENT:
+    if (dst->var_type != src->var_type)
     {
-        char *name = node->data.op.left->data.name;
-        check_const_assignment(name);
+        yyerror("transpose requires arrays of the same type");
+        interpreter_exit(EXIT_FAILURE);
+    }
 
-        // Handle array assignment
-        if (node->data.op.left->type == NODE_ARRAY_ACCESS)
+    size_t rows = src->array_dimensions.dimensions[0];
+    size_t cols = src->array_dimensions.dimensions[1];
+    if ((size_t)dst->array_dimensions.dimensions[0] != cols ||
+        (size_t)dst->array_dimensions.dimensions[1] != rows)
+    {
+        char error_msg[128];
+        snprintf(error_msg, sizeof(error_msg),
+                 "transpose dimension mismatch: [%d][%d] cannot hold transpose of [%d][%d]",
+                 dst->array_dimensions.dimensions[0], dst->array_dimensions.dimensions[1],
+                 src->array_dimensions.dimensions[0], src->array_dimensions.dimensions[1]);
+        yyerror(error_msg);
+        interpreter_exit(EXIT_FAILURE);
+    }
+
+    if (src->var_type == VAR_BOOL)
+    {
+        // cap arrays are bit-packed, so move one flag at a time out of a
+        // scratch copy (which also covers the in-place case).
+        size_t words = bitset_words(rows * cols);
+        bitset_word *tmp = SAFE_MALLOC_ARRAY(bitset_word, words);
+        memcpy(tmp, src->value.array_data, words * sizeof(bitset_word));
+        for (size_t i = 0; i < rows; i++)
         {
-            ASTNode *array_node = node->data.op.left;
-            Variable *var = get_variable(array_node->data.name);
-            void *element = evaluate_multi_array_access(array_node);
-            switch (var->var_type)
+            for (size_t j = 0; j < cols; j++)
             {
-            case VAR_FLOAT:
-                *(float *)element = evaluate_expression_float(node->data.op.right);
-                break;
-            case VAR_DOUBLE:
-                *(double *)element = evaluate_expression_double(node->data.op.right);
-                break;
-            case VAR_INT:
-                *(int *)element = evaluate_expression_int(node->data.op.right);
-                break;
-            case VAR_SHORT:
-                *(short *)element = evaluate_expression_short(node->data.op.right);
-                break;
-            case VAR_BOOL:
-                *(bool *)element = evaluate_expression_bool(node->data.op.right);
-                break;
-            case VAR_CHAR:
-                *(char *)element = evaluate_expression_int(node->data.op.right);
-                break;
-            default:
-                yyerror("Unsupported array type");
-                return;
+                bitset_set(dst->value.array_data, j * rows + i, bitset_get(tmp, i * cols + j));
             }
-            return;
         }
+        SAFE_FREE(tmp);
+        return;
+    }
 
-        ASTNode *value_node = node->data.op.right;
-        TypeModifiers mods = node->modifiers;
+    size_t elem_size = get_element_size(src->var_type);
+    if (dst->value.array_data == src->value.array_data)
+    {
+        // In-place transpose of a square matrix: go through a scratch copy.
+        size_t bytes = rows * cols * elem_size;
+        void *tmp = safe_malloc(bytes);
+        memcpy(tmp, src->value.array_data, bytes);
+        transpose(dst->value.array_data, tmp, rows, cols, elem_size);
+        SAFE_FREE(tmp);
+        return;
+    }
+    transpose(dst->value.array_data, src->value.array_data, rows, cols, elem_size);
+}
 
-        if (value_node->type == NODE_CHAR)
-        {
-            // Handle character assignments directly
-            if (!set_char_variable(name, value_node->data.ivalue, mods))
-            {
-                yyerror("Failed to set character variable");
-            }
-        }
-        else if (value_node->type == NODE_BOOLEAN)
-        {
-            if (!set_bool_variable(name, value_node->data.bvalue, mods))
-            {
-                yyerror("Failed to set boolean variable");
-            }
-        }
-        else if (value_node->type == NODE_SHORT)
-        {
-            if (!set_short_variable(name, value_node->data.svalue, mods))
-            {
-                yyerror("Failed to set short variable");
-            }
-        }
-        else if (node->var_type == VAR_FLOAT || is_float_expression(value_node))
-        {
-            float value = evaluate_expression_float(value_node);
-            if (!set_float_variable(name, value, mods))
-            {
-                yyerror("Failed to set float variable");
-            }
-        }
-        else if (node->var_type == VAR_DOUBLE || is_double_expression(value_node))
-        {
-            double value = evaluate_expression_double(value_node);
-            if (!set_double_variable(name, value, mods))
-            {
-                yyerror("Failed to set double variable");
-            }
-        }
-        else
-        {
-            int value = evaluate_expression_int(value_node);
-            if (!set_int_variable(name, value, mods))
-            {
-                yyerror("Failed to set integer variable");
-            }
-        }
+static void sort_array_range(Variable *var, size_t lo, size_t hi, bool stable)
+{
+    size_t n = hi - lo;
+    bool sorted = true;
+    switch (var->var_type)
+    {
+    case VAR_INT:
+        sort_int((int *)var->value.array_data + lo, n);
         break;
-    }
-    case NODE_ARRAY_ACCESS:
-        if (node->data.array.name && node->data.array.index)
-        {
-            if (!(node->data.array.name))
-            {
-                yyerror("Failed to create array");
-            }
-        }
+    case VAR_SHORT:
+        sort_short((short *)var->value.array_data + lo, n);
         break;
-    case NODE_OPERATION:
-    case NODE_UNARY_OPERATION:
-    case NODE_INT:
-    case NODE_SHORT:
-    case NODE_FLOAT:
-    case NODE_DOUBLE:
-    case NODE_CHAR:
-    case NODE_IDENTIFIER:
-        evaluate_expression(node);
+    case VAR_CHAR:
+        sort_char((char *)var->value.array_data + lo, n);
         break;
-    case NODE_FUNC_CALL:
-        // TODO: clearn up built-in functions
-        if (strcmp(node->data.func_call.function_name, "yapping") == 0)
-        {
-            execute_yapping_call(node->data.func_call.arguments);
-        }
-        else if (strcmp(node->data.func_call.function_name, "yappin") == 0)
-        {
-            execute_yappin_call(node->data.func_call.arguments);
-        }
-        else if (strcmp(node->data.func_call.function_name, "baka") == 0)
-        {
-            execute_baka_call(node->data.func_call.arguments);
-        }
-        else if (strcmp(node->data.func_call.function_name, "ragequit") == 0)
-        {
-            execute_ragequit_call(node->data.func_call.arguments);
-        }
-        else if (strcmp(node->data.func_call.function_name, "chill") == 0)
-        {
-            execute_chill_call(node->data.func_call.arguments);
-        }
-        else if (strcmp(node->data.func_call.function_name, "slorp") == 0)
-        {
-            execute_slorp_call(node->data.func_call.arguments);
-        }
+    case VAR_BOOL:
+    {
+        // Sorted flags are just the L run followed by the W run.
+        size_t ones = bitset_count(var->value.array_data, lo, hi);
+        bitset_fill(var->value.array_data, lo, hi - ones, false);
+        bitset_fill(var->value.array_data, hi - ones, hi, true);
+        break;
+    }
+    case VAR_FLOAT:
+        if (stable)
+            sorted = stable_sort_float((float *)var->value.array_data + lo, n);
         else
-        {
-            execute_function_call(
-                node->data.func_call.function_name,
-                node->data.func_call.arguments);
-        }
+            sort_float((float *)var->value.array_data + lo, n);
         break;
-    case NODE_FOR_STATEMENT:
-        execute_for_statement(node);
+    case VAR_DOUBLE:
+        if (stable)
+            sorted = stable_sort_double((double *)var->value.array_data + lo, n);
+        else
+            sort_double((double *)var->value.array_data + lo, n);
+        break;
+    default:
+        yyerror("Unsupported array type for sort");
+        interpreter_exit(EXIT_FAILURE);
+    }
+    if (!sorted)
+    {
+        yyerror("Memory allocation failed in stable_sort");
+        interpreter_exit(EXIT_FAILURE);
+    }
+}
+
+void execute_sort_call(ArgumentList *args)
+{
+    if (!args || args->next)
+    {
+        yyerror("sort expects 1 argument: sort(arr)");
+        interpreter_exit(EXIT_FAILURE);
+    }
+    Variable *var = get_array_argument(args->expr, "sort");
+    check_const_assignment(args->expr->data.name);
+    sort_array_range(var, 0, var->array_dimensions.total_size, false);
+}
+
+void execute_stable_sort_call(ArgumentList *args)
+{
+    if (!args || args->next)
+    {
+        yyerror("stable_sort expects 1 argument: stable_sort(arr)");
+        interpreter_exit(EXIT_FAILURE);
+    }
+    Variable *var = get_array_argument(args->expr, "stable_sort");
+    check_const_assignment(args->expr->data.name);
+    sort_array_range(var, 0, var->array_dimensions.total_size, true);
+}
+
+void execute_sort_range_call(ArgumentList *args)
+{
+    if (!args || !args->next || !args->next->next || args->next->next->next)
+    {
+        yyerror("sort_range expects 3 arguments: sort_range(arr, lo, hi)");
+        interpreter_exit(EXIT_FAILURE);
+    }
+    Variable *var = get_array_argument(args->expr, "sort_range");
+    check_const_assignment(args->expr->data.name);
+
+    int lo = evaluate_expression_int(args->next->expr);
+    int hi = evaluate_expression_int(args->next->next->expr);
+    if (lo < 0 || hi < lo || (size_t)hi > var->array_dimensions.total_size)
+    {
+        yyerror("sort_range bounds out of range");
+        interpreter_exit(EXIT_FAILURE);
+    }
+    sort_array_range(var, lo, hi, false);
+}
+
+void execute_binary_search_call(ArgumentList *args)
+{
+    if (!args || !args->next || args->next->next)
+    {
+        yyerror("binary_search expects 2 arguments: binary_search(arr, x)");
+        interpreter_exit(EXIT_FAILURE);
+    }
+    Variable *var = get_array_argument(args->expr, "binary_search");
+    ASTNode *x = args->next->expr;
+    size_t n = var->array_dimensions.total_size;
+
+    size_t pos = n;
+    bool found = false;
+    switch (var->var_type)
+    {
+    case VAR_INT:
+    {
+        int *a = var->value.array_data;
+        int key = evaluate_expression_int(x);
+        pos = lower_bound_int(a, n, key);
+        found = pos < n && a[pos] == key;
         break;
-    case NODE_WHILE_STATEMENT:
-        execute_while_statement(node);
+    }
+    case VAR_SHORT:
+    {
+        short *a = var->value.array_data;
+        short key = evaluate_expression_short(x);
+        pos = lower_bound_short(a, n, key);
+        found = pos < n && a[pos] == key;
         break;
-    case NODE_DO_WHILE_STATEMENT:
-        execute_do_while_statement(node);
+    }
+    case VAR_CHAR:
+    {
+        char *a = var->value.array_data;
+        char key = evaluate_expression_int(x);
+        pos = lower_bound_char(a, n, key);
+        found = pos < n && a[pos] == key;
         break;
-    case NODE_PRINT_STATEMENT:
+    }
+    case VAR_BOOL:
     {
-        ASTNode *expr = node->data.op.left;
-        if (expr->type == NODE_STRING_LITERAL)
-        {
-            yapping("%s\n", expr->data.name);
-        }
-        else
-        {
-            int value = evaluate_expression(expr);
-            yapping("%d\n", value);
-        }
+        bool key = evaluate_expression_bool(x);
+        pos = key ? bitset_find_next_set(var->value.array_data, 0, n) : 0;
+        found = pos < n && bitset_get(var->value.array_data, pos) == key;
         break;
     }
-    case NODE_ERROR_STATEMENT:
+    case VAR_FLOAT:
     {
-        ASTNode *expr = node->data.op.left;
-        if (expr->type == NODE_STRING_LITERAL)
-        {
-            baka("%s\n", expr->data.name);
-        }
-        else
-        {
-            int value = evaluate_expression(expr);
-            baka("%d\n", value);
-        }
+        float *a = var->value.array_data;
+        float key = evaluate_expression_float(x);
+        pos = lower_bound_float(a, n, key);
+        found = pos < n && a[pos] == key;
         break;
     }
-    case NODE_STATEMENT_LIST:
-        execute_statements(node);
+    case VAR_DOUBLE:
+    {
+        double *a = var->value.array_data;
+        double key = evaluate_expression_double(x);
+        pos = lower_bound_double(a, n, key);
+        found = pos < n && a[pos] == key;
         break;
-    case NODE_IF_STATEMENT:
-        enter_scope();
-        if (evaluate_expression(node->data.if_stmt.condition))
-        {
-            execute_statement(node->data.if_stmt.then_branch);
-        }
-        else if (node->data.if_stmt.else_branch)
-        {
-            execute_statement(node->data.if_stmt.else_branch);
-        }
-        exit_scope();
+    }
+    default:
+        yyerror("Unsupported array type for binary_search");
+        interpreter_exit(EXIT_FAILURE);
+    }
+
+    current_return_value.has_value = true;
+    current_return_value.value.ivalue = found ? (int)pos : -1;
+}
+
+void execute_unique_call(ArgumentList *args)
+{
+    if (!args || args->next)
+    {
+        yyerror("unique expects 1 argument: unique(arr)");
+        interpreter_exit(EXIT_FAILURE);
+    }
+    Variable *var = get_array_argument(args->expr, "unique");
+    check_const_assignment(args->expr->data.name);
+    size_t n = var->array_dimensions.total_size;
+
+    size_t kept;
+    switch (var->var_type)
+    {
+    case VAR_INT:
+        kept = unique_int(var->value.array_data, n);
         break;
-    case NODE_SWITCH_STATEMENT:
-        execute_switch_statement(node);
+    case VAR_SHORT:
+        kept = unique_short(var->value.array_data, n);
         break;
-    case NODE_BREAK_STATEMENT:
-        // Signal to break out of the current loop/switch
-        bruh();
+    case VAR_CHAR:
+        kept = unique_char(var->value.array_data, n);
         break;
-    case NODE_FUNCTION_DEF:
+    case VAR_BOOL:
     {
-        Function *func = create_function(
-            node->data.function_def.name,
-            node->data.function_def.return_type,
-            node->data.function_def.parameters,
-            node->data.function_def.body);
-        if (!func)
+        bitset_word *bits = var->value.array_data;
+        bool prev = false;
+        kept = 0;
+        for (size_t i = 0; i < n; i++)
         {
-            yyerror("Failed to create function");
-            exit(1);
+            bool b = bitset_get(bits, i);
+            if (kept == 0 || b != prev)
+            {
+                bitset_set(bits, kept++, b);
+                prev = b;
+            }
         }
         break;
     }
-    case NODE_RETURN:
-    {
-        handle_return_statement(node->data.op.left);
+    case VAR_FLOAT:
+        kept = unique_float(var->value.array_data, n);
         break;
-    }
-    default:
-        yyerror("Unknown statement type");
+    case VAR_DOUBLE:
+        kept = unique_double(var->value.array_data, n);
         break;
+    default:
+        yyerror("Unsupported array type for unique");
+        interpreter_exit(EXIT_FAILURE);
+    }
+
+    current_return_value.has_value = true;
+    current_return_value.value.ivalue = (int)kept;
+}
+
+static void execute_math_call(ArgumentList *args, VmathOp op, const char *name)
+{
+    if (!args || args->next)
+    {
+        char error_msg[100];
+        snprintf(error_msg, sizeof(error_msg), "%s expects 1 argument: %s(x)", name, name);
+        yyerror(error_msg);
+        interpreter_exit(EXIT_FAILURE);
     }
+    current_return_value.has_value = true;
+    current_return_value.value.dvalue = vmath_scalar(op, evaluate_expression_double(args->expr));
 }
 
-void execute_statements(ASTNode *node)
+/* Validates dst/src for an element-wise array builtin and returns the length. */
+static size_t get_math_array_operands(ArgumentList *args, const char *name,
+                                      Variable **dst, Variable **src)
 {
-    if (!node)
-        return;
-    if (node->type != NODE_STATEMENT_LIST)
+    *dst = get_array_argument(args->expr, name);
+    *src = get_array_argument(args->next->expr, name);
+    check_const_assignment(args->expr->data.name);
+
+    if ((*src)->var_type != VAR_FLOAT && (*src)->var_type != VAR_DOUBLE)
     {
-        execute_statement(node);
-        return;
+        char error_msg[100];
+        snprintf(error_msg, sizeof(error_msg), "%s requires chad or gigachad arrays", name);
+        yyerror(error_msg);
+        interpreter_exit(EXIT_FAILURE);
     }
-    StatementList *current = node->data.statements;
-    while (current)
+    if ((*dst)->var_type != (*src)->var_type)
     {
-        execute_statement(current->statement);
-        current = current->next;
+        char error_msg[100];
+        snprintf(error_msg, sizeof(error_msg), "%s requires arrays of the same type", name);
+        yyerror(error_msg);
+        interpreter_exit(EXIT_FAILURE);
     }
+    if ((*dst)->array_dimensions.total_size != (*src)->array_dimensions.total_size)
+    {
+        char error_msg[128];
+        snprintf(error_msg, sizeof(error_msg), "%s size mismatch: %zu elements cannot hold %zu",
+                 name, (*dst)->array_dimensions.total_size, (*src)->array_dimensions.total_size);
+        yyerror(error_msg);
+        interpreter_exit(EXIT_FAILURE);
+    }
+    return (*src)->array_dimensions.total_size;
 }
 
-void execute_for_statement(ASTNode *node)
+static void execute_math_array_call(ArgumentList *args, VmathOp op, const char *name)
 {
-    PUSH_JUMP_BUFFER();
-    if (setjmp(CURRENT_JUMP_BUFFER()) == 0)
+    if (!args || !args->next || args->next->next)
     {
-        // Execute initialization once
-        enter_scope();
-        if (node->data.for_stmt.init)
-        {
-            execute_statement(node->data.for_stmt.init);
-        }
+        char error_msg[100];
+        snprintf(error_msg, sizeof(error_msg), "%s expects 2 arguments: %s(dst, src)", name, name);
+        yyerror(error_msg);
+        interpreter_exit(EXIT_FAILURE);
+    }
 
-        while (1)
-        {
-            // Evaluate condition
-            enter_scope();
-            if (node->data.for_stmt.cond)
-            {
-                int cond_result = evaluate_expression(node->data.for_stmt.cond);
-                if (!cond_result)
-                {
-                    break;
-                }
-            }
+    Variable *dst;
+    Variable *src;
+    size_t n = get_math_array_operands(args, name, &dst, &src);
+    if (src->var_type == VAR_FLOAT)
+    {
+        vmath_apply_float(op, dst->value.array_data, src->value.array_data, n);
+    }
+    else
+    {
+        vmath_apply_double(op, dst->value.array_data, src->value.array_data, n);
+    }
+}
 
-            // Execute body
-            if (node->data.for_stmt.body)
-            {
-                execute_statement(node->data.for_stmt.body);
-            }
+#define DEFINE_MATH_BUILTINS(fname, op)                               \
+    static void execute_##fname##_call(ArgumentList *args)            \
+    {                                                                 \
+        execute_math_call(args, op, #fname);                          \
+    }                                                                 \
+    static void execute_##fname##_array_call(ArgumentList *args)      \
+    {                                                                 \
+        execute_math_array_call(args, op, #fname "_array");           \
+    }
+
+DEFINE_MATH_BUILTINS(sqrt, VMATH_SQRT)
+DEFINE_MATH_BUILTINS(exp, VMATH_EXP)
+DEFINE_MATH_BUILTINS(log, VMATH_LOG)
+DEFINE_MATH_BUILTINS(sin, VMATH_SIN)
+DEFINE_MATH_BUILTINS(cos, VMATH_COS)
+DEFINE_MATH_BUILTINS(floor, VMATH_FLOOR)
+DEFINE_MATH_BUILTINS(abs, VMATH_ABS)
+
+void execute_pow_call(ArgumentList *args)
+{
+    if (!args || !args->next || args->next->next)
+    {
+        yyerror("pow expects 2 arguments: pow(x, p)");
+        interpreter_exit(EXIT_FAILURE);
+    }
+    double x = evaluate_expression_double(args->expr);
+    double p = evaluate_expression_double(args->next->expr);
+    current_return_value.has_value = true;
+    current_return_value.value.dvalue = pow(x, p);
+}
 
-            // Execute increment
-            if (node->data.for_stmt.incr)
+void execute_pow_array_call(ArgumentList *args)
+{
+    if (!args || !args->next || !args->next->next || args->next->next->next)
+    {
+        yyerror("pow_array expects 3 arguments: pow_array(dst, src, p)");
+        interpreter_exit(EXIT_FAILURE);
+    }
+
+    Variable *dst;
+    Variable *src;
+    size_t n = get_math_array_operands(args, "pow_array", &dst, &src);
+    double p = evaluate_expression_double(args->next->next->expr);
+    if (src->var_type == VAR_FLOAT)
+    {
+        vmath_pow_float(dst->value.array_data, src->value.array_data, p, n);
+    }
+    else
+    {
+        vmath_pow_double(dst->value.array_data, src->value.array_data, p, n);
+    }
+}
+
+static Variable *get_cap_array_argument(ASTNode *expr, const char *func_name)
+{
+    Variable *var = get_array_argument(expr, func_name);
+    if (var->var_type != VAR_BOOL)
+    {
+        char error_msg[100];
+        snprintf(error_msg, sizeof(error_msg), "%s requires a cap array", func_name);
+        yyerror(error_msg);
+        interpreter_exit(EXIT_FAILURE);
+    }
+    return var;
+}
+
+void execute_popcount_call(ArgumentList *args)
+{
+    if (!args || args->next)
+    {
+        yyerror("popcount expects 1 argument: popcount(flags)");
+        interpreter_exit(EXIT_FAILURE);
+    }
+    Variable *var = get_cap_array_argument(args->expr, "popcount");
+    size_t n = var->array_dimensions.total_size;
+
+    current_return_value.has_value = true;
+    current_return_value.value.ivalue = (int)bitset_count(var->value.array_data, 0, n);
+}
+
+void execute_find_next_set_call(ArgumentList *args)
+{
+    if (!args || !args->next || args->next->next)
+    {
+        yyerror("find_next_set expects 2 arguments: find_next_set(flags, from)");
+        interpreter_exit(EXIT_FAILURE);
+    }
+    Variable *var = get_cap_array_argument(args->expr, "find_next_set");
+    size_t n = var->array_dimensions.total_size;
+    int from = evaluate_expression_int(args->next->expr);
+
+    size_t pos = bitset_find_next_set(var->value.array_data, from < 0 ? 0 : (size_t)from, n);
+    current_return_value.has_value = true;
+    current_return_value.value.ivalue = pos < n ? (int)pos : -1;
+}
+
+static Variable *get_map_argument(ASTNode *expr, const char *func_name)
+{
+    Variable *var = expr && expr->type == NODE_IDENTIFIER ? get_variable(expr->data.name) : NULL;
+    if (var == NULL || !var->is_map)
+    {
+        char error_msg[100];
+        snprintf(error_msg, sizeof(error_msg), "%s expects a lore map as first argument", func_name);
+        yyerror(error_msg);
+        interpreter_exit(EXIT_FAILURE);
+    }
+    return var;
+}
+
+/*
+ * Returns the text of a string literal or a null-terminated yap array, or
+ * NULL if expr is neither.
+ */
+static const char *get_string_value(ASTNode *expr)
+{
+    if (expr->type == NODE_STRING_LITERAL)
+        return expr->data.name;
+    if (expr->type == NODE_IDENTIFIER)
+    {
+        Variable *var = get_variable(expr->data.name);
+        if (var != NULL && var->is_array && var->var_type == VAR_CHAR)
+        {
+            const char *str = var->value.array_data;
+            if (strnlen(str, var->array_dimensions.total_size) == var->array_dimensions.total_size)
             {
-                execute_statement(node->data.for_stmt.incr);
+                char error_msg[100];
+                snprintf(error_msg, sizeof(error_msg), "yap array '%s' is not null-terminated", expr->data.name);
+                yyerror(error_msg);
+                interpreter_exit(EXIT_FAILURE);
             }
-            exit_scope();
+            return str;
         }
-        exit_scope();
     }
-    POP_JUMP_BUFFER();
+    return NULL;
 }
 
-void execute_while_statement(ASTNode *node)
+/*
+ * Returns the key bytes for a map lookup. rizz keys are the int itself;
+ * yap keys are the string including its terminator, taken from a string
+ * literal or a yap array.
+ */
+static const void *get_map_key(Variable *map, ASTNode *expr, int *int_key, size_t *key_size)
 {
-    PUSH_JUMP_BUFFER();
-    enter_scope();
-    while (evaluate_expression(node->data.while_stmt.cond) && setjmp(CURRENT_JUMP_BUFFER()) == 0)
+    if (map->key_type == VAR_INT)
     {
-        enter_scope();
-        execute_statement(node->data.while_stmt.body);
-        exit_scope();
+        *int_key = evaluate_expression_int(expr);
+        *key_size = sizeof(int);
+        return int_key;
     }
-    exit_scope();
-    POP_JUMP_BUFFER();
-}
 
-void execute_do_while_statement(ASTNode *node)
-{
-    PUSH_JUMP_BUFFER();
-    enter_scope();
-    do
+    const char *str = get_string_value(expr);
+    if (str == NULL)
     {
-        enter_scope();
-        execute_statement(node->data.while_stmt.body);
-        exit_scope();
-    } while (evaluate_expression(node->data.while_stmt.cond) && setjmp(CURRENT_JUMP_BUFFER()) == 0);
-    exit_scope();
-    POP_JUMP_BUFFER();
+        yyerror("lore with yap keys expects a string or yap array as key");
+        interpreter_exit(EXIT_FAILURE);
+    }
+    *key_size = strlen(str) + 1;
+    return str;
 }
 
-ASTNode *create_if_statement_node(ASTNode *condition, ASTNode *then_branch, ASTNode *else_branch)
+void execute_map_put_call(ArgumentList *args)
 {
-    ASTNode *node = ARENA_ALLOC(ASTNode);
-    node->type = NODE_IF_STATEMENT;
-    node->data.if_stmt.condition = condition;
-    node->data.if_stmt.then_branch = then_branch;
-    node->data.if_stmt.else_branch = else_branch;
-    return node;
+    if (!args || !args->next || !args->next->next || args->next->next->next)
+    {
+        yyerror("map_put expects 3 arguments: map_put(m, key, value)");
+        interpreter_exit(EXIT_FAILURE);
+    }
+    Variable *map = get_map_argument(args->expr, "map_put");
+    check_const_assignment(args->expr->data.name);
+
+    int int_key;
+    size_t key_size;
+    const void *key = get_map_key(map, args->next->expr, &int_key, &key_size);
+
+    ASTNode *value_expr = args->next->next->expr;
+    Value value;
+    switch (map->var_type)
+    {
+    case VAR_INT:
+        value.ivalue = evaluate_expression_int(value_expr);
+        break;
+    case VAR_SHORT:
+        value.svalue = evaluate_expression_short(value_expr);
+        break;
+    case VAR_FLOAT:
+        value.fvalue = evaluate_expression_float(value_expr);
+        break;
+    case VAR_DOUBLE:
+        value.dvalue = evaluate_expression_double(value_expr);
+        break;
+    case VAR_BOOL:
+        value.bvalue = evaluate_expression_bool(value_expr);
+        break;
+    case VAR_CHAR:
+        value.ivalue = (char)evaluate_expression_int(value_expr);
+        break;
+    default:
+        yyerror("Unsupported lore value type");
+        interpreter_exit(EXIT_FAILURE);
+    }
+    hm_put(map->value.map_data, key, key_size, &value, sizeof(Value));
 }
 
-ASTNode *create_string_literal_node(char *string)
+VarType get_map_get_type(ArgumentList *args)
 {
-    ASTNode *node = ARENA_ALLOC(ASTNode);
-    node->type = NODE_STRING_LITERAL;
-    node->data.name = ARENA_STRDUP(string);
-    return node;
+    return get_map_argument(args ? args->expr : NULL, "map_get")->var_type;
 }
 
-ASTNode *create_switch_statement_node(ASTNode *expression, CaseNode *cases)
+void execute_map_get_call(ArgumentList *args)
 {
-    ASTNode *node = ARENA_ALLOC(ASTNode);
-    node->type = NODE_SWITCH_STATEMENT;
-    node->data.switch_stmt.expression = expression;
-    node->data.switch_stmt.cases = cases;
-    return node;
+    if (!args || !args->next || args->next->next)
+    {
+        yyerror("map_get expects 2 arguments: map_get(m, key)");
+        interpreter_exit(EXIT_FAILURE);
+    }
+    Variable *map = get_map_argument(args->expr, "map_get");
+
+    int int_key;
+    size_t key_size;
+    const void *key = get_map_key(map, args->next->expr, &int_key, &key_size);
+    const Value *value = hm_get(map->value.map_data, key, key_size);
+    if (value == NULL)
+    {
+        char error_msg[100];
+        snprintf(error_msg, sizeof(error_msg), "Key not found in lore '%s'", args->expr->data.name);
+        yyerror(error_msg);
+        interpreter_exit(EXIT_FAILURE);
+    }
+
+    current_return_value.has_value = true;
+    current_return_value.type = map->var_type;
+    switch (map->var_type)
+    {
+    case VAR_INT:
+    case VAR_CHAR:
+        current_return_value.value.ivalue = value->ivalue;
+        break;
+    case VAR_SHORT:
+        current_return_value.value.svalue = value->svalue;
+        break;
+    case VAR_FLOAT:
+        current_return_value.value.fvalue = value->fvalue;
+        break;
+    case VAR_DOUBLE:
+        current_return_value.value.dvalue = value->dvalue;
+        break;
+    case VAR_BOOL:
+        current_return_value.value.bvalue = value->bvalue;
+        break;
+    default:
+        break;
+    }
 }
 
-CaseNode *create_case_node(ASTNode *value, ASTNode *statements)
+void execute_map_delete_call(ArgumentList *args)
 {
-    CaseNode *node = ARENA_ALLOC(CaseNode);
-    node->value = value;
-    node->statements = statements;
-    node->next = NULL;
-    return node;
+    if (!args || !args->next || args->next->next)
+    {
+        yyerror("map_delete expects 2 arguments: map_delete(m, key)");
+        interpreter_exit(EXIT_FAILURE);
+    }
+    Variable *map = get_map_argument(args->expr, "map_delete");
+    check_const_assignment(args->expr->data.name);
+
+    int int_key;
+    size_t key_size;
+    const void *key = get_map_key(map, args->next->expr, &int_key, &key_size);
+    current_return_value.has_value = true;
+    current_return_value.value.bvalue = hm_remove(map->value.map_data, key, key_size);
 }
 
-CaseNode *create_default_case_node(ASTNode *statements)
+void execute_map_contains_call(ArgumentList *args)
 {
-    return create_case_node(NULL, statements); // NULL value indicates default case
+    if (!args || !args->next || args->next->next)
+    {
+        yyerror("map_contains expects 2 arguments: map_contains(m, key)");
+        interpreter_exit(EXIT_FAILURE);
+    }
+    Variable *map = get_map_argument(args->expr, "map_contains");
+
+    int int_key;
+    size_t key_size;
+    const void *key = get_map_key(map, args->next->expr, &int_key, &key_size);
+    current_return_value.has_value = true;
+    current_return_value.value.bvalue = hm_get(map->value.map_data, key, key_size) != NULL;
 }
 
-CaseNode *append_case_list(CaseNode *list, CaseNode *case_node)
+void execute_map_size_call(ArgumentList *args)
 {
-    if (!list)
-        return case_node;
-    CaseNode *current = list;
-    while (current->next)
-        current = current->next;
-    current->next = case_node;
-    return list;
+    if (!args || args->next)
+    {
+        yyerror("map_size expects 1 argument: map_size(m)");
+        interpreter_exit(EXIT_FAILURE);
+    }
+    Variable *map = get_map_argument(args->expr, "map_size");
+    current_return_value.has_value = true;
+    current_return_value.value.ivalue = (int)map->value.map_data->size;
 }
 
-ASTNode *create_break_node()
+static Variable *get_channel_argument(ASTNode *expr, const char *func_name)
 {
-    ASTNode *node = ARENA_ALLOC(ASTNode);
-    node->type = NODE_BREAK_STATEMENT;
-    node->data.break_stmt = NULL;
-    return node;
+    Variable *var = expr && expr->type == NODE_IDENTIFIER ? get_variable(expr->data.name) : NULL;
+    if (var == NULL || !var->is_channel)
+    {
+        char error_msg[100];
+        snprintf(error_msg, sizeof(error_msg), "%s expects a dm or gc channel as first argument", func_name);
+        yyerror(error_msg);
+        interpreter_exit(EXIT_FAILURE);
+    }
+    return var;
 }
 
-void execute_yapping_call(ArgumentList *args)
+void execute_send_call(ArgumentList *args)
 {
-    if (!args)
+    if (!args || !args->next || args->next->next)
     {
-        yyerror("No arguments provided for yapping function call");
-        exit(EXIT_FAILURE);
+        yyerror("send expects 2 arguments: send(ch, value)");
+        interpreter_exit(EXIT_FAILURE);
     }
+    Variable *ch = get_channel_argument(args->expr, "send");
 
-    ASTNode *formatNode = args->expr;
-    if (formatNode->type != NODE_STRING_LITERAL)
+    ASTNode *value_expr = args->next->expr;
+    Value message;
+    switch (ch->var_type)
     {
-        yyerror("First argument to yapping must be a string literal");
-        return;
+    case VAR_INT:
+        message.ivalue = evaluate_expression_int(value_expr);
+        break;
+    case VAR_SHORT:
+        message.svalue = evaluate_expression_short(value_expr);
+        break;
+    case VAR_FLOAT:
+        message.fvalue = evaluate_expression_float(value_expr);
+        break;
+    case VAR_DOUBLE:
+        message.dvalue = evaluate_expression_double(value_expr);
+        break;
+    case VAR_BOOL:
+        message.bvalue = evaluate_expression_bool(value_expr);
+        break;
+    case VAR_CHAR:
+        message.ivalue = (char)evaluate_expression_int(value_expr);
+        break;
+    default:
+        yyerror("Unsupported channel message type");
+        interpreter_exit(EXIT_FAILURE);
     }
 
-    const char *format = formatNode->data.name; // The format string
-    char buffer[1024];                          // Buffer for the final formatted output
-    int buffer_offset = 0;
-
-    ArgumentList *cur = args->next;
-
-    while (*format != '\0')
+    ChanStatus status = chan_send(ch->value.channel_data, &message);
+    // Another thread's error ended the program while this one waited
+    if (status == CHAN_CANCELLED)
+        interpreter_exit(current_interpreter->status);
+    if (status != CHAN_OK)
     {
-        if (*format == '%' && cur != NULL)
-        {
-            // Start extracting the format specifier
-            const char *start = format;
-            format++; // Move past '%'
-
-            // Extract until a valid specifier character is found
-            while (strchr("diouxXfFeEgGaAcspnb%", *format) == NULL && *format != '\0')
-            {
-                format++;
-            }
-
-            if (*format == '\0')
-            {
-                yyerror("Invalid format specifier");
-                exit(EXIT_FAILURE);
-            }
-
-            // Copy the format specifier into a temporary buffer
-            char specifier[32];
-            int length = format - start + 1;
-            strncpy(specifier, start, length);
-            specifier[length] = '\0';
-
-            // Process the argument based on the format specifier
-            ASTNode *expr = cur->expr;
-            if (!expr)
-            {
-                yyerror("Invalid argument in yapping call");
-                exit(EXIT_FAILURE);
-            }
-
-            if (*format == 'b')
-            {
-                // Handle boolean values
-                bool val = evaluate_expression_bool(expr);
-                buffer_offset += snprintf(buffer + buffer_offset, sizeof(buffer) - buffer_offset, "%s", val ? "W" : "L");
-            }
-            else if (strchr("diouxX", *format))
-            {
-                // Integer or unsigned integer
-                volatile bool is_unsigned = (expr->type == NODE_IDENTIFIER &&
-                                    get_variable_modifiers(expr->data.name).is_unsigned);
-                
-                if (is_unsigned)
-                {
-                    if (is_short_expression(expr))
-                    {
-                        unsigned short val = evaluate_expression_short(expr);
-                        buffer_offset += snprintf(buffer + buffer_offset, sizeof(buffer) - buffer_offset, specifier, val);
-                    }
-                    else
-                    {
-                        unsigned int val = (unsigned int)evaluate_expression_int(expr);
-                        buffer_offset += snprintf(buffer + buffer_offset, sizeof(buffer) - buffer_offset, specifier, val);
-                    }
-                }
-                else
-                {
-                    if (is_short_expression(expr))
-                    {
-                        short val = evaluate_expression_short(expr);
-                        buffer_offset += snprintf(buffer + buffer_offset, sizeof(buffer) - buffer_offset, specifier, val);
-                    }
-                    else
-                    {
-                        int val = evaluate_expression_int(expr);
-                        buffer_offset += snprintf(buffer + buffer_offset, sizeof(buffer) - buffer_offset, specifier, val);
-                    }
-                }
-            }
-            else if (strchr("fFeEgGa", *format))
-            {
-                // Floating-point numbers
-                if (expr->type == NODE_ARRAY_ACCESS)
-                {
-                    // Special handling for array access
-                    const char *array_name = expr->data.array.name;
-                    void *element = evaluate_multi_array_access(expr);
-                    if (!element)
-                    {
-                        yyerror("Invalid array access in floating-point format specifier");
-                        exit(EXIT_FAILURE);
-                    }
-                    
-
-                    Variable *var = get_variable(array_name);
-                    if (var != NULL)
-                    {
-                        if (var->var_type == VAR_FLOAT)
-                        {
-                            float val = *(float*)element;
-                            buffer_offset += snprintf(buffer + buffer_offset,
-                                                      sizeof(buffer) - buffer_offset,
-                                                      specifier, val);
-                        }
-                        else if (var->var_type == VAR_DOUBLE)
-                        {
-                            double val = *(double*)element;
-                            buffer_offset += snprintf(buffer + buffer_offset,
-                                                      sizeof(buffer) - buffer_offset,
-                                                      specifier, val);
-                        }
-                        break;
-                    }
-                }
-                else if (is_float_expression(expr))
-                {
-                    float val = evaluate_expression_float(expr);
-                    buffer_offset += snprintf(buffer + buffer_offset, sizeof(buffer) - buffer_offset, specifier, val);
-                }
-                else if (is_double_expression(expr))
-                {
-                    double val = evaluate_expression_double(expr);
-                    buffer_offset += snprintf(buffer + buffer_offset, sizeof(buffer) - buffer_offset, specifier, val);
-                }
-                else
-                {
-                    yyerror("Invalid argument type for floating-point format specifier");
-                    exit(EXIT_FAILURE);
-                }
-            }
-            else if (*format == 'c')
-            {
-                // Character
-                int val = evaluate_expression_int(expr);
-                buffer_offset += snprintf(buffer + buffer_offset, sizeof(buffer) - buffer_offset, specifier, val);
-            }
-            else if (*format == 's')
-            {
-                // String
-                const Variable *var = get_variable(expr->data.name);
-                if (var != NULL)
-                {
-                    if (!var->is_array)
-                    {
-                        yyerror("Invalid argument type for %s");
-                        exit(EXIT_FAILURE);
-                    }
-                    buffer_offset += snprintf(buffer + buffer_offset, sizeof(buffer) - buffer_offset, specifier, var->value.array_data);
-                }
-                else if (expr->type != NODE_STRING_LITERAL)
-                {
-                    yyerror("Invalid argument type for %s");
-                    exit(EXIT_FAILURE);
-                }
-                else
-                {
-                    buffer_offset += snprintf(buffer + buffer_offset, sizeof(buffer) - buffer_offset, specifier, expr->data.name);
-                }
-            }
-            else
-            {
-                yyerror("Unsupported format specifier");
-                exit(EXIT_FAILURE);
-            }
+        char error_msg[160];
+        snprintf(error_msg, sizeof(error_msg),
+                 status == CHAN_BUSY ? "send on dm channel '%s' while another send is under way; use a gc channel"
+                                     : "send on closed channel '%s'",
+                 args->expr->data.name);
+        yyerror(error_msg);
+        interpreter_exit(EXIT_FAILURE);
+    }
+}
 
-            cur = cur->next; // Move to the next argument
-            format++;        // Move past the format specifier
-        }
-        else
-        {
-            // Copy non-format characters to the buffer
-            buffer[buffer_offset++] = *format++;
-        }
+/*
+ * recv(ch, x) waits for a message and stores it in x, converted to x's
+ * type. It returns W, or L without touching x once ch is closed and empty,
+ * so `goon (recv(ch, x)) { ... }` drains a channel.
+ */
+void execute_recv_call(ArgumentList *args)
+{
+    if (!args || !args->next || args->next->next)
+    {
+        yyerror("recv expects 2 arguments: recv(ch, variable)");
+        interpreter_exit(EXIT_FAILURE);
+    }
+    Variable *ch = get_channel_argument(args->expr, "recv");
 
-        // Check for buffer overflow
-        if (buffer_offset >= (int)sizeof(buffer))
+    ASTNode *target = args->next->expr;
+    Variable *var = target->type == NODE_IDENTIFIER ? get_variable(target->data.name) : NULL;
+    if (var == NULL || var->is_array || var->is_map || var->is_channel || var->struct_def != NULL)
+    {
+        yyerror("recv stores the message in a scalar variable: recv(ch, variable)");
+        interpreter_exit(EXIT_FAILURE);
+    }
+    check_const_assignment(target->data.name);
+
+    Value message;
+    ChanStatus status = chan_recv(ch->value.channel_data, &message);
+    if (status == CHAN_CANCELLED)
+        interpreter_exit(current_interpreter->status);
+    if (status == CHAN_BUSY)
+    {
+        char error_msg[160];
+        snprintf(error_msg, sizeof(error_msg),
+                 "recv on dm channel '%s' while another recv is under way; use a gc channel", args->expr->data.name);
+        yyerror(error_msg);
+        interpreter_exit(EXIT_FAILURE);
+    }
+    bool received = status == CHAN_OK;
+    if (received)
+    {
+        ReturnValue as_result = {.has_value = true, .type = ch->var_type};
+        switch (ch->var_type)
         {
-            yyerror("Buffer overflow in yapping call");
-            exit(EXIT_FAILURE);
+        case VAR_INT:
+        case VAR_CHAR:
+            as_result.value.ivalue = message.ivalue;
+            break;
+        case VAR_SHORT:
+            as_result.value.svalue = message.svalue;
+            break;
+        case VAR_FLOAT:
+            as_result.value.fvalue = message.fvalue;
+            break;
+        case VAR_DOUBLE:
+            as_result.value.dvalue = message.dvalue;
+            break;
+        case VAR_BOOL:
+            as_result.value.bvalue = message.bvalue;
+            break;
+        case NONE:
+            break;
         }
+        store_scalar(var, return_value_as_double(as_result));
     }
 
-    buffer[buffer_offset] = '\0'; // Null-terminate the string
+    current_return_value.has_value = true;
+    current_return_value.value.bvalue = received;
+}
 
-    // Print the final formatted output
-    yapping("%s", buffer);
+void execute_close_call(ArgumentList *args)
+{
+    if (!args || args->next)
+    {
+        yyerror("close expects 1 argument: close(ch)");
+        interpreter_exit(EXIT_FAILURE);
+    }
+    chan_close(get_channel_argument(args->expr, "close")->value.channel_data);
 }
 
-void execute_yappin_call(ArgumentList *args)
+// The lane type of a vector expression, or NONE if it is a plain number
+static VarType simd_expression_type(ASTNode *node)
 {
-    if (!args)
+    switch (node->type)
     {
-        yyerror("No arguments provided for yappin function call");
-        exit(EXIT_FAILURE);
+    case NODE_IDENTIFIER:
+    {
+        Variable *var = get_variable(node->data.name);
+        return var != NULL && var->is_simd ? var->var_type : NONE;
+    }
+    case NODE_OPERATION:
+    {
+        VarType type = simd_expression_type(node->data.op.left);
+        return type != NONE ? type : simd_expression_type(node->data.op.right);
+    }
+    case NODE_UNARY_OPERATION:
+        return simd_expression_type(node->data.unary.operand);
+    case NODE_FUNC_CALL:
+    {
+        ArgumentList *args = node->data.func_call.arguments;
+        if (strcmp(node->data.func_call.function_name, "vload") == 0)
+            return args ? get_array_argument(args->expr, "vload")->var_type : NONE;
+        if (!is_vector_builtin(node->data.func_call.function_name))
+            return NONE;
+        for (; args; args = args->next)
+        {
+            VarType type = simd_expression_type(args->expr);
+            if (type != NONE)
+                return type;
+        }
+        return NONE;
+    }
+    default:
+        return NONE;
     }
+}
 
-    ASTNode *formatNode = args->expr;
-    if (formatNode->type != NODE_STRING_LITERAL)
+// vstore(arr, i, v): writes the lanes of v to arr[i] .. arr[i + lanes - 1]
+void execute_vstore_call(ArgumentList *args)
+{
+    if (!args || !args->next || !args->next->next || args->next->next->next)
     {
-        yyerror("First argument to yappin must be a string literal");
-        exit(EXIT_FAILURE);
+        yyerror("vstore expects 3 arguments: vstore(arr, i, v)");
+        interpreter_exit(EXIT_FAILURE);
     }
+    Variable *var = get_array_argument(args->expr, "vstore");
+    check_const_assignment(args->expr->data.name);
+    VarType type = var->var_type;
+    if (type != VAR_FLOAT && type != VAR_DOUBLE && type != VAR_INT)
+        simd_error("vstore needs a chad, gigachad or rizz array, not '%s'", args->expr->data.name);
 
-    const char *format = formatNode->data.name; // The format string
-    char buffer[1024];                          // Buffer for the final formatted output
-    int buffer_offset = 0;
+    size_t lanes = simd_lanes(simd_kind(type));
+    int start = evaluate_expression_int(args->next->expr);
+    if (start < 0 || (size_t)start + lanes > var->array_dimensions.total_size)
+        simd_error("vstore writes past the end of '%s'", args->expr->data.name);
 
-    ArgumentList *cur = args->next;
+    SimdVec value;
+    evaluate_simd(args->next->next->expr, type, &value);
+    simd_store(simd_kind(type), (char *)var->value.array_data + (size_t)start * get_element_size(type), &value);
+}
 
-    while (*format != '\0')
+VarType get_horizontal_type(ArgumentList *args)
+{
+    VarType type = args ? simd_expression_type(args->expr) : NONE;
+    if (type == NONE)
     {
-        if (*format == '%' && cur != NULL)
-        {
-            // Start extracting the format specifier
-            const char *start = format;
-            format++; // Move past '%'
+        yyerror("hsum, hmin and hmax expect a chad4, gigachad4 or rizz8 vector");
+        interpreter_exit(EXIT_FAILURE);
+    }
+    return type;
+}
 
-            // Extract until a valid specifier character is found
-            while (strchr("diouxXfFeEgGaAcspnb%", *format) == NULL && *format != '\0')
-            {
-                format++;
-            }
+static void execute_horizontal_call(ArgumentList *args, SimdReduce op, const char *name)
+{
+    if (!args || args->next)
+        simd_error("%s expects 1 argument", name);
+    VarType type = get_horizontal_type(args);
+    SimdVec v;
+    evaluate_simd(args->expr, type, &v);
+    double result = simd_reduce(op, simd_kind(type), &v);
 
-            if (*format == '\0')
-            {
-                yyerror("Invalid format specifier");
-                exit(EXIT_FAILURE);
-            }
+    current_return_value.has_value = true;
+    current_return_value.type = type;
+    if (type == VAR_FLOAT)
+        current_return_value.value.fvalue = (float)result;
+    else if (type == VAR_DOUBLE)
+        current_return_value.value.dvalue = result;
+    else
+        current_return_value.value.ivalue = (int)result;
+}
 
-            // Copy the format specifier into a temporary buffer
-            char specifier[32];
-            int length = format - start + 1;
-            strncpy(specifier, start, length);
-            specifier[length] = '\0';
+void execute_hsum_call(ArgumentList *args)
+{
+    execute_horizontal_call(args, SIMD_SUM, "hsum");
+}
 
-            // Process the argument based on the format specifier
-            ASTNode *expr = cur->expr;
-            if (!expr)
-            {
-                yyerror("Invalid argument in yappin call");
-                exit(EXIT_FAILURE);
-            }
+void execute_hmin_call(ArgumentList *args)
+{
+    execute_horizontal_call(args, SIMD_HMIN, "hmin");
+}
 
-            if (*format == 'b')
-            {
-                // Handle boolean values
-                bool val = evaluate_expression_bool(expr);
-                buffer_offset += snprintf(buffer + buffer_offset, sizeof(buffer) - buffer_offset, "%s", val ? "W" : "L");
-            }
-            else if (strchr("diouxX", *format))
-            {
-                if (is_short_expression(expr))
-                {
-                    short val = evaluate_expression_short(expr);
-                    buffer_offset += snprintf(buffer + buffer_offset, sizeof(buffer) - buffer_offset, specifier, val);
-                }
-                else
-                {
-                    int val = evaluate_expression_int(expr);
-                    buffer_offset += snprintf(buffer + buffer_offset, sizeof(buffer) - buffer_offset, specifier, val);
-                }
-            }
-            else if (strchr("fFeEgGa", *format))
-            {
-                // Handle floating-point numbers
-                if (is_float_expression(expr))
-                {
-                    float val = evaluate_expression_float(expr);
-                    buffer_offset += snprintf(buffer + buffer_offset, sizeof(buffer) - buffer_offset, specifier, val);
-                }
-                else if (is_double_expression(expr))
-                {
-                    double val = evaluate_expression_double(expr);
-                    buffer_offset += snprintf(buffer + buffer_offset, sizeof(buffer) - buffer_offset, specifier, val);
-                }
-                else
-                {
-                    yyerror("Invalid argument type for floating-point format specifier");
-                    exit(EXIT_FAILURE);
-                }
-            }
-            else if (*format == 'c')
-            {
-                // Handle character values
-                int val = evaluate_expression_int(expr);
-                buffer_offset += snprintf(buffer + buffer_offset, sizeof(buffer) - buffer_offset, specifier, val);
-            }
-            else if (*format == 's')
-            {
-                const Variable *var = get_variable(expr->data.name);
-                if (var != NULL)
-                {
-                    if (!var->is_array)
-                    {
-                        yyerror("Invalid argument type for %s");
-                        exit(EXIT_FAILURE);
-                    }
-                    buffer_offset += snprintf(buffer + buffer_offset, sizeof(buffer) - buffer_offset, specifier, var->value.array_data);
-                }
-                else if (expr->type != NODE_STRING_LITERAL)
-                {
-                    yyerror("Invalid argument type for %s");
-                    exit(EXIT_FAILURE);
-                }
-                else
-                {
-                    buffer_offset += snprintf(buffer + buffer_offset, sizeof(buffer) - buffer_offset, specifier, expr->data.name);
-                }
-            }
-            else
-            {
-                yyerror("Unsupported format specifier");
-                exit(EXIT_FAILURE);
-            }
+void execute_hmax_call(ArgumentList *args)
+{
+    execute_horizontal_call(args, SIMD_HMAX, "hmax");
+}
 
-            cur = cur->next; // Move to the next argument
-            format++;        // Move past the format specifier
-        }
-        else
-        {
-            // Copy non-format characters to the buffer
-            buffer[buffer_offset++] = *format++;
-        }
+// vload, vselect, vmin and vmax only make sense inside vector expressions
+static void execute_vector_only_call(ArgumentList *args)
+{
+    (void)args;
+    yyerror("Vector used as a number; assign it to a chad4, gigachad4 or rizz8, "
+            "or reduce it with hsum, hmin or hmax");
+    interpreter_exit(EXIT_FAILURE);
+}
 
-        // Check for buffer overflow
-        if (buffer_offset >= (int)sizeof(buffer))
-        {
-            yyerror("Buffer overflow in yappin call");
-            exit(EXIT_FAILURE);
-        }
+static Variable *get_vector_argument(ASTNode *expr, const char *func_name)
+{
+    Variable *var = get_array_argument(expr, func_name);
+    if (!var->is_vector)
+    {
+        char error_msg[128];
+        snprintf(error_msg, sizeof(error_msg),
+                 "%s expects a vector, declared with empty brackets like rizz %s[]",
+                 func_name, expr->data.name);
+        yyerror(error_msg);
+        interpreter_exit(EXIT_FAILURE);
+    }
+    return var;
+}
+
+void execute_push_call(ArgumentList *args)
+{
+    if (!args || !args->next || args->next->next)
+    {
+        yyerror("push expects 2 arguments: push(v, x)");
+        interpreter_exit(EXIT_FAILURE);
+    }
+    Variable *var = get_vector_argument(args->expr, "push");
+    check_const_assignment(args->expr->data.name);
+
+    size_t n = var->array_dimensions.total_size;
+    if (n == INT_MAX)
+    {
+        yyerror("Vector is full");
+        interpreter_exit(EXIT_FAILURE);
+    }
+    if (n == var->capacity)
+    {
+        // Geometric growth keeps push amortized O(1).
+        vector_reserve(var, var->capacity * 2);
+    }
+
+    ASTNode *x = args->next->expr;
+    void *data = var->value.array_data;
+    switch (var->var_type)
+    {
+    case VAR_INT:
+        ((int *)data)[n] = evaluate_expression_int(x);
+        break;
+    case VAR_SHORT:
+        ((short *)data)[n] = evaluate_expression_short(x);
+        break;
+    case VAR_FLOAT:
+        ((float *)data)[n] = evaluate_expression_float(x);
+        break;
+    case VAR_DOUBLE:
+        ((double *)data)[n] = evaluate_expression_double(x);
+        break;
+    case VAR_BOOL:
+        bitset_set(data, n, evaluate_expression_bool(x));
+        break;
+    case VAR_CHAR:
+        ((char *)data)[n] = evaluate_expression_int(x);
+        break;
+    default:
+        yyerror("Unsupported vector type");
+        interpreter_exit(EXIT_FAILURE);
+    }
+    vector_set_length(var, n + 1);
+}
+
+VarType get_pop_type(ArgumentList *args)
+{
+    return get_vector_argument(args ? args->expr : NULL, "pop")->var_type;
+}
+
+void execute_pop_call(ArgumentList *args)
+{
+    if (!args || args->next)
+    {
+        yyerror("pop expects 1 argument: pop(v)");
+        interpreter_exit(EXIT_FAILURE);
+    }
+    Variable *var = get_vector_argument(args->expr, "pop");
+    check_const_assignment(args->expr->data.name);
+
+    size_t n = var->array_dimensions.total_size;
+    if (n == 0)
+    {
+        char error_msg[100];
+        snprintf(error_msg, sizeof(error_msg), "pop from empty vector '%s'", args->expr->data.name);
+        yyerror(error_msg);
+        interpreter_exit(EXIT_FAILURE);
+    }
+    n--;
+
+    void *data = var->value.array_data;
+    current_return_value.has_value = true;
+    current_return_value.type = var->var_type;
+    switch (var->var_type)
+    {
+    case VAR_INT:
+        current_return_value.value.ivalue = ((int *)data)[n];
+        break;
+    case VAR_SHORT:
+        current_return_value.value.svalue = ((short *)data)[n];
+        break;
+    case VAR_FLOAT:
+        current_return_value.value.fvalue = ((float *)data)[n];
+        break;
+    case VAR_DOUBLE:
+        current_return_value.value.dvalue = ((double *)data)[n];
+        break;
+    case VAR_BOOL:
+        current_return_value.value.bvalue = bitset_get(data, n);
+        bitset_set(data, n, false);
+        break;
+    case VAR_CHAR:
+        current_return_value.value.ivalue = ((char *)data)[n];
+        ((char *)data)[n] = '\0';
+        break;
+    default:
+        yyerror("Unsupported vector type");
+        interpreter_exit(EXIT_FAILURE);
+    }
+    vector_set_length(var, n);
+}
+
+void execute_reserve_call(ArgumentList *args)
+{
+    if (!args || !args->next || args->next->next)
+    {
+        yyerror("reserve expects 2 arguments: reserve(v, n)");
+        interpreter_exit(EXIT_FAILURE);
     }
+    Variable *var = get_vector_argument(args->expr, "reserve");
+    int n = evaluate_expression_int(args->next->expr);
+    if (n < 0)
+    {
+        yyerror("reserve size must not be negative");
+        interpreter_exit(EXIT_FAILURE);
+    }
+    vector_reserve(var, (size_t)n);
+}
 
-    buffer[buffer_offset] = '\0'; // Null-terminate the string
+void execute_clear_call(ArgumentList *args)
+{
+    if (!args || args->next)
+    {
+        yyerror("clear expects 1 argument: clear(v)");
+        interpreter_exit(EXIT_FAILURE);
+    }
+    Variable *var = get_vector_argument(args->expr, "clear");
+    check_const_assignment(args->expr->data.name);
 
-    // Print the final formatted output
-    yappin("%s", buffer);
+    memset(var->value.array_data, 0, vector_bytes(var->var_type, var->array_dimensions.total_size));
+    vector_set_length(var, 0);
 }
 
-void execute_baka_call(ArgumentList *args)
+void execute_swap_call(ArgumentList *args)
 {
-    if (!args)
-    {
-        baka("\n");
+    if (!args || !args->next || args->next->next)
+    {
+        yyerror("swap expects 2 arguments: swap(a, b)");
+        interpreter_exit(EXIT_FAILURE);
+    }
+    Variable *a = get_array_argument(args->expr, "swap");
+    Variable *b = get_array_argument(args->next->expr, "swap");
+    check_const_assignment(args->expr->data.name);
+    check_const_assignment(args->next->expr->data.name);
+    check_spawn_pins(a, "swap", args->expr->data.name);
+    check_spawn_pins(b, "swap", args->next->expr->data.name);
+
+    if (a->var_type == b->var_type && a->is_vector && b->is_vector)
+    {
+        Variable tmp = *a;
+        a->value.array_data = b->value.array_data;
+        a->capacity = b->capacity;
+        vector_set_length(a, b->array_dimensions.total_size);
+        b->value.array_data = tmp.value.array_data;
+        b->capacity = tmp.capacity;
+        vector_set_length(b, tmp.array_dimensions.total_size);
         return;
     }
+    if (a->var_type != b->var_type || a->is_vector || b->is_vector || !same_array_shape(a, b))
+    {
+        yyerror("swap needs two arrays of the same type and shape");
+        interpreter_exit(EXIT_FAILURE);
+    }
 
-    ASTNode *formatNode = args->expr;
-    if (formatNode->type != NODE_STRING_LITERAL)
+    if (a->is_view || b->is_view)
     {
-        yyerror("First argument to yapping must be a string literal");
+        // An array parameter shares its caller's storage, so rebinding the
+        // pointer would not be seen by the caller; exchange the contents.
+        size_t bytes = array_storage_bytes(a);
+        void *tmp = safe_malloc(bytes);
+        memcpy(tmp, a->value.array_data, bytes);
+        memcpy(a->value.array_data, b->value.array_data, bytes);
+        memcpy(b->value.array_data, tmp, bytes);
+        SAFE_FREE(tmp);
         return;
     }
 
-    baka(formatNode->data.name);
+    void *tmp = a->value.array_data;
+    a->value.array_data = b->value.array_data;
+    b->value.array_data = tmp;
 }
 
-void execute_ragequit_call(ArgumentList *args)
+/*
+ * Replaces an array's storage with a shared mapping of a file. A vector
+ * takes its length from the file size and becomes a fixed 1D array; any
+ * other array maps exactly as many bytes as its declared shape holds.
+ */
+static void bind_array_to_file(ArgumentList *args, const char *func_name, bool writable)
 {
-    if (!args)
+    if (!args || !args->next || args->next->next)
     {
-        yyerror("No arguments provided for ragequit function call");
-        exit(EXIT_FAILURE);
+        char error_msg[100];
+        snprintf(error_msg, sizeof(error_msg), "%s expects 2 arguments: %s(arr, path)", func_name, func_name);
+        yyerror(error_msg);
+        interpreter_exit(EXIT_FAILURE);
+    }
+    Variable *var = get_array_argument(args->expr, func_name);
+    if (writable)
+        check_const_assignment(args->expr->data.name);
+    check_spawn_pins(var, func_name, args->expr->data.name);
+    if (var->is_view || var->var_type == VAR_BOOL)
+    {
+        char error_msg[160];
+        snprintf(error_msg, sizeof(error_msg),
+                 "%s cannot bind '%s'; array parameters and cap arrays cannot be file-backed",
+                 func_name, args->expr->data.name);
+        yyerror(error_msg);
+        interpreter_exit(EXIT_FAILURE);
+    }
+    const char *path = get_string_value(args->next->expr);
+    if (path == NULL)
+    {
+        char error_msg[100];
+        snprintf(error_msg, sizeof(error_msg), "%s expects a string or yap array as path", func_name);
+        yyerror(error_msg);
+        interpreter_exit(EXIT_FAILURE);
     }
 
-    ASTNode *formatNode = args->expr;
-    if (formatNode->type != NODE_INT)
+    size_t elem_size = get_element_size(var->var_type);
+    size_t bytes = var->is_vector ? 0 : array_storage_bytes(var);
+    void *data = safe_map_file(path, &bytes, writable);
+    if (data == NULL)
     {
-        yyerror("First argument to ragequit must be a integer");
-        exit(EXIT_FAILURE);
+        char error_msg[512];
+        snprintf(error_msg, sizeof(error_msg), "%s cannot map '%s': %s", func_name, path,
+                 errno == EINVAL ? "file is empty or too short for the array" : strerror(errno));
+        yyerror(error_msg);
+        interpreter_exit(EXIT_FAILURE);
+    }
+    if (bytes % elem_size != 0)
+    {
+        SAFE_FREE(data);
+        char error_msg[512];
+        snprintf(error_msg, sizeof(error_msg), "%s: size of '%s' is not a multiple of the element size",
+                 func_name, path);
+        yyerror(error_msg);
+        interpreter_exit(EXIT_FAILURE);
     }
 
-    ragequit(formatNode->data.ivalue);
+    SAFE_FREE(var->value.array_data);
+    var->value.array_data = data;
+    if (var->is_vector)
+    {
+        var->is_vector = false;
+        var->capacity = 0;
+        vector_set_length(var, bytes / elem_size);
+    }
+    if (!writable)
+        var->modifiers.is_const = true;
+
+    current_return_value.has_value = true;
+    current_return_value.value.ivalue = (int)var->array_dimensions.total_size;
 }
 
-void execute_chill_call(ArgumentList *args)
+void execute_bind_file_call(ArgumentList *args)
 {
-    if (!args)
+    bind_array_to_file(args, "bind_file", false);
+}
+
+void execute_bind_file_rw_call(ArgumentList *args)
+{
+    bind_array_to_file(args, "bind_file_rw", true);
+}
+
+static int yap_sink(void *ctx, const void *data, size_t len)
+{
+    (void)ctx;
+    yap_write(data, len);
+    return 0;
+}
+
+/*
+ * Shared body of read_bin and write_bin: transfer raw little-endian elements
+ * between arr[offset .. offset + count) and a file, or stdin/stdout when the
+ * path is "-". Without a count the rest of the array is used, except that
+ * reading into a vector consumes the whole input and grows the vector.
+ * Returns the number of elements transferred.
+ */
+static void binary_array_io(ArgumentList *args, const char *func_name, bool writing)
+{
+    int nargs = 0;
+    for (ArgumentList *a = args; a; a = a->next)
+        nargs++;
+    if (nargs < 2 || nargs > 4)
     {
-        yyerror("No arguments provided for chill function call");
-        exit(EXIT_FAILURE);
+        char error_msg[100];
+        snprintf(error_msg, sizeof(error_msg), "%s expects 2 to 4 arguments: %s(arr, path, offset, count)",
+                 func_name, func_name);
+        yyerror(error_msg);
+        interpreter_exit(EXIT_FAILURE);
+    }
+    Variable *var = get_array_argument(args->expr, func_name);
+    if (!writing)
+        check_const_assignment(args->expr->data.name);
+    if (var->var_type == VAR_BOOL)
+    {
+        char error_msg[100];
+        snprintf(error_msg, sizeof(error_msg), "%s does not support cap arrays", func_name);
+        yyerror(error_msg);
+        interpreter_exit(EXIT_FAILURE);
+    }
+    const char *path = get_string_value(args->next->expr);
+    if (path == NULL)
+    {
+        char error_msg[100];
+        snprintf(error_msg, sizeof(error_msg), "%s expects a string or yap array as path", func_name);
+        yyerror(error_msg);
+        interpreter_exit(EXIT_FAILURE);
     }
 
-    ASTNode *formatNode = args->expr;
-    if (formatNode->type != NODE_INT && !formatNode->modifiers.is_unsigned)
+    size_t total = var->array_dimensions.total_size;
+    int offset = nargs > 2 ? evaluate_expression_int(args->next->next->expr) : 0;
+    int count = nargs > 3 ? evaluate_expression_int(args->next->next->next->expr) : -1;
+    bool grows = !writing && var->is_vector;
+    if (offset < 0 || (size_t)offset > total || (nargs > 3 && count < 0) ||
+        (!grows && count >= 0 && (size_t)count > total - (size_t)offset))
     {
-        yyerror("First argument to chill must be a unsigned integer");
-        exit(EXIT_FAILURE);
+        char error_msg[100];
+        snprintf(error_msg, sizeof(error_msg), "%s offset or count out of bounds", func_name);
+        yyerror(error_msg);
+        interpreter_exit(EXIT_FAILURE);
     }
+    bool read_all = grows && count < 0;
+    if (count < 0)
+        count = (int)(total - (size_t)offset);
 
-    chill(formatNode->data.ivalue);
+    int fd;
+    bool standard = strcmp(path, "-") == 0;
+    if (standard)
+    {
+        fd = writing ? STDOUT_FILENO : STDIN_FILENO;
+    }
+    else
+    {
+        fd = writing ? open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644) : open(path, O_RDONLY);
+    }
+    if (fd < 0)
+    {
+        char error_msg[512];
+        snprintf(error_msg, sizeof(error_msg), "%s cannot open '%s': %s", func_name, path, strerror(errno));
+        yyerror(error_msg);
+        interpreter_exit(EXIT_FAILURE);
+    }
+
+    size_t elem_size = get_element_size(var->var_type);
+    ssize_t done;
+    if (writing)
+    {
+        const char *src = (char *)var->value.array_data + (size_t)offset * elem_size;
+        // "-" goes where yapping does, which keeps the two in order
+        done = standard ? binio_emit(yap_sink, NULL, src, elem_size, (size_t)count)
+                        : binio_write(fd, src, elem_size, (size_t)count);
+    }
+    else if (var->is_vector)
+    {
+        // Grow geometrically and read straight into the spare capacity.
+        size_t length = (size_t)offset;
+        size_t limit = read_all ? (size_t)INT_MAX : length + (size_t)count;
+        done = 0;
+        while (length < limit)
+        {
+            if (length == var->capacity)
+            {
+                size_t grown = var->capacity ? var->capacity * 2 : VECTOR_MIN_CAPACITY;
+                vector_reserve(var, grown < limit ? grown : limit);
+            }
+            size_t room = var->capacity - length;
+            if (room > limit - length)
+                room = limit - length;
+            ssize_t n = binio_read(fd, (char *)var->value.array_data + length * elem_size, elem_size, room);
+            if (n < 0)
+            {
+                done = -1;
+                break;
+            }
+            length += (size_t)n;
+            done += n;
+            if ((size_t)n < room)
+                break;
+        }
+        if (done >= 0)
+        {
+            vector_set_length(var, length);
+            if (var->var_type == VAR_CHAR)
+                ((char *)var->value.array_data)[length] = '\0';
+        }
+    }
+    else
+    {
+        done = binio_read(fd, (char *)var->value.array_data + (size_t)offset * elem_size, elem_size, (size_t)count);
+    }
+    int saved = errno;
+    if (!standard)
+        close(fd);
+    if (done < 0)
+    {
+        char error_msg[512];
+        snprintf(error_msg, sizeof(error_msg), "%s failed on '%s': %s", func_name, path,
+                 saved == EINVAL ? "input ends partway through an element" : strerror(saved));
+        yyerror(error_msg);
+        interpreter_exit(EXIT_FAILURE);
+    }
+
+    current_return_value.has_value = true;
+    current_return_value.value.ivalue = (int)done;
 }
 
-void execute_slorp_call(ArgumentList *args)
+void execute_read_bin_call(ArgumentList *args)
 {
-    if (!args || args->expr->type != NODE_IDENTIFIER)
+    binary_array_io(args, "read_bin", false);
+}
+
+void execute_write_bin_call(ArgumentList *args)
+{
+    binary_array_io(args, "write_bin", true);
+}
+
+/*
+ * Loads the text of a file, or all of stdin for "-". Files are mapped
+ * rather than read. Returns NULL with *len == 0 for empty input; free the
+ * result with SAFE_FREE.
+ */
+static char *load_text_input(const char *path, size_t *len, const char *func_name)
+{
+    *len = 0;
+    if (strcmp(path, "-") != 0)
     {
-        yyerror("slurp requires a variable identifier");
-        return;
+        char *data = safe_map_file(path, len, false);
+        if (data != NULL || errno == EINVAL)
+            return data; // EINVAL: the file is empty
     }
-
-    char *name = args->expr->data.name;
-    Variable *var = get_variable(name);
-    if (!var)
+    else
     {
-        yyerror("Undefined variable");
-        return;
+        size_t capacity = 0;
+        char *data = NULL;
+        for (;;)
+        {
+            if (*len == capacity)
+            {
+                capacity = capacity ? capacity * 2 : INPUT_BUFFER_SIZE;
+                data = safe_realloc(data, capacity);
+                if (data == NULL)
+                {
+                    yyerror("Out of memory reading stdin");
+                    interpreter_exit(EXIT_FAILURE);
+                }
+            }
+            ssize_t n = input_read_raw(data + *len, capacity - *len);
+            if (n < 0 && errno == EINTR)
+                continue;
+            if (n <= 0)
+            {
+                if (n == 0)
+                    return data;
+                break;
+            }
+            *len += (size_t)n;
+        }
     }
 
+    char error_msg[512];
+    snprintf(error_msg, sizeof(error_msg), "%s cannot read '%s': %s", func_name, path, strerror(errno));
+    yyerror(error_msg);
+    interpreter_exit(EXIT_FAILURE);
+}
+
+// Parses one field into element `row` of a number array
+static input_status store_number(Variable *var, size_t row, const char *field, size_t length)
+{
+    long l = 0;
+    double d = 0.0;
+    input_status status;
     switch (var->var_type)
     {
     case VAR_INT:
+        status = input_parse_long(field, length, INT_MIN, INT_MAX, INPUT_INTEGER_OVERFLOW, &l);
+        ((int *)var->value.array_data)[row] = (int)l;
+        return status;
+    case VAR_SHORT:
+        status = input_parse_long(field, length, SHRT_MIN, SHRT_MAX, INPUT_SHORT_OVERFLOW, &l);
+        ((short *)var->value.array_data)[row] = (short)l;
+        return status;
+    case VAR_FLOAT:
+        status = input_parse_double(field, length, &d);
+        if (status == INPUT_SUCCESS && isfinite(d) && fabs(d) > FLT_MAX)
+            status = INPUT_FLOAT_OVERFLOW;
+        ((float *)var->value.array_data)[row] = (float)d;
+        return status;
+    default:
+        status = input_parse_double(field, length, &d);
+        ((double *)var->value.array_data)[row] = d;
+        return status;
+    }
+}
+
+/*
+ * read_csv(path, a, b, ...): parses comma-separated numbers into one array
+ * per column, in column order. Extra columns are ignored and a first row
+ * that does not start with a number is taken as a header. Fixed arrays
+ * must have room for every row; vectors are cleared and grown to fit.
+ * Returns the number of rows read.
+ */
+void execute_read_csv_call(ArgumentList *args)
+{
+    if (!args || !args->next)
     {
-        int val = 0;
-        val = slorp_int(val);
-        set_int_variable(name, val, var->modifiers);
-        break;
+        yyerror("read_csv expects a path and at least one array: read_csv(path, a, b, ...)");
+        interpreter_exit(EXIT_FAILURE);
     }
-    case VAR_FLOAT:
+    const char *path = get_string_value(args->expr);
+    if (path == NULL)
     {
-        float val = 0.0f;
-        val = slorp_float(val);
-        set_float_variable(name, val, var->modifiers);
-        break;
+        yyerror("read_csv expects a string or yap array as path");
+        interpreter_exit(EXIT_FAILURE);
     }
-    case VAR_DOUBLE:
+
+    int ncols = 0;
+    for (ArgumentList *a = args->next; a; a = a->next)
+        ncols++;
+    Variable **cols = safe_malloc_array((size_t)ncols, sizeof(Variable *));
+    int c = 0;
+    for (ArgumentList *a = args->next; a; a = a->next, c++)
     {
-        double val = 0.0;
-        val = slorp_double(val);
-        set_double_variable(name, val, var->modifiers);
-        break;
+        cols[c] = get_array_argument(a->expr, "read_csv");
+        check_const_assignment(a->expr->data.name);
+        if (cols[c]->var_type == VAR_BOOL || cols[c]->var_type == VAR_CHAR)
+        {
+            char error_msg[128];
+            snprintf(error_msg, sizeof(error_msg), "read_csv needs number arrays, but '%s' is not one",
+                     a->expr->data.name);
+            yyerror(error_msg);
+            interpreter_exit(EXIT_FAILURE);
+        }
+        if (cols[c]->is_vector)
+            vector_set_length(cols[c], 0);
     }
-    case VAR_SHORT:
+
+    size_t len;
+    char *text = load_text_input(path, &len, "read_csv");
+    CsvReader reader;
+    csv_init(&reader, text, len, ',');
+
+    size_t rows = 0;
+    bool first_row = true;
+    char error_msg[512];
+    error_msg[0] = '\0';
+    while (error_msg[0] == '\0' && csv_begin_row(&reader))
     {
-        short val = 0;
-        val = slorp_short(val);
-        set_short_variable(name, val, var->modifiers);
-        break;
+        const char *field;
+        size_t length;
+        if (first_row)
+        {
+            first_row = false;
+            CsvReader peek = reader;
+            double ignored;
+            csv_next_field(&peek, &field, &length);
+            if (input_parse_double(field, length, &ignored) == INPUT_CONVERSION_ERROR)
+                continue; // header row; csv_begin_row skips it
+        }
+        if (rows == INT_MAX)
+        {
+            snprintf(error_msg, sizeof(error_msg), "read_csv: '%s' has too many rows", path);
+            break;
+        }
+
+        for (c = 0; c < ncols; c++)
+        {
+            Variable *var = cols[c];
+            if (!csv_next_field(&reader, &field, &length))
+            {
+                snprintf(error_msg, sizeof(error_msg), "read_csv: line %zu has %d fields, expected at least %d",
+                         reader.row_line, c, ncols);
+                break;
+            }
+            if (var->is_vector && rows == var->capacity)
+            {
+                vector_reserve(var, var->capacity ? var->capacity * 2 : VECTOR_MIN_CAPACITY);
+            }
+            else if (!var->is_vector && rows == var->array_dimensions.total_size)
+            {
+                snprintf(error_msg, sizeof(error_msg), "read_csv: column %d of '%s' has more rows than its array holds",
+                         c + 1, path);
+                break;
+            }
+
+            input_status status = store_number(var, rows, field, length);
+            if (status == INPUT_CONVERSION_ERROR)
+            {
+                snprintf(error_msg, sizeof(error_msg), "read_csv: invalid number '%.*s' at line %zu, column %d",
+                         (int)(length < 32 ? length : 32), field, reader.row_line, c + 1);
+                break;
+            }
+            if (status != INPUT_SUCCESS)
+            {
+                snprintf(error_msg, sizeof(error_msg), "read_csv: value out of range at line %zu, column %d",
+                         reader.row_line, c + 1);
+                break;
+            }
+        }
+        rows++;
     }
-    case VAR_CHAR:
+    SAFE_FREE(text);
+    if (error_msg[0] != '\0')
     {
-        if (var->is_array)
+        SAFE_FREE(cols);
+        yyerror(error_msg);
+        interpreter_exit(EXIT_FAILURE);
+    }
+
+    for (c = 0; c < ncols; c++)
+    {
+        if (cols[c]->is_vector)
+            vector_set_length(cols[c], rows);
+    }
+    SAFE_FREE(cols);
+    current_return_value.has_value = true;
+    current_return_value.value.ivalue = (int)rows;
+}
+
+void execute_len_call(ArgumentList *args)
+{
+    if (!args || args->next)
+    {
+        yyerror("len expects 1 argument: len(arr)");
+        interpreter_exit(EXIT_FAILURE);
+    }
+    Variable *var = get_array_argument(args->expr, "len");
+    current_return_value.has_value = true;
+    current_return_value.value.ivalue = (int)var->array_dimensions.total_size;
+}
+
+/* Built-in functions, looked up by name before user-defined functions. */
+static const Builtin builtins[] = {
+    {"yapping", NONE, execute_yapping_call, NULL},
+    {"yappin", NONE, execute_yappin_call, NULL},
+    {"baka", NONE, execute_baka_call, NULL},
+    {"ragequit", NONE, execute_ragequit_call, NULL},
+    {"chill", NONE, execute_chill_call, NULL},
+    {"slorp", NONE, execute_slorp_call, NULL},
+    {"matmul", NONE, execute_matmul_call, NULL},
+    {"transpose", NONE, execute_transpose_call, NULL},
+    {"sort", NONE, execute_sort_call, NULL},
+    {"stable_sort", NONE, execute_stable_sort_call, NULL},
+    {"sort_range", NONE, execute_sort_range_call, NULL},
+    {"binary_search", VAR_INT, execute_binary_search_call, NULL},
+    {"unique", VAR_INT, execute_unique_call, NULL},
+    {"popcount", VAR_INT, execute_popcount_call, NULL},
+    {"find_next_set", VAR_INT, execute_find_next_set_call, NULL},
+    {"map_put", NONE, execute_map_put_call, NULL},
+    {"map_get", NONE, execute_map_get_call, get_map_get_type},
+    {"map_delete", VAR_BOOL, execute_map_delete_call, NULL},
+    {"map_contains", VAR_BOOL, execute_map_contains_call, NULL},
+    {"map_size", VAR_INT, execute_map_size_call, NULL},
+    {"send", NONE, execute_send_call, NULL},
+    {"recv", VAR_BOOL, execute_recv_call, NULL},
+    {"close", NONE, execute_close_call, NULL},
+    {"vload", NONE, execute_vector_only_call, NULL},
+    {"vselect", NONE, execute_vector_only_call, NULL},
+    {"vmin", NONE, execute_vector_only_call, NULL},
+    {"vmax", NONE, execute_vector_only_call, NULL},
+    {"vstore", NONE, execute_vstore_call, NULL},
+    {"hsum", NONE, execute_hsum_call, get_horizontal_type},
+    {"hmin", NONE, execute_hmin_call, get_horizontal_type},
+    {"hmax", NONE, execute_hmax_call, get_horizontal_type},
+    {"push", NONE, execute_push_call, NULL},
+    {"pop", NONE, execute_pop_call, get_pop_type},
+    {"reserve", NONE, execute_reserve_call, NULL},
+    {"clear", NONE, execute_clear_call, NULL},
+    {"len", VAR_INT, execute_len_call, NULL},
+    {"swap", NONE, execute_swap_call, NULL},
+    {"bind_file", VAR_INT, execute_bind_file_call, NULL},
+    {"bind_file_rw", VAR_INT, execute_bind_file_rw_call, NULL},
+    {"read_bin", VAR_INT, execute_read_bin_call, NULL},
+    {"write_bin", VAR_INT, execute_write_bin_call, NULL},
+    {"read_csv", VAR_INT, execute_read_csv_call, NULL},
+    {"sqrt", VAR_DOUBLE, execute_sqrt_call, NULL},
+    {"exp", VAR_DOUBLE, execute_exp_call, NULL},
+    {"log", VAR_DOUBLE, execute_log_call, NULL},
+    {"sin", VAR_DOUBLE, execute_sin_call, NULL},
+    {"cos", VAR_DOUBLE, execute_cos_call, NULL},
+    {"pow", VAR_DOUBLE, execute_pow_call, NULL},
+    {"floor", VAR_DOUBLE, execute_floor_call, NULL},
+    {"abs", VAR_DOUBLE, execute_abs_call, NULL},
+    {"sqrt_array", NONE, execute_sqrt_array_call, NULL},
+    {"exp_array", NONE, execute_exp_array_call, NULL},
+    {"log_array", NONE, execute_log_array_call, NULL},
+    {"sin_array", NONE, execute_sin_array_call, NULL},
+    {"cos_array", NONE, execute_cos_array_call, NULL},
+    {"pow_array", NONE, execute_pow_array_call, NULL},
+    {"floor_array", NONE, execute_floor_array_call, NULL},
+    {"abs_array", NONE, execute_abs_array_call, NULL},
+};
+
+const Builtin *get_builtin(const char *name)
+{
+    for (size_t i = 0; i < sizeof(builtins) / sizeof(builtins[0]); i++)
+    {
+        if (strcmp(builtins[i].name, name) == 0)
         {
-            char val[var->array_length];
-            slorp_string(val, sizeof(val));
-            strncpy(var->value.array_data, val, var->array_length - 1);
-            ((char *)var->value.array_data)[var->array_length - 1] = '\0';
-            return;
+            return &builtins[i];
         }
-        char val = 0;
-        val = slorp_char(val);
-        set_int_variable(name, val, var->modifiers);
-        break;
     }
-    default:
-        yyerror("Unsupported type for slorp");
+    return NULL;
+}
+
+VarType get_builtin_return_type(const Builtin *builtin, ArgumentList *args)
+{
+    if (builtin->resolve_type != NULL)
+    {
+        return builtin->resolve_type(args);
     }
+    return builtin->return_type;
+}
+
+/*
+ * Builtins report their result through current_return_value, the same
+ * channel user functions use. The caller's value is saved around the call so
+ * a builtin used inside a `bussin` expression does not clobber the return
+ * type of the enclosing function.
+ */
+ReturnValue call_builtin(const Builtin *builtin, ArgumentList *args)
+{
+    ReturnValue saved = current_return_value;
+    current_return_value.has_value = false;
+    current_return_value.type = get_builtin_return_type(builtin, args);
+
+    builtin->execute(args);
+
+    ReturnValue result = current_return_value;
+    current_return_value = saved;
+    return result;
 }
 
 void bruh()
@@ -3085,7 +7523,7 @@ ASTNode *create_default_node(VarType var_type)
         return create_boolean_node(0);
     default:
         yyerror("Unsupported type for default node");
-        exit(1);
+        interpreter_exit(1);
     }
 }
 
@@ -3096,7 +7534,7 @@ ExpressionList *create_expression_list(ASTNode *expr)
     if (!list)
     {
         yyerror("Failed to allocate memory for expression list");
-        exit(1);
+        interpreter_exit(1);
     }
     list->expr = expr;
     list->next = list;
@@ -3110,7 +7548,7 @@ ExpressionList *append_expression_list(ExpressionList *list, ASTNode *expr)
     if (!new_node)
     {
         yyerror("Failed to allocate memory for expression list");
-        exit(1);
+        interpreter_exit(1);
     }
     new_node->expr = expr;
 
@@ -3203,8 +7641,12 @@ void populate_multi_array_variable(char *name, ExpressionList *list, int dimensi
                 break;
             }
             case VAR_BOOL: {
-                bool *array = (bool*)var->value.array_data;
-                array[index] = evaluate_expression_bool(current->expr);
+                bitset_set(var->value.array_data, index, evaluate_expression_bool(current->expr));
+                break;
+            }
+            case VAR_CHAR: {
+                char *array = (char*)var->value.array_data;
+                array[index] = evaluate_expression_int(current->expr);
                 break;
             }
             default:
@@ -3234,7 +7676,7 @@ void free_statement_list(StatementList *list)
 
 void free_ast()
 {
-    arena_free(&arena);
+    arena_free(&current_interpreter->arena);
 }
 
 Scope *create_scope(Scope *parent)
@@ -3244,7 +7686,7 @@ Scope *create_scope(Scope *parent)
     {
         yyerror("Failed to allocate memory for scope");
         SAFE_FREE(scope);
-        exit(1);
+        interpreter_exit(1);
     }
     scope->variables = hm_new();
     scope->parent = parent;
@@ -3275,8 +7717,14 @@ void exit_scope()
     if (!current_scope)
     {
         yyerror("No scope to exit");
-        exit(1);
+        interpreter_exit(1);
     }
+    // Spawned calls finish with this scope's variables before it goes away
+    if (current_scope->spawn_pins > 0)
+    {
+        execute_sync();
+    }
+
     Scope *parent = current_scope->parent;
     hm_free(current_scope->variables);
     SAFE_FREE(current_scope);
@@ -3301,10 +7749,16 @@ Variable *variable_new(char *name)
     if (!var)
     {
         yyerror("Failed to allocate memory for variable");
-        exit(1);
+        interpreter_exit(1);
     }
     var->name = name;
     var->is_array = false;
+    var->is_vector = false;
+    var->is_map = false;
+    var->struct_def = NULL;
+    var->is_view = false;
+    var->stride = 0;
+    var->stride_span = 0;
     return var;
 }
 
@@ -3313,14 +7767,14 @@ void add_variable_to_scope(const char *name, Variable *var)
     if (!current_scope)
     {
         yyerror("No scope to add variable to");
-        exit(1);
+        interpreter_exit(1);
     }
     Variable *existing = hm_get(current_scope->variables, name, strlen(name));
     if (existing)
     {
         yyerror("Variable already exists in current scope");
         SAFE_FREE(var);
-        exit(1);
+        interpreter_exit(1);
     }
 
     hm_put(current_scope->variables, name, strlen(name), var, sizeof(Variable));
@@ -3352,40 +7806,66 @@ Function *create_function(char *name, VarType return_type, Parameter *params, AS
     func->return_type = return_type;
     func->parameters = params;
     func->body = body;
-    func->next = function_table;
-    function_table = func;
+    func->next = current_interpreter->functions;
+    current_interpreter->functions = func;
 
     return func;
 }
 
-void execute_function_call(const char *name, ArgumentList *args)
+static int evaluate_arguments(Function *func, ArgumentList *args, Value *values, Variable **arrays);
+static void bind_arguments(Function *func, const Value *values, Variable *const *arrays, int count);
+
+/*
+ * Runs a user function on arguments that are already evaluated; a negative
+ * count runs it unbound, as after a mismatched call. bussin and a stray
+ * bruh both land on this call's jump buffer, and the scopes the body left
+ * open are closed here, after the calls it spawned are synced.
+ */
+static void run_function(Function *func, const Value *values, Variable *const *arrays, int count)
 {
-    // Find function in function table
-    Function *func = function_table;
-    while (func)
-    {
-        if (strcmp(func->name, name) == 0)
-        {
-            // Create new scope for function
-            enter_function_scope(func, args);
-            current_return_value.type = func->return_type;
+    Scope *caller_scope = current_scope;
+    SpawnFrame *caller_frame = spawn_frame;
+    spawn_frame = NULL;
 
+    if (count >= 0)
+        bind_arguments(func, values, arrays, count);
+    current_return_value.type = func->return_type;
 
-            // Set up return handling
-            current_return_value.has_value = false;
-            PUSH_JUMP_BUFFER();
-            if (setjmp(CURRENT_JUMP_BUFFER()) == 0)
-            {
-                execute_statement(func->body);
-            }
+    // Set up return handling
+    current_return_value.has_value = false;
+    PUSH_JUMP_BUFFER();
+    jump_buffer->is_function = true;
+    if (setjmp(CURRENT_JUMP_BUFFER()) == 0)
+    {
+        execute_statement(func->body);
+    }
+    POP_JUMP_BUFFER();
 
-            POP_JUMP_BUFFER();
-            return;
-        }
-        func = func->next;
+    execute_sync();
+    if (spawn_frame != NULL)
+    {
+        SAFE_FREE(spawn_frame->pinned);
+        SAFE_FREE(spawn_frame->pinned_arrays);
+        SAFE_FREE(spawn_frame);
+    }
+    spawn_frame = caller_frame;
+    while (current_scope != caller_scope)
+        exit_scope();
+}
+
+void execute_function_call(const char *name, ArgumentList *args)
+{
+    Function *func = get_function(name);
+    if (func == NULL)
+    {
+        yyerror("Undefined function");
+        return;
     }
 
-    yyerror("Undefined function");
+    Value arg_values[MAX_ARGUMENTS];
+    Variable *arg_arrays[MAX_ARGUMENTS];
+    int arg_count = evaluate_arguments(func, args, arg_values, arg_arrays);
+    run_function(func, arg_values, arg_arrays, arg_count);
 }
 
 void handle_return_statement(ASTNode *expr)
@@ -3412,9 +7892,21 @@ void handle_return_statement(ASTNode *expr)
             break;
         default:
             yyerror("Unsupported return type");
-            exit(1);
+            interpreter_exit(1);
         }
     }
+    // Inside a function, jump straight to the call, dropping the buffers of
+    // any loops in between; the call closes the scopes
+    JumpBuffer *call = jump_buffer;
+    while (call && !call->is_function)
+        call = call->next;
+    if (call)
+    {
+        while (jump_buffer != call)
+            POP_JUMP_BUFFER();
+        LONGJMP();
+    }
+
     // Clean up all scopes until we reach the function scope
     while (current_scope && !current_scope->is_function_scope)
     {
@@ -3441,12 +7933,97 @@ Parameter *create_parameter(char *name, VarType type, Parameter *next, TypeModif
     param->type = type;
     param->next = next;
     param->modifiers = mods;
+    param->is_array = false;
+    param->num_dimensions = 0;
+    param->is_channel = false;
+    param->is_single = false;
+
+    return param;
+}
+
+Parameter *create_channel_parameter(char *name, VarType type, bool single, Parameter *next, TypeModifiers mods)
+{
+    Parameter *param = create_parameter(name, type, next, mods);
+    if (param)
+    {
+        param->is_channel = true;
+        param->is_single = single;
+    }
+    return param;
+}
 
+Parameter *create_array_parameter(char *name, VarType type, int num_dimensions, Parameter *next, TypeModifiers mods)
+{
+    Parameter *param = create_parameter(name, type, next, mods);
+    if (param)
+    {
+        param->is_array = true;
+        param->num_dimensions = num_dimensions;
+    }
     return param;
 }
 
+// Look up the caller's array for an array parameter and check it fits
+static Variable *resolve_array_parameter(Parameter *param, ASTNode *expr)
+{
+    char error_msg[160];
+    Variable *var = expr && expr->type == NODE_IDENTIFIER ? get_variable(expr->data.name) : NULL;
+    if (var == NULL || !var->is_array)
+    {
+        snprintf(error_msg, sizeof(error_msg), "Parameter '%s' expects an array name as argument", param->name);
+        yyerror(error_msg);
+        interpreter_exit(EXIT_FAILURE);
+    }
+    if (var->var_type != param->type || var->array_dimensions.num_dimensions != param->num_dimensions)
+    {
+        snprintf(error_msg, sizeof(error_msg), "Array '%s' does not match the type or rank of parameter '%s'",
+                 expr->data.name, param->name);
+        yyerror(error_msg);
+        interpreter_exit(EXIT_FAILURE);
+    }
+    return var;
+}
+
+// Look up the caller's channel for a channel parameter and check it fits
+static Variable *resolve_channel_parameter(Parameter *param, ASTNode *expr)
+{
+    char error_msg[160];
+    Variable *var = expr && expr->type == NODE_IDENTIFIER ? get_variable(expr->data.name) : NULL;
+    if (var == NULL || !var->is_channel)
+    {
+        snprintf(error_msg, sizeof(error_msg), "Parameter '%s' expects a channel name as argument", param->name);
+        yyerror(error_msg);
+        interpreter_exit(EXIT_FAILURE);
+    }
+    if (var->var_type != param->type || chan_is_single(var->value.channel_data) != param->is_single)
+    {
+        snprintf(error_msg, sizeof(error_msg), "Channel '%s' does not match the type or kind of parameter '%s'",
+                 expr->data.name, param->name);
+        yyerror(error_msg);
+        interpreter_exit(EXIT_FAILURE);
+    }
+    return var;
+}
+
+void reverse_parameter_list(Parameter **head)
+{
+    Parameter *prev = NULL, *current = *head, *next = NULL;
+    while (current)
+    {
+        next = current->next;
+        current->next = prev;
+        prev = current;
+        current = next;
+    }
+    *head = prev;
+}
+
 ASTNode *create_function_def_node(char *name, VarType return_type, Parameter *params, ASTNode *body)
 {
+    // The grammar builds parameter lists back to front. Put them in order
+    // once here so calls never modify the shared list.
+    reverse_parameter_list(&params);
+
     ASTNode *node = ARENA_ALLOC(ASTNode);
     if (!node)
     {
@@ -3469,7 +8046,7 @@ ASTNode *create_function_def_node(char *name, VarType return_type, Parameter *pa
 
 void free_function_table(void)
 {
-    Function *f = function_table;
+    Function *f = current_interpreter->functions;
     while (f)
     {
         Function *next = f->next;
@@ -3484,35 +8061,30 @@ void free_function_table(void)
         SAFE_FREE(f);
         f = next;
     }
-    function_table = NULL;
-}
-
-void reverse_parameter_list(Parameter **head)
-{
-    Parameter *prev = NULL, *current = *head, *next = NULL;
-    while (current)
-    {
-        next = current->next;
-        current->next = prev;
-        prev = current;
-        current = next;
-    }
-    *head = prev;
+    current_interpreter->functions = NULL;
 }
 
-void enter_function_scope(Function *func, ArgumentList *args)
+// Evaluates call arguments in the caller's scope. Returns how many there
+// are, or -1 if they do not match the parameters.
+static int evaluate_arguments(Function *func, ArgumentList *args, Value *arg_values, Variable **arg_arrays)
 {
     ArgumentList *curr_arg = args;
-    Value arg_values[MAX_ARGUMENTS];
     int arg_count = 0;
 
-    // Reverse the parameter list
-    reverse_parameter_list(&func->parameters);
     Parameter *curr_param = func->parameters;
 
-    // Evaluate argument values before creating the scope
     while (curr_arg && curr_param)
     {
+        if (curr_param->is_array || curr_param->is_channel)
+        {
+            arg_arrays[arg_count] = curr_param->is_channel ? resolve_channel_parameter(curr_param, curr_arg->expr)
+                                                           : resolve_array_parameter(curr_param, curr_arg->expr);
+            curr_arg = curr_arg->next;
+            curr_param = curr_param->next;
+            arg_count++;
+            continue;
+        }
+
         switch (curr_param->type)
         {
         case VAR_INT:
@@ -3543,15 +8115,19 @@ void enter_function_scope(Function *func, ArgumentList *args)
     if (curr_arg || curr_param)
     {
         yyerror("Mismatched number of arguments and parameters");
-        return;
+        return -1;
     }
+    return arg_count;
+}
 
-    // Create function scope after evaluating arguments
+// Opens the function scope and binds evaluated arguments to the parameters
+static void bind_arguments(Function *func, const Value *arg_values, Variable *const *arg_arrays, int arg_count)
+{
     Scope *scope = create_scope(current_scope);
     current_scope = scope;
     current_scope->is_function_scope = true;
 
-    curr_param = func->parameters; // Reset parameter list after reversing
+    Parameter *curr_param = func->parameters;
 
     // Assign evaluated values to function parameters
     for (int i = 0; i < arg_count; i++)
@@ -3559,6 +8135,40 @@ void enter_function_scope(Function *func, ArgumentList *args)
         Variable *var = variable_new(curr_param->name);
         var->var_type = curr_param->type;
         TypeModifiers mods = curr_param->modifiers;
+
+        if (curr_param->is_channel)
+        {
+            var->is_channel = true;
+            var->is_view = true;
+            var->modifiers = mods;
+            var->value.channel_data = arg_arrays[i]->value.channel_data;
+            add_variable_to_scope(curr_param->name, var);
+            SAFE_FREE(var);
+            curr_param = curr_param->next;
+            continue;
+        }
+
+        if (curr_param->is_array)
+        {
+            // Arrays are passed by reference: the parameter shares the
+            // caller's storage and dimensions instead of copying them.
+            Variable *caller = arg_arrays[i];
+            var->is_array = true;
+            var->is_view = true;
+            var->modifiers = mods;
+            // A deadass or read-only mapped array stays read-only through the view
+            var->modifiers.is_const |= caller->modifiers.is_const;
+            var->value.array_data = caller->value.array_data;
+            var->array_dimensions = caller->array_dimensions;
+            var->array_length = caller->array_length;
+            var->stride = caller->stride;
+            var->stride_span = caller->stride_span;
+            add_variable_to_scope(curr_param->name, var);
+            SAFE_FREE(var);
+            curr_param = curr_param->next;
+            continue;
+        }
+
         add_variable_to_scope(curr_param->name, var);
         SAFE_FREE(var);
 
@@ -3585,6 +8195,525 @@ void enter_function_scope(Function *func, ArgumentList *args)
         }
         curr_param = curr_param->next;
     }
-    reverse_parameter_list(&func->parameters);
 }
 
+void enter_function_scope(Function *func, ArgumentList *args)
+{
+    Value arg_values[MAX_ARGUMENTS];
+    Variable *arg_arrays[MAX_ARGUMENTS];
+    int arg_count = evaluate_arguments(func, args, arg_values, arg_arrays);
+    if (arg_count >= 0)
+        bind_arguments(func, arg_values, arg_arrays, arg_count);
+}
+
+ASTNode *create_spawn_node(ASTNode *declaration, ASTNode *target, ASTNode *call)
+{
+    if (get_builtin(call->data.func_call.function_name) != NULL)
+    {
+        char error_msg[160];
+        snprintf(error_msg, sizeof(error_msg), "spawn needs a user function, but '%s' is built in",
+                 call->data.func_call.function_name);
+        yyerror(error_msg);
+        interpreter_exit(EXIT_FAILURE);
+    }
+
+    ASTNode *node = create_node(NODE_SPAWN, NONE, current_interpreter->modifiers);
+    node->data.spawn.declaration = declaration;
+    node->data.spawn.target = target;
+    node->data.spawn.call = call;
+    return node;
+}
+
+ASTNode *create_sync_node(void)
+{
+    return create_node(NODE_SYNC, NONE, current_interpreter->modifiers);
+}
+
+// The scope that holds name, searched the way get_variable does
+static Scope *find_variable_scope(const char *name)
+{
+    for (Scope *scope = current_scope; scope; scope = scope->parent)
+    {
+        if (hm_get(scope->variables, name, strlen(name)))
+            return scope;
+        if (scope->is_function_scope)
+            break;
+    }
+    return NULL;
+}
+
+/*
+ * Checks where a spawned call's result will go and remembers it in the
+ * task. Returns the array for an element target, which must stay put
+ * until the result is delivered, or NULL.
+ */
+static Variable *resolve_spawn_target(SpawnTask *task, ASTNode *target)
+{
+    char error_msg[160];
+    bool element = target->type == NODE_ARRAY_ACCESS;
+    const char *name = element ? target->data.array.name : target->data.name;
+
+    check_const_assignment(name);
+    Variable *var = get_variable(name);
+    if (var == NULL)
+    {
+        snprintf(error_msg, sizeof(error_msg), "spawn stores into undeclared variable '%s'", name);
+        yyerror(error_msg);
+        interpreter_exit(EXIT_FAILURE);
+    }
+    if (element ? var->is_array && var->var_type == VAR_BOOL && !var->stride
+                : var->is_array || var->is_map || var->struct_def != NULL)
+    {
+        snprintf(error_msg, sizeof(error_msg), "spawn cannot store into '%s'; use a scalar or an array element", name);
+        yyerror(error_msg);
+        interpreter_exit(EXIT_FAILURE);
+    }
+
+    task->scope = find_variable_scope(name);
+    if (element)
+    {
+        task->element = evaluate_multi_array_access(target);
+        task->element_type = var->var_type;
+        return var;
+    }
+    task->name = name;
+    return NULL;
+}
+
+// Makes the scope sync before it closes, since a pending call uses it
+static void pin_scope(Scope *scope)
+{
+    if (scope == NULL || scope->spawn_pins++ > 0)
+        return;
+    SpawnFrame *frame = spawn_frame;
+    if (frame->num_pinned == frame->pinned_capacity)
+    {
+        frame->pinned_capacity = frame->pinned_capacity ? frame->pinned_capacity * 2 : 8;
+        frame->pinned = safe_realloc(frame->pinned, frame->pinned_capacity * sizeof(Scope *));
+    }
+    frame->pinned[frame->num_pinned++] = scope;
+}
+
+// Keeps the array's storage where it is until the frame syncs
+static void pin_array(Variable *var)
+{
+    if (var->spawn_pins++ > 0)
+        return;
+    SpawnFrame *frame = spawn_frame;
+    if (frame->num_pinned_arrays == frame->pinned_arrays_capacity)
+    {
+        frame->pinned_arrays_capacity = frame->pinned_arrays_capacity ? frame->pinned_arrays_capacity * 2 : 8;
+        frame->pinned_arrays =
+            safe_realloc(frame->pinned_arrays, frame->pinned_arrays_capacity * sizeof(Variable *));
+    }
+    frame->pinned_arrays[frame->num_pinned_arrays++] = var;
+}
+
+static void call_spawned(void *ctx, size_t index)
+{
+    (void)index;
+    SpawnTask *task = ctx;
+    run_function(task->func, task->values, task->arrays, task->count);
+    task->result = current_return_value;
+}
+
+static void run_spawned_task(void *ctx, size_t index)
+{
+    SpawnTask *task = ctx;
+    Interpreter *interpreter = task->interpreter;
+
+    Interpreter *saved_interpreter = bind_interpreter(interpreter);
+    Scope *saved_scope = current_scope;
+    JumpBuffer *saved_jump = jump_buffer;
+    ReturnValue saved_return = current_return_value;
+    FILE *saved_stream = yap_stream;
+
+    current_scope = NULL;
+    jump_buffer = NULL;
+    yap_stream = task->stream;
+    // Calls still queued when the program fails are skipped
+    if (!atomic_load(&interpreter->failed))
+        run_guarded(call_spawned, task, index);
+
+    bind_interpreter(saved_interpreter);
+    current_scope = saved_scope;
+    jump_buffer = saved_jump;
+    current_return_value = saved_return;
+    yap_stream = saved_stream;
+    atomic_fetch_sub_explicit(&interpreter->tasks.pending, 1, memory_order_release);
+}
+
+void execute_spawn(ASTNode *node)
+{
+    if (node->data.spawn.declaration)
+        execute_statement(node->data.spawn.declaration);
+
+    ASTNode *call = node->data.spawn.call;
+    Function *func = get_function(call->data.func_call.function_name);
+    if (func == NULL)
+    {
+        yyerror("Undefined function");
+        interpreter_exit(EXIT_FAILURE);
+    }
+
+    Value arg_values[MAX_ARGUMENTS];
+    Variable *arg_arrays[MAX_ARGUMENTS];
+    int arg_count = evaluate_arguments(func, call->data.func_call.arguments, arg_values, arg_arrays);
+    if (arg_count < 0)
+        interpreter_exit(EXIT_FAILURE);
+
+    SpawnTask *task = SAFE_MALLOC(SpawnTask);
+    task->interpreter = current_interpreter;
+    task->func = func;
+    task->count = arg_count;
+    task->stream = yap_stream;
+    if (arg_count > 0)
+    {
+        // The caller's views may be gone by the time the task runs
+        task->values = safe_malloc_array(arg_count, sizeof(Value));
+        task->arrays = safe_malloc_array(arg_count, sizeof(Variable *));
+        task->array_storage = safe_malloc_array(arg_count, sizeof(Variable));
+        memcpy(task->values, arg_values, arg_count * sizeof(Value));
+    }
+    Variable *target_array = node->data.spawn.target ? resolve_spawn_target(task, node->data.spawn.target) : NULL;
+
+    if (spawn_frame == NULL)
+    {
+        spawn_frame = SAFE_MALLOC(SpawnFrame);
+        pool_group_init(&spawn_frame->group);
+    }
+    pin_scope(task->scope);
+    if (target_array != NULL)
+        pin_array(target_array);
+
+    Parameter *param = func->parameters;
+    ArgumentList *arg = call->data.func_call.arguments;
+    for (int i = 0; i < arg_count; i++, param = param->next, arg = arg->next)
+    {
+        if (param->is_array || param->is_channel)
+        {
+            task->array_storage[i] = *arg_arrays[i];
+            task->arrays[i] = &task->array_storage[i];
+            pin_scope(find_variable_scope(arg->expr->data.name));
+            if (param->is_array)
+                pin_array(arg_arrays[i]);
+        }
+    }
+    if (spawn_frame->last)
+        spawn_frame->last->next = task;
+    else
+        spawn_frame->first = task;
+    spawn_frame->last = task;
+
+    atomic_fetch_add_explicit(&current_interpreter->tasks.pending, 1, memory_order_relaxed);
+    pool_spawn(&spawn_frame->group, run_spawned_task, task, 0);
+}
+
+static void deliver_spawn_result(SpawnTask *task)
+{
+    double value = return_value_as_double(task->result);
+    if (task->name != NULL)
+    {
+        store_scalar(hm_get(task->scope->variables, task->name, strlen(task->name)), value);
+        return;
+    }
+
+    void *dest = task->element;
+    if (dest == NULL)
+        return;
+    switch (task->element_type)
+    {
+    case VAR_INT:
+        *(int *)dest = (int)value;
+        break;
+    case VAR_SHORT:
+        *(short *)dest = (short)value;
+        break;
+    case VAR_FLOAT:
+        *(float *)dest = (float)value;
+        break;
+    case VAR_DOUBLE:
+        *(double *)dest = value;
+        break;
+    case VAR_BOOL:
+        *(bool *)dest = value != 0;
+        break;
+    case VAR_CHAR:
+        *(char *)dest = (char)value;
+        break;
+    case NONE:
+        break;
+    }
+}
+
+// Waits for the calls this function spawned and stores their results in
+// spawn order
+void execute_sync(void)
+{
+    SpawnFrame *frame = spawn_frame;
+    if (frame == NULL || frame->first == NULL)
+        return;
+
+    pool_wait(&frame->group);
+    for (size_t i = 0; i < frame->num_pinned; i++)
+        frame->pinned[i]->spawn_pins = 0;
+    frame->num_pinned = 0;
+    for (size_t i = 0; i < frame->num_pinned_arrays; i++)
+        frame->pinned_arrays[i]->spawn_pins = 0;
+    frame->num_pinned_arrays = 0;
+
+    SpawnTask *task = frame->first;
+    frame->first = frame->last = NULL;
+    while (task)
+    {
+        SpawnTask *next = task->next;
+        deliver_spawn_result(task);
+        SAFE_FREE(task->values);
+        SAFE_FREE(task->arrays);
+        SAFE_FREE(task->array_storage);
+        SAFE_FREE(task);
+        task = next;
+    }
+
+    // A call that failed ends the program here, where it is joined
+    if (atomic_load(&current_interpreter->failed))
+        interpreter_exit(current_interpreter->status);
+}
+
+
+// Returns NULL if out of memory
+Interpreter *interpreter_new(void)
+{
+    Interpreter *interpreter = SAFE_MALLOC(Interpreter);
+    if (interpreter == NULL)
+        return NULL;
+    // Not create_scope: with no run or parse to unwind to, it would exit
+    interpreter->globals = SAFE_MALLOC(Scope);
+    HashMap *variables = interpreter->globals ? hm_new() : NULL;
+    if (variables == NULL)
+    {
+        SAFE_FREE(interpreter->globals);
+        SAFE_FREE(interpreter);
+        return NULL;
+    }
+    interpreter->globals->variables = variables;
+    pool_group_init(&interpreter->tasks);
+    atomic_init(&interpreter->failed, false);
+    pthread_mutex_init(&interpreter->io_lock, NULL);
+    return interpreter;
+}
+
+/*
+ * Parses source into the interpreter. Functions and gang types are defined
+ * while parsing; variables of every kind are only created when their
+ * declaration runs. Returns false on a syntax error, or if an error stopped
+ * the parse, in which case the status is set.
+ */
+bool interpreter_parse(Interpreter *interpreter, FILE *source)
+{
+    pthread_mutex_lock(&parse_lock);
+    Interpreter *saved_interpreter = bind_interpreter(interpreter);
+    Scope *saved_scope = current_scope;
+    jmp_buf *saved_exit = exit_point;
+    jmp_buf here;
+
+    current_scope = interpreter->globals;
+    exit_point = &here;
+    yyin = source;
+    yylineno = 1;
+    current_var_type = NONE;
+
+    volatile bool ok = false;
+    if (setjmp(here) == 0)
+        ok = yyparse() == 0;
+
+    interpreter->lineno = yylineno;
+    interpreter->parsed = true;
+    yylex_destroy();
+
+    bind_interpreter(saved_interpreter);
+    current_scope = saved_scope;
+    exit_point = saved_exit;
+    pthread_mutex_unlock(&parse_lock);
+    return ok && !atomic_load(&interpreter->failed);
+}
+
+// Frees a frame whose calls have all finished, delivered or not
+static void free_spawn_frame(SpawnFrame *frame)
+{
+    SpawnTask *task = frame->first;
+    while (task)
+    {
+        SpawnTask *next = task->next;
+        SAFE_FREE(task->values);
+        SAFE_FREE(task->arrays);
+        SAFE_FREE(task->array_storage);
+        SAFE_FREE(task);
+        task = next;
+    }
+    SAFE_FREE(frame->pinned);
+    SAFE_FREE(frame->pinned_arrays);
+    SAFE_FREE(frame);
+}
+
+/*
+ * Runs a parsed program on the calling thread and returns its exit status:
+ * 0, the code given to ragequit, or 1 after an error. When it fails, the
+ * calls it spawned are waited for before the scopes it left open are freed.
+ */
+int interpreter_run(Interpreter *interpreter)
+{
+    Interpreter *saved_interpreter = bind_interpreter(interpreter);
+    Scope *saved_scope = current_scope;
+    JumpBuffer *saved_jump = jump_buffer;
+    SpawnFrame *saved_frame = spawn_frame;
+    jmp_buf *saved_exit = exit_point;
+    ReturnValue saved_return = current_return_value;
+    FILE *saved_stream = yap_stream;
+    jmp_buf here;
+
+    // A thread may have run other programs before; start from clean state
+    current_scope = interpreter->globals;
+    jump_buffer = NULL;
+    spawn_frame = NULL;
+    current_return_value = (ReturnValue){0};
+    yap_stream = NULL;
+    exit_point = &here;
+    if (setjmp(here) == 0)
+    {
+        execute_statement(interpreter->root);
+        execute_sync();
+    }
+    else
+    {
+        pool_wait(&interpreter->tasks);
+        while (current_scope != NULL && current_scope != interpreter->globals)
+        {
+            Scope *parent = current_scope->parent;
+            hm_free(current_scope->variables);
+            SAFE_FREE(current_scope);
+            current_scope = parent;
+        }
+        CLEAN_JUMP_BUFFER();
+    }
+    // A bussin at the top level closes the global scope itself
+    interpreter->globals = current_scope;
+    if (spawn_frame != NULL)
+        free_spawn_frame(spawn_frame);
+
+    bind_interpreter(saved_interpreter);
+    current_scope = saved_scope;
+    jump_buffer = saved_jump;
+    spawn_frame = saved_frame;
+    exit_point = saved_exit;
+    current_return_value = saved_return;
+    yap_stream = saved_stream;
+    return interpreter->status;
+}
+
+void interpreter_free(Interpreter *interpreter)
+{
+    if (!interpreter)
+        return;
+    Interpreter *saved_interpreter = bind_interpreter(interpreter);
+    free_function_table();
+    free_scope(interpreter->globals);
+    free_ast();
+    bind_interpreter(saved_interpreter);
+    input_source_free(interpreter->input);
+    pthread_mutex_destroy(&interpreter->io_lock);
+    SAFE_FREE(interpreter);
+}
+
+static _Noreturn void end_program(int status, bool quit)
+{
+    Interpreter *interpreter = current_interpreter;
+    if (exit_point == NULL || interpreter == NULL)
+        exit(status);
+    if (!atomic_exchange(&interpreter->failed, true))
+    {
+        interpreter->status = status;
+        interpreter->quit = quit;
+    }
+    longjmp(*exit_point, 1);
+}
+
+/*
+ * Ends the running program with the given status. Errors come here: it
+ * unwinds to the run, parse, squad slice or spawned call on this thread,
+ * and the first status recorded is the one the program exits with.
+ * Outside any of those it exits the process, as it always did.
+ */
+void interpreter_exit(int status)
+{
+    end_program(status, false);
+}
+
+// Ends the program the same way for ragequit
+void interpreter_quit(int status)
+{
+    end_program(status, true);
+}
+
+static void sink_write(const OutputSink *sink, FILE *fallback, const char *data, size_t len)
+{
+    if (sink == NULL || sink->write == NULL)
+    {
+        fwrite(data, 1, len, fallback);
+        return;
+    }
+    // Spawned calls may write from several threads at once
+    pthread_mutex_lock(&current_interpreter->io_lock);
+    sink->write(sink->ctx, data, len);
+    pthread_mutex_unlock(&current_interpreter->io_lock);
+}
+
+static void sink_vprintf(const OutputSink *sink, FILE *fallback, const char *format, va_list args)
+{
+    if (sink == NULL || sink->write == NULL)
+    {
+        vfprintf(fallback, format, args);
+        return;
+    }
+    char small[256];
+    va_list copy;
+    va_copy(copy, args);
+    int n = vsnprintf(small, sizeof(small), format, copy);
+    va_end(copy);
+    if (n < 0)
+        return;
+    char *text = small;
+    if ((size_t)n >= sizeof(small))
+    {
+        text = safe_malloc((size_t)n + 1);
+        if (text == NULL)
+            return;
+        vsnprintf(text, (size_t)n + 1, format, args);
+    }
+    sink_write(sink, fallback, text, (size_t)n);
+    if (text != small)
+        SAFE_FREE(text);
+}
+
+/* yapping goes to the squad slice's buffer while one runs, and otherwise
+ * to the program's output */
+void yap_write(const char *data, size_t len)
+{
+    if (yap_stream)
+        fwrite(data, 1, len, yap_stream);
+    else
+        sink_write(current_interpreter ? &current_interpreter->output : NULL, stdout, data, len);
+}
+
+void yap_vprintf(const char *format, va_list args)
+{
+    if (yap_stream)
+        vfprintf(yap_stream, format, args);
+    else
+        sink_vprintf(current_interpreter ? &current_interpreter->output : NULL, stdout, format, args);
+}
+
+void baka_vprintf(const char *format, va_list args)
+{
+    sink_vprintf(current_interpreter ? &current_interpreter->errors : NULL, stderr, format, args);
+}
@@ -6,7 +6,11 @@
 #include "lib/hm.h"
 #include "lib/arena.h"
 #include "lib/mem.h"
+#include "lib/pool.h"
+#include "lib/input.h"
 #include <stdio.h>
+#include <stdarg.h>
+#include <pthread.h>
 #include <stdlib.h>
 #include <stdbool.h>
 #include <string.h>
@@ -15,6 +19,9 @@
 #define MAX_VARS 100
 #define MAX_ARGUMENTS 100
 #define MAX_DIMENSIONS 10
+#define VECTOR_MIN_CAPACITY 8
+#define SQUAD_MAX_CHUNKS 256 // squad flex splits its iterations into at most this many slices
+#define AUTO_PARALLEL_MIN_ITERATIONS 2048 // plain flex loops shorter than this stay serial
 
 /* Forward declarations */
 typedef struct ASTNode ASTNode;
@@ -44,6 +51,7 @@ typedef struct
 typedef struct JumpBuffer
 {
     jmp_buf data;
+    bool is_function; // pushed by a function call; bussin unwinds to it
     struct JumpBuffer *next;
 } JumpBuffer;
 
@@ -70,6 +78,10 @@ typedef struct Parameter
     char *name;
     VarType type;
     TypeModifiers modifiers;
+    bool is_array;      // passed by reference to the caller's array
+    int num_dimensions; // array parameters only: rank the argument must have
+    bool is_channel;    // passed by reference to the caller's channel...
+    bool is_single;     // ...which must be a dm rather than a gc
     struct Parameter *next;
 } Parameter;
 
@@ -82,6 +94,26 @@ typedef struct Function
     struct Function *next;
 } Function;
 
+/* gang (struct) definitions */
+typedef struct StructField
+{
+    char *name;
+    VarType type;
+    ArrayDimensions dims; // num_dimensions is 0 for scalar fields
+    size_t size;          // bytes of one field value
+    size_t offset;        // byte offset inside an interleaved record
+    struct StructField *next;
+} StructField;
+
+typedef struct StructDef
+{
+    char *name;
+    StructField *fields;
+    size_t size;      // bytes of one interleaved record, including padding
+    size_t data_size; // sum of the field sizes
+    struct StructDef *next;
+} StructDef;
+
 typedef struct
 {
     bool has_value;
@@ -96,6 +128,16 @@ typedef struct
     VarType type;
 } ReturnValue;
 
+typedef struct
+{
+    const char *name;
+    VarType return_type;
+    void (*execute)(ArgumentList *args);
+    // Optional: works out the return type from the arguments, for builtins
+    // whose result type depends on what they are called with.
+    VarType (*resolve_type)(ArgumentList *args);
+} Builtin;
+
 /* Symbol table structure */
 typedef struct
 {
@@ -108,12 +150,25 @@ typedef struct
         float fvalue;
         double dvalue;
         void *array_data;
+        struct HashMap *map_data;
+        struct Channel *channel_data;
     } value;
     TypeModifiers modifiers;
-    VarType var_type;
+    VarType var_type; // element type for arrays, value type for maps
     bool is_array;
+    bool is_vector; // growable 1D array; array_length is the current length
+    size_t capacity; // vectors only: elements allocated
+    bool is_map;
+    bool is_channel; // dm or gc; var_type is the message type
+    bool is_simd;    // chad4, gigachad4 or rizz8: a 1D array of lanes
+    VarType key_type; // lore maps only: VAR_INT or VAR_CHAR
+    StructDef *struct_def; // gang variables only: the record type
+    bool is_view;         // array_data is owned by another variable
+    size_t stride;        // interleaved gang fields: bytes from one record to the next
+    size_t stride_span;   // ...and elements of the field inside each record
     int array_length; // lets keep it for now for backword compatibility
     ArrayDimensions array_dimensions;
+    int spawn_pins; // pending spawned calls that use the array's storage
 } Variable;
 
 typedef union
@@ -184,8 +239,39 @@ typedef enum
     NODE_FUNC_CALL,
     NODE_FUNCTION_DEF,
     NODE_RETURN,
+    NODE_MAP_DECLARATION,
+    NODE_VECTOR_DECLARATION,
+    NODE_STRUCT_DECLARATION,
+    NODE_ARRAY_DECLARATION,
+    NODE_PARALLEL_FOR,
+    NODE_SPAWN,
+    NODE_SYNC,
+    NODE_CHANNEL_DECLARATION,
+    NODE_SIMD_DECLARATION,
 } NodeType;
 
+typedef enum
+{
+    REDUCE_SUM,
+    REDUCE_MIN,
+    REDUCE_MAX,
+    REDUCE_LAST, // keeps the value from the final iteration
+} ReductionOp;
+
+/* A variable combined across the chunks of a squad loop */
+typedef struct Reduction
+{
+    ReductionOp op;
+    char *name;
+    struct Reduction *next;
+} Reduction;
+
+typedef struct
+{
+    char **names;
+    int count;
+} NameList;
+
 typedef struct
 {
     char *name;
@@ -257,6 +343,7 @@ struct ASTNode
             ASTNode *cond;
             ASTNode *incr;
             ASTNode *body;
+            ASTNode *parallel; // NODE_PARALLEL_FOR to run instead, if the body was proven safe
         } for_stmt;
         struct
         {
@@ -287,6 +374,57 @@ struct ASTNode
             ASTNode *body;
         } function_def;
         ASTNode *break_stmt;
+        struct
+        {
+            char *name;
+            ASTNode *dimensions[MAX_DIMENSIONS];
+            int num_dimensions;
+            ExpressionList *init;
+        } array_decl;
+        struct
+        {
+            ASTNode *loop;         // the NODE_FOR_STATEMENT being split
+            Reduction *reductions;
+            char *var;             // counter, from `rizz var = start`
+            ASTNode *start;
+            OperatorType cmp;      // var cmp bound
+            ASTNode *bound;
+            ASTNode *step;         // added each iteration; negated for `-`
+            bool step_negated;
+            bool automatic;        // found by the analyzer; falls back to the plain loop
+            NameList arrays;       // outer arrays the body uses, checked for overlap
+            NameList written;      // ...and the ones among them it writes
+            NameList integral;     // outer names added into sums, which must be integers
+        } parallel_for;
+        struct
+        {
+            ASTNode *declaration;  // declares the target first, for `rizz x = spawn f()`
+            ASTNode *target;       // identifier or array element receiving the result, or NULL
+            ASTNode *call;         // NODE_FUNC_CALL of a user function
+        } spawn;
+        struct
+        {
+            char *name;
+            ASTNode *capacity;
+            bool single;           // dm: one sender and one receiver
+        } channel_decl;
+        struct
+        {
+            char *name;
+            ASTNode *init;         // vector expression, or NULL for all zeros
+        } simd_decl;
+        struct
+        {
+            char *name;
+            VarType key_type;      // VAR_INT or VAR_CHAR; node->var_type is the value type
+        } map_decl;
+        struct
+        {
+            char *name;
+            StructDef *def;
+            bool split;            // one array per field instead of interleaved records
+            ASTNode *previous;     // the gang declaration parsed before this one
+        } struct_decl;             // record dimensions are in node->array_dimensions
     } data;
 };
 
@@ -295,14 +433,60 @@ typedef struct Scope
     HashMap *variables;
     struct Scope *parent;
     bool is_function_scope;
+    int spawn_pins; // pending spawned calls that use variables of this scope
 } Scope;
 
-/* Global variable declarations */
-extern TypeModifiers current_modifiers;
-extern Scope *current_scope;
-extern Function *function_table;
-extern ReturnValue current_return_value;
-extern JumpBuffer *jump_buffer;
+/* Where a program's output or error messages go. With no write function
+ * they go to the process's stdout or stderr. */
+typedef struct
+{
+    void (*write)(void *ctx, const char *data, size_t len);
+    void *ctx;
+} OutputSink;
+
+/* One program: the tree the parser built and the state it runs with.
+ * Parsing and running bind it to the calling thread, and squad slices and
+ * spawned calls bind it on whichever pool thread runs them, so several
+ * programs can be parsed and run in one process without sharing anything. */
+typedef struct Interpreter
+{
+    Arena arena;              // AST nodes and the names they use
+    ASTNode *root;
+    Function *functions;
+    StructDef *structs;
+    ASTNode *gang_decls;      // gang declarations parsed so far, newest first
+    TypeModifiers modifiers;  // modifiers of the declaration being parsed
+    Scope *globals;
+    PoolGroup tasks;          // spawned calls that have not finished
+    atomic_bool failed;       // an error or ragequit is ending the program
+    int status;               // exit status, set by whatever ended it first
+    bool quit;                // ended by ragequit rather than an error
+    int lineno;               // where parsing stopped; runtime errors report it
+    bool parsed;
+    OutputSink output;        // yapping, yappin and write_bin to "-"
+    OutputSink errors;        // baka and error messages
+    InputSource *input;       // what slorp reads; NULL for stdin
+    pthread_mutex_t io_lock;  // one sink call at a time
+} Interpreter;
+
+Interpreter *interpreter_new(void);
+bool interpreter_parse(Interpreter *interpreter, FILE *source);
+int interpreter_run(Interpreter *interpreter);
+void interpreter_free(Interpreter *interpreter);
+_Noreturn void interpreter_exit(int status);
+_Noreturn void interpreter_quit(int status);
+
+void yap_write(const char *data, size_t len);
+void yap_vprintf(const char *format, va_list args);
+void baka_vprintf(const char *format, va_list args);
+
+/* Global variable declarations. Execution state is per thread so that the
+ * chunks of a squad loop can run concurrently. */
+extern _Thread_local Interpreter *current_interpreter;
+extern _Thread_local Scope *current_scope;
+extern _Thread_local ReturnValue current_return_value;
+extern _Thread_local JumpBuffer *jump_buffer;
+extern _Thread_local FILE *yap_stream; // where yapping writes; NULL for stdout
 /* Function prototypes */
 bool set_int_variable(const char *name, int value, TypeModifiers mods);
 bool set_array_variable(char *name, int length, TypeModifiers mods, VarType type);
@@ -321,7 +505,7 @@ void free_scope(Scope *scope);
 void add_variable_to_scope(const char *name, Variable *var);
 Variable *variable_new(char *name);
 Function *get_function(const char *name);
-VarType get_function_return_type(const char *name);
+VarType get_function_return_type(ASTNode *call);
 
 /* Node creation functions */
 ASTNode *create_int_node(int value);
@@ -338,6 +522,15 @@ ASTNode *create_declaration_node(char *name, ASTNode *expr);
 ASTNode *create_operation_node(OperatorType op, ASTNode *left, ASTNode *right);
 ASTNode *create_unary_operation_node(OperatorType op, ASTNode *operand);
 ASTNode *create_for_statement_node(ASTNode *init, ASTNode *cond, ASTNode *incr, ASTNode *body);
+Reduction *create_reduction(const char *op, char *name, Reduction *next);
+ASTNode *create_parallel_for_node(ASTNode *loop, Reduction *reductions);
+void check_concurrent_calls(void);
+ASTNode *find_parallel_loop(ASTNode *loop);
+ASTNode *create_spawn_node(ASTNode *declaration, ASTNode *target, ASTNode *call);
+ASTNode *create_sync_node(void);
+ASTNode *create_channel_declaration_node(char *name, VarType type, ASTNode *capacity, bool single);
+ASTNode *create_simd_declaration_node(char *name, VarType type, ASTNode *init);
+Parameter *create_channel_parameter(char *name, VarType type, bool single, Parameter *next, TypeModifiers mods);
 ASTNode *create_while_statement_node(ASTNode *cond, ASTNode *body);
 ASTNode *create_do_while_statement_node(ASTNode *cond, ASTNode *body);
 ASTNode *create_function_call_node(char *func_name, ArgumentList *args);
@@ -377,6 +570,9 @@ void execute_statement(ASTNode *node);
 void execute_statements(ASTNode *node);
 void execute_assignment(ASTNode *node);
 void execute_for_statement(ASTNode *node);
+bool execute_parallel_for(ASTNode *node);
+void execute_spawn(ASTNode *node);
+void execute_sync(void);
 void execute_while_statement(ASTNode *node);
 void execute_do_while_statement(ASTNode *node);
 void execute_if_statement(ASTNode *node);
@@ -386,33 +582,83 @@ void execute_baka_call(ArgumentList *args);
 void execute_ragequit_call(ArgumentList *args);
 void execute_chill_call(ArgumentList *args);
 void execute_slorp_call(ArgumentList *args);
+void execute_matmul_call(ArgumentList *args);
+void execute_transpose_call(ArgumentList *args);
+void execute_sort_call(ArgumentList *args);
+void execute_stable_sort_call(ArgumentList *args);
+void execute_sort_range_call(ArgumentList *args);
+void execute_binary_search_call(ArgumentList *args);
+void execute_unique_call(ArgumentList *args);
+void execute_pow_call(ArgumentList *args);
+void execute_pow_array_call(ArgumentList *args);
+void execute_popcount_call(ArgumentList *args);
+void execute_find_next_set_call(ArgumentList *args);
+void execute_map_put_call(ArgumentList *args);
+void execute_map_get_call(ArgumentList *args);
+void execute_map_delete_call(ArgumentList *args);
+void execute_map_contains_call(ArgumentList *args);
+void execute_map_size_call(ArgumentList *args);
+void execute_send_call(ArgumentList *args);
+void execute_recv_call(ArgumentList *args);
+void execute_close_call(ArgumentList *args);
+void execute_vstore_call(ArgumentList *args);
+void execute_hsum_call(ArgumentList *args);
+void execute_hmin_call(ArgumentList *args);
+void execute_hmax_call(ArgumentList *args);
+VarType get_horizontal_type(ArgumentList *args);
+void execute_push_call(ArgumentList *args);
+void execute_pop_call(ArgumentList *args);
+void execute_reserve_call(ArgumentList *args);
+void execute_clear_call(ArgumentList *args);
+void execute_len_call(ArgumentList *args);
+void execute_swap_call(ArgumentList *args);
+void execute_bind_file_call(ArgumentList *args);
+void execute_bind_file_rw_call(ArgumentList *args);
+void execute_read_bin_call(ArgumentList *args);
+void execute_write_bin_call(ArgumentList *args);
+void execute_read_csv_call(ArgumentList *args);
+Variable *get_array_argument(ASTNode *expr, const char *func_name);
+const Builtin *get_builtin(const char *name);
+VarType get_builtin_return_type(const Builtin *builtin, ArgumentList *args);
+VarType get_map_get_type(ArgumentList *args);
+VarType get_pop_type(ArgumentList *args);
+ReturnValue call_builtin(const Builtin *builtin, ArgumentList *args);
 void reset_modifiers(void);
 bool check_and_mark_identifier(ASTNode *node, const char *contextErrorMessage);
 void bruh();
 size_t count_expression_list(ExpressionList *list);
 size_t handle_sizeof(ASTNode *node);
 size_t get_type_size(char *name);
-void *handle_function_call(ASTNode *node);
-ASTNode *create_multi_array_declaration_node(char *name, int dimensions[], int num_dimensions, VarType type);
+ReturnValue handle_function_call(ASTNode *node);
+double return_value_as_double(ReturnValue result);
+void store_scalar(Variable *var, double value);
+ASTNode *create_multi_array_declaration_node(char *name, ASTNode *dimensions[], int num_dimensions, VarType type, ExpressionList *init);
 bool set_multi_array_variable(const char *name, int dimensions[], int num_dimensions, TypeModifiers mods, VarType type);
+ASTNode *create_map_declaration_node(char *name, VarType key_type, VarType value_type);
+ASTNode *create_vector_declaration_node(char *name, VarType type);
+StructField *append_struct_field(StructField *fields, char *name, VarType type, ArrayDimensions *dims);
+void define_struct(char *name, StructField *fields);
+ASTNode *create_struct_declaration_node(char *name, char *struct_name, ArrayDimensions *dims, bool split);
+ASTNode *create_field_access_node(char *base, ASTNode *outer[], int num_outer, char *field, ASTNode *inner[], int num_inner);
+ASTNode *create_field_assignment_node(ASTNode *target, ASTNode *value);
+size_t get_element_size(VarType type);
 ASTNode *create_array_access_node_single(char *name, ASTNode *index);
 ASTNode *create_multi_array_access_node(char *name, ASTNode *indices[], int num_indices);
+Variable *resolve_array_access(ASTNode *node, size_t *offset);
+double evaluate_array_element(ASTNode *node);
 
 /* User-defined functions */
 Function *create_function(char *name, VarType return_type, Parameter *params, ASTNode *body);
 Parameter *create_parameter(char *name, VarType type, Parameter *next, TypeModifiers mods);
+Parameter *create_array_parameter(char *name, VarType type, int num_dimensions, Parameter *next, TypeModifiers mods);
 void execute_function_call(const char *name, ArgumentList *args);
 ASTNode *create_function_def_node(char *name, VarType return_type, Parameter *params, ASTNode *body);
 void handle_return_statement(ASTNode *expr);
 void *handle_binary_operation(ASTNode *node);
 void free_function_table(void);
 
-extern TypeModifiers current_modifiers;
-
-extern Arena arena;
-
-#define ARENA_ALLOC(type) arena_alloc(&arena, sizeof(type))
-#define ARENA_STRDUP(str) arena_strdup(&arena, str)
+#define ARENA_ALLOC(type) arena_alloc(&current_interpreter->arena, sizeof(type))
+#define ARENA_STRDUP(str) arena_strdup(&current_interpreter->arena, str)
 
 /* Macros for assigning specific fields to a node */
 #define SET_DATA_INT(node, value) ((node)->data.ivalue = (value))
@@ -487,7 +733,7 @@ extern Arena arena;
         else                                     \
         {                                        \
             yyerror("No jump buffer available"); \
-            exit(1);                             \
+            interpreter_exit(1);                 \
         }                                        \
     } while (0)
 
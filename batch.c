@@ -0,0 +1,387 @@
+/* batch.c */
+
+#include "brainrot.h"
+#include "cli.h"
+#include <ctype.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+// Same as the pool's workers: interpreted recursion is deep
+#define BATCH_STACK_SIZE ((size_t)64 << 20)
+
+// Where one stream of a script goes: a file under --out, else memory
+typedef struct
+{
+    FILE *file;
+    char *path;
+    char *data;
+    size_t len;
+    size_t capacity;
+} Capture;
+
+typedef struct
+{
+    char *script;
+    char *input; // NULL reads nothing
+    Capture out;
+    Capture err;
+    const char *status;
+    int exit_code;
+    bool done;
+} BatchJob;
+
+typedef struct
+{
+    BatchJob *jobs;
+    size_t count;
+    atomic_size_t next;
+    const char *out_dir;
+    pthread_mutex_t lock; // guards done, reported and ok
+    size_t reported;
+    bool ok;
+} Batch;
+
+static void capture_write(void *user, const char *data, size_t len)
+{
+    Capture *capture = user;
+    if (len == 0)
+        return;
+    if (capture->file != NULL)
+    {
+        fwrite(data, 1, len, capture->file);
+        return;
+    }
+    if (capture->len + len > capture->capacity)
+    {
+        size_t capacity = capture->capacity ? capture->capacity : 256;
+        while (capacity < capture->len + len)
+            capacity *= 2;
+        char *grown = realloc(capture->data, capacity);
+        if (grown == NULL)
+            return; // the manifest gets what fit
+        capture->data = grown;
+        capture->capacity = capacity;
+    }
+    memcpy(capture->data + capture->len, data, len);
+    capture->len += len;
+}
+
+static void capture_printf(Capture *capture, const char *format, ...)
+{
+    char buffer[512];
+    va_list args;
+    va_start(args, format);
+    int len = vsnprintf(buffer, sizeof buffer, format, args);
+    va_end(args);
+    if (len > 0)
+        capture_write(capture, buffer, (size_t)len < sizeof buffer ? (size_t)len : sizeof buffer - 1);
+}
+
+static bool capture_open(Capture *capture, const char *dir, size_t index, const char *suffix)
+{
+    if (dir == NULL)
+        return true;
+    int len = snprintf(NULL, 0, "%s/%zu.%s", dir, index, suffix);
+    capture->path = malloc((size_t)len + 1);
+    if (capture->path == NULL)
+        return false;
+    snprintf(capture->path, (size_t)len + 1, "%s/%zu.%s", dir, index, suffix);
+    capture->file = fopen(capture->path, "wb");
+    return capture->file != NULL;
+}
+
+static void capture_free(Capture *capture)
+{
+    if (capture->file != NULL)
+        fclose(capture->file);
+    free(capture->path);
+    free(capture->data);
+    memset(capture, 0, sizeof *capture);
+}
+
+static ssize_t read_fd(void *user, char *dst, size_t len)
+{
+    int fd = *(int *)user;
+    if (fd < 0)
+        return 0;
+    ssize_t n;
+    do
+        n = read(fd, dst, len);
+    while (n < 0 && errno == EINTR);
+    return n;
+}
+
+static void run_job(Batch *batch, size_t index)
+{
+    BatchJob *job = &batch->jobs[index];
+    job->exit_code = EXIT_FAILURE;
+    job->status = "io error";
+    if (!capture_open(&job->out, batch->out_dir, index, "stdout") ||
+        !capture_open(&job->err, batch->out_dir, index, "stderr"))
+    {
+        fprintf(stderr, "Cannot open output for %s: %s\n", job->script, strerror(errno));
+        return;
+    }
+
+    size_t len;
+    char *source = read_source(job->script, &len);
+    if (source == NULL)
+    {
+        capture_printf(&job->err, "Cannot open source file: %s\n", strerror(errno));
+        return;
+    }
+    int fd = -1;
+    if (job->input != NULL && (fd = open(job->input, O_RDONLY)) < 0)
+    {
+        capture_printf(&job->err, "Cannot open input file: %s\n", strerror(errno));
+        free(source);
+        return;
+    }
+
+    Brainrot *br = brainrot_create();
+    BrainrotStatus status = br ? BRAINROT_OK : BRAINROT_NO_MEMORY;
+    if (status == BRAINROT_OK)
+        brainrot_set_output(br, capture_write, &job->out);
+    if (status == BRAINROT_OK)
+        brainrot_set_errors(br, capture_write, &job->err);
+    if (status == BRAINROT_OK)
+        status = brainrot_set_input(br, read_fd, &fd);
+    if (status == BRAINROT_OK)
+        status = brainrot_parse(br, source, len);
+    if (status == BRAINROT_OK)
+        status = brainrot_run(br);
+    job->status = brainrot_status_name(status);
+    job->exit_code = br ? brainrot_exit_code(br) : EXIT_FAILURE;
+
+    brainrot_destroy(br);
+    free(source);
+    if (fd >= 0)
+        close(fd);
+}
+
+static void json_string(const char *s, size_t len)
+{
+    putchar('"');
+    for (size_t i = 0; i < len; i++)
+    {
+        unsigned char c = (unsigned char)s[i];
+        if (c == '"' || c == '\\')
+            printf("\\%c", c);
+        else if (c == '\n')
+            fputs("\\n", stdout);
+        else if (c == '\t')
+            fputs("\\t", stdout);
+        else if (c == '\r')
+            fputs("\\r", stdout);
+        else if (c < 0x20)
+            printf("\\u%04x", c);
+        else
+            putchar(c);
+    }
+    putchar('"');
+}
+
+static void json_field(const char *name, const Capture *capture)
+{
+    printf(", \"%s%s\": ", name, capture->path ? "_file" : "");
+    if (capture->path != NULL)
+        json_string(capture->path, strlen(capture->path));
+    else
+        json_string(capture->data ? capture->data : "", capture->len);
+}
+
+// One manifest line per script, in list order as soon as its turn comes
+static void report_job(const BatchJob *job)
+{
+    fputs("{\"script\": ", stdout);
+    json_string(job->script, strlen(job->script));
+    printf(", \"status\": \"%s\", \"exit\": %d", job->status, job->exit_code);
+    json_field("stdout", &job->out);
+    json_field("stderr", &job->err);
+    fputs("}\n", stdout);
+    fflush(stdout);
+}
+
+static void *batch_worker(void *arg)
+{
+    Batch *batch = arg;
+    size_t index;
+    while ((index = atomic_fetch_add(&batch->next, 1)) < batch->count)
+    {
+        run_job(batch, index);
+        BatchJob *job = &batch->jobs[index];
+        if (job->out.file != NULL)
+            fflush(job->out.file);
+        if (job->err.file != NULL)
+            fflush(job->err.file);
+
+        pthread_mutex_lock(&batch->lock);
+        job->done = true;
+        if (strcmp(job->status, "ok") != 0 || job->exit_code != 0)
+            batch->ok = false;
+        while (batch->reported < batch->count && batch->jobs[batch->reported].done)
+        {
+            BatchJob *next = &batch->jobs[batch->reported++];
+            report_job(next);
+            capture_free(&next->out);
+            capture_free(&next->err);
+        }
+        pthread_mutex_unlock(&batch->lock);
+    }
+    return NULL;
+}
+
+// Lines name a script and optionally a file for its stdin; # comments
+static bool parse_list(char *text, size_t len, Batch *batch)
+{
+    size_t capacity = 16;
+    batch->jobs = calloc(capacity, sizeof(BatchJob));
+    size_t line = 0;
+    char *end = text + len;
+    for (char *p = text; batch->jobs != NULL && p < end; p++)
+    {
+        line++;
+        char *eol = memchr(p, '\n', (size_t)(end - p));
+        if (eol == NULL)
+            eol = end; // read_source always leaves a spare byte past the text
+        *eol = '\0';
+
+        char *fields[3] = {NULL, NULL, NULL};
+        int count = 0;
+        for (char *q = p; *q && *q != '#' && count < 3;)
+        {
+            while (isspace((unsigned char)*q))
+                *q++ = '\0';
+            if (*q == '\0' || *q == '#')
+                break;
+            fields[count++] = q;
+            while (*q && !isspace((unsigned char)*q))
+                q++;
+        }
+        if (count > 2)
+        {
+            fprintf(stderr, "Error: line %zu of the batch list: expected a script and at most one input file\n", line);
+            return false;
+        }
+        p = eol;
+        if (count == 0)
+            continue;
+
+        if (batch->count == capacity)
+        {
+            BatchJob *grown = realloc(batch->jobs, capacity * 2 * sizeof(BatchJob));
+            if (grown == NULL)
+            {
+                fprintf(stderr, "Error: out of memory reading the batch list\n");
+                return false;
+            }
+            memset(grown + capacity, 0, capacity * sizeof(BatchJob));
+            batch->jobs = grown;
+            capacity *= 2;
+        }
+        batch->jobs[batch->count].script = fields[0];
+        batch->jobs[batch->count].input = fields[1];
+        batch->count++;
+    }
+    if (batch->jobs == NULL)
+    {
+        fprintf(stderr, "Error: out of memory reading the batch list\n");
+        return false;
+    }
+    return true;
+}
+
+static size_t default_jobs(void)
+{
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    return n > 0 ? (size_t)n : 1;
+}
+
+/**
+ * @brief Runs every script of a list concurrently, each in its own interpreter
+ * @param argc Arguments after --batch, plus one for the flag itself
+ * @param argv "--batch", then [--jobs N] [--out DIR] <listfile>
+ * @return 0 if every script ran to the end with exit code 0, 1 otherwise
+ *
+ * Prints a JSON manifest line per script in list order. Scripts without an
+ * input file see an empty stdin, since they cannot share the real one.
+ */
+int batch_main(int argc, char *argv[])
+{
+    size_t jobs = default_jobs();
+    const char *out_dir = NULL;
+    const char *list = NULL;
+    bool usage = false;
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--jobs") == 0 && i + 1 < argc)
+        {
+            char *end;
+            long n = strtol(argv[++i], &end, 10);
+            if (*end != '\0' || n < 1)
+            {
+                fprintf(stderr, "Error: --jobs needs a positive count\n");
+                return 1;
+            }
+            jobs = (size_t)n;
+        }
+        else if (strcmp(argv[i], "--out") == 0 && i + 1 < argc)
+            out_dir = argv[++i];
+        else if (list == NULL && argv[i][0] != '-')
+            list = argv[i];
+        else
+            usage = true;
+    }
+    if (list == NULL || usage)
+    {
+        fprintf(stderr, "Usage: brainrot --batch [--jobs N] [--out DIR] <listfile>\n");
+        return 1;
+    }
+
+    size_t len;
+    char *text = read_source(list, &len);
+    if (text == NULL)
+    {
+        perror("Cannot open batch list");
+        return 1;
+    }
+    Batch batch = {.out_dir = out_dir, .ok = true};
+    atomic_init(&batch.next, 0);
+    pthread_mutex_init(&batch.lock, NULL);
+    if (!parse_list(text, len, &batch))
+    {
+        free(batch.jobs);
+        free(text);
+        return 1;
+    }
+
+    if (jobs > batch.count)
+        jobs = batch.count;
+    pthread_t *threads = calloc(jobs ? jobs : 1, sizeof(pthread_t));
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setstacksize(&attr, BATCH_STACK_SIZE);
+    size_t started = 0;
+    while (threads != NULL && started < jobs && pthread_create(&threads[started], &attr, batch_worker, &batch) == 0)
+        started++;
+    pthread_attr_destroy(&attr);
+    if (started == 0)
+        batch_worker(&batch);
+    for (size_t i = 0; i < started; i++)
+        pthread_join(threads[i], NULL);
+
+    bool ok = batch.ok;
+    pthread_mutex_destroy(&batch.lock);
+    free(threads);
+    free(batch.jobs);
+    free(text);
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,174 @@
+/* brainrot.c */
+
+#include "brainrot.h"
+#include "ast.h"
+#include "lib/input.h"
+#include "lib/mem.h"
+#include <stdatomic.h>
+#include <stdio.h>
+
+typedef enum
+{
+    STAGE_NEW,
+    STAGE_PARSED,
+    STAGE_DONE, // ran, or failed to parse
+} Stage;
+
+struct Brainrot
+{
+    Interpreter *interpreter;
+    Stage stage;
+    BrainrotReadFn read;
+    void *read_user;
+};
+
+/**
+ * @brief Creates an interpreter for one program
+ * @return The handle, or NULL if out of memory
+ */
+Brainrot *brainrot_create(void)
+{
+    Brainrot *br = SAFE_MALLOC(Brainrot);
+    if (br == NULL)
+        return NULL;
+    br->interpreter = interpreter_new();
+    if (br->interpreter == NULL)
+    {
+        SAFE_FREE(br);
+        return NULL;
+    }
+    br->stage = STAGE_NEW;
+    return br;
+}
+
+/**
+ * @brief Frees the program and everything it allocated
+ * @param br Handle from brainrot_create, or NULL
+ */
+void brainrot_destroy(Brainrot *br)
+{
+    if (br == NULL)
+        return;
+    interpreter_free(br->interpreter);
+    SAFE_FREE(br);
+}
+
+BrainrotStatus brainrot_set_output(Brainrot *br, BrainrotWriteFn write, void *user)
+{
+    if (br == NULL || br->stage == STAGE_DONE)
+        return BRAINROT_MISUSE;
+    br->interpreter->output.write = write;
+    br->interpreter->output.ctx = user;
+    return BRAINROT_OK;
+}
+
+BrainrotStatus brainrot_set_errors(Brainrot *br, BrainrotWriteFn write, void *user)
+{
+    if (br == NULL || br->stage == STAGE_DONE)
+        return BRAINROT_MISUSE;
+    br->interpreter->errors.write = write;
+    br->interpreter->errors.ctx = user;
+    return BRAINROT_OK;
+}
+
+static ssize_t read_input(void *ctx, void *dst, size_t len)
+{
+    Brainrot *br = ctx;
+    return br->read(br->read_user, dst, len);
+}
+
+/**
+ * @brief Sets where the program's input comes from
+ * @param br Handle
+ * @param read Callback, or NULL to read stdin
+ * @param user Passed to every call of read
+ * @return BRAINROT_OK, or BRAINROT_NO_MEMORY
+ */
+BrainrotStatus brainrot_set_input(Brainrot *br, BrainrotReadFn read, void *user)
+{
+    if (br == NULL || br->stage == STAGE_DONE)
+        return BRAINROT_MISUSE;
+    InputSource *source = NULL;
+    if (read != NULL && (source = input_source_new(read_input, br)) == NULL)
+        return BRAINROT_NO_MEMORY;
+    input_source_free(br->interpreter->input);
+    br->interpreter->input = source;
+    br->read = read;
+    br->read_user = user;
+    return BRAINROT_OK;
+}
+
+/**
+ * @brief Parses a program from memory
+ * @param br Handle that has not parsed anything yet
+ * @param source Program text
+ * @param len Length of the text in bytes
+ * @return BRAINROT_OK, or BRAINROT_SYNTAX_ERROR after reporting the error
+ *
+ * Parses are serialized across the process, since the generated parser
+ * keeps its state in globals; runs are not.
+ */
+BrainrotStatus brainrot_parse(Brainrot *br, const char *source, size_t len)
+{
+    if (br == NULL || source == NULL || br->stage != STAGE_NEW)
+        return BRAINROT_MISUSE;
+
+    // fmemopen may refuse an empty buffer; an empty program is a blank line
+    static const char blank[] = "\n";
+    FILE *file = len > 0 ? fmemopen((void *)source, len, "r") : fmemopen((void *)blank, 1, "r");
+    if (file == NULL)
+        return BRAINROT_NO_MEMORY;
+    bool parsed = interpreter_parse(br->interpreter, file);
+    fclose(file);
+
+    br->stage = parsed ? STAGE_PARSED : STAGE_DONE;
+    return parsed ? BRAINROT_OK : BRAINROT_SYNTAX_ERROR;
+}
+
+/**
+ * @brief Runs a parsed program to the end
+ * @param br Handle whose brainrot_parse succeeded; a program runs once
+ * @return BRAINROT_OK if it finished or called ragequit(0), BRAINROT_QUIT
+ *         for another ragequit code, BRAINROT_RUNTIME_ERROR after an error
+ */
+BrainrotStatus brainrot_run(Brainrot *br)
+{
+    if (br == NULL || br->stage != STAGE_PARSED)
+        return BRAINROT_MISUSE;
+    br->stage = STAGE_DONE;
+
+    Interpreter *interpreter = br->interpreter;
+    int status = interpreter_run(interpreter);
+    if (interpreter->output.write == NULL)
+        fflush(stdout);
+    if (!atomic_load(&interpreter->failed))
+        return BRAINROT_OK;
+    if (interpreter->quit)
+        return status == 0 ? BRAINROT_OK : BRAINROT_QUIT;
+    return BRAINROT_RUNTIME_ERROR;
+}
+
+int brainrot_exit_code(const Brainrot *br)
+{
+    return br ? br->interpreter->status : EXIT_FAILURE;
+}
+
+const char *brainrot_status_name(BrainrotStatus status)
+{
+    switch (status)
+    {
+    case BRAINROT_OK:
+        return "ok";
+    case BRAINROT_SYNTAX_ERROR:
+        return "syntax error";
+    case BRAINROT_RUNTIME_ERROR:
+        return "runtime error";
+    case BRAINROT_QUIT:
+        return "ragequit";
+    case BRAINROT_MISUSE:
+        return "misuse";
+    case BRAINROT_NO_MEMORY:
+        return "out of memory";
+    }
+    return "unknown status";
+}
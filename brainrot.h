@@ -0,0 +1,70 @@
+/* brainrot.h */
+
+#ifndef BRAINROT_H
+#define BRAINROT_H
+
+#include <stddef.h>
+#include <sys/types.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#if defined(__GNUC__)
+#define BRAINROT_API __attribute__((visibility("default")))
+#else
+#define BRAINROT_API
+#endif
+
+/*
+ * One Brainrot program, parsed once and then run. Handles share nothing,
+ * so different threads can use different handles at the same time; one
+ * handle must only be used by one thread at a time.
+ */
+typedef struct Brainrot Brainrot;
+
+typedef enum
+{
+    BRAINROT_OK = 0,
+    BRAINROT_SYNTAX_ERROR,  // the source did not parse
+    BRAINROT_RUNTIME_ERROR, // an error stopped the program
+    BRAINROT_QUIT,          // the program called ragequit with a non-zero code
+    BRAINROT_MISUSE,        // a NULL argument, or a call out of order
+    BRAINROT_NO_MEMORY,
+} BrainrotStatus;
+
+/*
+ * Receives output as the program writes it. Spawned calls run on worker
+ * threads and may write from there, but calls for one handle never overlap.
+ */
+typedef void (*BrainrotWriteFn)(void *user, const char *data, size_t len);
+
+/*
+ * Supplies the input slorp, read_csv and read_bin read: fills buf with up
+ * to len bytes and returns how many, 0 at end of input or -1 on an error.
+ */
+typedef ssize_t (*BrainrotReadFn)(void *user, char *buf, size_t len);
+
+BRAINROT_API Brainrot *brainrot_create(void);
+BRAINROT_API void brainrot_destroy(Brainrot *br);
+
+/* Without these, output goes to stdout, errors and baka to stderr, and
+ * input comes from stdin. Set them before brainrot_run. */
+BRAINROT_API BrainrotStatus brainrot_set_output(Brainrot *br, BrainrotWriteFn write, void *user);
+BRAINROT_API BrainrotStatus brainrot_set_errors(Brainrot *br, BrainrotWriteFn write, void *user);
+BRAINROT_API BrainrotStatus brainrot_set_input(Brainrot *br, BrainrotReadFn read, void *user);
+
+/* The source need not be null-terminated and is not used after parsing. */
+BRAINROT_API BrainrotStatus brainrot_parse(Brainrot *br, const char *source, size_t len);
+BRAINROT_API BrainrotStatus brainrot_run(Brainrot *br);
+
+/* The status the brainrot command would exit with after the same calls */
+BRAINROT_API int brainrot_exit_code(const Brainrot *br);
+BRAINROT_API const char *brainrot_status_name(BrainrotStatus status);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* BRAINROT_H */
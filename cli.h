@@ -0,0 +1,16 @@
+/* cli.h */
+
+#ifndef CLI_H
+#define CLI_H
+
+#include <stddef.h>
+
+// Shared by the command line front ends built on brainrot.h
+
+char *read_source(const char *path, size_t *len);
+int batch_main(int argc, char *argv[]);
+int shard_main(int argc, char *argv[]);
+int serve_main(int argc, char *argv[]);
+int client_main(int argc, char *argv[]);
+
+#endif
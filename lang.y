@@ -11,7 +11,6 @@
 #include <unistd.h>
 
 int yylex(void);
-int yylex_destroy(void);
 void yyerror(const char *s);
 void ragequit(int exit_code);
 void yapping(const char* format, ...);
@@ -23,16 +22,10 @@ int slorp_int(int val);
 short slorp_short(short val);
 float slorp_float(float var);
 double slorp_double(double var);
-void cleanup();
 TypeModifiers get_variable_modifiers(const char* name);
-extern TypeModifiers current_modifiers;
 extern VarType current_var_type;
 
 extern int yylineno;
-extern FILE *yyin;
-
-/* Root of the AST */
-ASTNode *root = NULL;
 %}
 
 %union {
@@ -49,6 +42,8 @@ ASTNode *root = NULL;
     Parameter *param;
     ArrayDimensions array_dims;
     Array array;
+    StructField *field;
+    Reduction *reduction;
 }
 
 /* Define token types */
@@ -68,15 +63,18 @@ ASTNode *root = NULL;
 %token <ival> BOOLEAN
 %token <fval> FLOAT_LITERAL
 %token <dval> DOUBLE_LITERAL
-%token SLORP
+%token SLORP LORE DOT SPLIT SQUAD SPAWN SYNC DM GC
+%token CHAD4 GIGACHAD4 RIZZ8
 
 /* Declare types for non-terminals */
-%type <ival> type
+%type <ival> type param_dimensions
 %type <node> program skibidi_function
 %type <node> statements statement
 %type <node> declaration
 %type <node> expression
-%type <node> for_statement
+%type <node> for_statement parallel_for spawn_statement
+%type <ival> channel_kind simd_type
+%type <reduction> reductions reduction
 %type <node> while_statement
 %type <node> do_while_statement
 %type <node> function_call
@@ -97,6 +95,8 @@ ASTNode *root = NULL;
 %type <param> param_list params
 %type <array_dims> dimensions
 %type <array> multi_dimension_access
+%type <node> field_access
+%type <field> struct_fields
 
 %start program
 
@@ -117,7 +117,10 @@ ASTNode *root = NULL;
 
 program
     : function_def_list skibidi_function
-        { root = create_statement_list($2, $1); }
+        {
+            current_interpreter->root = create_statement_list($2, $1);
+            check_concurrent_calls();
+        }
     ;
 
 function_def_list
@@ -125,6 +128,27 @@ function_def_list
         { $$ = NULL; }
     | function_def_list function_def
         { $$ = create_statement_list($2, $1); }
+    | function_def_list struct_def
+        { $$ = $1; }
+    ;
+
+struct_def
+    : STRUCT IDENTIFIER LBRACE struct_fields RBRACE SEMICOLON
+        {
+            define_struct($2, $4);
+            SAFE_FREE($2);
+        }
+    ;
+
+struct_fields
+    : type IDENTIFIER SEMICOLON
+        { $$ = append_struct_field(NULL, $2, $1, NULL); SAFE_FREE($2); }
+    | type IDENTIFIER dimensions SEMICOLON
+        { $$ = append_struct_field(NULL, $2, $1, &$3); SAFE_FREE($2); }
+    | struct_fields type IDENTIFIER SEMICOLON
+        { $$ = append_struct_field($1, $3, $2, NULL); SAFE_FREE($3); }
+    | struct_fields type IDENTIFIER dimensions SEMICOLON
+        { $$ = append_struct_field($1, $3, $2, &$4); SAFE_FREE($3); }
     ;
 
 function_def
@@ -142,8 +166,40 @@ params
 param_list
     : optional_modifiers type IDENTIFIER
         { $$ = create_parameter($3, $2, NULL, get_current_modifiers()); SAFE_FREE($3); }
+    | optional_modifiers type IDENTIFIER param_dimensions
+        { $$ = create_array_parameter($3, $2, $4, NULL, get_current_modifiers()); SAFE_FREE($3); }
     | param_list COMMA optional_modifiers type IDENTIFIER 
         { $$ = create_parameter($5, $4, $1, get_current_modifiers()); SAFE_FREE($5); }
+    | param_list COMMA optional_modifiers type IDENTIFIER param_dimensions
+        { $$ = create_array_parameter($5, $4, $6, $1, get_current_modifiers()); SAFE_FREE($5); }
+    | optional_modifiers channel_kind LT type GT IDENTIFIER
+        { $$ = create_channel_parameter($6, $4, $2, NULL, get_current_modifiers()); SAFE_FREE($6); }
+    | param_list COMMA optional_modifiers channel_kind LT type GT IDENTIFIER
+        { $$ = create_channel_parameter($8, $6, $4, $1, get_current_modifiers()); SAFE_FREE($8); }
+    ;
+
+channel_kind:
+      DM        { $$ = true; }
+    | GC        { $$ = false; }
+    ;
+
+simd_type:
+      CHAD4     { $$ = VAR_FLOAT; }
+    | GIGACHAD4 { $$ = VAR_DOUBLE; }
+    | RIZZ8     { $$ = VAR_INT; }
+    ;
+
+param_dimensions
+    : LBRACKET RBRACKET
+        { $$ = 1; }
+    | param_dimensions LBRACKET RBRACKET
+        {
+            if ($1 >= MAX_DIMENSIONS) {
+                yyerror("Maximum array dimensions exceeded");
+                YYABORT;
+            }
+            $$ = $1 + 1;
+        }
     ;
 
 
@@ -164,6 +220,8 @@ statement:
         { $$ = $1; }
     | for_statement
         { $$ = $1;  }
+    | parallel_for
+        { $$ = $1;  }
     | while_statement
         { $$ = $1;  }
     | do_while_statement
@@ -172,6 +230,10 @@ statement:
         { $$ = $1; }
     | return_statement SEMICOLON
         { $$ = $1; }
+    | spawn_statement SEMICOLON
+        { $$ = $1; }
+    | SYNC SEMICOLON
+        { $$ = create_sync_node(); }
     | if_statement
         { $$ = $1;  }
     | switch_statement
@@ -235,31 +297,60 @@ declaration:
             $$ = create_declaration_node($3, $5);
             SAFE_FREE($3);
         }
-    | optional_modifiers type IDENTIFIER dimensions
+    | optional_modifiers type IDENTIFIER multi_dimension_access
         {
-            Variable *var = variable_new($3);
-            add_variable_to_scope($3, var);
-            if (!set_multi_array_variable($3, $4.dimensions, $4.num_dimensions, get_current_modifiers(), $2)) {
-                yyerror("Failed to create array");
-                SAFE_FREE($3);
-                YYABORT;
-            }
-            $$ = create_multi_array_declaration_node($3, $4.dimensions, $4.num_dimensions, $2);
+            $$ = create_multi_array_declaration_node($3, $4.indices, $4.num_dimensions, $2, NULL);
             SAFE_FREE($3);
-            SAFE_FREE(var);
         }
-    | optional_modifiers type IDENTIFIER dimensions EQUALS array_init
+    | optional_modifiers type IDENTIFIER multi_dimension_access EQUALS array_init
         {
-            Variable *var = variable_new($3);
-            add_variable_to_scope($3, var);
-            set_multi_array_variable($3, $4.dimensions, $4.num_dimensions, get_current_modifiers(), $2);
-            // Handle initialization with proper dimension checks
-            populate_multi_array_variable($3, $6, $4.dimensions, $4.num_dimensions);
-            $$ = create_multi_array_declaration_node($3, $4.dimensions, $4.num_dimensions, $2);
+            $$ = create_multi_array_declaration_node($3, $4.indices, $4.num_dimensions, $2, $6);
             SAFE_FREE($3);
-            SAFE_FREE(var);
             free_expression_list($6);
         }
+    | optional_modifiers simd_type IDENTIFIER
+        {
+            $$ = create_simd_declaration_node($3, $2, NULL);
+            SAFE_FREE($3);
+        }
+    | optional_modifiers simd_type IDENTIFIER EQUALS expression
+        {
+            $$ = create_simd_declaration_node($3, $2, $5);
+            SAFE_FREE($3);
+        }
+    | optional_modifiers channel_kind LT type GT IDENTIFIER LBRACKET expression RBRACKET
+        {
+            $$ = create_channel_declaration_node($6, $4, $8, $2);
+            SAFE_FREE($6);
+        }
+    | optional_modifiers LORE LT type COMMA type GT IDENTIFIER
+        {
+            $$ = create_map_declaration_node($8, $4, $6);
+            SAFE_FREE($8);
+        }
+    | optional_modifiers type IDENTIFIER LBRACKET RBRACKET
+        {
+            $$ = create_vector_declaration_node($3, $2);
+            SAFE_FREE($3);
+        }
+    | optional_modifiers STRUCT IDENTIFIER IDENTIFIER
+        {
+            $$ = create_struct_declaration_node($4, $3, NULL, false);
+            SAFE_FREE($3);
+            SAFE_FREE($4);
+        }
+    | optional_modifiers STRUCT IDENTIFIER IDENTIFIER dimensions
+        {
+            $$ = create_struct_declaration_node($4, $3, &$5, false);
+            SAFE_FREE($3);
+            SAFE_FREE($4);
+        }
+    | optional_modifiers SPLIT STRUCT IDENTIFIER IDENTIFIER dimensions
+        {
+            $$ = create_struct_declaration_node($5, $4, &$6, true);
+            SAFE_FREE($4);
+            SAFE_FREE($5);
+        }
     ;
 
 array_init:
@@ -300,13 +391,13 @@ optional_modifiers:
 
 modifier:
     VOLATILE
-        { current_modifiers.is_volatile = true; }
+        { current_interpreter->modifiers.is_volatile = true; }
     | SIGNED
-        { current_modifiers.is_signed = true; }
+        { current_interpreter->modifiers.is_signed = true; }
     | UNSIGNED 
-        { current_modifiers.is_unsigned = true; }
+        { current_interpreter->modifiers.is_unsigned = true; }
     | DEADASS
-        { current_modifiers.is_const = true; }
+        { current_interpreter->modifiers.is_const = true; }
     | CAP
         { current_var_type = VAR_BOOL; } 
     ;
@@ -318,6 +409,48 @@ for_statement:
         }
     ;
 
+parallel_for:
+    SQUAD for_statement
+        { $$ = create_parallel_for_node($2, NULL); }
+    | SQUAD LPAREN reductions RPAREN for_statement
+        { $$ = create_parallel_for_node($5, $3); }
+    ;
+
+spawn_statement:
+      SPAWN function_call
+        { $$ = create_spawn_node(NULL, NULL, $2); }
+    | IDENTIFIER EQUALS SPAWN function_call
+        {
+            $$ = create_spawn_node(NULL, create_identifier_node($1), $4);
+            SAFE_FREE($1);
+        }
+    | IDENTIFIER multi_dimension_access EQUALS SPAWN function_call
+        {
+            $$ = create_spawn_node(NULL, create_multi_array_access_node($1, $2.indices, $2.num_dimensions), $5);
+            SAFE_FREE($1);
+        }
+    | optional_modifiers type IDENTIFIER EQUALS SPAWN function_call
+        {
+            ASTNode *declaration = create_declaration_node($3, create_default_node($2));
+            $$ = create_spawn_node(declaration, create_identifier_node($3), $6);
+            SAFE_FREE($3);
+        }
+    ;
+
+reductions:
+      reduction
+        { $$ = $1; }
+    | reduction COMMA reductions
+        { $1->next = $3; $$ = $1; }
+    ;
+
+reduction:
+      PLUS COLON IDENTIFIER
+        { $$ = create_reduction("+", $3, NULL); SAFE_FREE($3); }
+    | IDENTIFIER COLON IDENTIFIER
+        { $$ = create_reduction($1, $3, NULL); SAFE_FREE($1); SAFE_FREE($3); }
+    ;
+
 while_statement:
     GOON LPAREN expression RPAREN LBRACE statements RBRACE
         {
@@ -410,6 +543,7 @@ expression:
     | array_access
     | sizeof_expression
     | function_call
+    | field_access
     ;
 
 sizeof_expression:
@@ -446,7 +580,7 @@ assignment:
             if (!node) {
                 yyerror("Memory allocation failed");
                 SAFE_FREE($1);
-                exit(EXIT_FAILURE);
+                interpreter_exit(EXIT_FAILURE);
             }
             node->type = NODE_ASSIGNMENT;
             node->data.op.left = access;
@@ -455,6 +589,35 @@ assignment:
             $$ = node;
             SAFE_FREE($1);
         }
+    | field_access EQUALS expression
+        { $$ = create_field_assignment_node($1, $3); }
+    ;
+
+field_access:
+    IDENTIFIER DOT IDENTIFIER
+        {
+            $$ = create_field_access_node($1, NULL, 0, $3, NULL, 0);
+            SAFE_FREE($1);
+            SAFE_FREE($3);
+        }
+    | IDENTIFIER DOT IDENTIFIER multi_dimension_access
+        {
+            $$ = create_field_access_node($1, NULL, 0, $3, $4.indices, $4.num_dimensions);
+            SAFE_FREE($1);
+            SAFE_FREE($3);
+        }
+    | IDENTIFIER multi_dimension_access DOT IDENTIFIER
+        {
+            $$ = create_field_access_node($1, $2.indices, $2.num_dimensions, $4, NULL, 0);
+            SAFE_FREE($1);
+            SAFE_FREE($4);
+        }
+    | IDENTIFIER multi_dimension_access DOT IDENTIFIER multi_dimension_access
+        {
+            $$ = create_field_access_node($1, $2.indices, $2.num_dimensions, $4, $5.indices, $5.num_dimensions);
+            SAFE_FREE($1);
+            SAFE_FREE($4);
+        }
     ;
 
 multi_dimension_access:
@@ -518,66 +681,40 @@ array_access:
 
 %%
 
-int main(int argc, char *argv[]) {
-    if (argc != 2) {
-        fprintf(stderr, "Usage: %s <sourcefile>\n", argv[0]);
-        return 1;
-    }
-
-    FILE *source = fopen(argv[1], "r");
-    if (!source) {
-        perror("Cannot open source file");
-        return 1;
-    }
-
-    yyin = source;
-    current_scope = create_scope(NULL);
-
-    if (yyparse() == 0) {
-        execute_statement(root);
-    }
-
-    fclose(source);
-    free_ast();
-    free_function_table();
-    free_scope(current_scope);
-    yylex_destroy();
-    
-    return 0;
-}
-
 void yyerror(const char *s) {
-    fprintf(stderr, "Error: %s at line %d\n", s, yylineno - 1);
+    /* Once parsed, a program reports against the line parsing stopped at */
+    int line = current_interpreter && current_interpreter->parsed ? current_interpreter->lineno : yylineno;
+    baka("Error: %s at line %d\n", s, line - 1);
 }
 
 void ragequit(int exit_code) {
-    cleanup();
-    exit(exit_code);
+    interpreter_quit(exit_code);
 }
 
 void chill(unsigned int seconds) {
     sleep(seconds);
 }
 
+/* Inside a squad flex loop each slice yaps into its own buffer */
 void yapping(const char* format, ...) {
     va_list args;
     va_start(args, format);
-    vprintf(format, args);
+    yap_vprintf(format, args);
     va_end(args);
-    printf("\n");
+    yap_write("\n", 1);
 }
 
 void yappin(const char* format, ...) {
     va_list args;
     va_start(args, format);
-    vprintf(format, args);
+    yap_vprintf(format, args);
     va_end(args);
 }
 
 void baka(const char* format, ...) {
     va_list args;
     va_start(args, format);
-    vfprintf(stderr, format, args);
+    baka_vprintf(format, args);
     va_end(args);
 }
 
@@ -591,13 +728,13 @@ char slorp_char(char chr) {
     }
     else if (status == INPUT_INVALID_LENGTH)
     {
-        fprintf(stderr, "Error: Invalid input length.\n");
-        exit(EXIT_FAILURE);
+        baka("Error: Invalid input length.\n");
+        interpreter_exit(EXIT_FAILURE);
     }
     else
     {
-        fprintf(stderr, "Error reading char: %d\n", status);
-        exit(EXIT_FAILURE);
+        baka("Error reading char: %d\n", status);
+        interpreter_exit(EXIT_FAILURE);
     }
 }
 
@@ -612,13 +749,13 @@ char *slorp_string(char *string, size_t size) {
     }
     else if (status == INPUT_BUFFER_OVERFLOW)
     {
-        fprintf(stderr, "Error: Input exceeded buffer size.\n");
-        exit(EXIT_FAILURE);
+        baka("Error: Input exceeded buffer size.\n");
+        interpreter_exit(EXIT_FAILURE);
     }
     else
     {
-        fprintf(stderr, "Error reading string: %d\n", status);
-        exit(EXIT_FAILURE);
+        baka("Error reading string: %d\n", status);
+        interpreter_exit(EXIT_FAILURE);
     }
 }
 
@@ -632,18 +769,18 @@ int slorp_int(int val) {
     }
     else if (status == INPUT_INTEGER_OVERFLOW)
     {
-        fprintf(stderr, "Error: Integer value out of range.\n");
-        exit(EXIT_FAILURE);
+        baka("Error: Integer value out of range.\n");
+        interpreter_exit(EXIT_FAILURE);
     }
     else if (status == INPUT_CONVERSION_ERROR)
     {
-        fprintf(stderr, "Error: Invalid integer format.\n");
-        exit(EXIT_FAILURE);
+        baka("Error: Invalid integer format.\n");
+        interpreter_exit(EXIT_FAILURE);
     }
     else
     {
-        fprintf(stderr, "Error reading integer: %d\n", status);
-        exit(EXIT_FAILURE);
+        baka("Error reading integer: %d\n", status);
+        interpreter_exit(EXIT_FAILURE);
     }
     return 0;
 }
@@ -658,18 +795,18 @@ short slorp_short(short val) {
     }
     else if (status == INPUT_SHORT_OVERFLOW)
     {
-        fprintf(stderr, "Error: short value out of range.\n");
-        exit(EXIT_FAILURE);
+        baka("Error: short value out of range.\n");
+        interpreter_exit(EXIT_FAILURE);
     }
     else if (status == INPUT_CONVERSION_ERROR)
     {
-        fprintf(stderr, "Error: short integer format.\n");
-        exit(EXIT_FAILURE);
+        baka("Error: short integer format.\n");
+        interpreter_exit(EXIT_FAILURE);
     }
     else
     {
-        fprintf(stderr, "Error reading short: %d\n", status);
-        exit(EXIT_FAILURE);
+        baka("Error reading short: %d\n", status);
+        interpreter_exit(EXIT_FAILURE);
     }
     return 0;
 }
@@ -684,18 +821,18 @@ float slorp_float(float var) {
     }
     else if (status == INPUT_FLOAT_OVERFLOW)
     {
-        fprintf(stderr, "Error: Double value out of range.\n");
-        exit(EXIT_FAILURE);
+        baka("Error: Double value out of range.\n");
+        interpreter_exit(EXIT_FAILURE);
     }
     else if (status == INPUT_CONVERSION_ERROR)
     {
-        fprintf(stderr, "Error: Invalid float format.\n");
-        exit(EXIT_FAILURE);
+        baka("Error: Invalid float format.\n");
+        interpreter_exit(EXIT_FAILURE);
     }
     else
     {
-        fprintf(stderr, "Error reading float: %d\n", status);
-        exit(EXIT_FAILURE);
+        baka("Error reading float: %d\n", status);
+        interpreter_exit(EXIT_FAILURE);
     }
 }
 
@@ -709,36 +846,21 @@ double slorp_double(double var) {
     }
     else if (status == INPUT_DOUBLE_OVERFLOW)
     {
-        fprintf(stderr, "Error: Double value out of range.\n");
-        exit(EXIT_FAILURE);
+        baka("Error: Double value out of range.\n");
+        interpreter_exit(EXIT_FAILURE);
     }
     else if (status == INPUT_CONVERSION_ERROR)
     {
-        fprintf(stderr, "Error: Invalid double format.\n");
-        exit(EXIT_FAILURE);
+        baka("Error: Invalid double format.\n");
+        interpreter_exit(EXIT_FAILURE);
     }
     else
     {
-        fprintf(stderr, "Error reading double: %d\n", status);
-        exit(EXIT_FAILURE);
+        baka("Error reading double: %d\n", status);
+        interpreter_exit(EXIT_FAILURE);
     }
 }
 
-void cleanup() {
-    // Free the AST
-    free_ast();
-    
-    // Free the scope
-    free_scope(current_scope);
-
-    free_function_table();
-
-    CLEAN_JUMP_BUFFER();
-    
-    // Clean up flex's internal state
-    yylex_destroy();
-}
-
 TypeModifiers get_variable_modifiers(const char* name) {
     TypeModifiers mods = {false, false, false, false, false};  // Default modifiers
     Variable *var = get_variable(name); 
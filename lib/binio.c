@@ -0,0 +1,162 @@
+#include "binio.h"
+#include "input.h"
+#include "mem.h"
+#include <unistd.h>
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+#define BINIO_SWAP 1
+#endif
+
+#ifdef BINIO_SWAP
+// Reverses the bytes of each element in place
+static void swap_elements(unsigned char *p, size_t elem_size, size_t count)
+{
+    if (elem_size == 1)
+        return;
+    for (size_t i = 0; i < count; i++, p += elem_size)
+    {
+        for (size_t lo = 0, hi = elem_size - 1; lo < hi; lo++, hi--)
+        {
+            unsigned char t = p[lo];
+            p[lo] = p[hi];
+            p[hi] = t;
+        }
+    }
+}
+#endif
+
+// slorp may already have buffered part of stdin, so stdin goes through input.c
+static ssize_t read_some(int fd, void *dst, size_t len)
+{
+    return fd == STDIN_FILENO ? input_read_raw(dst, len) : read(fd, dst, len);
+}
+
+/**
+ * @brief Reads up to count elements from a file descriptor
+ * @param fd Descriptor to read from
+ * @param dst Destination buffer with room for count elements
+ * @param elem_size Size of one element in bytes
+ * @param count Maximum number of elements to read
+ * @return Elements read, fewer than count only at end of file, or -1 on a
+ *         read error or when the input ends partway through an element
+ *         (errno is EINVAL in that case)
+ *
+ * Reads go straight into dst in chunks of BINIO_CHUNK_BYTES, retrying
+ * short reads from pipes and interrupted calls.
+ */
+ssize_t binio_read(int fd, void *dst, size_t elem_size, size_t count)
+{
+    unsigned char *p = dst;
+    size_t want = elem_size * count;
+    size_t got = 0;
+
+    while (got < want)
+    {
+        size_t chunk = want - got < BINIO_CHUNK_BYTES ? want - got : BINIO_CHUNK_BYTES;
+        ssize_t n = read_some(fd, p + got, chunk);
+        if (n < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            return -1;
+        }
+        if (n == 0)
+            break;
+        got += (size_t)n;
+    }
+    if (got % elem_size != 0)
+    {
+        errno = EINVAL;
+        return -1;
+    }
+
+#ifdef BINIO_SWAP
+    swap_elements(p, elem_size, got / elem_size);
+#endif
+    return (ssize_t)(got / elem_size);
+}
+
+// Writes all of len bytes, retrying short and interrupted writes
+static int write_all(void *ctx, const void *data, size_t len)
+{
+    int fd = *(int *)ctx;
+    const unsigned char *p = data;
+    while (len > 0)
+    {
+        ssize_t n = write(fd, p, len);
+        if (n < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            return -1;
+        }
+        p += n;
+        len -= (size_t)n;
+    }
+    return 0;
+}
+
+/**
+ * @brief Writes count elements to a file descriptor
+ * @param fd Descriptor to write to
+ * @param src Elements to write
+ * @param elem_size Size of one element in bytes
+ * @param count Number of elements to write
+ * @return count on success, or -1 on a write error
+ */
+ssize_t binio_write(int fd, const void *src, size_t elem_size, size_t count)
+{
+    return binio_emit(write_all, &fd, src, elem_size, count);
+}
+
+/**
+ * @brief Hands count elements to a sink in little-endian blocks
+ * @param sink Called with each block in order
+ * @param ctx Passed to every call of sink
+ * @param src Elements to write
+ * @param elem_size Size of one element in bytes
+ * @param count Number of elements to write
+ * @return count on success, or -1 if the sink failed
+ *
+ * On little-endian hosts the array is handed over in place in chunks of
+ * BINIO_CHUNK_BYTES. Big-endian hosts byte-swap each chunk into a scratch
+ * buffer first so the source is left untouched.
+ */
+ssize_t binio_emit(binio_sink_fn sink, void *ctx, const void *src, size_t elem_size, size_t count)
+{
+    const unsigned char *p = src;
+    size_t left = elem_size * count;
+
+#ifdef BINIO_SWAP
+    size_t per_chunk = BINIO_CHUNK_BYTES / elem_size * elem_size;
+    unsigned char *scratch = safe_malloc(left < per_chunk ? left : per_chunk);
+    if (scratch == NULL && left > 0)
+        return -1;
+    while (left > 0)
+    {
+        size_t chunk = left < per_chunk ? left : per_chunk;
+        memcpy(scratch, p, chunk);
+        swap_elements(scratch, elem_size, chunk / elem_size);
+        if (sink(ctx, scratch, chunk) != 0)
+        {
+            int saved = errno;
+            SAFE_FREE(scratch);
+            errno = saved;
+            return -1;
+        }
+        p += chunk;
+        left -= chunk;
+    }
+    SAFE_FREE(scratch);
+#else
+    while (left > 0)
+    {
+        size_t chunk = left < BINIO_CHUNK_BYTES ? left : BINIO_CHUNK_BYTES;
+        if (sink(ctx, p, chunk) != 0)
+            return -1;
+        p += chunk;
+        left -= chunk;
+    }
+#endif
+    return (ssize_t)count;
+}
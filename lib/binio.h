@@ -0,0 +1,22 @@
+/* binio.h */
+
+#ifndef BINIO_H
+#define BINIO_H
+
+#include <stddef.h>
+#include <sys/types.h>
+
+// Largest single read(2)/write(2) issued; also the size of the byte-swap
+// scratch buffer on big-endian hosts.
+#define BINIO_CHUNK_BYTES ((size_t)8 << 20)
+
+// Both return the number of whole elements transferred, or -1 with errno set.
+// Data on disk is little-endian regardless of the host byte order.
+ssize_t binio_read(int fd, void *dst, size_t elem_size, size_t count);
+ssize_t binio_write(int fd, const void *src, size_t elem_size, size_t count);
+
+// Takes one block of bytes; returns 0, or -1 with errno set
+typedef int (*binio_sink_fn)(void *ctx, const void *data, size_t len);
+ssize_t binio_emit(binio_sink_fn sink, void *ctx, const void *src, size_t elem_size, size_t count);
+
+#endif
@@ -0,0 +1,105 @@
+#include "bitset.h"
+
+/*
+ * On x86-64 the word loops are compiled twice, once with the POPCNT
+ * instruction enabled, and the loader picks the variant the CPU supports.
+ * The baseline variant falls back to a bit-twiddling popcount.
+ */
+#if defined(__GNUC__) && !defined(__clang__) && defined(__x86_64__)
+#define BITSET_POPCNT_CLONES __attribute__((target_clones("popcnt", "default")))
+#else
+#define BITSET_POPCNT_CLONES
+#endif
+
+// Mask of bits [lo, hi) within one word, 0 <= lo < hi <= 64.
+static inline bitset_word range_mask(size_t lo, size_t hi)
+{
+    bitset_word upper = hi == BITSET_WORD_BITS ? ~(bitset_word)0 : ((bitset_word)1 << hi) - 1;
+    return upper & ~(((bitset_word)1 << lo) - 1);
+}
+
+/**
+ * @brief Counts the set bits in [from, to)
+ * @param bits Bitset storage
+ * @param from First bit to count
+ * @param to One past the last bit to count
+ * @return Number of set bits in the range
+ */
+BITSET_POPCNT_CLONES
+size_t bitset_count(const bitset_word *bits, size_t from, size_t to)
+{
+    if (from >= to)
+        return 0;
+
+    size_t first = from / BITSET_WORD_BITS;
+    size_t last = (to - 1) / BITSET_WORD_BITS;
+    size_t lo = from % BITSET_WORD_BITS;
+    size_t hi = (to - 1) % BITSET_WORD_BITS + 1;
+
+    if (first == last)
+        return __builtin_popcountll(bits[first] & range_mask(lo, hi));
+
+    size_t count = __builtin_popcountll(bits[first] & range_mask(lo, BITSET_WORD_BITS));
+    for (size_t w = first + 1; w < last; w++)
+    {
+        count += __builtin_popcountll(bits[w]);
+    }
+    count += __builtin_popcountll(bits[last] & range_mask(0, hi));
+    return count;
+}
+
+/**
+ * @brief Finds the first set bit at or after a position
+ * @param bits Bitset storage
+ * @param from Position to start searching from
+ * @param nbits Logical size of the bitset
+ * @return Index of the set bit, or nbits if there is none
+ *
+ * Skips whole zero words and locates the bit inside a word with a single
+ * count-trailing-zeros instruction.
+ */
+size_t bitset_find_next_set(const bitset_word *bits, size_t from, size_t nbits)
+{
+    if (from >= nbits)
+        return nbits;
+
+    size_t w = from / BITSET_WORD_BITS;
+    size_t words = bitset_words(nbits);
+    bitset_word word = bits[w] & ~(((bitset_word)1 << (from % BITSET_WORD_BITS)) - 1);
+    while (word == 0)
+    {
+        if (++w == words)
+            return nbits;
+        word = bits[w];
+    }
+
+    size_t pos = w * BITSET_WORD_BITS + __builtin_ctzll(word);
+    return pos < nbits ? pos : nbits;
+}
+
+/**
+ * @brief Sets or clears every bit in [from, to)
+ * @param bits Bitset storage
+ * @param from First bit to change
+ * @param to One past the last bit to change
+ * @param value Value to store
+ */
+void bitset_fill(bitset_word *bits, size_t from, size_t to, bool value)
+{
+    if (from >= to)
+        return;
+
+    size_t first = from / BITSET_WORD_BITS;
+    size_t last = (to - 1) / BITSET_WORD_BITS;
+    size_t lo = from % BITSET_WORD_BITS;
+    size_t hi = (to - 1) % BITSET_WORD_BITS + 1;
+
+    for (size_t w = first; w <= last; w++)
+    {
+        bitset_word mask = range_mask(w == first ? lo : 0, w == last ? hi : BITSET_WORD_BITS);
+        if (value)
+            bits[w] |= mask;
+        else
+            bits[w] &= ~mask;
+    }
+}
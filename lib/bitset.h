@@ -0,0 +1,48 @@
+/* bitset.h */
+
+#ifndef BITSET_H
+#define BITSET_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// cap arrays are stored as packed bitsets, one flag per bit.
+#define BITSET_WORD_BITS 64
+
+typedef uint64_t bitset_word;
+
+static inline size_t bitset_words(size_t nbits)
+{
+    return (nbits + BITSET_WORD_BITS - 1) / BITSET_WORD_BITS;
+}
+
+static inline bool bitset_get(const bitset_word *bits, size_t i)
+{
+    return (bits[i / BITSET_WORD_BITS] >> (i % BITSET_WORD_BITS)) & 1;
+}
+
+static inline void bitset_set(bitset_word *bits, size_t i, bool value)
+{
+    bitset_word mask = (bitset_word)1 << (i % BITSET_WORD_BITS);
+    if (value)
+        bits[i / BITSET_WORD_BITS] |= mask;
+    else
+        bits[i / BITSET_WORD_BITS] &= ~mask;
+}
+
+// For threads setting different flags that may share a word
+static inline void bitset_set_atomic(bitset_word *bits, size_t i, bool value)
+{
+    bitset_word mask = (bitset_word)1 << (i % BITSET_WORD_BITS);
+    if (value)
+        __atomic_fetch_or(&bits[i / BITSET_WORD_BITS], mask, __ATOMIC_RELAXED);
+    else
+        __atomic_fetch_and(&bits[i / BITSET_WORD_BITS], ~mask, __ATOMIC_RELAXED);
+}
+
+size_t bitset_count(const bitset_word *bits, size_t from, size_t to);
+size_t bitset_find_next_set(const bitset_word *bits, size_t from, size_t nbits);
+void bitset_fill(bitset_word *bits, size_t from, size_t to, bool value);
+
+#endif
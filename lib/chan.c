@@ -0,0 +1,352 @@
+#include "chan.h"
+#include "mem.h"
+#include "pool.h"
+#include <limits.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <string.h>
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+#include <time.h>
+
+/*
+ * Bounded ring buffers. The general channel is Vyukov's MPMC queue: each
+ * slot carries a sequence number saying whether it is ready to be written
+ * or read on the current lap, so senders and receivers claim slots with
+ * one compare-and-swap and never take a lock. A channel with one sender
+ * and one receiver needs no claiming at all, only the two indices.
+ *
+ * Blocking is the slow path. A sender that finds the ring full sleeps on a
+ * futex word that receivers bump after every message, and the other way
+ * round; the wake system call is only made when someone is waiting. The
+ * sleep is bounded so a waiter also notices the channel's cancel flag,
+ * which nothing that sets it knows to wake it for.
+ */
+
+#define CHAN_CACHE_LINE 64
+#define CHAN_SPINS 32
+#define CHAN_CANCEL_POLL_NS 10000000 // 10ms
+
+struct Channel
+{
+    size_t mask; // capacity - 1; the capacity is a power of two
+    size_t elem_size;
+    bool single;
+    const atomic_bool *cancel; // or NULL
+    unsigned char *data;
+    atomic_size_t *seq; // per-slot lap counters, general channels only
+
+    // Senders and receivers each get their own cache line
+    char pad_head[CHAN_CACHE_LINE];
+    atomic_size_t head; // next slot to receive from
+    char pad_tail[CHAN_CACHE_LINE];
+    atomic_size_t tail; // next slot to send into
+    char pad_wait[CHAN_CACHE_LINE];
+
+    atomic_uint sent;     // futex words, bumped after every message...
+    atomic_uint received; // ...in each direction
+    atomic_uint send_waiters;
+    atomic_uint recv_waiters;
+    atomic_bool closed;
+    atomic_bool sending;   // single channels only: a send...
+    atomic_bool receiving; // ...or a recv is under way
+};
+
+static void futex_wait(atomic_uint *word, unsigned int seen)
+{
+#ifdef __linux__
+    struct timespec timeout = {0, CHAN_CANCEL_POLL_NS};
+    syscall(SYS_futex, (unsigned int *)word, FUTEX_WAIT_PRIVATE, seen, &timeout, NULL, 0);
+#else
+    // No futex: poll
+    (void)word;
+    (void)seen;
+    struct timespec pause = {0, 100000};
+    nanosleep(&pause, NULL);
+#endif
+}
+
+static void futex_wake(atomic_uint *word)
+{
+#ifdef __linux__
+    syscall(SYS_futex, (unsigned int *)word, FUTEX_WAKE_PRIVATE, INT_MAX, NULL, NULL, 0);
+#else
+    (void)word;
+#endif
+}
+
+static void notify(atomic_uint *word, atomic_uint *waiters)
+{
+    atomic_fetch_add(word, 1);
+    if (atomic_load(waiters) > 0)
+        futex_wake(word);
+}
+
+static bool cancelled(const Channel *ch)
+{
+    return ch->cancel != NULL && atomic_load_explicit(ch->cancel, memory_order_relaxed);
+}
+
+static inline void *slot(Channel *ch, size_t pos)
+{
+    return ch->data + (pos & ch->mask) * ch->elem_size;
+}
+
+static bool try_send(Channel *ch, const void *elem)
+{
+    if (ch->single)
+    {
+        size_t tail = atomic_load_explicit(&ch->tail, memory_order_relaxed);
+        if (tail - atomic_load_explicit(&ch->head, memory_order_acquire) > ch->mask)
+            return false;
+        memcpy(slot(ch, tail), elem, ch->elem_size);
+        atomic_store_explicit(&ch->tail, tail + 1, memory_order_release);
+        return true;
+    }
+
+    size_t pos = atomic_load_explicit(&ch->tail, memory_order_relaxed);
+    for (;;)
+    {
+        size_t seq = atomic_load_explicit(&ch->seq[pos & ch->mask], memory_order_acquire);
+        intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+        if (diff == 0)
+        {
+            // The slot is free on this lap; claim it
+            if (atomic_compare_exchange_weak_explicit(&ch->tail, &pos, pos + 1,
+                                                      memory_order_relaxed, memory_order_relaxed))
+            {
+                memcpy(slot(ch, pos), elem, ch->elem_size);
+                atomic_store_explicit(&ch->seq[pos & ch->mask], pos + 1, memory_order_release);
+                return true;
+            }
+        }
+        else if (diff < 0)
+        {
+            return false; // still holds last lap's message: full
+        }
+        else
+        {
+            pos = atomic_load_explicit(&ch->tail, memory_order_relaxed);
+        }
+    }
+}
+
+static bool try_recv(Channel *ch, void *elem)
+{
+    if (ch->single)
+    {
+        size_t head = atomic_load_explicit(&ch->head, memory_order_relaxed);
+        if (atomic_load_explicit(&ch->tail, memory_order_acquire) == head)
+            return false;
+        memcpy(elem, slot(ch, head), ch->elem_size);
+        atomic_store_explicit(&ch->head, head + 1, memory_order_release);
+        return true;
+    }
+
+    size_t pos = atomic_load_explicit(&ch->head, memory_order_relaxed);
+    for (;;)
+    {
+        size_t seq = atomic_load_explicit(&ch->seq[pos & ch->mask], memory_order_acquire);
+        intptr_t diff = (intptr_t)seq - (intptr_t)(pos + 1);
+        if (diff == 0)
+        {
+            if (atomic_compare_exchange_weak_explicit(&ch->head, &pos, pos + 1,
+                                                      memory_order_relaxed, memory_order_relaxed))
+            {
+                memcpy(elem, slot(ch, pos), ch->elem_size);
+                // Free the slot for the sender one lap ahead
+                atomic_store_explicit(&ch->seq[pos & ch->mask], pos + ch->mask + 1, memory_order_release);
+                return true;
+            }
+        }
+        else if (diff < 0)
+        {
+            return false; // not written yet on this lap: empty
+        }
+        else
+        {
+            pos = atomic_load_explicit(&ch->head, memory_order_relaxed);
+        }
+    }
+}
+
+static size_t queued_messages(Channel *ch)
+{
+    return atomic_load(&ch->tail) - atomic_load(&ch->head);
+}
+
+/**
+ * @brief Creates an empty open channel
+ * @param capacity Messages it holds before senders block; rounded up to a power of two
+ * @param elem_size Size of one message in bytes
+ * @param single True if only one thread sends and only one receives at a time
+ * @param cancel Flag that, once set, makes waiting sends and receives give
+ * up with CHAN_CANCELLED; may be NULL
+ * @return The channel, to be released with chan_free()
+ */
+Channel *chan_new(size_t capacity, size_t elem_size, bool single, const atomic_bool *cancel)
+{
+    size_t size = 1;
+    while (size < capacity)
+        size <<= 1;
+
+    Channel *ch = SAFE_MALLOC(Channel);
+    ch->mask = size - 1;
+    ch->elem_size = elem_size;
+    ch->single = single;
+    ch->cancel = cancel;
+    ch->data = safe_malloc_array(size, elem_size);
+    if (!single)
+    {
+        ch->seq = safe_malloc_array(size, sizeof(atomic_size_t));
+        for (size_t i = 0; i < size; i++)
+            atomic_init(&ch->seq[i], i);
+    }
+    return ch;
+}
+
+/**
+ * @brief Releases a channel nobody uses any more
+ * @param ch Channel to free, or NULL
+ */
+void chan_free(Channel *ch)
+{
+    if (ch == NULL)
+        return;
+    SAFE_FREE(ch->data);
+    SAFE_FREE(ch->seq);
+    SAFE_FREE(ch);
+}
+
+size_t chan_capacity(const Channel *ch)
+{
+    return ch->mask + 1;
+}
+
+bool chan_is_single(const Channel *ch)
+{
+    return ch->single;
+}
+
+static ChanStatus send_message(Channel *ch, const void *elem)
+{
+    for (int spins = 0;; spins++)
+    {
+        if (atomic_load(&ch->closed))
+            return CHAN_CLOSED;
+        if (cancelled(ch))
+            return CHAN_CANCELLED;
+        if (try_send(ch, elem))
+        {
+            notify(&ch->sent, &ch->recv_waiters);
+            return CHAN_OK;
+        }
+        if (spins < CHAN_SPINS)
+        {
+            sched_yield();
+            continue;
+        }
+
+        // Register first, then look again, so a receiver that frees a slot
+        // in between either wakes us or changes the word we sleep on
+        unsigned int seen = atomic_load(&ch->received);
+        atomic_fetch_add(&ch->send_waiters, 1);
+        if (!atomic_load(&ch->closed) && !cancelled(ch) && queued_messages(ch) > ch->mask)
+        {
+            pool_will_block();
+            futex_wait(&ch->received, seen);
+        }
+        atomic_fetch_sub(&ch->send_waiters, 1);
+    }
+}
+
+static ChanStatus recv_message(Channel *ch, void *elem)
+{
+    for (int spins = 0;; spins++)
+    {
+        if (try_recv(ch, elem))
+        {
+            notify(&ch->received, &ch->send_waiters);
+            return CHAN_OK;
+        }
+        if (atomic_load(&ch->closed))
+        {
+            // Messages sent before the close are visible now
+            if (try_recv(ch, elem))
+            {
+                notify(&ch->received, &ch->send_waiters);
+                return CHAN_OK;
+            }
+            return CHAN_CLOSED;
+        }
+        if (cancelled(ch))
+            return CHAN_CANCELLED;
+        if (spins < CHAN_SPINS)
+        {
+            sched_yield();
+            continue;
+        }
+
+        unsigned int seen = atomic_load(&ch->sent);
+        atomic_fetch_add(&ch->recv_waiters, 1);
+        if (!atomic_load(&ch->closed) && !cancelled(ch) && queued_messages(ch) == 0)
+        {
+            pool_will_block();
+            futex_wait(&ch->sent, seen);
+        }
+        atomic_fetch_sub(&ch->recv_waiters, 1);
+    }
+}
+
+/**
+ * @brief Sends a message, waiting while the channel is full
+ * @param ch Channel
+ * @param elem Message of the channel's element size
+ * @return CHAN_OK, CHAN_CLOSED if the channel is closed, CHAN_CANCELLED if
+ * its cancel flag is set, or CHAN_BUSY if it is single and another thread
+ * is sending on it
+ */
+ChanStatus chan_send(Channel *ch, const void *elem)
+{
+    // The single ring has no claiming, so a second sender would corrupt it
+    if (ch->single && atomic_exchange(&ch->sending, true))
+        return CHAN_BUSY;
+    ChanStatus status = send_message(ch, elem);
+    if (ch->single)
+        atomic_store(&ch->sending, false);
+    return status;
+}
+
+/**
+ * @brief Receives a message, waiting while the channel is empty
+ * @param ch Channel
+ * @param elem Where to store the message
+ * @return CHAN_OK, CHAN_CLOSED once the channel is closed and drained,
+ * CHAN_CANCELLED if its cancel flag is set while it is empty, or CHAN_BUSY
+ * if it is single and another thread is receiving from it
+ */
+ChanStatus chan_recv(Channel *ch, void *elem)
+{
+    if (ch->single && atomic_exchange(&ch->receiving, true))
+        return CHAN_BUSY;
+    ChanStatus status = recv_message(ch, elem);
+    if (ch->single)
+        atomic_store(&ch->receiving, false);
+    return status;
+}
+
+/**
+ * @brief Closes a channel: later sends fail, and receivers drain what is
+ * left and then see CHAN_CLOSED
+ * @param ch Channel
+ */
+void chan_close(Channel *ch)
+{
+    atomic_store(&ch->closed, true);
+    notify(&ch->sent, &ch->recv_waiters);
+    notify(&ch->received, &ch->send_waiters);
+}
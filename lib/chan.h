@@ -0,0 +1,31 @@
+/* chan.h */
+
+#ifndef CHAN_H
+#define CHAN_H
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// A bounded queue of fixed-size messages between threads. A channel made
+// for a single sender and a single receiver is cheaper per message.
+typedef struct Channel Channel;
+
+typedef enum
+{
+    CHAN_OK,
+    CHAN_CLOSED,    // send on a closed channel, or recv on a closed and empty one
+    CHAN_BUSY,      // a second thread sending, or receiving, on a single channel
+    CHAN_CANCELLED, // the cancel flag given to chan_new was set while waiting
+} ChanStatus;
+
+Channel *chan_new(size_t capacity, size_t elem_size, bool single, const atomic_bool *cancel);
+void chan_free(Channel *ch);
+size_t chan_capacity(const Channel *ch);
+bool chan_is_single(const Channel *ch);
+
+ChanStatus chan_send(Channel *ch, const void *elem);
+ChanStatus chan_recv(Channel *ch, void *elem);
+void chan_close(Channel *ch);
+
+#endif
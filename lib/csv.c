@@ -0,0 +1,136 @@
+#include "csv.h"
+#include <string.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+static inline bool is_field_blank(char c)
+{
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+/**
+ * @brief Finds the first delimiter or newline in [p, end)
+ * @param p Start of the text to scan
+ * @param end End of the text
+ * @param delim Field delimiter
+ * @return Pointer to the delimiter or newline, or end if there is none
+ *
+ * With SSE2 sixteen bytes are compared against both characters at once and
+ * the first hit is located from the combined byte mask.
+ */
+const char *csv_find_stop(const char *p, const char *end, char delim)
+{
+#if defined(__SSE2__)
+    const __m128i newline = _mm_set1_epi8('\n');
+    const __m128i separator = _mm_set1_epi8(delim);
+    while (end - p >= 16)
+    {
+        __m128i bytes = _mm_loadu_si128((const __m128i *)p);
+        __m128i hits = _mm_or_si128(_mm_cmpeq_epi8(bytes, newline), _mm_cmpeq_epi8(bytes, separator));
+        int mask = _mm_movemask_epi8(hits);
+        if (mask != 0)
+            return p + __builtin_ctz((unsigned)mask);
+        p += 16;
+    }
+#endif
+    while (p < end && *p != '\n' && *p != delim)
+        p++;
+    return p;
+}
+
+/**
+ * @brief Starts reading delimited text
+ * @param r Reader to initialize
+ * @param data Text to read; it need not be null-terminated
+ * @param len Length of the text
+ * @param delim Field delimiter
+ */
+void csv_init(CsvReader *r, const char *data, size_t len, char delim)
+{
+    r->pos = data;
+    r->end = data + len;
+    r->delim = delim;
+    r->row_open = false;
+    r->line = 1;
+    r->row_line = 1;
+}
+
+/**
+ * @brief Moves to the start of the next non-blank row
+ * @param r Reader
+ * @return false at end of data
+ *
+ * Any fields of the current row that were not read are skipped.
+ */
+bool csv_begin_row(CsvReader *r)
+{
+    if (r->row_open)
+    {
+        const char *nl = memchr(r->pos, '\n', (size_t)(r->end - r->pos));
+        r->pos = nl ? nl + 1 : r->end;
+        r->line += nl != NULL;
+        r->row_open = false;
+    }
+
+    for (;;)
+    {
+        const char *p = r->pos;
+        while (p < r->end && is_field_blank(*p))
+            p++;
+        if (p == r->end)
+        {
+            r->pos = p;
+            return false;
+        }
+        if (*p != '\n')
+            break;
+        r->pos = p + 1;
+        r->line++;
+    }
+
+    r->row_open = true;
+    r->row_line = r->line;
+    return true;
+}
+
+/**
+ * @brief Returns the next field of the current row
+ * @param r Reader
+ * @param field Set to the start of the field, with blanks and one pair of
+ *              surrounding double quotes removed
+ * @param length Set to the length of the field
+ * @return false if the current row has no more fields
+ */
+bool csv_next_field(CsvReader *r, const char **field, size_t *length)
+{
+    if (!r->row_open)
+        return false;
+
+    const char *start = r->pos;
+    const char *stop = csv_find_stop(start, r->end, r->delim);
+    if (stop == r->end || *stop == '\n')
+    {
+        r->row_open = false;
+        r->pos = stop == r->end ? stop : stop + 1;
+        r->line += stop != r->end;
+    }
+    else
+    {
+        r->pos = stop + 1;
+    }
+
+    while (start < stop && is_field_blank(*start))
+        start++;
+    while (stop > start && is_field_blank(stop[-1]))
+        stop--;
+    if (stop - start >= 2 && *start == '"' && stop[-1] == '"')
+    {
+        start++;
+        stop--;
+    }
+    *field = start;
+    *length = (size_t)(stop - start);
+    return true;
+}
@@ -0,0 +1,26 @@
+/* csv.h */
+
+#ifndef CSV_H
+#define CSV_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+// Cursor over delimited text held in memory. Rows end at '\n' (a '\r'
+// before it is trimmed with the field); blank rows are skipped.
+typedef struct
+{
+    const char *pos;
+    const char *end;
+    char delim;
+    bool row_open;
+    size_t line;     // line of pos, 1-based
+    size_t row_line; // line of the current row
+} CsvReader;
+
+void csv_init(CsvReader *r, const char *data, size_t len, char delim);
+bool csv_begin_row(CsvReader *r);
+bool csv_next_field(CsvReader *r, const char **field, size_t *length);
+const char *csv_find_stop(const char *p, const char *end, char delim);
+
+#endif
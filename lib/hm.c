@@ -1,4 +1,5 @@
 #include "../ast.h"
+#include "chan.h"
 #include "hm.h"
 #include "mem.h"
 
@@ -40,7 +41,7 @@ bool key_equal(const void *a, const void *b, size_t len)
 
 /**
  * @brief Creates a new empty hashmap
- * @return HashMap* Pointer to newly allocated hashmap
+ * @return HashMap* Pointer to newly allocated hashmap, or NULL if out of memory
  *
  * Allocates and initializes a new hashmap with default initial capacity.
  * The nodes array is zero-initialized.
@@ -49,9 +50,13 @@ bool key_equal(const void *a, const void *b, size_t len)
 HashMap *hm_new()
 {
     HashMap *hm = SAFE_MALLOC(HashMap);
+    if (hm == NULL)
+        return NULL;
     hm->capacity = INIT_CAPACITY;
     hm->size = 0;
     hm->nodes = SAFE_CALLOC(hm->capacity, HashMapNode *);
+    if (hm->nodes == NULL)
+        SAFE_FREE(hm);
     return hm;
 }
 
@@ -136,7 +141,7 @@ void *hm_get(HashMap *hm, const void *key, size_t key_size)
         if (!node)
             return NULL; // Empty slot means key not found
 
-        if (key_equal(node->key, key, key_size))
+        if (node->key_size == key_size && key_equal(node->key, key, key_size))
         {
             return node->value;
         }
@@ -173,7 +178,7 @@ void hm_put(HashMap *hm, const void *key, size_t key_size, void *value, size_t v
     while (hm->nodes[index])
     {
         HashMapNode *node = hm->nodes[index];
-        if (key_equal(node->key, key, key_size))
+        if (node->key_size == key_size && key_equal(node->key, key, key_size))
         {
             // Update existing value
             void *new_value = safe_malloc(value_size);
@@ -219,6 +224,59 @@ void hm_put(HashMap *hm, const void *key, size_t key_size, void *value, size_t v
     hm->size++;
 }
 
+/**
+ * @brief Removes a key and its value from the hashmap
+ * @param hm Pointer to the hashmap
+ * @param key Pointer to the key
+ * @param key_size Size of the key in bytes
+ * @return true if the key was present, false otherwise
+ *
+ * Uses backward-shift deletion instead of tombstones: entries after the
+ * freed slot are moved back whenever their home slot allows it, so every
+ * probe sequence stays unbroken and lookups never scan dead slots.
+ */
+bool hm_remove(HashMap *hm, const void *key, size_t key_size)
+{
+    size_t index = fnv1a_hash(key, key_size) % hm->capacity;
+    size_t probes = 0;
+
+    for (;;)
+    {
+        HashMapNode *node = hm->nodes[index];
+        if (!node || ++probes > hm->capacity)
+            return false;
+        if (node->key_size == key_size && key_equal(node->key, key, key_size))
+            break;
+        index = (index + 1) % hm->capacity;
+    }
+
+    SAFE_FREE(hm->nodes[index]->key);
+    SAFE_FREE(hm->nodes[index]->value);
+    SAFE_FREE(hm->nodes[index]);
+    hm->size--;
+
+    size_t hole = index;
+    size_t next = (hole + 1) % hm->capacity;
+    while (hm->nodes[next])
+    {
+        HashMapNode *node = hm->nodes[next];
+        size_t home = fnv1a_hash(node->key, node->key_size) % hm->capacity;
+
+        // The entry may fill the hole unless its home lies cyclically in
+        // (hole, next], in which case moving it would put it before home.
+        bool stays = (hole <= next) ? (hole < home && home <= next)
+                                    : (hole < home || home <= next);
+        if (!stays)
+        {
+            hm->nodes[hole] = node;
+            hm->nodes[next] = NULL;
+            hole = next;
+        }
+        next = (next + 1) % hm->capacity;
+    }
+    return true;
+}
+
 /**
  * @brief Frees all memory associated with a hashmap
  * @param hm Pointer to hashmap to free
@@ -237,7 +295,19 @@ void hm_free(HashMap *hm)
             Variable *var = hm->nodes[i]->value;
             if (var != NULL)
             {
-                if (var->is_array)
+                if (var->is_array && !var->is_view)
+                {
+                    SAFE_FREE(var->value.array_data);
+                }
+                else if (var->is_map)
+                {
+                    hm_free_raw(var->value.map_data);
+                }
+                else if (var->is_channel && !var->is_view)
+                {
+                    chan_free(var->value.channel_data);
+                }
+                else if (var->struct_def)
                 {
                     SAFE_FREE(var->value.array_data);
                 }
@@ -250,3 +320,27 @@ void hm_free(HashMap *hm)
     SAFE_FREE(hm->nodes);
     SAFE_FREE(hm);
 }
+
+/**
+ * @brief Frees a hashmap whose values are plain data
+ * @param hm Pointer to hashmap to free
+ *
+ * Like hm_free(), but does not treat values as Variables, so it is safe for
+ * maps holding scalars such as the language's lore maps.
+ */
+void hm_free_raw(HashMap *hm)
+{
+    if (!hm)
+        return;
+    for (size_t i = 0; i < hm->capacity; i++)
+    {
+        if (hm->nodes[i])
+        {
+            SAFE_FREE(hm->nodes[i]->key);
+            SAFE_FREE(hm->nodes[i]->value);
+            SAFE_FREE(hm->nodes[i]);
+        }
+    }
+    SAFE_FREE(hm->nodes);
+    SAFE_FREE(hm);
+}
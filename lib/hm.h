@@ -18,7 +18,7 @@ typedef struct
     size_t value_size;
 } HashMapNode;
 
-typedef struct
+typedef struct HashMap
 {
     HashMapNode **nodes;
     size_t size;
@@ -32,6 +32,8 @@ void hm_resize(HashMap *hm);
 void dump(HashMap *hm);
 void *hm_get(HashMap *hm, const void *key, size_t key_size);
 void hm_put(HashMap *hm, const void *key, size_t key_size, void *value, size_t value_size);
+bool hm_remove(HashMap *hm, const void *key, size_t key_size);
 void hm_free(HashMap *hm);
+void hm_free_raw(HashMap *hm);
 
 #endif
@@ -5,14 +5,481 @@
  */
 
 #include "input.h"
+#include <float.h>
+#include <math.h>
+#include <stdbool.h>
+#include <unistd.h>
+
+/*
+ * Input is read in large blocks into a single buffer that both the
+ * line-based readers and the token scanner consume from, so the two can be
+ * mixed freely. Nothing else in the interpreter reads stdin.
+ */
+struct InputSource
+{
+    input_read_fn read;
+    void *ctx;
+    char *data; // INPUT_BUFFER_SIZE bytes, allocated by the first read
+    size_t pos;
+    size_t len;
+    bool eof;
+    bool error;
+    size_t line;
+    size_t token_line;
+};
+
+static ssize_t read_stdin(void *ctx, void *dst, size_t len)
+{
+    (void)ctx;
+    return read(STDIN_FILENO, dst, len);
+}
+
+static char stdin_data[INPUT_BUFFER_SIZE];
+static InputSource stdin_source = {.read = read_stdin, .data = stdin_data, .line = 1, .token_line = 1};
+
+// What the readers on this thread consume; NULL for stdin
+static _Thread_local InputSource *current;
+
+static InputSource *active(void)
+{
+    return current ? current : &stdin_source;
+}
+
+/**
+ * Creates an input source that reads through a callback
+ *
+ * @param read Called like read(2) whenever the buffer runs dry
+ * @param ctx Passed to every call of read
+ * @return The source, or NULL if out of memory
+ */
+InputSource *input_source_new(input_read_fn read, void *ctx)
+{
+    InputSource *source = calloc(1, sizeof(InputSource));
+    if (source == NULL)
+    {
+        return NULL;
+    }
+    source->read = read;
+    source->ctx = ctx;
+    source->line = 1;
+    source->token_line = 1;
+    return source;
+}
+
+void input_source_free(InputSource *source)
+{
+    if (source != NULL)
+    {
+        free(source->data);
+        free(source);
+    }
+}
+
+/**
+ * Selects what the input functions read on the calling thread
+ *
+ * @param source Source to read, or NULL for stdin
+ * @return The source that was selected before
+ */
+InputSource *input_use(InputSource *source)
+{
+    InputSource *previous = current;
+    current = source;
+    return previous;
+}
+
+/*
+ * Moves unread bytes to the front of the buffer and appends one read(2)
+ * worth of input. Returns false at end of input, on an I/O error, or when
+ * the buffer is already full of unread bytes.
+ */
+static bool refill(InputSource *in)
+{
+    if (in->data == NULL && (in->data = malloc(INPUT_BUFFER_SIZE)) == NULL)
+    {
+        in->error = true;
+        in->eof = true;
+    }
+    if (in->eof)
+    {
+        return false;
+    }
+    if (in->pos > 0)
+    {
+        memmove(in->data, in->data + in->pos, in->len - in->pos);
+        in->len -= in->pos;
+        in->pos = 0;
+    }
+    if (in->len == INPUT_BUFFER_SIZE)
+    {
+        return false;
+    }
+
+    for (;;)
+    {
+        ssize_t n = in->read(in->ctx, in->data + in->len, INPUT_BUFFER_SIZE - in->len);
+        if (n < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (n <= 0)
+        {
+            in->error = n < 0;
+            in->eof = true;
+            return false;
+        }
+        in->len += (size_t)n;
+        return true;
+    }
+}
+
+static int next_byte(InputSource *in)
+{
+    if (in->pos == in->len && !refill(in))
+    {
+        return EOF;
+    }
+    char c = in->data[in->pos++];
+    if (c == '\n')
+    {
+        in->line++;
+    }
+    return (unsigned char)c;
+}
+
+static inline bool is_blank(char c)
+{
+    return c == ' ' || c == '\n' || c == '\t' || c == '\r' || c == '\v' || c == '\f';
+}
+
+/*
+ * Skips whitespace and returns the next token, which stays valid until the
+ * next read from the buffer. Returns NULL at end of input.
+ */
+static const char *next_token(InputSource *in, size_t *length)
+{
+    for (;;)
+    {
+        while (in->pos < in->len && is_blank(in->data[in->pos]))
+        {
+            if (in->data[in->pos] == '\n')
+            {
+                in->line++;
+            }
+            in->pos++;
+        }
+        if (in->pos < in->len)
+        {
+            break;
+        }
+        if (!refill(in))
+        {
+            return NULL;
+        }
+    }
+
+    size_t end = in->pos;
+    for (;;)
+    {
+        while (end < in->len && !is_blank(in->data[end]))
+        {
+            end++;
+        }
+        if (end < in->len)
+        {
+            break;
+        }
+        // The token runs to the end of the buffer; keep it and read more.
+        size_t scanned = end - in->pos;
+        bool more = refill(in);
+        end = in->pos + scanned;
+        if (!more)
+        {
+            break;
+        }
+    }
+
+    in->token_line = in->line;
+    *length = end - in->pos;
+    const char *token = in->data + in->pos;
+    in->pos = end;
+    return token;
+}
+
+/**
+ * Parses a decimal integer in [min, max] from text that is not null-terminated
+ *
+ * Unlike strtol this ignores the locale and rejects anything but an
+ * optional sign followed by digits.
+ *
+ * @param s Start of the text
+ * @param n Length of the text
+ * @param min Smallest accepted value
+ * @param max Largest accepted value
+ * @param overflow Status to return when the value is out of range
+ * @param value Pointer to store the value
+ * @return input_status indicating success or type of error
+ */
+input_status input_parse_long(const char *s, size_t n, long min, long max, input_status overflow, long *value)
+{
+    size_t i = 0;
+    bool negative = false;
+    if (i < n && (s[i] == '+' || s[i] == '-'))
+    {
+        negative = s[i++] == '-';
+    }
+    if (i == n)
+    {
+        return INPUT_CONVERSION_ERROR;
+    }
+
+    unsigned long limit = negative ? (unsigned long)-(min + 1) + 1 : (unsigned long)max;
+    unsigned long result = 0;
+    bool too_big = false;
+    for (; i < n; i++)
+    {
+        unsigned digit = (unsigned)(s[i] - '0');
+        if (digit > 9)
+        {
+            return INPUT_CONVERSION_ERROR;
+        }
+        if (result > (limit - digit) / 10)
+        {
+            too_big = true;
+        }
+        result = result * 10 + digit;
+    }
+    if (too_big)
+    {
+        return overflow;
+    }
+
+    *value = negative ? (long)(0 - result) : (long)result;
+    return INPUT_SUCCESS;
+}
+
+// Powers of ten that are exact doubles
+static const double exact_powers_of_ten[] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+
+/**
+ * Parses a floating-point number from text that is not null-terminated
+ *
+ * Plain decimals with at most 19 significant digits whose mantissa and
+ * power of ten are both exact doubles are converted with one multiply or
+ * divide, which rounds correctly. Anything else (long mantissas, large
+ * exponents, inf, nan, hex) goes to strtod.
+ *
+ * @param s Start of the text
+ * @param n Length of the text
+ * @param value Pointer to store the value
+ * @return input_status indicating success or type of error
+ */
+input_status input_parse_double(const char *s, size_t n, double *value)
+{
+    size_t i = 0;
+    bool negative = false;
+    if (i < n && (s[i] == '+' || s[i] == '-'))
+    {
+        negative = s[i++] == '-';
+    }
+
+    uint64_t mantissa = 0;
+    int significant = 0;
+    int exponent = 0;
+    bool any_digits = false;
+    bool exact = true;
+    for (; i < n && (unsigned)(s[i] - '0') <= 9; i++)
+    {
+        any_digits = true;
+        if (significant < 19)
+        {
+            mantissa = mantissa * 10 + (unsigned)(s[i] - '0');
+            significant += mantissa != 0;
+        }
+        else
+        {
+            exact = false;
+        }
+    }
+    if (i < n && s[i] == '.')
+    {
+        for (i++; i < n && (unsigned)(s[i] - '0') <= 9; i++)
+        {
+            any_digits = true;
+            if (significant < 19)
+            {
+                mantissa = mantissa * 10 + (unsigned)(s[i] - '0');
+                significant += mantissa != 0;
+                exponent--;
+            }
+            else
+            {
+                exact = false;
+            }
+        }
+    }
+    if (any_digits && i < n && (s[i] == 'e' || s[i] == 'E'))
+    {
+        size_t j = i + 1;
+        bool negative_exponent = false;
+        if (j < n && (s[j] == '+' || s[j] == '-'))
+        {
+            negative_exponent = s[j++] == '-';
+        }
+        int e = 0;
+        size_t first_digit = j;
+        for (; j < n && (unsigned)(s[j] - '0') <= 9; j++)
+        {
+            if (e < 100000)
+            {
+                e = e * 10 + (s[j] - '0');
+            }
+        }
+        if (j > first_digit)
+        {
+            exponent += negative_exponent ? -e : e;
+            i = j;
+        }
+    }
+
+    if (any_digits && i == n && exact && mantissa <= ((uint64_t)1 << 53) && exponent >= -22 && exponent <= 22)
+    {
+        double result = (double)mantissa;
+        result = exponent < 0 ? result / exact_powers_of_ten[-exponent] : result * exact_powers_of_ten[exponent];
+        *value = negative ? -result : result;
+        return INPUT_SUCCESS;
+    }
+
+    char buffer[128];
+    if (n >= sizeof(buffer))
+    {
+        return INPUT_CONVERSION_ERROR;
+    }
+    memcpy(buffer, s, n);
+    buffer[n] = '\0';
+    errno = 0;
+    char *endptr;
+    double result = strtod(buffer, &endptr);
+    // An empty field leaves endptr at buffer + 0 as well
+    if (endptr == buffer || endptr != buffer + n)
+    {
+        return INPUT_CONVERSION_ERROR;
+    }
+    if (errno == ERANGE)
+    {
+        return INPUT_DOUBLE_OVERFLOW;
+    }
+    *value = result;
+    return INPUT_SUCCESS;
+}
+
+/*
+ * Defines input_<name>_array: scan tokens with next_token and convert each
+ * with PARSE, a statement that sets `status` and stores into `dst[i]`.
+ */
+#define DEFINE_INPUT_ARRAY(name, type, PARSE)                                  \
+    input_status input_##name##_array(type *dst, size_t count, size_t *values_read) \
+    {                                                                          \
+        if (dst == NULL || values_read == NULL)                                \
+        {                                                                      \
+            return INPUT_NULL_PTR;                                             \
+        }                                                                      \
+        InputSource *in = active();                                            \
+        size_t i = 0;                                                          \
+        input_status status = INPUT_SUCCESS;                                   \
+        for (; i < count; i++)                                                 \
+        {                                                                      \
+            size_t len;                                                        \
+            const char *token = next_token(in, &len);                          \
+            if (token == NULL)                                                 \
+            {                                                                  \
+                break;                                                         \
+            }                                                                  \
+            PARSE;                                                             \
+            if (status != INPUT_SUCCESS)                                       \
+            {                                                                  \
+                break;                                                         \
+            }                                                                  \
+        }                                                                      \
+        *values_read = i;                                                      \
+        if (status == INPUT_SUCCESS && in->error)                              \
+        {                                                                      \
+            status = INPUT_IO_ERROR;                                           \
+        }                                                                      \
+        return status;                                                         \
+    }
+
+DEFINE_INPUT_ARRAY(int, int, {
+    long v = 0;
+    status = input_parse_long(token, len, INT_MIN, INT_MAX, INPUT_INTEGER_OVERFLOW, &v);
+    dst[i] = (int)v;
+})
+
+DEFINE_INPUT_ARRAY(short, short, {
+    long v = 0;
+    status = input_parse_long(token, len, SHRT_MIN, SHRT_MAX, INPUT_SHORT_OVERFLOW, &v);
+    dst[i] = (short)v;
+})
+
+DEFINE_INPUT_ARRAY(float, float, {
+    double v = 0.0;
+    status = input_parse_double(token, len, &v);
+    if (status == INPUT_DOUBLE_OVERFLOW || (status == INPUT_SUCCESS && isfinite(v) && fabs(v) > FLT_MAX))
+    {
+        status = INPUT_FLOAT_OVERFLOW;
+    }
+    dst[i] = (float)v;
+})
+
+DEFINE_INPUT_ARRAY(double, double, {
+    double v = 0.0;
+    status = input_parse_double(token, len, &v);
+    dst[i] = v;
+})
+
+/**
+ * Reads raw bytes from the input, handing out any buffered input first
+ *
+ * @param dst Destination buffer
+ * @param len Maximum number of bytes to read
+ * @return Bytes read, 0 at end of input, or -1 with errno set, like read(2)
+ */
+ssize_t input_read_raw(void *dst, size_t len)
+{
+    InputSource *in = active();
+    size_t buffered = in->len - in->pos;
+    if (buffered > 0)
+    {
+        size_t n = buffered < len ? buffered : len;
+        memcpy(dst, in->data + in->pos, n);
+        in->pos += n;
+        return (ssize_t)n;
+    }
+    if (in->eof)
+    {
+        return 0;
+    }
+    return in->read(in->ctx, dst, len);
+}
+
+/**
+ * Returns the 1-based stdin line of the most recently read token
+ */
+size_t input_line(void)
+{
+    return active()->token_line;
+}
 
 /**
  * Clears the remaining input in stdin to prevent it from affecting subsequent reads.
  */
 void clear_stdin_buffer(void)
 {
+    InputSource *in = active();
     int c;
-    while ((c = getchar()) != '\n' && c != EOF)
+    while ((c = next_byte(in)) != '\n' && c != EOF)
         ;
 }
 
@@ -68,36 +535,22 @@ input_status input_string(char *buffer, size_t buffer_size, size_t *chars_read)
         return INPUT_BUFFER_OVERFLOW;
     }
 
-    // Clear errno before operation
-    errno = 0;
-
-    // Read input ensuring space for null terminator
-    if (fgets(buffer, (int)buffer_size, stdin) == NULL)
+    // Like fgets: read up to buffer_size - 1 characters or through the
+    // newline, whichever comes first, leaving the rest of a long line unread.
+    InputSource *in = active();
+    size_t len = 0;
+    int c = 0;
+    while (len < buffer_size - 1 && (c = next_byte(in)) != EOF && c != '\n')
     {
-        if (ferror(stdin))
-        {
-            clearerr(stdin);
-            return INPUT_IO_ERROR;
-        }
-        // EOF reached
-        buffer[0] = '\0';
-        *chars_read = 0;
-        return INPUT_SUCCESS;
-    }
-
-    // Check if the input was truncated (no newline found)
-    size_t len = strnlen(buffer, buffer_size);
-    if(len == buffer_size && buffer[len - 1] != '\n')
-    {
-        clear_stdin_buffer();
-        return INPUT_BUFFER_OVERFLOW;
+        buffer[len++] = (char)c;
     }
+    buffer[len] = '\0';
 
-    // Remove trailing newline if present
-    if (len > 0 && buffer[len - 1] == '\n')
+    if (c == EOF && in->error)
     {
-        buffer[len - 1] = '\0';
-        len--;
+        in->error = false;
+        in->eof = false;
+        return INPUT_IO_ERROR;
     }
 
     *chars_read = len;
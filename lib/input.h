@@ -18,6 +18,11 @@
 #include <errno.h>
 #include <stdint.h>
 #include <limits.h>
+#include <sys/types.h>
+
+// All input goes through one buffer of this size per source, filled with
+// read(2) for stdin or with the source's callback.
+#define INPUT_BUFFER_SIZE ((size_t)1 << 20)
 
 // Return codes for input functions
 typedef enum
@@ -35,6 +40,19 @@ typedef enum
     INPUT_INVALID_LENGTH = -10,
 } input_status;
 
+/*
+ * Where the input functions read from. stdin is used unless a thread
+ * selects another source with input_use.
+ */
+typedef struct InputSource InputSource;
+
+// Fills dst with up to len bytes like read(2): 0 at end of input, -1 on error
+typedef ssize_t (*input_read_fn)(void *ctx, void *dst, size_t len);
+
+InputSource *input_source_new(input_read_fn read, void *ctx);
+void input_source_free(InputSource *source);
+InputSource *input_use(InputSource *source);
+
 /**
  * Clears the remaining input in stdin to prevent it from affecting subsequent reads.
  */
@@ -90,4 +108,45 @@ input_status input_float(float *value);
  */
 input_status input_double(double *value);
 
+/**
+ * Reads raw bytes from the input, handing out any buffered input first
+ *
+ * @param dst Destination buffer
+ * @param len Maximum number of bytes to read
+ * @return Bytes read, 0 at end of input, or -1 with errno set, like read(2)
+ */
+ssize_t input_read_raw(void *dst, size_t len);
+
+/**
+ * Reads whitespace-separated values from stdin into an array
+ *
+ * Tokens may be split across lines in any way. Reading stops after count
+ * values or at end of input, whichever comes first.
+ *
+ * @param dst Array with room for count values
+ * @param count Maximum number of values to read
+ * @param values_read Pointer to store the number of values stored in dst
+ * @return input_status indicating success or type of error; on error
+ *         input_line() gives the line of the offending token
+ */
+input_status input_int_array(int *dst, size_t count, size_t *values_read);
+input_status input_short_array(short *dst, size_t count, size_t *values_read);
+input_status input_float_array(float *dst, size_t count, size_t *values_read);
+input_status input_double_array(double *dst, size_t count, size_t *values_read);
+
+/**
+ * Returns the 1-based stdin line of the most recently read token
+ */
+size_t input_line(void);
+
+/**
+ * Locale-independent number parsers for text that is not null-terminated
+ *
+ * The whole text must be the number; surrounding whitespace is an error.
+ *
+ * @return input_status indicating success or type of error
+ */
+input_status input_parse_long(const char *s, size_t n, long min, long max, input_status overflow, long *value);
+input_status input_parse_double(const char *s, size_t n, double *value);
+
 #endif // INPUT_H
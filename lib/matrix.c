@@ -0,0 +1,132 @@
+#include "matrix.h"
+#include <stdint.h>
+#include <string.h>
+
+#define MIN(a, b) ((a) < (b) ? (a) : (b))
+
+/*
+ * Blocked i-k-j matrix multiply. The innermost loop walks one row of B and one
+ * row of C with unit stride and no loop-carried dependency, which is the shape
+ * the compiler turns into packed SIMD arithmetic; the restrict qualifiers tell
+ * it the three matrices never overlap. Sums are formed in `acc`, which for int
+ * is unsigned so that overflow wraps like the rest of the integer arithmetic.
+ */
+#define DEFINE_MATMUL(name, type, acc)                                                  \
+    void name(type *c, const type *a, const type *b, size_t m, size_t k, size_t n)      \
+    {                                                                                   \
+        type *restrict cr = c;                                                          \
+        const type *restrict ar = a;                                                    \
+        const type *restrict br = b;                                                    \
+                                                                                        \
+        memset(cr, 0, m * n * sizeof(type));                                            \
+        for (size_t ii = 0; ii < m; ii += MATRIX_BLOCK)                                 \
+        {                                                                               \
+            size_t i_end = MIN(ii + MATRIX_BLOCK, m);                                   \
+            for (size_t pp = 0; pp < k; pp += MATRIX_BLOCK)                             \
+            {                                                                           \
+                size_t p_end = MIN(pp + MATRIX_BLOCK, k);                               \
+                for (size_t jj = 0; jj < n; jj += MATRIX_BLOCK)                         \
+                {                                                                       \
+                    size_t j_end = MIN(jj + MATRIX_BLOCK, n);                           \
+                    for (size_t i = ii; i < i_end; i++)                                 \
+                    {                                                                   \
+                        type *restrict c_row = cr + i * n;                              \
+                        for (size_t p = pp; p < p_end; p++)                             \
+                        {                                                               \
+                            const type a_ip = ar[i * k + p];                            \
+                            const type *restrict b_row = br + p * n;                    \
+                            for (size_t j = jj; j < j_end; j++)                         \
+                            {                                                           \
+                                acc sum = (acc)c_row[j] + (acc)a_ip * (acc)b_row[j];    \
+                                c_row[j] = (type)sum;                                   \
+                            }                                                           \
+                        }                                                               \
+                    }                                                                   \
+                }                                                                       \
+            }                                                                           \
+        }                                                                               \
+    }
+
+/**
+ * @brief Computes C = A * B for row-major int matrices
+ * @param c Output matrix, m x n. Must not overlap a or b.
+ * @param a Left operand, m x k
+ * @param b Right operand, k x n
+ * @param m Rows of A and C
+ * @param k Columns of A, rows of B
+ * @param n Columns of B and C
+ */
+DEFINE_MATMUL(matmul_int, int, unsigned)
+
+/**
+ * @brief Computes C = A * B for row-major float matrices
+ * @see matmul_int
+ */
+DEFINE_MATMUL(matmul_float, float, float)
+
+/**
+ * @brief Computes C = A * B for row-major double matrices
+ * @see matmul_int
+ */
+DEFINE_MATMUL(matmul_double, double, double)
+
+#define TRANSPOSE_TILE 32
+
+#define DEFINE_TRANSPOSE(name, type)                                             \
+    static void name(type *restrict dst, const type *restrict src,               \
+                     size_t rows, size_t cols)                                   \
+    {                                                                            \
+        for (size_t ii = 0; ii < rows; ii += TRANSPOSE_TILE)                     \
+        {                                                                        \
+            size_t i_end = MIN(ii + TRANSPOSE_TILE, rows);                       \
+            for (size_t jj = 0; jj < cols; jj += TRANSPOSE_TILE)                 \
+            {                                                                    \
+                size_t j_end = MIN(jj + TRANSPOSE_TILE, cols);                   \
+                for (size_t i = ii; i < i_end; i++)                              \
+                {                                                                \
+                    for (size_t j = jj; j < j_end; j++)                          \
+                    {                                                            \
+                        dst[j * rows + i] = src[i * cols + j];                   \
+                    }                                                            \
+                }                                                                \
+            }                                                                    \
+        }                                                                        \
+    }
+
+DEFINE_TRANSPOSE(transpose_8, uint8_t)
+DEFINE_TRANSPOSE(transpose_16, uint16_t)
+DEFINE_TRANSPOSE(transpose_32, uint32_t)
+DEFINE_TRANSPOSE(transpose_64, uint64_t)
+
+/**
+ * @brief Writes the transpose of a row-major matrix
+ * @param dst Output matrix, cols x rows. Must not overlap src.
+ * @param src Input matrix, rows x cols
+ * @param rows Rows of src
+ * @param cols Columns of src
+ * @param elem_size Size of one element in bytes (1, 2, 4 or 8)
+ *
+ * Works tile by tile so that both the rows read from src and the columns
+ * written to dst stay in cache, instead of striding through dst one cache
+ * line per element.
+ */
+void transpose(void *dst, const void *src, size_t rows, size_t cols, size_t elem_size)
+{
+    switch (elem_size)
+    {
+    case 1:
+        transpose_8(dst, src, rows, cols);
+        break;
+    case 2:
+        transpose_16(dst, src, rows, cols);
+        break;
+    case 4:
+        transpose_32(dst, src, rows, cols);
+        break;
+    case 8:
+        transpose_64(dst, src, rows, cols);
+        break;
+    default:
+        break;
+    }
+}
@@ -0,0 +1,17 @@
+/* matrix.h */
+
+#ifndef MATRIX_H
+#define MATRIX_H
+
+#include <stddef.h>
+
+// Tile edge (in elements) used by the blocked kernels. 64x64 doubles is 32KB,
+// so one tile of each operand stays resident in L1/L2 while it is reused.
+#define MATRIX_BLOCK 64
+
+void matmul_int(int *c, const int *a, const int *b, size_t m, size_t k, size_t n);
+void matmul_float(float *c, const float *a, const float *b, size_t m, size_t k, size_t n);
+void matmul_double(double *c, const double *a, const double *b, size_t m, size_t k, size_t n);
+void transpose(void *dst, const void *src, size_t rows, size_t cols, size_t elem_size);
+
+#endif
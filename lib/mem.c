@@ -1,5 +1,19 @@
 #include "mem.h"
 #include <stdint.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#if defined(MAP_ANONYMOUS) || defined(MAP_ANON)
+#define MEM_HAVE_MMAP 1
+#ifndef MAP_ANONYMOUS
+#define MAP_ANONYMOUS MAP_ANON
+#endif
+#endif
+
+// Transparent huge pages are 2MB on x86-64 and most arm64 kernels
+#define MEM_HUGE_PAGE_SIZE ((size_t)2 << 20)
 
 /**
  * @brief Retrieves the memory block header from a user pointer
@@ -18,6 +32,177 @@ static inline mem_block_t *get_block_ptr(const void *ptr)
     return ptr ? ((mem_block_t *)ptr - 1) : NULL;
 }
 
+#ifdef MEM_HAVE_MMAP
+static size_t page_size(void)
+{
+    static size_t cached;
+    if (cached == 0)
+    {
+        long size = sysconf(_SC_PAGESIZE);
+        cached = size > 0 ? (size_t)size : 4096;
+    }
+    return cached;
+}
+
+// A mapped block's header sits at the end of its own page, so the data
+// starts on a page boundary.
+static size_t mapped_length(size_t aligned_size)
+{
+    size_t page = page_size();
+    return page + (aligned_size + page - 1) / page * page;
+}
+
+/**
+ * @brief Allocates a large block directly with mmap
+ *
+ * The data is aligned to a huge page boundary where possible and the range
+ * is hinted with MADV_HUGEPAGE, so large arrays need far fewer TLB entries.
+ * Anonymous mappings are already zero, so nothing is memset here.
+ *
+ * @param aligned_size Size of the data area in bytes
+ * @return mem_block_t* Header of the new block, or NULL if mmap fails
+ */
+static mem_block_t *map_block(size_t aligned_size)
+{
+    size_t page = page_size();
+    size_t length = mapped_length(aligned_size);
+    if (length < aligned_size || length > MAX_ALLOC_SIZE - MEM_HUGE_PAGE_SIZE)
+    {
+        return NULL;
+    }
+
+    // Over-map by one huge page, then trim so the data is huge-page aligned
+    size_t padded = length + MEM_HUGE_PAGE_SIZE;
+    char *base = mmap(NULL, padded, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (base == MAP_FAILED)
+    {
+        return NULL;
+    }
+
+    uintptr_t data = ((uintptr_t)base + page + MEM_HUGE_PAGE_SIZE - 1) & ~(uintptr_t)(MEM_HUGE_PAGE_SIZE - 1);
+    char *start = (char *)(data - page);
+    if (start > base)
+    {
+        munmap(base, start - base);
+    }
+    char *end = start + length;
+    if (end < base + padded)
+    {
+        munmap(end, base + padded - end);
+    }
+
+#ifdef MADV_HUGEPAGE
+    madvise((void *)data, length - page, MADV_HUGEPAGE);
+#endif
+
+    mem_block_t *block = (mem_block_t *)data - 1;
+    block->guard = MEMORY_GUARD_MAPPED;
+    block->size = aligned_size;
+    return block;
+}
+
+static void unmap_block(mem_block_t *block)
+{
+    size_t page = page_size();
+    munmap((char *)block->data - page, mapped_length(block->size));
+}
+#endif
+
+/**
+ * @brief Maps a file into memory as a block that safe_free can release
+ *
+ * The file is mapped shared, so pages are read in lazily as they are first
+ * touched and, for writable mappings, changes go back to the file without
+ * any explicit I/O. The block header lives on an anonymous page placed just
+ * before the file data, so the result looks like any other mapped block.
+ *
+ * @param path File to map
+ * @param size In: bytes to map, or 0 for the whole file. Out: bytes mapped
+ * @param writable Nonzero to map read-write. A writable file is created if
+ *                 missing and extended with zeros if it is shorter than *size
+ * @return void* Pointer to the file data, or NULL if:
+ *         - the file cannot be opened, or is empty when *size is 0
+ *         - a read-only file is shorter than *size
+ *         - mmap fails or is not available on this platform
+ *
+ * @note Sets errno on failure
+ */
+void *safe_map_file(const char *path, size_t *size, int writable)
+{
+#ifdef MEM_HAVE_MMAP
+    int fd = open(path, writable ? O_RDWR | O_CREAT : O_RDONLY, 0644);
+    if (fd < 0)
+    {
+        return NULL;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0)
+    {
+        close(fd);
+        return NULL;
+    }
+
+    size_t file_size = (size_t)st.st_size;
+    size_t length = *size ? *size : file_size;
+    if (length == 0 || length > MAX_ALLOC_SIZE / 2)
+    {
+        close(fd);
+        errno = EINVAL;
+        return NULL;
+    }
+    if (file_size < length)
+    {
+        if (!writable)
+        {
+            close(fd);
+            errno = EINVAL;
+            return NULL;
+        }
+        if (ftruncate(fd, (off_t)length) != 0)
+        {
+            int saved = errno;
+            close(fd);
+            errno = saved;
+            return NULL;
+        }
+    }
+
+    // Reserve the header page and the data range, then put the file over
+    // the data range.
+    size_t page = page_size();
+    size_t total = mapped_length(length);
+    char *base = mmap(NULL, total, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (base == MAP_FAILED)
+    {
+        close(fd);
+        return NULL;
+    }
+    int prot = writable ? PROT_READ | PROT_WRITE : PROT_READ;
+    if (mmap(base + page, total - page, prot, MAP_SHARED | MAP_FIXED, fd, 0) == MAP_FAILED)
+    {
+        int saved = errno;
+        munmap(base, total);
+        close(fd);
+        errno = saved;
+        return NULL;
+    }
+    close(fd);
+
+    mem_block_t *block = (mem_block_t *)(base + page) - 1;
+    block->guard = MEMORY_GUARD_MAPPED;
+    block->size = length;
+    *size = length;
+    return block->data;
+#else
+    (void)path;
+    (void)size;
+    (void)writable;
+    errno = ENOSYS;
+    return NULL;
+#endif
+}
+
 /**
  * @brief Aligns a size value to the platform's memory alignment requirement
  *
@@ -102,6 +287,14 @@ void *safe_calloc(size_t count, size_t size)
         return handle_malloc_error(total_size);
     }
 
+#ifdef MEM_HAVE_MMAP
+    if (aligned_size >= MEM_MMAP_THRESHOLD)
+    {
+        mem_block_t *mapped = map_block(aligned_size);
+        return mapped ? mapped->data : handle_malloc_error(total_size);
+    }
+#endif
+
     // Calculate total size needed including metadata
     size_t block_size = sizeof(mem_block_t) + aligned_size;
     if (block_size < total_size)
@@ -133,6 +326,9 @@ void *safe_calloc(size_t count, size_t size)
  * - Size tracking
  * - Guard pattern for corruption detection
  *
+ * Blocks of MEM_MMAP_THRESHOLD bytes or more are mapped directly, see
+ * map_block().
+ *
  * @param size Number of bytes to allocate
  * @return void* Pointer to allocated memory, or NULL if:
  *         - size is 0
@@ -160,6 +356,14 @@ void *safe_malloc(size_t size)
         return handle_malloc_error(size);
     }
 
+#ifdef MEM_HAVE_MMAP
+    if (aligned_size >= MEM_MMAP_THRESHOLD)
+    {
+        mem_block_t *mapped = map_block(aligned_size);
+        return mapped ? mapped->data : handle_malloc_error(size);
+    }
+#endif
+
     // Calculate total size needed including metadata
     size_t total_size = sizeof(mem_block_t) + aligned_size;
     if (total_size < size)
@@ -204,6 +408,81 @@ void *safe_malloc_array(size_t nmemb, size_t size)
     return safe_malloc(nmemb * size);
 }
 
+/**
+ * @brief Safely resizes memory allocated by safe_malloc
+ *
+ * Resizes a block with the same checks as safe_malloc. The underlying
+ * realloc extends the block in place when the allocator can, so growing a
+ * buffer does not always copy it. Bytes added at the end are zeroed, matching
+ * safe_malloc.
+ *
+ * @param ptr Pointer from safe_malloc, or NULL to allocate a new block
+ * @param size New size in bytes
+ * @return void* Pointer to the resized memory, or NULL if:
+ *         - size is 0
+ *         - ptr was not allocated by safe_malloc
+ *         - size > MAX_ALLOC_SIZE or alignment would overflow
+ *         - system is out of memory (the original block is left intact)
+ *
+ * @note Sets errno on failure
+ */
+void *safe_realloc(void *ptr, size_t size)
+{
+    if (ptr == NULL)
+    {
+        return safe_malloc(size);
+    }
+    if (size == 0)
+    {
+        errno = EINVAL;
+        return NULL;
+    }
+
+    mem_block_t *block = get_block_ptr(ptr);
+    if (block->guard != MEMORY_GUARD && block->guard != MEMORY_GUARD_MAPPED)
+    {
+        errno = EINVAL;
+        return NULL;
+    }
+
+    size_t aligned_size = align_size(size);
+    if (aligned_size == 0 || aligned_size > MAX_ALLOC_SIZE - sizeof(mem_block_t))
+    {
+        return handle_malloc_error(size);
+    }
+
+    if (block->guard == MEMORY_GUARD_MAPPED)
+    {
+        if (aligned_size <= block->size)
+        {
+            return ptr;
+        }
+        // Move to a fresh block; its pages past the copied range stay zero
+        void *grown = safe_malloc(size);
+        if (grown == NULL)
+        {
+            return NULL;
+        }
+        memcpy(grown, ptr, block->size);
+        safe_free(&ptr, __FILE__, __LINE__, __func__);
+        return grown;
+    }
+
+    size_t old_size = block->size;
+    mem_block_t *new_block = realloc(block, sizeof(mem_block_t) + aligned_size);
+    if (new_block == NULL)
+    {
+        return handle_malloc_error(size);
+    }
+
+    if (aligned_size > old_size)
+    {
+        memset(new_block->data + old_size, 0, aligned_size - old_size);
+    }
+    new_block->size = aligned_size;
+    return new_block->data;
+}
+
 /**
  * @brief Validates if a pointer was allocated by safe_malloc
  *
@@ -221,7 +500,7 @@ int is_safe_malloc_ptr(const void *ptr)
     if (!ptr)
         return 0;
     mem_block_t *block = get_block_ptr(ptr);
-    return block->guard == MEMORY_GUARD;
+    return block->guard == MEMORY_GUARD || block->guard == MEMORY_GUARD_MAPPED;
 }
 
 /**
@@ -231,6 +510,9 @@ int is_safe_malloc_ptr(const void *ptr)
  * - Validates the pointer was allocated by safe_malloc
  * - Wipes memory contents before freeing
  * - Sets pointer to NULL after freeing
+ *
+ * Mapped blocks are returned with munmap instead; the kernel discards their
+ * pages, so they are not wiped first.
  * - Handles NULL pointers safely
  *
  * @param ptr Address of pointer to free. Must not be NULL.
@@ -247,6 +529,15 @@ void safe_free(void **ptr, const char* file, int line, const char* func)
     }
 
     mem_block_t *block = get_block_ptr(*ptr);
+#ifdef MEM_HAVE_MMAP
+    if (block && block->guard == MEMORY_GUARD_MAPPED)
+    {
+        block->guard = 0;
+        unmap_block(block);
+        *ptr = NULL;
+        return;
+    }
+#endif
     if (!block || block->guard != MEMORY_GUARD)
     {
         fprintf(stderr, "Warning: Attempt to free invalid/corrupted pointer, %s, %d, %s\n",
@@ -18,6 +18,12 @@
 
 // Magic number to detect buffer overruns and validate pointers
 #define MEMORY_GUARD 0xDEADBEEFDEADBEEFULL
+// Guard for blocks mapped straight from the kernel rather than malloc'd
+#define MEMORY_GUARD_MAPPED 0xFEEDFACEFEEDFACEULL
+
+// Blocks at least this large are mmap'd: the pages arrive zeroed, so they
+// are not touched until used, and are handed back with munmap on free.
+#define MEM_MMAP_THRESHOLD ((size_t)1 << 20)
 
 typedef struct
 {
@@ -30,11 +36,13 @@ void *handle_malloc_error(size_t size);
 size_t align_size(size_t size);
 void *safe_malloc(size_t size);
 void *safe_malloc_array(size_t nmemb, size_t size);
+void *safe_realloc(void *ptr, size_t size);
 void safe_free(void **ptr, const char *file, int line, const char *func);
 void *safe_memcpy(void *dest, const void *src, size_t n);
 char *safe_strdup(const char *str);
 int is_safe_malloc_ptr(const void *ptr);
 void *safe_calloc(size_t count, size_t size);
+void *safe_map_file(const char *path, size_t *size, int writable);
 
 // Convenience macro for type-safe allocation
 #define SAFE_MALLOC(type) ((type *)safe_malloc(sizeof(type)))
@@ -0,0 +1,357 @@
+#include "pool.h"
+#include "mem.h"
+#include <pthread.h>
+#include <sched.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+/*
+ * A work-stealing scheduler. Every pool thread owns a deque of tasks: it
+ * pushes and pops at the bottom, so its own work runs newest first while it
+ * is still cache-warm, and idle threads steal the oldest task from the top
+ * of a randomly chosen victim. In divide-and-conquer code the oldest task
+ * is usually the biggest piece left, so one steal moves a lot of work.
+ *
+ * Waiting for a group never blocks: the waiting thread keeps running
+ * tasks, its own first, until the group is done. Threads with nothing to
+ * do sleep until a task is pushed. A thread that does have to block, on a
+ * channel say, first makes sure queued tasks still have a thread to run
+ * them, starting a spare worker if every worker is busy.
+ *
+ * Threads outside the pool, such as the one that started it or the threads
+ * of a host running several programs, share the first deque.
+ */
+
+typedef struct
+{
+    pool_task_fn fn;
+    void *ctx;
+    size_t index;
+    PoolGroup *group;
+} Task;
+
+typedef struct
+{
+    pthread_mutex_t lock;
+    Task *tasks;     // ring buffer indexed by position & (capacity - 1)
+    size_t capacity; // a power of two
+    size_t top;      // oldest task, taken by thieves
+    size_t bottom;   // one past the newest, pushed and popped by the owner
+} Deque;
+
+#define POOL_DEQUE_INITIAL 256
+#define POOL_IDLE_SPINS 64
+#define POOL_IDLE_SLEEP_NS 50000
+#define POOL_MAX_SPARES 64
+
+static pthread_once_t pool_once = PTHREAD_ONCE_INIT;
+static size_t pool_threads = 1;
+static atomic_size_t num_deques; // workers started so far, spares included
+static size_t num_spares;        // guarded by sleep_lock
+static Deque *deques;
+static pthread_attr_t worker_attr;
+
+static atomic_size_t queued; // tasks sitting in deques
+static atomic_size_t sleepers;
+static pthread_mutex_t sleep_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t wake = PTHREAD_COND_INITIALIZER;
+
+static _Thread_local Deque *own_deque; // NULL on threads outside the pool
+static _Thread_local unsigned int steal_seed;
+static _Thread_local int task_depth;
+
+static void deque_push(Deque *d, Task task)
+{
+    pthread_mutex_lock(&d->lock);
+    if (d->bottom - d->top == d->capacity)
+    {
+        Task *grown = safe_malloc_array(d->capacity * 2, sizeof(Task));
+        for (size_t i = d->top; i != d->bottom; i++)
+        {
+            grown[i & (d->capacity * 2 - 1)] = d->tasks[i & (d->capacity - 1)];
+        }
+        SAFE_FREE(d->tasks);
+        d->tasks = grown;
+        d->capacity *= 2;
+    }
+    d->tasks[d->bottom & (d->capacity - 1)] = task;
+    d->bottom++;
+    pthread_mutex_unlock(&d->lock);
+}
+
+// Takes the newest task (owner) or the oldest one (thief)
+static bool deque_take(Deque *d, Task *task, bool newest)
+{
+    pthread_mutex_lock(&d->lock);
+    bool found = d->bottom != d->top;
+    if (found && newest)
+    {
+        *task = d->tasks[--d->bottom & (d->capacity - 1)];
+    }
+    else if (found)
+    {
+        *task = d->tasks[d->top++ & (d->capacity - 1)];
+    }
+    pthread_mutex_unlock(&d->lock);
+    return found;
+}
+
+static unsigned int next_random(void)
+{
+    // xorshift32; the seed is never zero
+    steal_seed ^= steal_seed << 13;
+    steal_seed ^= steal_seed >> 17;
+    steal_seed ^= steal_seed << 5;
+    return steal_seed;
+}
+
+static bool find_task(Task *task)
+{
+    if (own_deque && deque_take(own_deque, task, true))
+    {
+        atomic_fetch_sub(&queued, 1);
+        return true;
+    }
+    if (atomic_load(&queued) == 0)
+    {
+        return false;
+    }
+    size_t n = atomic_load(&num_deques);
+    size_t start = next_random() % n;
+    for (size_t i = 0; i < n; i++)
+    {
+        Deque *victim = &deques[(start + i) % n];
+        if (victim != own_deque && deque_take(victim, task, false))
+        {
+            atomic_fetch_sub(&queued, 1);
+            return true;
+        }
+    }
+    return false;
+}
+
+static void run_task(Task *task)
+{
+    PoolGroup *group = task->group;
+    task_depth++;
+    task->fn(task->ctx, task->index);
+    task_depth--;
+    // The waiter may free the group as soon as this lands
+    atomic_fetch_sub_explicit(&group->pending, 1, memory_order_release);
+}
+
+static void *worker_main(void *arg)
+{
+    own_deque = arg;
+    steal_seed = (unsigned int)(own_deque - deques) * 2654435761u + 1;
+    int idle = 0;
+    for (;;)
+    {
+        Task task;
+        if (find_task(&task))
+        {
+            run_task(&task);
+            idle = 0;
+            continue;
+        }
+        if (++idle < POOL_IDLE_SPINS)
+        {
+            sched_yield();
+            continue;
+        }
+
+        idle = 0;
+        pthread_mutex_lock(&sleep_lock);
+        atomic_fetch_add(&sleepers, 1);
+        while (atomic_load(&queued) == 0)
+        {
+            pthread_cond_wait(&wake, &sleep_lock);
+        }
+        atomic_fetch_sub(&sleepers, 1);
+        pthread_mutex_unlock(&sleep_lock);
+    }
+    return NULL;
+}
+
+// Gives the next deque to a new worker thread; returns false if it failed
+static bool start_worker(void)
+{
+    Deque *d = &deques[atomic_load(&num_deques)];
+    pthread_mutex_init(&d->lock, NULL);
+    d->tasks = safe_malloc_array(POOL_DEQUE_INITIAL, sizeof(Task));
+    d->capacity = POOL_DEQUE_INITIAL;
+    d->top = d->bottom = 0;
+
+    pthread_t thread;
+    if (pthread_create(&thread, &worker_attr, worker_main, d) != 0)
+    {
+        pthread_mutex_destroy(&d->lock);
+        SAFE_FREE(d->tasks);
+        return false;
+    }
+    // Published only now, so thieves never see a half-made deque
+    atomic_fetch_add(&num_deques, 1);
+    return true;
+}
+
+static void start_pool(void)
+{
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    const char *env = getenv(POOL_THREADS_ENV);
+    if (env != NULL && atol(env) > 0)
+    {
+        n = atol(env);
+    }
+    if (n < 1)
+    {
+        n = 1;
+    }
+
+    deques = safe_malloc_array((size_t)n + POOL_MAX_SPARES, sizeof(Deque));
+
+    // The thread that starts the pool takes the first deque
+    pthread_mutex_init(&deques[0].lock, NULL);
+    deques[0].tasks = safe_malloc_array(POOL_DEQUE_INITIAL, sizeof(Task));
+    deques[0].capacity = POOL_DEQUE_INITIAL;
+    atomic_init(&num_deques, 1);
+    own_deque = &deques[0];
+    steal_seed = 1;
+
+    pthread_attr_init(&worker_attr);
+    pthread_attr_setstacksize(&worker_attr, POOL_STACK_SIZE);
+    pthread_attr_setdetachstate(&worker_attr, PTHREAD_CREATE_DETACHED);
+    while (pool_threads < (size_t)n && start_worker())
+    {
+        pool_threads++;
+    }
+}
+
+/**
+ * @brief Returns the number of threads that run pool tasks, caller included
+ */
+size_t pool_size(void)
+{
+    pthread_once(&pool_once, start_pool);
+    return pool_threads;
+}
+
+// Gives a thread outside the pool the shared first deque to push tasks on
+static void attach_thread(void)
+{
+    pool_size();
+    if (own_deque == NULL)
+    {
+        own_deque = &deques[0];
+        steal_seed = (unsigned int)(uintptr_t)&own_deque | 1;
+    }
+}
+
+/**
+ * @brief Tells whether the calling thread is running a pool task
+ */
+bool pool_in_task(void)
+{
+    return task_depth > 0;
+}
+
+/**
+ * @brief Prepares an empty task group
+ * @param group Group to initialize
+ */
+void pool_group_init(PoolGroup *group)
+{
+    atomic_init(&group->pending, 0);
+}
+
+/**
+ * @brief Queues fn(ctx, task) to run on some pool thread
+ * @param group Group that pool_wait() will wait on
+ * @param fn Task function
+ * @param ctx Passed to the task
+ * @param task Passed to the task
+ */
+void pool_spawn(PoolGroup *group, pool_task_fn fn, void *ctx, size_t task)
+{
+    attach_thread();
+    atomic_fetch_add_explicit(&group->pending, 1, memory_order_relaxed);
+    deque_push(own_deque, (Task){fn, ctx, task, group});
+    atomic_fetch_add(&queued, 1);
+    if (atomic_load(&sleepers) > 0)
+    {
+        pthread_mutex_lock(&sleep_lock);
+        pthread_cond_signal(&wake);
+        pthread_mutex_unlock(&sleep_lock);
+    }
+}
+
+/**
+ * @brief Returns once every task spawned into the group has finished
+ * @param group Group to wait for
+ *
+ * The calling thread runs queued tasks, from any group, while it waits.
+ */
+void pool_wait(PoolGroup *group)
+{
+    int idle = 0;
+    while (atomic_load_explicit(&group->pending, memory_order_acquire) > 0)
+    {
+        Task task;
+        if (find_task(&task))
+        {
+            run_task(&task);
+            idle = 0;
+        }
+        else if (++idle < POOL_IDLE_SPINS)
+        {
+            sched_yield();
+        }
+        else
+        {
+            struct timespec pause = {0, POOL_IDLE_SLEEP_NS};
+            nanosleep(&pause, NULL);
+        }
+    }
+}
+
+/**
+ * @brief Called by a thread that is about to block
+ *
+ * If tasks are queued and no worker is idle to take them, starts a spare
+ * worker, so that whatever the blocked thread waits for still gets to run.
+ */
+void pool_will_block(void)
+{
+    if (atomic_load(&queued) == 0)
+    {
+        return;
+    }
+    pthread_mutex_lock(&sleep_lock);
+    if (atomic_load(&sleepers) == 0 && num_spares < POOL_MAX_SPARES && start_worker())
+    {
+        num_spares++;
+    }
+    pthread_mutex_unlock(&sleep_lock);
+}
+
+/**
+ * @brief Runs fn(ctx, 0) .. fn(ctx, ntasks - 1) across the pool
+ * @param ntasks Number of tasks
+ * @param fn Task function; tasks may run in any order and concurrently
+ * @param ctx Passed to every task
+ *
+ * Returns once every task has finished. The calling thread runs tasks as
+ * well, and calls from inside a task split their work the same way.
+ */
+void pool_run(size_t ntasks, pool_task_fn fn, void *ctx)
+{
+    PoolGroup group;
+    pool_group_init(&group);
+    // Pushed last to first, so the caller starts with task 0
+    for (size_t task = ntasks; task > 0; task--)
+    {
+        pool_spawn(&group, fn, ctx, task - 1);
+    }
+    pool_wait(&group);
+}
@@ -0,0 +1,34 @@
+/* pool.h */
+
+#ifndef POOL_H
+#define POOL_H
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// Overrides the worker count, which defaults to the number of online CPUs.
+#define POOL_THREADS_ENV "BRAINROT_THREADS"
+
+// Worker threads get a large stack, since interpreted recursion is deep and
+// a thread waiting on tasks runs other tasks on top of its own frames.
+#define POOL_STACK_SIZE ((size_t)64 << 20)
+
+typedef void (*pool_task_fn)(void *ctx, size_t task);
+
+// Tasks spawned into a group can be waited for together.
+typedef struct
+{
+    atomic_size_t pending;
+} PoolGroup;
+
+size_t pool_size(void);
+bool pool_in_task(void);
+void pool_run(size_t ntasks, pool_task_fn fn, void *ctx);
+
+void pool_group_init(PoolGroup *group);
+void pool_spawn(PoolGroup *group, pool_task_fn fn, void *ctx, size_t task);
+void pool_wait(PoolGroup *group);
+void pool_will_block(void);
+
+#endif
@@ -0,0 +1,676 @@
+#include "simd.h"
+#include <stdbool.h>
+#include <string.h>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#elif defined(__SSE4_1__)
+#include <smmintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+/*
+ * Element-wise kernels for the vector types. chad4 fills an SSE register,
+ * and gigachad4 and rizz8 fill an AVX one, or two SSE registers when the
+ * build does not target AVX. Operations the instruction set lacks, such
+ * as integer division, run lane by lane, as does everything on targets
+ * without SSE2.
+ */
+
+size_t simd_lanes(SimdKind kind)
+{
+    return kind == SIMD_I32X8 ? 8 : 4;
+}
+
+static size_t lane_size(SimdKind kind)
+{
+    return kind == SIMD_F64X4 ? sizeof(double) : sizeof(float);
+}
+
+/**
+ * @brief Sets every lane to the same value
+ * @param kind Vector type
+ * @param dst Vector to fill
+ * @param x Value, converted to the lane type
+ */
+void simd_splat(SimdKind kind, SimdVec *dst, double x)
+{
+    for (size_t i = 0; i < simd_lanes(kind); i++)
+    {
+        switch (kind)
+        {
+        case SIMD_F32X4:
+            dst->f32[i] = (float)x;
+            break;
+        case SIMD_F64X4:
+            dst->f64[i] = x;
+            break;
+        case SIMD_I32X8:
+            dst->i32[i] = (int32_t)x;
+            break;
+        }
+    }
+}
+
+/**
+ * @brief Loads consecutive elements into a vector
+ * @param kind Vector type
+ * @param dst Vector to fill
+ * @param src First element; needs no particular alignment
+ */
+void simd_load(SimdKind kind, SimdVec *dst, const void *src)
+{
+    memcpy(dst, src, simd_lanes(kind) * lane_size(kind));
+}
+
+/**
+ * @brief Stores a vector into consecutive elements
+ * @param kind Vector type
+ * @param dst First element; needs no particular alignment
+ * @param v Vector to store
+ */
+void simd_store(SimdKind kind, void *dst, const SimdVec *v)
+{
+    memcpy(dst, v, simd_lanes(kind) * lane_size(kind));
+}
+
+// Lane-by-lane versions, for targets and operations without instructions
+#define SCALAR_FLOAT_BINARY(field, type, lanes)            \
+    for (size_t i = 0; i < (lanes); i++)                   \
+    {                                                      \
+        type x = a->field[i];                              \
+        type y = b->field[i];                              \
+        switch (op)                                        \
+        {                                                  \
+        case SIMD_ADD:                                     \
+            x = x + y;                                     \
+            break;                                         \
+        case SIMD_SUB:                                     \
+            x = x - y;                                     \
+            break;                                         \
+        case SIMD_MUL:                                     \
+            x = x * y;                                     \
+            break;                                         \
+        case SIMD_DIV:                                     \
+            x = x / y;                                     \
+            break;                                         \
+        case SIMD_MIN:                                     \
+            x = x < y ? x : y;                             \
+            break;                                         \
+        case SIMD_MAX:                                     \
+            x = x > y ? x : y;                             \
+            break;                                         \
+        case SIMD_LT:                                      \
+            x = x < y;                                     \
+            break;                                         \
+        case SIMD_GT:                                      \
+            x = x > y;                                     \
+            break;                                         \
+        case SIMD_LE:                                      \
+            x = x <= y;                                    \
+            break;                                         \
+        case SIMD_GE:                                      \
+            x = x >= y;                                    \
+            break;                                         \
+        case SIMD_EQ:                                      \
+            x = x == y;                                    \
+            break;                                         \
+        case SIMD_NE:                                      \
+            x = x != y;                                    \
+            break;                                         \
+        case SIMD_AND:                                     \
+            x = x != 0 && y != 0;                          \
+            break;                                         \
+        case SIMD_OR:                                      \
+            x = x != 0 || y != 0;                          \
+            break;                                         \
+        }                                                  \
+        dst->field[i] = x;                                 \
+    }
+
+static void scalar_binary_i32(SimdOp op, SimdVec *dst, const SimdVec *a, const SimdVec *b)
+{
+    for (size_t i = 0; i < 8; i++)
+    {
+        int32_t x = a->i32[i];
+        int32_t y = b->i32[i];
+        switch (op)
+        {
+        case SIMD_ADD:
+            x = (int32_t)((uint32_t)x + (uint32_t)y);
+            break;
+        case SIMD_SUB:
+            x = (int32_t)((uint32_t)x - (uint32_t)y);
+            break;
+        case SIMD_MUL:
+            x = (int32_t)((uint32_t)x * (uint32_t)y);
+            break;
+        case SIMD_DIV:
+            // INT32_MIN / -1 wraps like the other operations
+            x = y == -1 ? (int32_t)(0u - (uint32_t)x) : x / y;
+            break;
+        case SIMD_MIN:
+            x = x < y ? x : y;
+            break;
+        case SIMD_MAX:
+            x = x > y ? x : y;
+            break;
+        case SIMD_LT:
+            x = x < y;
+            break;
+        case SIMD_GT:
+            x = x > y;
+            break;
+        case SIMD_LE:
+            x = x <= y;
+            break;
+        case SIMD_GE:
+            x = x >= y;
+            break;
+        case SIMD_EQ:
+            x = x == y;
+            break;
+        case SIMD_NE:
+            x = x != y;
+            break;
+        case SIMD_AND:
+            x = x != 0 && y != 0;
+            break;
+        case SIMD_OR:
+            x = x != 0 || y != 0;
+            break;
+        }
+        dst->i32[i] = x;
+    }
+}
+
+#if defined(__SSE2__)
+
+static void binary_f32(SimdOp op, SimdVec *dst, const SimdVec *a, const SimdVec *b)
+{
+    __m128 x = _mm_load_ps(a->f32);
+    __m128 y = _mm_load_ps(b->f32);
+    __m128 one = _mm_set1_ps(1.0f);
+    __m128 zero = _mm_setzero_ps();
+    __m128 r = x;
+    switch (op)
+    {
+    case SIMD_ADD:
+        r = _mm_add_ps(x, y);
+        break;
+    case SIMD_SUB:
+        r = _mm_sub_ps(x, y);
+        break;
+    case SIMD_MUL:
+        r = _mm_mul_ps(x, y);
+        break;
+    case SIMD_DIV:
+        r = _mm_div_ps(x, y);
+        break;
+    case SIMD_MIN:
+        r = _mm_min_ps(x, y); // x < y ? x : y, like the scalar version
+        break;
+    case SIMD_MAX:
+        r = _mm_max_ps(x, y);
+        break;
+    case SIMD_LT:
+        r = _mm_and_ps(_mm_cmplt_ps(x, y), one);
+        break;
+    case SIMD_GT:
+        r = _mm_and_ps(_mm_cmpgt_ps(x, y), one);
+        break;
+    case SIMD_LE:
+        r = _mm_and_ps(_mm_cmple_ps(x, y), one);
+        break;
+    case SIMD_GE:
+        r = _mm_and_ps(_mm_cmpge_ps(x, y), one);
+        break;
+    case SIMD_EQ:
+        r = _mm_and_ps(_mm_cmpeq_ps(x, y), one);
+        break;
+    case SIMD_NE:
+        r = _mm_and_ps(_mm_cmpneq_ps(x, y), one);
+        break;
+    case SIMD_AND:
+        r = _mm_andnot_ps(_mm_or_ps(_mm_cmpeq_ps(x, zero), _mm_cmpeq_ps(y, zero)), one);
+        break;
+    case SIMD_OR:
+        r = _mm_andnot_ps(_mm_and_ps(_mm_cmpeq_ps(x, zero), _mm_cmpeq_ps(y, zero)), one);
+        break;
+    }
+    _mm_store_ps(dst->f32, r);
+}
+
+#else
+
+static void binary_f32(SimdOp op, SimdVec *dst, const SimdVec *a, const SimdVec *b)
+{
+    SCALAR_FLOAT_BINARY(f32, float, 4)
+}
+
+#endif
+
+#if defined(__AVX__)
+
+static void binary_f64(SimdOp op, SimdVec *dst, const SimdVec *a, const SimdVec *b)
+{
+    __m256d x = _mm256_load_pd(a->f64);
+    __m256d y = _mm256_load_pd(b->f64);
+    __m256d one = _mm256_set1_pd(1.0);
+    __m256d zero = _mm256_setzero_pd();
+    __m256d r = x;
+    switch (op)
+    {
+    case SIMD_ADD:
+        r = _mm256_add_pd(x, y);
+        break;
+    case SIMD_SUB:
+        r = _mm256_sub_pd(x, y);
+        break;
+    case SIMD_MUL:
+        r = _mm256_mul_pd(x, y);
+        break;
+    case SIMD_DIV:
+        r = _mm256_div_pd(x, y);
+        break;
+    case SIMD_MIN:
+        r = _mm256_min_pd(x, y);
+        break;
+    case SIMD_MAX:
+        r = _mm256_max_pd(x, y);
+        break;
+    case SIMD_LT:
+        r = _mm256_and_pd(_mm256_cmp_pd(x, y, _CMP_LT_OQ), one);
+        break;
+    case SIMD_GT:
+        r = _mm256_and_pd(_mm256_cmp_pd(x, y, _CMP_GT_OQ), one);
+        break;
+    case SIMD_LE:
+        r = _mm256_and_pd(_mm256_cmp_pd(x, y, _CMP_LE_OQ), one);
+        break;
+    case SIMD_GE:
+        r = _mm256_and_pd(_mm256_cmp_pd(x, y, _CMP_GE_OQ), one);
+        break;
+    case SIMD_EQ:
+        r = _mm256_and_pd(_mm256_cmp_pd(x, y, _CMP_EQ_OQ), one);
+        break;
+    case SIMD_NE:
+        r = _mm256_and_pd(_mm256_cmp_pd(x, y, _CMP_NEQ_UQ), one);
+        break;
+    case SIMD_AND:
+        r = _mm256_andnot_pd(_mm256_or_pd(_mm256_cmp_pd(x, zero, _CMP_EQ_OQ),
+                                          _mm256_cmp_pd(y, zero, _CMP_EQ_OQ)),
+                             one);
+        break;
+    case SIMD_OR:
+        r = _mm256_andnot_pd(_mm256_and_pd(_mm256_cmp_pd(x, zero, _CMP_EQ_OQ),
+                                           _mm256_cmp_pd(y, zero, _CMP_EQ_OQ)),
+                             one);
+        break;
+    }
+    _mm256_store_pd(dst->f64, r);
+}
+
+#elif defined(__SSE2__)
+
+static __m128d binary_pd(SimdOp op, __m128d x, __m128d y)
+{
+    __m128d one = _mm_set1_pd(1.0);
+    __m128d zero = _mm_setzero_pd();
+    switch (op)
+    {
+    case SIMD_ADD:
+        return _mm_add_pd(x, y);
+    case SIMD_SUB:
+        return _mm_sub_pd(x, y);
+    case SIMD_MUL:
+        return _mm_mul_pd(x, y);
+    case SIMD_DIV:
+        return _mm_div_pd(x, y);
+    case SIMD_MIN:
+        return _mm_min_pd(x, y);
+    case SIMD_MAX:
+        return _mm_max_pd(x, y);
+    case SIMD_LT:
+        return _mm_and_pd(_mm_cmplt_pd(x, y), one);
+    case SIMD_GT:
+        return _mm_and_pd(_mm_cmpgt_pd(x, y), one);
+    case SIMD_LE:
+        return _mm_and_pd(_mm_cmple_pd(x, y), one);
+    case SIMD_GE:
+        return _mm_and_pd(_mm_cmpge_pd(x, y), one);
+    case SIMD_EQ:
+        return _mm_and_pd(_mm_cmpeq_pd(x, y), one);
+    case SIMD_NE:
+        return _mm_and_pd(_mm_cmpneq_pd(x, y), one);
+    case SIMD_AND:
+        return _mm_andnot_pd(_mm_or_pd(_mm_cmpeq_pd(x, zero), _mm_cmpeq_pd(y, zero)), one);
+    case SIMD_OR:
+        return _mm_andnot_pd(_mm_and_pd(_mm_cmpeq_pd(x, zero), _mm_cmpeq_pd(y, zero)), one);
+    }
+    return x;
+}
+
+static void binary_f64(SimdOp op, SimdVec *dst, const SimdVec *a, const SimdVec *b)
+{
+    __m128d lo = binary_pd(op, _mm_load_pd(a->f64), _mm_load_pd(b->f64));
+    __m128d hi = binary_pd(op, _mm_load_pd(a->f64 + 2), _mm_load_pd(b->f64 + 2));
+    _mm_store_pd(dst->f64, lo);
+    _mm_store_pd(dst->f64 + 2, hi);
+}
+
+#else
+
+static void binary_f64(SimdOp op, SimdVec *dst, const SimdVec *a, const SimdVec *b)
+{
+    SCALAR_FLOAT_BINARY(f64, double, 4)
+}
+
+#endif
+
+#if defined(__AVX2__)
+
+static void binary_i32(SimdOp op, SimdVec *dst, const SimdVec *a, const SimdVec *b)
+{
+    __m256i x = _mm256_load_si256((const __m256i *)a->i32);
+    __m256i y = _mm256_load_si256((const __m256i *)b->i32);
+    __m256i one = _mm256_set1_epi32(1);
+    __m256i zero = _mm256_setzero_si256();
+    __m256i r = x;
+    switch (op)
+    {
+    case SIMD_ADD:
+        r = _mm256_add_epi32(x, y);
+        break;
+    case SIMD_SUB:
+        r = _mm256_sub_epi32(x, y);
+        break;
+    case SIMD_MUL:
+        r = _mm256_mullo_epi32(x, y);
+        break;
+    case SIMD_DIV:
+        scalar_binary_i32(op, dst, a, b); // no integer division instruction
+        return;
+    case SIMD_MIN:
+        r = _mm256_min_epi32(x, y);
+        break;
+    case SIMD_MAX:
+        r = _mm256_max_epi32(x, y);
+        break;
+    case SIMD_LT:
+        r = _mm256_and_si256(_mm256_cmpgt_epi32(y, x), one);
+        break;
+    case SIMD_GT:
+        r = _mm256_and_si256(_mm256_cmpgt_epi32(x, y), one);
+        break;
+    case SIMD_LE:
+        r = _mm256_andnot_si256(_mm256_cmpgt_epi32(x, y), one);
+        break;
+    case SIMD_GE:
+        r = _mm256_andnot_si256(_mm256_cmpgt_epi32(y, x), one);
+        break;
+    case SIMD_EQ:
+        r = _mm256_and_si256(_mm256_cmpeq_epi32(x, y), one);
+        break;
+    case SIMD_NE:
+        r = _mm256_andnot_si256(_mm256_cmpeq_epi32(x, y), one);
+        break;
+    case SIMD_AND:
+        r = _mm256_andnot_si256(_mm256_or_si256(_mm256_cmpeq_epi32(x, zero), _mm256_cmpeq_epi32(y, zero)), one);
+        break;
+    case SIMD_OR:
+        r = _mm256_andnot_si256(_mm256_and_si256(_mm256_cmpeq_epi32(x, zero), _mm256_cmpeq_epi32(y, zero)), one);
+        break;
+    }
+    _mm256_store_si256((__m256i *)dst->i32, r);
+}
+
+#elif defined(__SSE2__)
+
+// Returns false for operations SSE2 has no instruction for
+static bool binary_epi32(SimdOp op, __m128i x, __m128i y, __m128i *r)
+{
+    __m128i one = _mm_set1_epi32(1);
+    __m128i zero = _mm_setzero_si128();
+    switch (op)
+    {
+    case SIMD_ADD:
+        *r = _mm_add_epi32(x, y);
+        return true;
+    case SIMD_SUB:
+        *r = _mm_sub_epi32(x, y);
+        return true;
+#if defined(__SSE4_1__)
+    case SIMD_MUL:
+        *r = _mm_mullo_epi32(x, y);
+        return true;
+    case SIMD_MIN:
+        *r = _mm_min_epi32(x, y);
+        return true;
+    case SIMD_MAX:
+        *r = _mm_max_epi32(x, y);
+        return true;
+#endif
+    case SIMD_LT:
+        *r = _mm_and_si128(_mm_cmplt_epi32(x, y), one);
+        return true;
+    case SIMD_GT:
+        *r = _mm_and_si128(_mm_cmpgt_epi32(x, y), one);
+        return true;
+    case SIMD_LE:
+        *r = _mm_andnot_si128(_mm_cmpgt_epi32(x, y), one);
+        return true;
+    case SIMD_GE:
+        *r = _mm_andnot_si128(_mm_cmplt_epi32(x, y), one);
+        return true;
+    case SIMD_EQ:
+        *r = _mm_and_si128(_mm_cmpeq_epi32(x, y), one);
+        return true;
+    case SIMD_NE:
+        *r = _mm_andnot_si128(_mm_cmpeq_epi32(x, y), one);
+        return true;
+    case SIMD_AND:
+        *r = _mm_andnot_si128(_mm_or_si128(_mm_cmpeq_epi32(x, zero), _mm_cmpeq_epi32(y, zero)), one);
+        return true;
+    case SIMD_OR:
+        *r = _mm_andnot_si128(_mm_and_si128(_mm_cmpeq_epi32(x, zero), _mm_cmpeq_epi32(y, zero)), one);
+        return true;
+    default:
+        return false;
+    }
+}
+
+static void binary_i32(SimdOp op, SimdVec *dst, const SimdVec *a, const SimdVec *b)
+{
+    const __m128i *x = (const __m128i *)a->i32;
+    const __m128i *y = (const __m128i *)b->i32;
+    __m128i lo, hi;
+    if (binary_epi32(op, _mm_load_si128(x), _mm_load_si128(y), &lo) &&
+        binary_epi32(op, _mm_load_si128(x + 1), _mm_load_si128(y + 1), &hi))
+    {
+        _mm_store_si128((__m128i *)dst->i32, lo);
+        _mm_store_si128((__m128i *)dst->i32 + 1, hi);
+        return;
+    }
+    scalar_binary_i32(op, dst, a, b);
+}
+
+#else
+
+static void binary_i32(SimdOp op, SimdVec *dst, const SimdVec *a, const SimdVec *b)
+{
+    scalar_binary_i32(op, dst, a, b);
+}
+
+#endif
+
+/**
+ * @brief Applies an arithmetic, comparison or logical operation lane by lane
+ * @param op Operation
+ * @param kind Vector type of all three vectors
+ * @param dst Result
+ * @param a Left operand
+ * @param b Right operand
+ */
+void simd_binary(SimdOp op, SimdKind kind, SimdVec *dst, const SimdVec *a, const SimdVec *b)
+{
+    switch (kind)
+    {
+    case SIMD_F32X4:
+        binary_f32(op, dst, a, b);
+        break;
+    case SIMD_F64X4:
+        binary_f64(op, dst, a, b);
+        break;
+    case SIMD_I32X8:
+        binary_i32(op, dst, a, b);
+        break;
+    }
+}
+
+/**
+ * @brief Negates every lane
+ * @param kind Vector type
+ * @param dst Result
+ * @param a Operand
+ */
+void simd_neg(SimdKind kind, SimdVec *dst, const SimdVec *a)
+{
+    SimdVec zero;
+    simd_splat(kind, &zero, 0.0);
+    if (kind == SIMD_I32X8)
+    {
+        simd_binary(SIMD_SUB, kind, dst, &zero, a);
+        return;
+    }
+    // 0 - x would turn -0.0 into +0.0; flip the sign bits instead
+    for (size_t i = 0; i < simd_lanes(kind); i++)
+    {
+        if (kind == SIMD_F32X4)
+            dst->f32[i] = -a->f32[i];
+        else
+            dst->f64[i] = -a->f64[i];
+    }
+}
+
+/**
+ * @brief Picks lanes from a where the mask is non-zero and from b elsewhere
+ * @param kind Vector type of all four vectors
+ * @param dst Result
+ * @param mask Mask, usually from a comparison
+ * @param a Lanes taken where the mask is set
+ * @param b Lanes taken where it is not
+ */
+void simd_select(SimdKind kind, SimdVec *dst, const SimdVec *mask, const SimdVec *a, const SimdVec *b)
+{
+    switch (kind)
+    {
+    case SIMD_F32X4:
+    {
+#if defined(__SSE2__)
+        __m128 m = _mm_cmpneq_ps(_mm_load_ps(mask->f32), _mm_setzero_ps());
+        _mm_store_ps(dst->f32, _mm_or_ps(_mm_and_ps(m, _mm_load_ps(a->f32)),
+                                         _mm_andnot_ps(m, _mm_load_ps(b->f32))));
+#else
+        for (size_t i = 0; i < 4; i++)
+            dst->f32[i] = mask->f32[i] != 0 ? a->f32[i] : b->f32[i];
+#endif
+        break;
+    }
+    case SIMD_F64X4:
+    {
+#if defined(__AVX__)
+        __m256d m = _mm256_cmp_pd(_mm256_load_pd(mask->f64), _mm256_setzero_pd(), _CMP_NEQ_UQ);
+        _mm256_store_pd(dst->f64, _mm256_blendv_pd(_mm256_load_pd(b->f64), _mm256_load_pd(a->f64), m));
+#elif defined(__SSE2__)
+        for (size_t h = 0; h < 4; h += 2)
+        {
+            __m128d m = _mm_cmpneq_pd(_mm_load_pd(mask->f64 + h), _mm_setzero_pd());
+            _mm_store_pd(dst->f64 + h, _mm_or_pd(_mm_and_pd(m, _mm_load_pd(a->f64 + h)),
+                                                 _mm_andnot_pd(m, _mm_load_pd(b->f64 + h))));
+        }
+#else
+        for (size_t i = 0; i < 4; i++)
+            dst->f64[i] = mask->f64[i] != 0 ? a->f64[i] : b->f64[i];
+#endif
+        break;
+    }
+    case SIMD_I32X8:
+    {
+#if defined(__AVX2__)
+        __m256i unset = _mm256_cmpeq_epi32(_mm256_load_si256((const __m256i *)mask->i32), _mm256_setzero_si256());
+        _mm256_store_si256((__m256i *)dst->i32,
+                           _mm256_blendv_epi8(_mm256_load_si256((const __m256i *)a->i32),
+                                              _mm256_load_si256((const __m256i *)b->i32), unset));
+#elif defined(__SSE2__)
+        for (size_t h = 0; h < 2; h++)
+        {
+            __m128i unset = _mm_cmpeq_epi32(_mm_load_si128((const __m128i *)mask->i32 + h), _mm_setzero_si128());
+            _mm_store_si128((__m128i *)dst->i32 + h,
+                            _mm_or_si128(_mm_andnot_si128(unset, _mm_load_si128((const __m128i *)a->i32 + h)),
+                                         _mm_and_si128(unset, _mm_load_si128((const __m128i *)b->i32 + h))));
+        }
+#else
+        for (size_t i = 0; i < 8; i++)
+            dst->i32[i] = mask->i32[i] != 0 ? a->i32[i] : b->i32[i];
+#endif
+        break;
+    }
+    }
+}
+
+/**
+ * @brief Combines the lanes of a vector into one number
+ * @param op Sum, minimum or maximum
+ * @param kind Vector type
+ * @param v Vector
+ * @return The result, exact for every lane type
+ *
+ * Lanes are combined in order, in the lane type's own precision, so a sum
+ * gives the same answer on every target.
+ */
+double simd_reduce(SimdReduce op, SimdKind kind, const SimdVec *v)
+{
+#define REDUCE(field, acc_type)                                                   \
+    do                                                                            \
+    {                                                                             \
+        acc_type acc = (acc_type)v->field[0];                                     \
+        for (size_t i = 1; i < simd_lanes(kind); i++)                             \
+        {                                                                         \
+            acc_type x = (acc_type)v->field[i];                                   \
+            if (op == SIMD_SUM)                                                   \
+                acc += x;                                                         \
+            else if (op == SIMD_HMIN ? x < acc : x > acc)                         \
+                acc = x;                                                          \
+        }                                                                         \
+        result = acc;                                                             \
+    } while (0)
+
+    double result = 0.0;
+    switch (kind)
+    {
+    case SIMD_F32X4:
+        REDUCE(f32, float);
+        break;
+    case SIMD_F64X4:
+        REDUCE(f64, double);
+        break;
+    case SIMD_I32X8:
+        if (op == SIMD_SUM)
+        {
+            // Wraps on overflow like the lane-wise integer operations
+            uint32_t sum = 0;
+            for (size_t i = 0; i < 8; i++)
+                sum += (uint32_t)v->i32[i];
+            result = (int32_t)sum;
+        }
+        else
+        {
+            REDUCE(i32, int32_t);
+        }
+        break;
+    }
+    return result;
+#undef REDUCE
+}
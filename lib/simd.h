@@ -0,0 +1,65 @@
+/* simd.h */
+
+#ifndef SIMD_H
+#define SIMD_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// The fixed-width vector types: chad4, gigachad4 and rizz8. Each fills
+// one SSE or AVX register.
+typedef enum
+{
+    SIMD_F32X4,
+    SIMD_F64X4,
+    SIMD_I32X8,
+} SimdKind;
+
+#define SIMD_BYTES 32
+
+typedef union
+{
+    _Alignas(SIMD_BYTES) float f32[SIMD_BYTES / sizeof(float)];
+    double f64[SIMD_BYTES / sizeof(double)];
+    int32_t i32[SIMD_BYTES / sizeof(int32_t)];
+} SimdVec;
+
+// Comparisons and AND/OR give masks: 1 in lanes where they hold, 0 elsewhere.
+typedef enum
+{
+    SIMD_ADD,
+    SIMD_SUB,
+    SIMD_MUL,
+    SIMD_DIV,
+    SIMD_MIN,
+    SIMD_MAX,
+    SIMD_LT,
+    SIMD_GT,
+    SIMD_LE,
+    SIMD_GE,
+    SIMD_EQ,
+    SIMD_NE,
+    SIMD_AND,
+    SIMD_OR,
+} SimdOp;
+
+typedef enum
+{
+    SIMD_SUM,
+    SIMD_HMIN,
+    SIMD_HMAX,
+} SimdReduce;
+
+size_t simd_lanes(SimdKind kind);
+void simd_splat(SimdKind kind, SimdVec *dst, double x);
+void simd_load(SimdKind kind, SimdVec *dst, const void *src);
+void simd_store(SimdKind kind, void *dst, const SimdVec *v);
+
+// dst may be the same vector as any operand. Integer lanes wrap on
+// overflow; integer division needs non-zero divisor lanes.
+void simd_binary(SimdOp op, SimdKind kind, SimdVec *dst, const SimdVec *a, const SimdVec *b);
+void simd_neg(SimdKind kind, SimdVec *dst, const SimdVec *a);
+void simd_select(SimdKind kind, SimdVec *dst, const SimdVec *mask, const SimdVec *a, const SimdVec *b);
+double simd_reduce(SimdReduce op, SimdKind kind, const SimdVec *v);
+
+#endif
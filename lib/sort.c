@@ -0,0 +1,398 @@
+#include "sort.h"
+#include "mem.h"
+#include <limits.h>
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
+
+/*
+ * Introsort: median-of-three quicksort that falls back to heapsort once the
+ * recursion gets deeper than 2*log2(n), so adversarial inputs stay
+ * O(n log n). Short slices are finished with insertion sort.
+ */
+#define DEFINE_INTROSORT(suffix, type)                                     \
+    static void insertion_sort_##suffix(type *a, size_t n)                 \
+    {                                                                      \
+        for (size_t i = 1; i < n; i++)                                     \
+        {                                                                  \
+            type v = a[i];                                                 \
+            size_t j = i;                                                  \
+            while (j > 0 && v < a[j - 1])                                  \
+            {                                                              \
+                a[j] = a[j - 1];                                           \
+                j--;                                                       \
+            }                                                              \
+            a[j] = v;                                                      \
+        }                                                                  \
+    }                                                                      \
+                                                                           \
+    static void sift_down_##suffix(type *a, size_t root, size_t n)         \
+    {                                                                      \
+        type v = a[root];                                                  \
+        size_t child;                                                      \
+        while ((child = 2 * root + 1) < n)                                 \
+        {                                                                  \
+            if (child + 1 < n && a[child] < a[child + 1])                  \
+                child++;                                                   \
+            if (!(v < a[child]))                                           \
+                break;                                                     \
+            a[root] = a[child];                                            \
+            root = child;                                                  \
+        }                                                                  \
+        a[root] = v;                                                       \
+    }                                                                      \
+                                                                           \
+    static void heapsort_##suffix(type *a, size_t n)                       \
+    {                                                                      \
+        for (size_t i = n / 2; i-- > 0;)                                   \
+            sift_down_##suffix(a, i, n);                                   \
+        for (size_t end = n; end-- > 1;)                                   \
+        {                                                                  \
+            type t = a[0];                                                 \
+            a[0] = a[end];                                                 \
+            a[end] = t;                                                    \
+            sift_down_##suffix(a, 0, end);                                 \
+        }                                                                  \
+    }                                                                      \
+                                                                           \
+    static void introsort_##suffix(type *a, size_t n, int depth)           \
+    {                                                                      \
+        while (n > SORT_INSERTION_THRESHOLD)                               \
+        {                                                                  \
+            if (depth-- == 0)                                              \
+            {                                                              \
+                heapsort_##suffix(a, n);                                   \
+                return;                                                    \
+            }                                                              \
+            size_t mid = n / 2;                                            \
+            type t;                                                        \
+            if (a[mid] < a[0])                                             \
+                t = a[mid], a[mid] = a[0], a[0] = t;                       \
+            if (a[n - 1] < a[mid])                                         \
+                t = a[n - 1], a[n - 1] = a[mid], a[mid] = t;               \
+            if (a[mid] < a[0])                                             \
+                t = a[mid], a[mid] = a[0], a[0] = t;                       \
+            type pivot = a[mid];                                           \
+                                                                           \
+            /* Hoare partition; a[0] and a[n-1] act as sentinels. */       \
+            size_t i = 0, j = n - 1;                                       \
+            for (;;)                                                       \
+            {                                                              \
+                while (a[i] < pivot)                                       \
+                    i++;                                                   \
+                while (pivot < a[j])                                       \
+                    j--;                                                   \
+                if (i >= j)                                                \
+                    break;                                                 \
+                t = a[i], a[i] = a[j], a[j] = t;                           \
+                i++;                                                       \
+                j--;                                                       \
+            }                                                              \
+            size_t left = j + 1;                                           \
+                                                                           \
+            /* Recurse into the smaller half, loop on the larger one. */   \
+            if (left < n - left)                                           \
+            {                                                              \
+                introsort_##suffix(a, left, depth);                        \
+                a += left;                                                 \
+                n -= left;                                                 \
+            }                                                              \
+            else                                                           \
+            {                                                              \
+                introsort_##suffix(a + left, n - left, depth);             \
+                n = left;                                                  \
+            }                                                              \
+        }                                                                  \
+        insertion_sort_##suffix(a, n);                                     \
+    }
+
+DEFINE_INTROSORT(int, int)
+DEFINE_INTROSORT(short, short)
+DEFINE_INTROSORT(float, float)
+DEFINE_INTROSORT(double, double)
+
+static int depth_limit(size_t n)
+{
+    int depth = 0;
+    while (n > 1)
+    {
+        depth += 2;
+        n >>= 1;
+    }
+    return depth;
+}
+
+/*
+ * LSD radix sort over 8-bit digits. Flipping the sign bit maps signed keys
+ * onto unsigned order; passes whose digit is identical for every element are
+ * skipped, so small-valued data only pays for the bytes that vary.
+ */
+#define DEFINE_RADIX_SORT(suffix, type, utype, sign_bit)                         \
+    void sort_##suffix(type *a, size_t n)                                        \
+    {                                                                            \
+        if (n < RADIX_THRESHOLD)                                                 \
+        {                                                                        \
+            insertion_sort_##suffix(a, n);                                       \
+            return;                                                              \
+        }                                                                        \
+                                                                                 \
+        type *buf = safe_malloc_array(n, sizeof(type));                          \
+        if (buf == NULL)                                                         \
+        {                                                                        \
+            introsort_##suffix(a, n, depth_limit(n));                            \
+            return;                                                              \
+        }                                                                        \
+                                                                                 \
+        size_t counts[sizeof(type)][256];                                        \
+        memset(counts, 0, sizeof(counts));                                       \
+        for (size_t i = 0; i < n; i++)                                           \
+        {                                                                        \
+            utype key = (utype)((utype)a[i] ^ (sign_bit));                       \
+            for (size_t b = 0; b < sizeof(type); b++)                            \
+                counts[b][(key >> (8 * b)) & 0xff]++;                            \
+        }                                                                        \
+                                                                                 \
+        type *src = a;                                                           \
+        type *dst = buf;                                                         \
+        for (size_t b = 0; b < sizeof(type); b++)                                \
+        {                                                                        \
+            utype first = (utype)((utype)src[0] ^ (sign_bit));                   \
+            if (counts[b][(first >> (8 * b)) & 0xff] == n)                       \
+                continue;                                                        \
+                                                                                 \
+            size_t offset = 0;                                                   \
+            for (size_t d = 0; d < 256; d++)                                     \
+            {                                                                    \
+                size_t c = counts[b][d];                                         \
+                counts[b][d] = offset;                                           \
+                offset += c;                                                     \
+            }                                                                    \
+            for (size_t i = 0; i < n; i++)                                       \
+            {                                                                    \
+                utype key = (utype)((utype)src[i] ^ (sign_bit));                 \
+                dst[counts[b][(key >> (8 * b)) & 0xff]++] = src[i];              \
+            }                                                                    \
+            type *t = src;                                                       \
+            src = dst;                                                           \
+            dst = t;                                                             \
+        }                                                                        \
+                                                                                 \
+        if (src != a)                                                            \
+            memcpy(a, src, n * sizeof(type));                                    \
+        SAFE_FREE(buf);                                                          \
+    }
+
+/**
+ * @brief Sorts an int array in ascending order
+ * @param a Array to sort in place
+ * @param n Number of elements
+ *
+ * Uses LSD radix sort (stable, O(n) per byte that varies) for large inputs
+ * and insertion sort for short ones.
+ */
+DEFINE_RADIX_SORT(int, int, uint32_t, 0x80000000u)
+
+/**
+ * @brief Sorts a short array in ascending order
+ * @see sort_int
+ */
+DEFINE_RADIX_SORT(short, short, uint16_t, 0x8000u)
+
+/**
+ * @brief Sorts a char array in ascending order
+ * @param a Array to sort in place
+ * @param n Number of elements
+ *
+ * A single-byte key fits in one counting pass, so the array is rewritten
+ * straight from the histogram without a scratch buffer. The bias puts
+ * negative values first only where char is signed.
+ */
+void sort_char(char *a, size_t n)
+{
+    const unsigned bias = CHAR_MIN < 0 ? 0x80 : 0;
+    size_t counts[256] = {0};
+    for (size_t i = 0; i < n; i++)
+        counts[(unsigned char)a[i] ^ bias]++;
+
+    size_t pos = 0;
+    for (size_t d = 0; d < 256; d++)
+    {
+        memset(a + pos, (int)(d ^ bias), counts[d]);
+        pos += counts[d];
+    }
+}
+
+/*
+ * NaN compares false against everything, which would break the partition
+ * invariants, so NaNs are moved to the tail first and only the rest is sorted.
+ */
+#define DEFINE_FLOAT_SORT(suffix, type)                                    \
+    void sort_##suffix(type *a, size_t n)                                  \
+    {                                                                      \
+        size_t end = n;                                                    \
+        for (size_t i = 0; i < end;)                                       \
+        {                                                                  \
+            if (isnan(a[i]))                                               \
+            {                                                              \
+                type t = a[i];                                             \
+                a[i] = a[--end];                                           \
+                a[end] = t;                                                \
+            }                                                              \
+            else                                                           \
+            {                                                              \
+                i++;                                                       \
+            }                                                              \
+        }                                                                  \
+        introsort_##suffix(a, end, depth_limit(end));                      \
+    }
+
+/**
+ * @brief Sorts a float array in ascending order, NaNs last
+ * @param a Array to sort in place
+ * @param n Number of elements
+ *
+ * Introsort: O(n log n) worst case, not stable.
+ */
+DEFINE_FLOAT_SORT(float, float)
+
+/**
+ * @brief Sorts a double array in ascending order, NaNs last
+ * @see sort_float
+ */
+DEFINE_FLOAT_SORT(double, double)
+
+#define STABLE_RUN 32
+
+/*
+ * Bottom-up merge sort: insertion-sort fixed runs, then merge pairs of runs
+ * back and forth between the array and one scratch buffer. Ties always take
+ * the left element, which keeps equal keys in their original order.
+ */
+#define DEFINE_STABLE_SORT(suffix, type)                                        \
+    static int stable_less_##suffix(type x, type y)                             \
+    {                                                                           \
+        return x < y || (isnan(y) && !isnan(x));                                \
+    }                                                                           \
+                                                                                \
+    bool stable_sort_##suffix(type *a, size_t n)                                \
+    {                                                                           \
+        for (size_t lo = 0; lo < n; lo += STABLE_RUN)                           \
+        {                                                                       \
+            size_t hi = lo + STABLE_RUN < n ? lo + STABLE_RUN : n;              \
+            for (size_t i = lo + 1; i < hi; i++)                                \
+            {                                                                   \
+                type v = a[i];                                                  \
+                size_t j = i;                                                   \
+                while (j > lo && stable_less_##suffix(v, a[j - 1]))             \
+                {                                                               \
+                    a[j] = a[j - 1];                                            \
+                    j--;                                                        \
+                }                                                               \
+                a[j] = v;                                                       \
+            }                                                                   \
+        }                                                                       \
+        if (n <= STABLE_RUN)                                                    \
+            return true;                                                        \
+                                                                                \
+        type *buf = safe_malloc_array(n, sizeof(type));                         \
+        if (buf == NULL)                                                        \
+            return false;                                                       \
+        type *src = a;                                                          \
+        type *dst = buf;                                                        \
+        for (size_t width = STABLE_RUN; width < n; width *= 2)                  \
+        {                                                                       \
+            for (size_t lo = 0; lo < n; lo += 2 * width)                        \
+            {                                                                   \
+                size_t mid = lo + width < n ? lo + width : n;                   \
+                size_t hi = lo + 2 * width < n ? lo + 2 * width : n;            \
+                size_t i = lo, j = mid, k = lo;                                 \
+                while (i < mid && j < hi)                                       \
+                    dst[k++] = stable_less_##suffix(src[j], src[i])             \
+                                   ? src[j++]                                   \
+                                   : src[i++];                                  \
+                while (i < mid)                                                 \
+                    dst[k++] = src[i++];                                        \
+                while (j < hi)                                                  \
+                    dst[k++] = src[j++];                                        \
+            }                                                                   \
+            type *t = src;                                                      \
+            src = dst;                                                          \
+            dst = t;                                                            \
+        }                                                                       \
+        if (src != a)                                                           \
+            memcpy(a, src, n * sizeof(type));                                   \
+        SAFE_FREE(buf);                                                         \
+        return true;                                                            \
+    }
+
+/**
+ * @brief Stable ascending sort of a float array, NaNs last
+ * @param a Array to sort in place
+ * @param n Number of elements
+ * @return false, with the array only partly sorted, if the scratch buffer
+ *         cannot be allocated
+ */
+DEFINE_STABLE_SORT(float, float)
+
+/**
+ * @brief Stable ascending sort of a double array, NaNs last
+ * @see stable_sort_float
+ */
+DEFINE_STABLE_SORT(double, double)
+
+/*
+ * Branch-light lower bound: halve the window every step and pick a side with
+ * a conditional move rather than an unpredictable branch.
+ */
+#define DEFINE_LOWER_BOUND(suffix, type)                                   \
+    size_t lower_bound_##suffix(const type *a, size_t n, type x)           \
+    {                                                                      \
+        const type *base = a;                                              \
+        while (n > 1)                                                      \
+        {                                                                  \
+            size_t half = n / 2;                                           \
+            base = base[half - 1] < x ? base + half : base;                \
+            n -= half;                                                     \
+        }                                                                  \
+        return (size_t)(base - a) + (n == 1 && *base < x);                 \
+    }
+
+/**
+ * @brief Finds the first position in a sorted array whose element is not less than x
+ * @param a Array sorted in ascending order
+ * @param n Number of elements
+ * @param x Value to search for
+ * @return size_t Index of the first element >= x, or n if there is none
+ */
+DEFINE_LOWER_BOUND(int, int)
+DEFINE_LOWER_BOUND(short, short)
+DEFINE_LOWER_BOUND(char, char)
+DEFINE_LOWER_BOUND(float, float)
+DEFINE_LOWER_BOUND(double, double)
+
+#define DEFINE_UNIQUE(suffix, type)                                        \
+    size_t unique_##suffix(type *a, size_t n)                              \
+    {                                                                      \
+        if (n == 0)                                                        \
+            return 0;                                                      \
+        size_t out = 1;                                                    \
+        for (size_t i = 1; i < n; i++)                                     \
+        {                                                                  \
+            if (a[i] != a[out - 1])                                        \
+                a[out++] = a[i];                                           \
+        }                                                                  \
+        return out;                                                        \
+    }
+
+/**
+ * @brief Collapses runs of equal adjacent elements to a single element
+ * @param a Array to compact in place (sort it first to remove all duplicates)
+ * @param n Number of elements
+ * @return size_t Number of elements kept; a[0..return) holds the result and
+ *         the elements after it keep their previous values
+ */
+DEFINE_UNIQUE(int, int)
+DEFINE_UNIQUE(short, short)
+DEFINE_UNIQUE(char, char)
+DEFINE_UNIQUE(float, float)
+DEFINE_UNIQUE(double, double)
@@ -0,0 +1,35 @@
+/* sort.h */
+
+#ifndef SORT_H
+#define SORT_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+// Below this many elements insertion sort beats both radix sort and
+// quicksort partitioning.
+#define SORT_INSERTION_THRESHOLD 16
+#define RADIX_THRESHOLD 64
+
+void sort_int(int *a, size_t n);
+void sort_short(short *a, size_t n);
+void sort_char(char *a, size_t n);
+void sort_float(float *a, size_t n);
+void sort_double(double *a, size_t n);
+
+bool stable_sort_float(float *a, size_t n);
+bool stable_sort_double(double *a, size_t n);
+
+size_t lower_bound_int(const int *a, size_t n, int x);
+size_t lower_bound_short(const short *a, size_t n, short x);
+size_t lower_bound_char(const char *a, size_t n, char x);
+size_t lower_bound_float(const float *a, size_t n, float x);
+size_t lower_bound_double(const double *a, size_t n, double x);
+
+size_t unique_int(int *a, size_t n);
+size_t unique_short(short *a, size_t n);
+size_t unique_char(char *a, size_t n);
+size_t unique_float(float *a, size_t n);
+size_t unique_double(double *a, size_t n);
+
+#endif
@@ -0,0 +1,360 @@
+#include "vmath.h"
+#include <float.h>
+#include <math.h>
+#include <stdbool.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#define VMATH_LN2_HI 6.93147180369123816490e-01
+#define VMATH_LN2_LO 1.90821492927058770002e-10
+#define VMATH_LOG2E 1.44269504088896338700e+00
+#define VMATH_SQRT2 1.41421356237309514547e+00
+#define VMATH_2_PI 6.36619772367581382433e-01
+
+// pi/2 split into 33-bit pieces, so n * piece is exact for |n| < 2^20.
+#define VMATH_PIO2_1 1.57079632673412561417e+00
+#define VMATH_PIO2_2 6.07710050630396597660e-11
+#define VMATH_PIO2_3 2.02226624871116645580e-21
+
+// Largest |x| the vector sin/cos range reduction handles exactly enough.
+#define VMATH_TRIG_LIMIT 1.0e5
+// exp(x) stays a normal double for |x| up to about 708.4.
+#define VMATH_EXP_LIMIT 708.0
+
+/**
+ * @brief Applies one math operation to a single value using libm
+ * @param op Operation to apply
+ * @param x Input value
+ * @return The result of op(x)
+ */
+double vmath_scalar(VmathOp op, double x)
+{
+    switch (op)
+    {
+    case VMATH_SQRT:
+        return sqrt(x);
+    case VMATH_EXP:
+        return exp(x);
+    case VMATH_LOG:
+        return log(x);
+    case VMATH_SIN:
+        return sin(x);
+    case VMATH_COS:
+        return cos(x);
+    case VMATH_FLOOR:
+        return floor(x);
+    case VMATH_ABS:
+        return fabs(x);
+    }
+    return x;
+}
+
+#if defined(__SSE2__)
+
+/*
+ * Two-lane double kernels. Each handles the common range with branch-free
+ * polynomial code and hands the whole pair to libm when either lane is out of
+ * range, NaN or infinite, so special values behave exactly like the scalar
+ * builtins.
+ */
+
+typedef __m128d (*Kernel)(__m128d);
+
+static inline __m128d select_pd(__m128d mask, __m128d a, __m128d b)
+{
+    return _mm_or_pd(_mm_and_pd(mask, a), _mm_andnot_pd(mask, b));
+}
+
+static inline __m128d abs_pd(__m128d x)
+{
+    return _mm_andnot_pd(_mm_set1_pd(-0.0), x);
+}
+
+static __m128d scalar_pair(VmathOp op, __m128d x)
+{
+    double v[2];
+    _mm_storeu_pd(v, x);
+    return _mm_set_pd(vmath_scalar(op, v[1]), vmath_scalar(op, v[0]));
+}
+
+static inline bool all_lanes(__m128d mask)
+{
+    return _mm_movemask_pd(mask) == 3;
+}
+
+static __m128d sqrt_pd(__m128d x)
+{
+    return _mm_sqrt_pd(x);
+}
+
+static __m128d floor_pd(__m128d x)
+{
+    // Adding and removing 2^52 rounds to an integer; step down if that
+    // rounded up. Lanes already integral (|x| >= 2^52, inf, NaN) pass through.
+    const __m128d two52 = _mm_set1_pd(4503599627370496.0);
+    __m128d sign = _mm_and_pd(x, _mm_set1_pd(-0.0));
+    __m128d magic = _mm_or_pd(two52, sign);
+    __m128d t = _mm_sub_pd(_mm_add_pd(x, magic), magic);
+    t = _mm_sub_pd(t, _mm_and_pd(_mm_cmpgt_pd(t, x), _mm_set1_pd(1.0)));
+    t = _mm_or_pd(t, sign);
+    return select_pd(_mm_cmplt_pd(abs_pd(x), two52), t, x);
+}
+
+static __m128d exp_pd(__m128d x)
+{
+    if (!all_lanes(_mm_cmple_pd(abs_pd(x), _mm_set1_pd(VMATH_EXP_LIMIT))))
+    {
+        return scalar_pair(VMATH_EXP, x);
+    }
+
+    // x = n*ln2 + r with |r| <= ln2/2, exp(x) = 2^n * exp(r).
+    const __m128d shifter = _mm_set1_pd(0x1.8p52);
+    __m128d kd = _mm_add_pd(_mm_mul_pd(x, _mm_set1_pd(VMATH_LOG2E)), shifter);
+    __m128d n = _mm_sub_pd(kd, shifter);
+    __m128d r = _mm_sub_pd(x, _mm_mul_pd(n, _mm_set1_pd(VMATH_LN2_HI)));
+    r = _mm_sub_pd(r, _mm_mul_pd(n, _mm_set1_pd(VMATH_LN2_LO)));
+
+    // Taylor series to r^13 is below half an ulp on |r| <= 0.347.
+    __m128d p = _mm_set1_pd(1.0 / 6227020800.0);
+    p = _mm_add_pd(_mm_mul_pd(p, r), _mm_set1_pd(1.0 / 479001600.0));
+    p = _mm_add_pd(_mm_mul_pd(p, r), _mm_set1_pd(1.0 / 39916800.0));
+    p = _mm_add_pd(_mm_mul_pd(p, r), _mm_set1_pd(1.0 / 3628800.0));
+    p = _mm_add_pd(_mm_mul_pd(p, r), _mm_set1_pd(1.0 / 362880.0));
+    p = _mm_add_pd(_mm_mul_pd(p, r), _mm_set1_pd(1.0 / 40320.0));
+    p = _mm_add_pd(_mm_mul_pd(p, r), _mm_set1_pd(1.0 / 5040.0));
+    p = _mm_add_pd(_mm_mul_pd(p, r), _mm_set1_pd(1.0 / 720.0));
+    p = _mm_add_pd(_mm_mul_pd(p, r), _mm_set1_pd(1.0 / 120.0));
+    p = _mm_add_pd(_mm_mul_pd(p, r), _mm_set1_pd(1.0 / 24.0));
+    p = _mm_add_pd(_mm_mul_pd(p, r), _mm_set1_pd(1.0 / 6.0));
+    p = _mm_add_pd(_mm_mul_pd(p, r), _mm_set1_pd(0.5));
+    p = _mm_add_pd(_mm_mul_pd(p, r), _mm_set1_pd(1.0));
+    p = _mm_add_pd(_mm_mul_pd(p, r), _mm_set1_pd(1.0));
+
+    // The low mantissa bits of kd hold n; build 2^n directly in the exponent.
+    __m128i k = _mm_sub_epi64(_mm_castpd_si128(kd), _mm_castpd_si128(shifter));
+    __m128i scale = _mm_slli_epi64(_mm_add_epi64(k, _mm_set1_epi64x(1023)), 52);
+    return _mm_mul_pd(p, _mm_castsi128_pd(scale));
+}
+
+static __m128d log_pd(__m128d x)
+{
+    __m128d normal = _mm_and_pd(_mm_cmpge_pd(x, _mm_set1_pd(DBL_MIN)),
+                                _mm_cmple_pd(x, _mm_set1_pd(DBL_MAX)));
+    if (!all_lanes(normal))
+    {
+        return scalar_pair(VMATH_LOG, x);
+    }
+
+    // x = m * 2^e with m in [sqrt(1/2), sqrt(2)).
+    __m128i bits = _mm_castpd_si128(x);
+    __m128i biased = _mm_shuffle_epi32(_mm_srli_epi64(bits, 52), _MM_SHUFFLE(3, 1, 2, 0));
+    __m128d e = _mm_sub_pd(_mm_cvtepi32_pd(biased), _mm_set1_pd(1023.0));
+    __m128i mant = _mm_and_si128(bits, _mm_set1_epi64x(0x000FFFFFFFFFFFFFLL));
+    __m128d m = _mm_castsi128_pd(_mm_or_si128(mant, _mm_set1_epi64x(0x3FF0000000000000LL)));
+    __m128d big = _mm_cmpgt_pd(m, _mm_set1_pd(VMATH_SQRT2));
+    m = select_pd(big, _mm_mul_pd(m, _mm_set1_pd(0.5)), m);
+    e = _mm_add_pd(e, _mm_and_pd(big, _mm_set1_pd(1.0)));
+
+    // log(m) = 2 atanh(s) with s = (m-1)/(m+1), |s| <= 0.172.
+    const __m128d one = _mm_set1_pd(1.0);
+    __m128d s = _mm_div_pd(_mm_sub_pd(m, one), _mm_add_pd(m, one));
+    __m128d z = _mm_mul_pd(s, s);
+    __m128d p = _mm_set1_pd(1.0 / 21.0);
+    p = _mm_add_pd(_mm_mul_pd(p, z), _mm_set1_pd(1.0 / 19.0));
+    p = _mm_add_pd(_mm_mul_pd(p, z), _mm_set1_pd(1.0 / 17.0));
+    p = _mm_add_pd(_mm_mul_pd(p, z), _mm_set1_pd(1.0 / 15.0));
+    p = _mm_add_pd(_mm_mul_pd(p, z), _mm_set1_pd(1.0 / 13.0));
+    p = _mm_add_pd(_mm_mul_pd(p, z), _mm_set1_pd(1.0 / 11.0));
+    p = _mm_add_pd(_mm_mul_pd(p, z), _mm_set1_pd(1.0 / 9.0));
+    p = _mm_add_pd(_mm_mul_pd(p, z), _mm_set1_pd(1.0 / 7.0));
+    p = _mm_add_pd(_mm_mul_pd(p, z), _mm_set1_pd(1.0 / 5.0));
+    p = _mm_add_pd(_mm_mul_pd(p, z), _mm_set1_pd(1.0 / 3.0));
+    __m128d two_s = _mm_add_pd(s, s);
+    __m128d log_m = _mm_add_pd(two_s, _mm_mul_pd(_mm_mul_pd(two_s, z), p));
+
+    __m128d lo = _mm_add_pd(log_m, _mm_mul_pd(e, _mm_set1_pd(VMATH_LN2_LO)));
+    return _mm_add_pd(_mm_mul_pd(e, _mm_set1_pd(VMATH_LN2_HI)), lo);
+}
+
+/*
+ * sin and cos share one range reduction: x = n*pi/2 + r with |r| <= pi/4,
+ * then pick sin(r) or cos(r) and a sign from the quadrant n mod 4. cos uses
+ * the identity cos(x) = sin(x + pi/2), i.e. the quadrant shifted by one.
+ */
+static __m128d sincos_pd(__m128d x, VmathOp op, int quadrant_shift)
+{
+    if (!all_lanes(_mm_cmple_pd(abs_pd(x), _mm_set1_pd(VMATH_TRIG_LIMIT))))
+    {
+        return scalar_pair(op, x);
+    }
+
+    const __m128d shifter = _mm_set1_pd(0x1.8p52);
+    __m128d kd = _mm_add_pd(_mm_mul_pd(x, _mm_set1_pd(VMATH_2_PI)), shifter);
+    __m128d n = _mm_sub_pd(kd, shifter);
+    __m128d r = _mm_sub_pd(x, _mm_mul_pd(n, _mm_set1_pd(VMATH_PIO2_1)));
+    r = _mm_sub_pd(r, _mm_mul_pd(n, _mm_set1_pd(VMATH_PIO2_2)));
+    r = _mm_sub_pd(r, _mm_mul_pd(n, _mm_set1_pd(VMATH_PIO2_3)));
+    __m128d z = _mm_mul_pd(r, r);
+
+    // Taylor series to r^17 (sin) and r^16 (cos) on |r| <= pi/4.
+    __m128d ps = _mm_set1_pd(1.0 / 355687428096000.0);
+    ps = _mm_add_pd(_mm_mul_pd(ps, z), _mm_set1_pd(-1.0 / 1307674368000.0));
+    ps = _mm_add_pd(_mm_mul_pd(ps, z), _mm_set1_pd(1.0 / 6227020800.0));
+    ps = _mm_add_pd(_mm_mul_pd(ps, z), _mm_set1_pd(-1.0 / 39916800.0));
+    ps = _mm_add_pd(_mm_mul_pd(ps, z), _mm_set1_pd(1.0 / 362880.0));
+    ps = _mm_add_pd(_mm_mul_pd(ps, z), _mm_set1_pd(-1.0 / 5040.0));
+    ps = _mm_add_pd(_mm_mul_pd(ps, z), _mm_set1_pd(1.0 / 120.0));
+    ps = _mm_add_pd(_mm_mul_pd(ps, z), _mm_set1_pd(-1.0 / 6.0));
+    __m128d sin_r = _mm_add_pd(r, _mm_mul_pd(_mm_mul_pd(r, z), ps));
+
+    __m128d pc = _mm_set1_pd(1.0 / 20922789888000.0);
+    pc = _mm_add_pd(_mm_mul_pd(pc, z), _mm_set1_pd(-1.0 / 87178291200.0));
+    pc = _mm_add_pd(_mm_mul_pd(pc, z), _mm_set1_pd(1.0 / 479001600.0));
+    pc = _mm_add_pd(_mm_mul_pd(pc, z), _mm_set1_pd(-1.0 / 3628800.0));
+    pc = _mm_add_pd(_mm_mul_pd(pc, z), _mm_set1_pd(1.0 / 40320.0));
+    pc = _mm_add_pd(_mm_mul_pd(pc, z), _mm_set1_pd(-1.0 / 720.0));
+    pc = _mm_add_pd(_mm_mul_pd(pc, z), _mm_set1_pd(1.0 / 24.0));
+    pc = _mm_add_pd(_mm_mul_pd(pc, z), _mm_set1_pd(-0.5));
+    __m128d cos_r = _mm_add_pd(_mm_set1_pd(1.0), _mm_mul_pd(z, pc));
+
+    // kd's low mantissa bits are n in two's complement, so n mod 4 is bits & 3.
+    __m128i q = _mm_add_epi64(_mm_castpd_si128(kd), _mm_set1_epi64x(quadrant_shift));
+    __m128i odd = _mm_sub_epi64(_mm_setzero_si128(), _mm_and_si128(q, _mm_set1_epi64x(1)));
+    __m128i negate = _mm_slli_epi64(_mm_and_si128(q, _mm_set1_epi64x(2)), 62);
+    __m128d result = select_pd(_mm_castsi128_pd(odd), cos_r, sin_r);
+    return _mm_xor_pd(result, _mm_castsi128_pd(negate));
+}
+
+static __m128d sin_pd(__m128d x)
+{
+    return sincos_pd(x, VMATH_SIN, 0);
+}
+
+static __m128d cos_pd(__m128d x)
+{
+    return sincos_pd(x, VMATH_COS, 1);
+}
+
+static Kernel get_kernel(VmathOp op)
+{
+    switch (op)
+    {
+    case VMATH_SQRT:
+        return sqrt_pd;
+    case VMATH_EXP:
+        return exp_pd;
+    case VMATH_LOG:
+        return log_pd;
+    case VMATH_SIN:
+        return sin_pd;
+    case VMATH_COS:
+        return cos_pd;
+    case VMATH_FLOOR:
+        return floor_pd;
+    case VMATH_ABS:
+        return abs_pd;
+    }
+    return NULL;
+}
+
+#endif /* __SSE2__ */
+
+/**
+ * @brief Applies a math operation element-wise to a double array
+ * @param op Operation to apply
+ * @param dst Output array of n elements; may be the same array as src
+ * @param src Input array of n elements
+ * @param n Number of elements
+ *
+ * With SSE2 available, two elements are processed per step using polynomial
+ * kernels; the remainder and out-of-range lanes go through libm.
+ */
+void vmath_apply_double(VmathOp op, double *dst, const double *src, size_t n)
+{
+    size_t i = 0;
+#if defined(__SSE2__)
+    Kernel kernel = get_kernel(op);
+    for (; i + 2 <= n; i += 2)
+    {
+        _mm_storeu_pd(dst + i, kernel(_mm_loadu_pd(src + i)));
+    }
+#endif
+    for (; i < n; i++)
+    {
+        dst[i] = vmath_scalar(op, src[i]);
+    }
+}
+
+/**
+ * @brief Applies a math operation element-wise to a float array
+ * @see vmath_apply_double
+ *
+ * Elements are widened to double four at a time, run through the double
+ * kernels and rounded back, so results match the scalar builtins.
+ */
+void vmath_apply_float(VmathOp op, float *dst, const float *src, size_t n)
+{
+    size_t i = 0;
+#if defined(__SSE2__)
+    Kernel kernel = get_kernel(op);
+    for (; i + 4 <= n; i += 4)
+    {
+        __m128 v = _mm_loadu_ps(src + i);
+        __m128d lo = kernel(_mm_cvtps_pd(v));
+        __m128d hi = kernel(_mm_cvtps_pd(_mm_movehl_ps(v, v)));
+        _mm_storeu_ps(dst + i, _mm_movelh_ps(_mm_cvtpd_ps(lo), _mm_cvtpd_ps(hi)));
+    }
+#endif
+    for (; i < n; i++)
+    {
+        dst[i] = (float)vmath_scalar(op, src[i]);
+    }
+}
+
+/**
+ * @brief Raises every element of a double array to a fixed power
+ * @param dst Output array of n elements; may be the same array as src
+ * @param src Input array of n elements
+ * @param p Exponent
+ * @param n Number of elements
+ *
+ * Squaring is a plain multiply loop; other exponents go through libm pow,
+ * since pow built from exp(p * log(x)) loses too much precision.
+ */
+void vmath_pow_double(double *dst, const double *src, double p, size_t n)
+{
+    if (p == 2.0)
+    {
+        for (size_t i = 0; i < n; i++)
+        {
+            dst[i] = src[i] * src[i];
+        }
+        return;
+    }
+    for (size_t i = 0; i < n; i++)
+    {
+        dst[i] = pow(src[i], p);
+    }
+}
+
+/**
+ * @brief Raises every element of a float array to a fixed power
+ * @see vmath_pow_double
+ */
+void vmath_pow_float(float *dst, const float *src, double p, size_t n)
+{
+    if (p == 2.0)
+    {
+        for (size_t i = 0; i < n; i++)
+        {
+            dst[i] = src[i] * src[i];
+        }
+        return;
+    }
+    for (size_t i = 0; i < n; i++)
+    {
+        dst[i] = (float)pow(src[i], p);
+    }
+}
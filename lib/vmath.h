@@ -0,0 +1,27 @@
+/* vmath.h */
+
+#ifndef VMATH_H
+#define VMATH_H
+
+#include <stddef.h>
+
+typedef enum
+{
+    VMATH_SQRT,
+    VMATH_EXP,
+    VMATH_LOG,
+    VMATH_SIN,
+    VMATH_COS,
+    VMATH_FLOOR,
+    VMATH_ABS,
+} VmathOp;
+
+double vmath_scalar(VmathOp op, double x);
+
+// dst and src may be the same array; they must not partially overlap.
+void vmath_apply_double(VmathOp op, double *dst, const double *src, size_t n);
+void vmath_apply_float(VmathOp op, float *dst, const float *src, size_t n);
+void vmath_pow_double(double *dst, const double *src, double p, size_t n);
+void vmath_pow_float(float *dst, const float *src, double p, size_t n);
+
+#endif
@@ -0,0 +1,85 @@
+/* main.c */
+
+#include "brainrot.h"
+#include "cli.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Reads a whole file into memory; NULL with errno set if it cannot
+char *read_source(const char *path, size_t *len)
+{
+    FILE *file = fopen(path, "rb");
+    if (file == NULL)
+        return NULL;
+
+    size_t capacity = 1 << 16;
+    char *data = malloc(capacity);
+    *len = 0;
+    while (data != NULL)
+    {
+        *len += fread(data + *len, 1, capacity - *len, file);
+        if (*len < capacity)
+            break;
+        char *grown = realloc(data, capacity * 2);
+        if (grown == NULL)
+        {
+            free(data);
+            data = NULL;
+            break;
+        }
+        data = grown;
+        capacity *= 2;
+    }
+    if (data != NULL && ferror(file))
+    {
+        free(data);
+        data = NULL;
+    }
+    fclose(file);
+    return data;
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc >= 2 && strcmp(argv[1], "--batch") == 0)
+        return batch_main(argc - 1, argv + 1);
+    if (argc >= 2 && strcmp(argv[1], "--shard") == 0)
+        return shard_main(argc - 1, argv + 1);
+    if (argc >= 2 && strcmp(argv[1], "--serve") == 0)
+        return serve_main(argc - 1, argv + 1);
+    if (argc >= 2 && strcmp(argv[1], "--client") == 0)
+        return client_main(argc - 1, argv + 1);
+    if (argc != 2)
+    {
+        fprintf(stderr, "Usage: %s <sourcefile>\n", argv[0]);
+        fprintf(stderr, "       %s --batch [--jobs N] [--out DIR] <listfile>\n", argv[0]);
+        fprintf(stderr, "       %s --shard [--jobs N] [--out DIR] <sourcefile> <inputfile>...\n", argv[0]);
+        fprintf(stderr, "       %s --serve <socketpath>\n", argv[0]);
+        fprintf(stderr, "       %s --client <socketpath> <sourcefile>\n", argv[0]);
+        return 1;
+    }
+
+    size_t len;
+    char *source = read_source(argv[1], &len);
+    if (source == NULL)
+    {
+        perror("Cannot open source file");
+        return 1;
+    }
+
+    Brainrot *br = brainrot_create();
+    if (br == NULL)
+    {
+        free(source);
+        fprintf(stderr, "Error: %s\n", brainrot_status_name(BRAINROT_NO_MEMORY));
+        return 1;
+    }
+    if (brainrot_parse(br, source, len) == BRAINROT_OK)
+        brainrot_run(br);
+    free(source);
+
+    int status = brainrot_exit_code(br);
+    brainrot_destroy(br);
+    return status;
+}
@@ -0,0 +1,600 @@
+/* serve.c */
+
+#include "brainrot.h"
+#include "cli.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <time.h>
+#include <unistd.h>
+
+/*
+ * A resident server on a Unix socket. Parsed programs are cached by the
+ * hash of their source; every request forks a child from the server, which
+ * runs the cached parse once with the request's stdin and answers the
+ * client itself, so requests run concurrently and each starts from an
+ * untouched program. The server never runs a program, so it never starts
+ * the work pool before forking.
+ *
+ * The server reads requests from all open connections at once, taking
+ * whatever each has sent so far, so a client that connects and stalls only
+ * holds up itself; it is dropped after SERVE_IDLE_MS without progress.
+ *
+ * Both directions are a sequence of fields, numbers as native uint32_t
+ * since both ends share a machine:
+ *
+ *   request:  kind (SERVE_SOURCE or SERVE_PATH), length, script bytes,
+ *             length, stdin bytes
+ *   response: BrainrotStatus, exit code, length, stdout bytes,
+ *             length, stderr bytes
+ *
+ * A SERVE_PATH script is read by the server, so it should be absolute.
+ */
+
+#define SERVE_SOURCE 0
+#define SERVE_PATH 1
+
+#define SERVE_CACHE_SLOTS 256 // direct-mapped by hash
+#define SERVE_MAX_FIELD ((uint32_t)1 << 28)
+#define SERVE_MAX_PENDING 64 // connections still sending their request
+#define SERVE_IDLE_MS 10000
+
+typedef struct
+{
+    uint64_t hash;
+    char *source;
+    size_t len;
+    Brainrot *br; // parsed, never run
+} CachedProgram;
+
+typedef struct
+{
+    char *data;
+    size_t len;
+    size_t capacity;
+} Buffer;
+
+typedef struct
+{
+    const char *data;
+    size_t len;
+    size_t pos;
+} Reader;
+
+// A connection whose request has not fully arrived
+typedef struct
+{
+    int fd;
+    Buffer request;
+    long long deadline; // ms on the monotonic clock
+} Pending;
+
+typedef struct
+{
+    CachedProgram *cache;
+    int listener;
+    Pending pending[SERVE_MAX_PENDING];
+    size_t count;
+} Server;
+
+static volatile sig_atomic_t stopping;
+
+static void stop(int sig)
+{
+    (void)sig;
+    stopping = 1;
+}
+
+static bool write_all(int fd, const void *data, size_t len)
+{
+    const char *p = data;
+    while (len > 0)
+    {
+        ssize_t n = write(fd, p, len);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return false;
+        p += n;
+        len -= (size_t)n;
+    }
+    return true;
+}
+
+static bool read_all(int fd, void *data, size_t len)
+{
+    char *p = data;
+    while (len > 0)
+    {
+        ssize_t n = read(fd, p, len);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return false;
+        p += n;
+        len -= (size_t)n;
+    }
+    return true;
+}
+
+static bool write_u32(int fd, uint32_t value)
+{
+    return write_all(fd, &value, sizeof value);
+}
+
+static bool read_u32(int fd, uint32_t *value)
+{
+    return read_all(fd, value, sizeof *value);
+}
+
+static bool write_field(int fd, const char *data, size_t len)
+{
+    return len <= SERVE_MAX_FIELD && write_u32(fd, (uint32_t)len) && write_all(fd, data, len);
+}
+
+// Reads a length and that many bytes, NUL-terminated for convenience
+static char *read_field(int fd, size_t *len)
+{
+    uint32_t n;
+    if (!read_u32(fd, &n) || n > SERVE_MAX_FIELD)
+        return NULL;
+    char *data = malloc((size_t)n + 1);
+    if (data != NULL && !read_all(fd, data, n))
+    {
+        free(data);
+        return NULL;
+    }
+    if (data != NULL)
+        data[n] = '\0';
+    *len = n;
+    return data;
+}
+
+static void buffer_write(void *user, const char *data, size_t len)
+{
+    Buffer *buffer = user;
+    if (len == 0)
+        return;
+    if (buffer->len + len > buffer->capacity)
+    {
+        size_t capacity = buffer->capacity ? buffer->capacity : 256;
+        while (capacity < buffer->len + len)
+            capacity *= 2;
+        char *grown = realloc(buffer->data, capacity);
+        if (grown == NULL)
+            return;
+        buffer->data = grown;
+        buffer->capacity = capacity;
+    }
+    memcpy(buffer->data + buffer->len, data, len);
+    buffer->len += len;
+}
+
+static ssize_t read_memory(void *user, char *dst, size_t len)
+{
+    Reader *reader = user;
+    size_t left = reader->len - reader->pos;
+    if (len > left)
+        len = left;
+    memcpy(dst, reader->data + reader->pos, len);
+    reader->pos += len;
+    return (ssize_t)len;
+}
+
+static void respond(int conn, BrainrotStatus status, int exit_code, const Buffer *out, const Buffer *err)
+{
+    // A client that hung up just misses its answer
+    if (write_u32(conn, (uint32_t)status) && write_u32(conn, (uint32_t)exit_code) &&
+        write_field(conn, out->data, out->len))
+        write_field(conn, err->data, err->len);
+}
+
+// FNV-1a, as the interpreter's hash maps use
+static uint64_t hash_source(const char *source, size_t len)
+{
+    uint64_t hash = 14695981039346656037ULL;
+    for (size_t i = 0; i < len; i++)
+        hash = (hash ^ (unsigned char)source[i]) * 1099511628211ULL;
+    return hash;
+}
+
+static void uncache(CachedProgram *slot)
+{
+    brainrot_destroy(slot->br);
+    free(slot->source);
+    memset(slot, 0, sizeof *slot);
+}
+
+// Finds the parsed program for source, parsing and caching it on a miss;
+// a syntax error leaves its message in err and exit code and returns NULL
+static Brainrot *lookup(CachedProgram *cache, char *source, size_t len, Buffer *err, int *exit_code)
+{
+    uint64_t hash = hash_source(source, len);
+    CachedProgram *slot = &cache[hash % SERVE_CACHE_SLOTS];
+    if (slot->br != NULL && slot->hash == hash && slot->len == len && memcmp(slot->source, source, len) == 0)
+    {
+        free(source);
+        return slot->br;
+    }
+
+    Brainrot *br = brainrot_create();
+    if (br == NULL || brainrot_set_errors(br, buffer_write, err) != BRAINROT_OK ||
+        brainrot_parse(br, source, len) != BRAINROT_OK)
+    {
+        *exit_code = brainrot_exit_code(br);
+        brainrot_destroy(br);
+        free(source);
+        return NULL;
+    }
+    uncache(slot);
+    *slot = (CachedProgram){hash, source, len, br};
+    return br;
+}
+
+// In the child: runs the cached program on the request's stdin and answers
+static _Noreturn void run_request(Brainrot *br, int conn, const char *input, size_t input_len)
+{
+    Buffer out = {0}, err = {0};
+    Reader reader = {input, input_len, 0};
+    BrainrotStatus status = brainrot_set_output(br, buffer_write, &out);
+    if (status == BRAINROT_OK)
+        status = brainrot_set_errors(br, buffer_write, &err);
+    if (status == BRAINROT_OK)
+        status = brainrot_set_input(br, read_memory, &reader);
+    if (status == BRAINROT_OK)
+        status = brainrot_run(br);
+    respond(conn, status, brainrot_exit_code(br), &out, &err);
+    _exit(0);
+}
+
+static bool take_u32(Reader *reader, uint32_t *value)
+{
+    if (reader->len - reader->pos < sizeof *value)
+        return false;
+    memcpy(value, reader->data + reader->pos, sizeof *value);
+    reader->pos += sizeof *value;
+    return true;
+}
+
+// Takes a length and that many bytes, if they have all arrived
+static bool take_field(Reader *reader, const char **data, size_t *len)
+{
+    uint32_t n;
+    if (!take_u32(reader, &n) || reader->len - reader->pos < n)
+        return false;
+    *data = reader->data + reader->pos;
+    *len = n;
+    reader->pos += n;
+    return true;
+}
+
+// True once the whole request is in; a malformed request sets *bad
+static bool request_complete(const Buffer *request, bool *bad)
+{
+    Reader reader = {request->data, request->len, 0};
+    uint32_t kind, script_len, input_len;
+    *bad = false;
+    if (!take_u32(&reader, &kind))
+        return false;
+    if (kind != SERVE_SOURCE && kind != SERVE_PATH)
+    {
+        *bad = true;
+        return false;
+    }
+    if (!take_u32(&reader, &script_len))
+        return false;
+    *bad = script_len > SERVE_MAX_FIELD;
+    if (*bad || reader.len - reader.pos < script_len)
+        return false;
+    reader.pos += script_len;
+    if (!take_u32(&reader, &input_len))
+        return false;
+    *bad = input_len > SERVE_MAX_FIELD;
+    return !*bad && reader.len - reader.pos >= input_len;
+}
+
+// In the child: nothing but the request's own connection stays open
+static void close_others(Server *server, int conn)
+{
+    close(server->listener);
+    for (size_t i = 0; i < server->count; i++)
+    {
+        if (server->pending[i].fd != conn)
+            close(server->pending[i].fd);
+    }
+}
+
+static void handle(Server *server, int conn, const Buffer *request)
+{
+    // request_complete has checked the layout
+    Reader reader = {request->data, request->len, 0};
+    uint32_t kind = SERVE_SOURCE;
+    const char *script = NULL, *input = NULL;
+    size_t script_len = 0, input_len = 0;
+    take_u32(&reader, &kind);
+    take_field(&reader, &script, &script_len);
+    take_field(&reader, &input, &input_len);
+
+    Buffer out = {0}, err = {0};
+    size_t len = script_len;
+    char *source = malloc(script_len + 1);
+    if (source != NULL)
+    {
+        memcpy(source, script, script_len);
+        source[script_len] = '\0';
+    }
+    if (source != NULL && kind == SERVE_PATH)
+    {
+        char *path = source;
+        source = read_source(path, &len);
+        if (source == NULL)
+        {
+            char message[PATH_MAX + 64];
+            snprintf(message, sizeof message, "Cannot open source file: %s\n", strerror(errno));
+            buffer_write(&err, message, strlen(message));
+        }
+        free(path);
+    }
+
+    int exit_code = EXIT_FAILURE;
+    BrainrotStatus status = source ? BRAINROT_SYNTAX_ERROR : BRAINROT_MISUSE;
+    Brainrot *br = source ? lookup(server->cache, source, len, &err, &exit_code) : NULL;
+    if (br == NULL)
+        respond(conn, status, exit_code, &out, &err);
+    else
+    {
+        pid_t pid = fork();
+        if (pid == 0)
+        {
+            close_others(server, conn);
+            run_request(br, conn, input, input_len);
+        }
+        if (pid < 0)
+        {
+            const char *message = "Error: cannot fork to run the program\n";
+            buffer_write(&err, message, strlen(message));
+            respond(conn, BRAINROT_NO_MEMORY, EXIT_FAILURE, &out, &err);
+        }
+    }
+    free(err.data);
+}
+
+static long long now_ms(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static void drop(Server *server, size_t i)
+{
+    close(server->pending[i].fd);
+    free(server->pending[i].request.data);
+    server->pending[i] = server->pending[--server->count];
+}
+
+// Takes whatever the client has sent; runs the request once it is whole
+static void serve_pending(Server *server, size_t i)
+{
+    Pending *p = &server->pending[i];
+    char chunk[1 << 14];
+    for (;;)
+    {
+        ssize_t n = read(p->fd, chunk, sizeof chunk);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+            break;
+        if (n <= 0)
+        {
+            drop(server, i); // hung up or failed before the request was whole
+            return;
+        }
+        buffer_write(&p->request, chunk, (size_t)n);
+        p->deadline = now_ms() + SERVE_IDLE_MS;
+    }
+
+    bool bad;
+    if (request_complete(&p->request, &bad))
+    {
+        // The child answers with blocking writes
+        fcntl(p->fd, F_SETFL, fcntl(p->fd, F_GETFL) & ~O_NONBLOCK);
+        handle(server, p->fd, &p->request);
+        drop(server, i);
+    }
+    else if (bad)
+        drop(server, i);
+}
+
+static void accept_pending(Server *server)
+{
+    int conn = accept(server->listener, NULL, NULL);
+    if (conn < 0)
+        return;
+    if (fcntl(conn, F_SETFL, fcntl(conn, F_GETFL) | O_NONBLOCK) < 0)
+    {
+        close(conn);
+        return;
+    }
+    server->pending[server->count++] = (Pending){conn, {0}, now_ms() + SERVE_IDLE_MS};
+}
+
+static bool socket_address(const char *path, struct sockaddr_un *addr)
+{
+    memset(addr, 0, sizeof *addr);
+    addr->sun_family = AF_UNIX;
+    if (strlen(path) >= sizeof addr->sun_path)
+    {
+        fprintf(stderr, "Error: socket path is too long: %s\n", path);
+        return false;
+    }
+    strcpy(addr->sun_path, path);
+    return true;
+}
+
+/**
+ * @brief Serves run requests on a Unix socket until SIGINT or SIGTERM
+ * @param argc Arguments after --serve, plus one for the flag itself
+ * @param argv "--serve", then <socketpath>
+ * @return 0 after a clean shutdown, 1 if the socket cannot be set up
+ */
+int serve_main(int argc, char *argv[])
+{
+    struct sockaddr_un addr;
+    if (argc != 2)
+    {
+        fprintf(stderr, "Usage: brainrot --serve <socketpath>\n");
+        return 1;
+    }
+    if (!socket_address(argv[1], &addr))
+        return 1;
+
+    // A socket file nobody answers on is left over from a server that died
+    int probe = socket(AF_UNIX, SOCK_STREAM, 0);
+    bool taken = probe >= 0 && connect(probe, (struct sockaddr *)&addr, sizeof addr) == 0;
+    if (probe >= 0)
+        close(probe);
+    if (taken)
+    {
+        fprintf(stderr, "Error: a server is already listening on %s\n", argv[1]);
+        return 1;
+    }
+    unlink(argv[1]);
+
+    int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listener < 0)
+    {
+        perror("Cannot create socket");
+        return 1;
+    }
+    if (bind(listener, (struct sockaddr *)&addr, sizeof addr) < 0 || listen(listener, SOMAXCONN) < 0)
+    {
+        perror("Cannot listen on socket");
+        close(listener);
+        return 1;
+    }
+
+    struct sigaction action = {0};
+    action.sa_handler = stop;
+    sigaction(SIGINT, &action, NULL); // no SA_RESTART, so poll returns
+    sigaction(SIGTERM, &action, NULL);
+    signal(SIGPIPE, SIG_IGN); // clients may hang up before the answer
+    signal(SIGCHLD, SIG_IGN); // children reap themselves
+
+    Server *server = calloc(1, sizeof(Server));
+    CachedProgram *cache = calloc(SERVE_CACHE_SLOTS, sizeof(CachedProgram));
+    if (server != NULL)
+        *server = (Server){.cache = cache, .listener = listener};
+    while (server != NULL && cache != NULL && !stopping)
+    {
+        // New connections wait in the backlog while every slot is taken
+        struct pollfd fds[SERVE_MAX_PENDING + 1];
+        fds[0] = (struct pollfd){listener, server->count < SERVE_MAX_PENDING ? POLLIN : 0, 0};
+        long long timeout = -1, now = now_ms();
+        for (size_t i = 0; i < server->count; i++)
+        {
+            fds[i + 1] = (struct pollfd){server->pending[i].fd, POLLIN, 0};
+            long long left = server->pending[i].deadline - now;
+            if (timeout < 0 || left < timeout)
+                timeout = left > 0 ? left : 0;
+        }
+        if (poll(fds, server->count + 1, (int)timeout) < 0)
+            continue;
+
+        // Backwards, since dropping one moves the last into its place
+        now = now_ms();
+        for (size_t i = server->count; i-- > 0;)
+        {
+            if (fds[i + 1].revents != 0)
+                serve_pending(server, i);
+            else if (server->pending[i].deadline <= now)
+                drop(server, i);
+        }
+        if (fds[0].revents & POLLIN)
+            accept_pending(server);
+    }
+
+    while (server != NULL && server->count > 0)
+        drop(server, server->count - 1);
+    for (size_t i = 0; cache != NULL && i < SERVE_CACHE_SLOTS; i++)
+        uncache(&cache[i]);
+    free(cache);
+    free(server);
+    close(listener);
+    unlink(argv[1]);
+    return 0;
+}
+
+/**
+ * @brief Runs a script on a server started with --serve
+ * @param argc Arguments after --client, plus one for the flag itself
+ * @param argv "--client", then <socketpath> <sourcefile>
+ * @return The script's exit code, or 1 if the server cannot be reached
+ *
+ * Sends the script's absolute path and this process's stdin, unless stdin
+ * is a terminal, and prints the script's output as if it ran here.
+ */
+int client_main(int argc, char *argv[])
+{
+    struct sockaddr_un addr;
+    if (argc != 3)
+    {
+        fprintf(stderr, "Usage: brainrot --client <socketpath> <sourcefile>\n");
+        return 1;
+    }
+    char path[PATH_MAX];
+    if (realpath(argv[2], path) == NULL)
+    {
+        perror("Cannot open source file");
+        return 1;
+    }
+    if (!socket_address(argv[1], &addr))
+        return 1;
+
+    Buffer input = {0};
+    if (!isatty(STDIN_FILENO))
+    {
+        char chunk[1 << 14];
+        ssize_t n;
+        while ((n = read(STDIN_FILENO, chunk, sizeof chunk)) > 0 || (n < 0 && errno == EINTR))
+            buffer_write(&input, chunk, n > 0 ? (size_t)n : 0);
+    }
+
+    int conn = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (conn < 0 || connect(conn, (struct sockaddr *)&addr, sizeof addr) < 0)
+    {
+        perror("Cannot reach server");
+        free(input.data);
+        return 1;
+    }
+    uint32_t status, exit_code;
+    size_t out_len, err_len;
+    char *out = NULL, *err = NULL;
+    bool ok = write_u32(conn, SERVE_PATH) && write_field(conn, path, strlen(path)) &&
+              write_field(conn, input.data, input.len) && read_u32(conn, &status) && read_u32(conn, &exit_code) &&
+              (out = read_field(conn, &out_len)) != NULL && (err = read_field(conn, &err_len)) != NULL;
+    close(conn);
+    free(input.data);
+    if (!ok)
+    {
+        fprintf(stderr, "Error: the server hung up\n");
+        free(out);
+        return 1;
+    }
+
+    fwrite(out, 1, out_len, stdout);
+    fflush(stdout);
+    fwrite(err, 1, err_len, stderr);
+    free(out);
+    free(err);
+    return (int)exit_code;
+}
@@ -0,0 +1,223 @@
+/* shard.c */
+
+#include "brainrot.h"
+#include "cli.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+/*
+ * Runs one program over many input files. The program is parsed once; each
+ * input then gets a child forked from the parsed process, so it starts from
+ * the untouched program with the syntax tree shared copy-on-write, and
+ * nothing in the interpreter needs to know. The parent never runs the
+ * program, so it never starts the work pool before forking.
+ */
+
+// Inputs finished but not yet printed, per job, before starting waits
+#define SHARD_WINDOW_PER_JOB 4
+
+typedef struct
+{
+    const char *input;
+    pid_t pid;
+    FILE *out; // NULL under --out, where the child writes the files itself
+    FILE *err;
+    int exit_code;
+    bool done;
+} ShardRun;
+
+static int open_output(const char *dir, size_t index, const char *suffix)
+{
+    char path[4096];
+    snprintf(path, sizeof path, "%s/%zu.%s", dir, index, suffix);
+    return open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+}
+
+// In the child: point stdin, stdout and stderr at this input's files and run
+static _Noreturn void run_child(Brainrot *br, ShardRun *run, size_t index, const char *out_dir)
+{
+    int out = out_dir ? open_output(out_dir, index, "stdout") : fileno(run->out);
+    int err = out_dir ? open_output(out_dir, index, "stderr") : fileno(run->err);
+    if (out < 0 || err < 0 || dup2(out, STDOUT_FILENO) < 0 || dup2(err, STDERR_FILENO) < 0)
+    {
+        perror("Cannot open shard output");
+        _exit(EXIT_FAILURE);
+    }
+    int in = open(run->input, O_RDONLY);
+    if (in < 0 || dup2(in, STDIN_FILENO) < 0)
+    {
+        perror("Cannot open input file");
+        _exit(EXIT_FAILURE);
+    }
+
+    brainrot_run(br);
+    fflush(stdout);
+    _exit(brainrot_exit_code(br));
+}
+
+static bool start_run(Brainrot *br, ShardRun *run, size_t index, const char *out_dir)
+{
+    if (out_dir == NULL && ((run->out = tmpfile()) == NULL || (run->err = tmpfile()) == NULL))
+        return false;
+    // Buffered output would otherwise be written again by the child
+    fflush(stdout);
+    fflush(stderr);
+    run->pid = fork();
+    if (run->pid == 0)
+        run_child(br, run, index, out_dir);
+    return run->pid > 0;
+}
+
+static void copy_file(FILE *from, FILE *to)
+{
+    char buffer[1 << 14];
+    size_t n;
+    rewind(from);
+    while ((n = fread(buffer, 1, sizeof buffer, from)) > 0)
+        fwrite(buffer, 1, n, to);
+}
+
+static void finish_run(ShardRun *run)
+{
+    if (run->out != NULL)
+    {
+        copy_file(run->out, stdout);
+        fclose(run->out);
+    }
+    if (run->err != NULL)
+    {
+        fflush(stdout);
+        copy_file(run->err, stderr);
+        fclose(run->err);
+    }
+    if (run->exit_code != 0)
+        fprintf(stderr, "%s: exit status %d\n", run->input, run->exit_code);
+    fflush(stdout);
+}
+
+/**
+ * @brief Runs one program once per input file, in forked children
+ * @param argc Arguments after --shard, plus one for the flag itself
+ * @param argv "--shard", then [--jobs N] [--out DIR] <sourcefile> <inputfile>...
+ * @return 0 if every run exited with 0, 1 otherwise
+ *
+ * Each run reads its input file as stdin. Outputs are printed in input
+ * order, or written to DIR/<n>.stdout and DIR/<n>.stderr under --out.
+ */
+int shard_main(int argc, char *argv[])
+{
+    size_t jobs = 0;
+    const char *out_dir = NULL;
+    int first = 1;
+    for (; first < argc && argv[first][0] == '-'; first++)
+    {
+        if (strcmp(argv[first], "--jobs") == 0 && first + 1 < argc)
+        {
+            char *end;
+            long n = strtol(argv[++first], &end, 10);
+            if (*end != '\0' || n < 1)
+            {
+                fprintf(stderr, "Error: --jobs needs a positive count\n");
+                return 1;
+            }
+            jobs = (size_t)n;
+        }
+        else if (strcmp(argv[first], "--out") == 0 && first + 1 < argc)
+            out_dir = argv[++first];
+        else
+            break;
+    }
+    if (argc - first < 2 || argv[first][0] == '-')
+    {
+        fprintf(stderr, "Usage: brainrot --shard [--jobs N] [--out DIR] <sourcefile> <inputfile>...\n");
+        return 1;
+    }
+    if (jobs == 0)
+    {
+        long n = sysconf(_SC_NPROCESSORS_ONLN);
+        jobs = n > 0 ? (size_t)n : 1;
+    }
+
+    size_t len;
+    char *source = read_source(argv[first], &len);
+    if (source == NULL)
+    {
+        perror("Cannot open source file");
+        return 1;
+    }
+    Brainrot *br = brainrot_create();
+    BrainrotStatus parsed = br ? brainrot_parse(br, source, len) : BRAINROT_NO_MEMORY;
+    free(source);
+    if (parsed != BRAINROT_OK)
+    {
+        if (parsed == BRAINROT_NO_MEMORY)
+            fprintf(stderr, "Error: %s\n", brainrot_status_name(parsed));
+        brainrot_destroy(br);
+        return 1;
+    }
+
+    size_t count = (size_t)(argc - first - 1);
+    ShardRun *runs = calloc(count, sizeof(ShardRun));
+    if (runs == NULL)
+    {
+        fprintf(stderr, "Error: %s\n", brainrot_status_name(BRAINROT_NO_MEMORY));
+        brainrot_destroy(br);
+        return 1;
+    }
+    for (size_t i = 0; i < count; i++)
+        runs[i].input = argv[first + 1 + i];
+
+    // Starts runs while jobs are free, reaps one, then prints whatever is
+    // next in order; the window bounds the temporary files held open
+    size_t next = 0, reported = 0, running = 0;
+    bool ok = true;
+    while (reported < count)
+    {
+        while (running < jobs && next < count && next - reported < jobs * SHARD_WINDOW_PER_JOB)
+        {
+            ShardRun *run = &runs[next];
+            if (start_run(br, run, next, out_dir))
+                running++;
+            else
+            {
+                fprintf(stderr, "Cannot start run for %s: %s\n", run->input, strerror(errno));
+                run->exit_code = EXIT_FAILURE;
+                run->done = true;
+            }
+            next++;
+        }
+
+        if (running > 0)
+        {
+            int status;
+            pid_t pid = wait(&status);
+            if (pid < 0 && errno == EINTR)
+                continue;
+            for (size_t i = reported; pid > 0 && i < next; i++)
+            {
+                if (runs[i].pid == pid && !runs[i].done)
+                {
+                    runs[i].exit_code = WIFEXITED(status) ? WEXITSTATUS(status) : 128 + WTERMSIG(status);
+                    runs[i].done = true;
+                    running--;
+                    break;
+                }
+            }
+        }
+        while (reported < next && runs[reported].done)
+        {
+            ok &= runs[reported].exit_code == 0;
+            finish_run(&runs[reported++]);
+        }
+    }
+
+    free(runs);
+    brainrot_destroy(br);
+    return ok ? 0 : 1;
+}
@@ -2,6 +2,9 @@ import subprocess
 import json
 import os
 import pytest
+import socket
+import struct
+import time
 
 # Get the absolute path to the directory containing the script
 script_dir = os.path.dirname(__file__)
@@ -13,31 +16,42 @@ file_path = os.path.join(script_dir, "expected_results.json")
 with open(file_path, "r") as file:
     expected_results = json.load(file)
 
+# What each example reads from stdin, by name prefix
+stdin_inputs = {
+    "slorp_int": "42\n",
+    "slorp_short": "69\n",
+    "slorp_float": "3.14\n",
+    "slorp_double": "3.141592\n",
+    "slorp_char": "c\n",
+    "slorp_string": "skibidi bop bop yes yes\n",
+    "read_csv": "x,y,label\n1,2.5,a\n 3 , -4e1 ,b\r\n\n5,\"6\",c\n",
+    "slorp_array": "10 -20\n  30\n1.5 2.25\n-3e2 0.125 1e-3\n",
+}
+
+
+def stdin_for(example):
+    return next((text for prefix, text in stdin_inputs.items() if example.startswith(prefix)), None)
+
+
+def combined_output(stdout, stderr, expected_output):
+    actual_output = stdout.strip() if stdout.strip() else stderr.strip()
+    if "Stderr:" in expected_output and stdout.strip():
+        actual_output = f"{stdout.strip()}\nStderr:\n{stderr.strip()}"
+    return actual_output
+
+
 @pytest.mark.parametrize("example,expected_output", expected_results.items())
 def test_brainrot_examples(example, expected_output):
     brainrot_path = os.path.abspath(os.path.join(script_dir, "../brainrot"))
     example_file_path = os.path.abspath(os.path.join(script_dir, f"../test_cases/{example}.brainrot"))
 
-    if example.startswith("slorp_int"):
-        command = f"echo '42' | {brainrot_path} {example_file_path}"
-    elif example.startswith("slorp_short"):
-        command = f"echo '69' | {brainrot_path} {example_file_path}"
-    elif example.startswith("slorp_float"):
-        command = f"echo '3.14' | {brainrot_path} {example_file_path}"
-    elif example.startswith("slorp_double"):
-        command = f"echo '3.141592' | {brainrot_path} {example_file_path}"
-    elif example.startswith("slorp_char"):
-        command = f"echo 'c' | {brainrot_path} {example_file_path}"
-    elif example.startswith("slorp_string"):
-        command = f"echo 'skibidi bop bop yes yes' | {brainrot_path} {example_file_path}"
-    else:
-        command = f"{brainrot_path} {example_file_path}"
-
-    result = subprocess.run(command, stdout=subprocess.PIPE, stderr=subprocess.PIPE, text=True, shell=True)
-    actual_output = result.stdout.strip() if result.stdout.strip() else result.stderr.strip()
-
-    if "Stderr:" in expected_output and result.stdout.strip():
-        actual_output = f"{result.stdout.strip()}\nStderr:\n{result.stderr.strip()}"
+    env = dict(os.environ)
+    if example.startswith(("squad", "auto_parallel", "spawn", "channels")):
+        env["BRAINROT_THREADS"] = "4"
+
+    result = subprocess.run([brainrot_path, example_file_path], input=stdin_for(example) or "",
+                            stdout=subprocess.PIPE, stderr=subprocess.PIPE, text=True, env=env)
+    actual_output = combined_output(result.stdout, result.stderr, expected_output)
 
     assert actual_output == expected_output.strip(), (
         f"Output for {example} did not match.\n"
@@ -51,5 +65,103 @@ def test_brainrot_examples(example, expected_output):
             f"Stderr:\n{result.stderr}"
         )
 
+
+@pytest.mark.parametrize("jobs", [1, 8])
+def test_batch_mode(tmp_path, jobs):
+    brainrot_path = os.path.abspath(os.path.join(script_dir, "../brainrot"))
+    lines = []
+    for example in expected_results:
+        line = os.path.abspath(os.path.join(script_dir, f"../test_cases/{example}.brainrot"))
+        if stdin_for(example) is not None:
+            input_path = tmp_path / f"{example}.in"
+            input_path.write_text(stdin_for(example))
+            line += f" {input_path}"
+        lines.append(line)
+    list_path = tmp_path / "scripts.txt"
+    list_path.write_text("# every example, run in one process\n" + "\n".join(lines) + "\n")
+
+    env = dict(os.environ, BRAINROT_THREADS="4")
+    result = subprocess.run([brainrot_path, "--batch", "--jobs", str(jobs), str(list_path)],
+                            stdout=subprocess.PIPE, stderr=subprocess.PIPE, text=True, env=env)
+    manifest = [json.loads(line) for line in result.stdout.splitlines()]
+    assert [entry["script"] for entry in manifest] == [line.split(" ")[0] for line in lines]
+
+    for (example, expected_output), entry in zip(expected_results.items(), manifest):
+        actual_output = combined_output(entry["stdout"], entry["stderr"], expected_output)
+        assert actual_output == expected_output.strip(), (
+            f"Batch output for {example} did not match.\n"
+            f"Expected:\n{expected_output}\n"
+            f"Actual:\n{actual_output}"
+        )
+        if "Error:" not in expected_output:
+            assert entry["exit"] == 0, f"{example} exited with {entry['exit']} ({entry['status']})"
+
+def test_shard_mode(tmp_path):
+    brainrot_path = os.path.abspath(os.path.join(script_dir, "../brainrot"))
+    example_file_path = os.path.abspath(os.path.join(script_dir, "../test_cases/slorp_int.brainrot"))
+    inputs = []
+    for i in range(20):
+        input_path = tmp_path / f"{i}.in"
+        input_path.write_text(f"{i * 7}\n")
+        inputs.append(str(input_path))
+    inputs.append(str(tmp_path / "missing.in"))
+
+    result = subprocess.run([brainrot_path, "--shard", "--jobs", "3", example_file_path] + inputs,
+                            stdout=subprocess.PIPE, stderr=subprocess.PIPE, text=True)
+    assert result.stdout == "".join(f"You typed: {i * 7}\n" for i in range(20))
+    assert "Cannot open input file" in result.stderr
+    assert result.stderr.endswith(f"{inputs[-1]}: exit status 1\n")
+    assert result.returncode == 1
+
+def test_serve_mode(tmp_path):
+    brainrot_path = os.path.abspath(os.path.join(script_dir, "../brainrot"))
+    socket_path = str(tmp_path / "brainrot.sock")
+    server = subprocess.Popen([brainrot_path, "--serve", socket_path])
+    try:
+        for _ in range(100):
+            if os.path.exists(socket_path):
+                break
+            time.sleep(0.05)
+
+        # A client that stalls partway through its request holds up nobody else
+        idle = socket.socket(socket.AF_UNIX)
+        idle.connect(socket_path)
+        idle.sendall(struct.pack("=II", 0, 100))
+
+        # Each example twice, so the second run comes from the cache
+        examples = ["hello_world", "slorp_int", "func-modifier", "squad_error", "fib"]
+        for example in examples:
+            example_file_path = os.path.abspath(os.path.join(script_dir, f"../test_cases/{example}.brainrot"))
+            expected_output = expected_results[example]
+            for _ in range(2):
+                result = subprocess.run([brainrot_path, "--client", socket_path, example_file_path],
+                                        input=stdin_for(example) or "", stdout=subprocess.PIPE,
+                                        stderr=subprocess.PIPE, text=True, timeout=10)
+                actual_output = combined_output(result.stdout, result.stderr, expected_output)
+                assert actual_output == expected_output.strip(), (
+                    f"Served output for {example} did not match.\n"
+                    f"Expected:\n{expected_output}\n"
+                    f"Actual:\n{actual_output}"
+                )
+                if "Error:" not in expected_output:
+                    assert result.returncode == 0
+
+        # Clients may also send the source itself
+        source = b'skibidi main { rizz x = 0; slorp(x); yapping("%d", x * 2); }\n'
+        stdin = b"21\n"
+        with socket.socket(socket.AF_UNIX) as conn:
+            conn.connect(socket_path)
+            conn.sendall(struct.pack("=II", 0, len(source)) + source + struct.pack("=I", len(stdin)) + stdin)
+            response = b""
+            while chunk := conn.recv(65536):
+                response += chunk
+        status, exit_code, out_len = struct.unpack("=IiI", response[:12])
+        assert (status, exit_code, response[12:12 + out_len]) == (0, 0, b"42\n")
+        idle.close()
+    finally:
+        server.terminate()
+        server.wait(timeout=10)
+    assert not os.path.exists(socket_path)
+
 if __name__ == "__main__":
     pytest.main(["-v", os.path.abspath(__file__)])